@@ -54,6 +54,7 @@ Application::Application(char *infile) {
 	en1 = new EmulNet(par);
 	mp1 = (MP1Node **) malloc(par->EN_GPSZ * sizeof(MP1Node *));
 	mp2 = (MP2Node **) malloc(par->EN_GPSZ * sizeof(MP2Node *));
+	hintedNode = -1;
 
 	/*
 	 * Init all nodes
@@ -323,6 +324,123 @@ void Application::mp2Run() {
 			updateTest();
 		} // End of update test
 
+		/************
+		 * TTL TESTS
+		 ************/
+		/**
+		 * TEST 1: Create a key and update another one with a TTL. Read both before the TTL is over.
+		 * 		   Check for their values being read in quorum of replicas
+		 *
+		 * Wait until the TTL is over
+		 *
+		 * TEST 2: Read both keys again. Check for RF+1 or QUORUM+1 READ FAIL messages of each in the log
+		 *
+		 */
+		else if ( par->getcurrtime() >= TEST_TIME && TTL_TEST == par->CRUDTEST ) {
+			ttlTest();
+		} // End of ttl test
+
+		/****************
+		 * READ AT TESTS
+		 ****************/
+		/**
+		 * TEST 1: Update a key, then read it at a time before the update.
+		 * 		   Check for the value it had then being read in quorum of replicas
+		 *
+		 * TEST 2: Read the key at a time before it was created. Check for RF+1 or QUORUM+1 READ FAIL messages in the log
+		 *
+		 */
+		else if ( par->getcurrtime() >= TEST_TIME && READ_AT_TEST == par->CRUDTEST ) {
+			readAtTest();
+		} // End of read at test
+
+		/*************
+		 * SCAN TESTS
+		 *************/
+		/**
+		 * Update a key, then scan the whole ring SCAN_PAGE_SIZE keys at a time
+		 *
+		 * TEST 1: Check that the scan is done and that no page failed
+		 * TEST 2: Check that every key is listed exactly once, with its newest value
+		 * TEST 3: Check that ranges holding more than a page continued after the last key of a page
+		 *
+		 */
+		else if ( par->getcurrtime() >= TEST_TIME && SCAN_TEST == par->CRUDTEST ) {
+			scanTest();
+		} // End of scan test
+
+		/********************
+		 * MEMORY FULL TESTS
+		 ********************/
+		/**
+		 * Create FULL_INSERTS more keys, FULL_INSERTS_PER_TICK at a time, until the memory cap of every node is reached
+		 *
+		 * TEST 1: Check that the nodes reported reaching their cap, and that the coordinators got REPLY_FULL
+		 * TEST 2: Create one more key. Check for its CREATE FAIL message in the log
+		 * TEST 3: Read a key created before the cap was reached. Check for its value being read in quorum of replicas
+		 *
+		 */
+		else if ( par->getcurrtime() >= TEST_TIME && FULL_TEST == par->CRUDTEST ) {
+			memoryFullTest();
+		} // End of memory full test
+
+		/****************
+		 * RESTART TESTS
+		 ****************/
+		/**
+		 * Update a key, then restart the storage of its primary replica, which recovers from its directory
+		 *
+		 * TEST 1: Check that the restarted node recovered as many keys as it held
+		 * TEST 2: Read the key. Check for its new value being read in quorum of replicas, the restarted one included
+		 *
+		 */
+		else if ( par->getcurrtime() >= TEST_TIME && RESTART_TEST == par->CRUDTEST ) {
+			restartTest();
+		} // End of restart test
+
+		/*************
+		 * LOAD TESTS
+		 *************/
+		/**
+		 * Create LOAD_INSERTS keys, read LOAD_HOT_KEYS of them LOAD_HOT_READS times each, then overwrite them all,
+		 * so that a small memtable flushes many tables and the engine compacts them
+		 *
+		 * TEST 1: Check the statistics the nodes logged after their compactions
+		 * TEST 2: Read LOAD_CHECKS keys. Check for their new values being read in quorum of replicas
+		 *
+		 */
+		else if ( par->getcurrtime() >= TEST_TIME && LOAD_TEST == par->CRUDTEST ) {
+			loadTest();
+		} // End of load test
+
+		/*************
+		 * HINT TESTS
+		 *************/
+		/**
+		 * Fail a replica of a key, update the key while the replica is down, then recover the replica
+		 *
+		 * TEST 1: Check that the coordinator replayed its hints to the recovered replica
+		 * TEST 2: Read the key. Check for its new value being read in quorum of replicas, the recovered one included
+		 *
+		 */
+		else if ( par->getcurrtime() >= TEST_TIME && HINT_TEST == par->CRUDTEST ) {
+			hintTest();
+		} // End of hint test
+
+		/***************
+		 * REPAIR TESTS
+		 ***************/
+		/**
+		 * Write a key to its primary replica only, then let anti-entropy compare the replicas
+		 *
+		 * TEST 1: Check that the replicas found their Merkle trees differ
+		 * TEST 2: Read the key. Check for its value being read on every replica
+		 *
+		 */
+		else if ( par->getcurrtime() >= TEST_TIME && REPAIR_TEST == par->CRUDTEST ) {
+			repairTest();
+		} // End of repair test
+
 	} // end of if ( par->getcurrtime == TEST_TIME)
 }
 
@@ -962,3 +1080,393 @@ void Application::updateTest() {
 	/** end of test 5 **/
 
 }
+
+/**
+ * FUNCTION NAME: ttlTest
+ *
+ * DESCRIPTION: Tests the TTL of the create and update APIs of the KV store
+ */
+void Application::ttlTest() {
+	// Step 0. Keys written with a TTL: a new key, and a test key that gets updated
+	map<string, string>::iterator it = testKVPairs.begin();
+	string ttlKey = "ttlKey";
+	string ttlValue = "ttlValue";
+	string newValue = "newValue";
+	int number;
+
+	/**
+	 * Test 1: Write the keys with a TTL, and read them before it is over
+	 */
+	if ( par->getcurrtime() == TEST_TIME ) {
+		// Step 1.a. Create a key with a TTL
+		number = findARandomNodeThatIsAlive();
+		cout<<endl<<"Creating a key with a TTL.... ... .. . ."<<endl;
+		log->LOG(&mp2[number]->getMemberNode()->addr, "CREATE OPERATION KEY: %s VALUE: %s TTL: %d at time: %d", ttlKey.c_str(), ttlValue.c_str(), TTL_TIME, par->getcurrtime());
+		mp2[number]->clientCreate(ttlKey, ttlValue, TTL_TIME);
+
+		// Step 1.b. Update a key with a TTL
+		number = findARandomNodeThatIsAlive();
+		cout<<endl<<"Updating a valid key with a TTL.... ... .. . ."<<endl;
+		log->LOG(&mp2[number]->getMemberNode()->addr, "UPDATE OPERATION KEY: %s VALUE: %s TTL: %d at time: %d", it->first.c_str(), newValue.c_str(), TTL_TIME, par->getcurrtime());
+		mp2[number]->clientUpdate(it->first, newValue, TTL_TIME);
+	}
+
+	if ( par->getcurrtime() == (TEST_TIME + TTL_TIME / 2) ) {
+		// Step 1.c. Read both keys
+		number = findARandomNodeThatIsAlive();
+		cout<<endl<<"Reading keys before their TTL is over.... ... .. . ."<<endl;
+		log->LOG(&mp2[number]->getMemberNode()->addr, "READ OPERATION KEY: %s VALUE: %s at time: %d", ttlKey.c_str(), ttlValue.c_str(), par->getcurrtime());
+		mp2[number]->clientRead(ttlKey);
+		log->LOG(&mp2[number]->getMemberNode()->addr, "READ OPERATION KEY: %s VALUE: %s at time: %d", it->first.c_str(), newValue.c_str(), par->getcurrtime());
+		mp2[number]->clientRead(it->first);
+	}
+
+	/** end of test 1 **/
+
+	/**
+	 * Test 2: Read the keys once their TTL is over. The reads should fail
+	 */
+	if ( par->getcurrtime() == (TEST_TIME + 2 * TTL_TIME) ) {
+		number = findARandomNodeThatIsAlive();
+		cout<<endl<<"Reading expired keys.... ... .. . ."<<endl;
+		log->LOG(&mp2[number]->getMemberNode()->addr, "READ OPERATION KEY: %s at time: %d", ttlKey.c_str(), par->getcurrtime());
+		mp2[number]->clientRead(ttlKey);
+		log->LOG(&mp2[number]->getMemberNode()->addr, "READ OPERATION KEY: %s at time: %d", it->first.c_str(), par->getcurrtime());
+		mp2[number]->clientRead(it->first);
+	}
+
+	/** end of test 2 **/
+}
+
+/**
+ * FUNCTION NAME: readAtTest
+ *
+ * DESCRIPTION: Tests the reads of the KV store at a past time. Needs MAX_VERSIONS > 1.
+ */
+void Application::readAtTest() {
+	// Step 0. Key to be updated, then read as it was before
+	map<string, string>::iterator it = testKVPairs.begin();
+	string newValue = "newValue";
+	int number;
+
+	if ( par->getcurrtime() == TEST_TIME ) {
+		number = findARandomNodeThatIsAlive();
+		cout<<endl<<"Updating a valid key.... ... .. . ."<<endl;
+		log->LOG(&mp2[number]->getMemberNode()->addr, "UPDATE OPERATION KEY: %s VALUE: %s at time: %d", it->first.c_str(), newValue.c_str(), par->getcurrtime());
+		mp2[number]->clientUpdate(it->first, newValue);
+	}
+
+	/**
+	 * Test 1: Read the key at a time after it was created and before it was updated
+	 */
+	if ( par->getcurrtime() == (TEST_TIME + FIRST_FAIL_TIME) ) {
+		number = findARandomNodeThatIsAlive();
+		cout<<endl<<"Reading a valid key at a past time.... ... .. . ."<<endl;
+		log->LOG(&mp2[number]->getMemberNode()->addr, "READ OPERATION KEY: %s VALUE: %s TIMESTAMP: %d at time: %d", it->first.c_str(), it->second.c_str(), TEST_TIME - 1, par->getcurrtime());
+		mp2[number]->clientRead(it->first, TEST_TIME - 1);
+	}
+
+	/** end of test 1 **/
+
+	/**
+	 * Test 2: Read the key at a time before it was created. The read should fail
+	 */
+	if ( par->getcurrtime() == (TEST_TIME + 2 * FIRST_FAIL_TIME) ) {
+		number = findARandomNodeThatIsAlive();
+		cout<<endl<<"Reading a valid key before it was created.... ... .. . ."<<endl;
+		log->LOG(&mp2[number]->getMemberNode()->addr, "READ OPERATION KEY: %s TIMESTAMP: %d at time: %d", it->first.c_str(), INSERT_TIME - 1, par->getcurrtime());
+		mp2[number]->clientRead(it->first, INSERT_TIME - 1);
+	}
+
+	/** end of test 2 **/
+}
+
+/**
+ * FUNCTION NAME: scanTest
+ *
+ * DESCRIPTION: Tests the SCAN API of the KV store
+ */
+void Application::scanTest() {
+	// Step 0. Key updated before the scan, so that the scan has to pick its newest value
+	map<string, string>::iterator it = testKVPairs.begin();
+	string newValue = "newValue";
+	int number;
+
+	if ( par->getcurrtime() == TEST_TIME ) {
+		number = findARandomNodeThatIsAlive();
+		cout<<endl<<"Updating a valid key.... ... .. . ."<<endl;
+		log->LOG(&mp2[number]->getMemberNode()->addr, "UPDATE OPERATION KEY: %s VALUE: %s at time: %d", it->first.c_str(), newValue.c_str(), par->getcurrtime());
+		mp2[number]->clientUpdate(it->first, newValue);
+		testKVPairs[it->first] = newValue;
+	}
+
+	if ( par->getcurrtime() == (TEST_TIME + FIRST_FAIL_TIME) ) {
+		number = findARandomNodeThatIsAlive();
+		cout<<endl<<"Scanning the ring.... ... .. . ."<<endl;
+		log->LOG(&mp2[number]->getMemberNode()->addr, "SCAN OPERATION FROM: %d TO: %d PAGE: %d at time: %d", 0, RING_SIZE - 1, SCAN_PAGE_SIZE, par->getcurrtime());
+		mp2[number]->clientScan(0, RING_SIZE - 1, SCAN_PAGE_SIZE);
+	}
+}
+
+/**
+ * FUNCTION NAME: memoryFullTest
+ *
+ * DESCRIPTION: Tests the KV store once the memory cap of its nodes is reached. Needs a small MEMORY_CAP.
+ */
+void Application::memoryFullTest() {
+	map<string, string>::iterator it = testKVPairs.begin();
+	int number;
+	int time = par->getcurrtime() - TEST_TIME;
+	char key[32];
+	char value[32];
+
+	// Step 0. Fill the nodes up
+	if ( time < FULL_INSERTS / FULL_INSERTS_PER_TICK ) {
+		for ( int i = time * FULL_INSERTS_PER_TICK; i < (time + 1) * FULL_INSERTS_PER_TICK; i++ ) {
+			sprintf(key, "fullKey%04d", i);
+			sprintf(value, "fullValue%04d", i);
+			number = findARandomNodeThatIsAlive();
+			log->LOG(&mp2[number]->getMemberNode()->addr, "CREATE OPERATION KEY: %s VALUE: %s at time: %d", key, value, par->getcurrtime());
+			mp2[number]->clientCreate(key, value);
+		}
+	}
+
+	/**
+	 * Test 2: Create one more key. The create should fail
+	 */
+	if ( time == FULL_INSERTS / FULL_INSERTS_PER_TICK + FIRST_FAIL_TIME ) {
+		string lateKey = "fullKeyLate";
+		string lateValue = "fullValueLate";
+		number = findARandomNodeThatIsAlive();
+		cout<<endl<<"Creating a key once the nodes are full.... ... .. . ."<<endl;
+		log->LOG(&mp2[number]->getMemberNode()->addr, "CREATE OPERATION KEY: %s VALUE: %s at time: %d", lateKey.c_str(), lateValue.c_str(), par->getcurrtime());
+		mp2[number]->clientCreate(lateKey, lateValue);
+	}
+
+	/** end of test 2 **/
+
+	/**
+	 * Test 3: Read a key created before the nodes were full
+	 */
+	if ( time == FULL_INSERTS / FULL_INSERTS_PER_TICK + 2 * FIRST_FAIL_TIME ) {
+		number = findARandomNodeThatIsAlive();
+		cout<<endl<<"Reading a valid key once the nodes are full.... ... .. . ."<<endl;
+		log->LOG(&mp2[number]->getMemberNode()->addr, "READ OPERATION KEY: %s VALUE: %s at time: %d", it->first.c_str(), it->second.c_str(), par->getcurrtime());
+		mp2[number]->clientRead(it->first);
+	}
+
+	/** end of test 3 **/
+}
+
+/**
+ * FUNCTION NAME: restartTest
+ *
+ * DESCRIPTION: Tests the recovery of a restarted node. Needs a commit log or snapshots.
+ */
+void Application::restartTest() {
+	map<string, string>::iterator it = testKVPairs.begin();
+	string newValue = "newValue";
+	vector<Node> replicas;
+	int number;
+
+	if ( par->getcurrtime() == TEST_TIME ) {
+		number = findARandomNodeThatIsAlive();
+		cout<<endl<<"Updating a valid key.... ... .. . ."<<endl;
+		log->LOG(&mp2[number]->getMemberNode()->addr, "UPDATE OPERATION KEY: %s VALUE: %s at time: %d", it->first.c_str(), newValue.c_str(), par->getcurrtime());
+		mp2[number]->clientUpdate(it->first, newValue);
+	}
+
+	/**
+	 * Test 1: Restart the primary replica of the key
+	 */
+	if ( par->getcurrtime() == (TEST_TIME + FIRST_FAIL_TIME) ) {
+		number = findARandomNodeThatIsAlive();
+		replicas = mp2[number]->findNodes(it->first);
+		for ( int i = 0; i < par->EN_GPSZ; i++ ) {
+			if ( mp2[i]->getMemberNode()->addr.getAddress() == replicas.at(PRIMARY).getAddress()->getAddress() ) {
+				cout<<endl<<"Restarting a replica node"<<endl;
+				log->LOG(&mp2[i]->getMemberNode()->addr, "Node restarted at time=%d", par->getcurrtime());
+				mp2[i]->restart();
+				break;
+			}
+		}
+	}
+
+	/** end of test 1 **/
+
+	/**
+	 * Test 2: Read the key once the replica is back
+	 */
+	if ( par->getcurrtime() == (TEST_TIME + 2 * FIRST_FAIL_TIME) ) {
+		number = findARandomNodeThatIsAlive();
+		cout<<endl<<"Reading a valid key.... ... .. . ."<<endl;
+		log->LOG(&mp2[number]->getMemberNode()->addr, "READ OPERATION KEY: %s VALUE: %s at time: %d", it->first.c_str(), newValue.c_str(), par->getcurrtime());
+		mp2[number]->clientRead(it->first);
+	}
+
+	/** end of test 2 **/
+}
+
+/**
+ * FUNCTION NAME: loadTest
+ *
+ * DESCRIPTION: Loads the KV store with enough writes for its storage engine to flush and compact. Needs a small MEMTABLE_SIZE.
+ */
+void Application::loadTest() {
+	int number;
+	int time = par->getcurrtime() - TEST_TIME;
+	int updateTime = 2 * FIRST_FAIL_TIME;
+	char key[32];
+	char value[32];
+
+	// Step 0. Create the keys
+	if ( time < LOAD_INSERTS / LOAD_INSERTS_PER_TICK ) {
+		for ( int i = time * LOAD_INSERTS_PER_TICK; i < (time + 1) * LOAD_INSERTS_PER_TICK; i++ ) {
+			sprintf(key, "loadKey%04d", i);
+			sprintf(value, "loadValue%04d", i);
+			number = findARandomNodeThatIsAlive();
+			log->LOG(&mp2[number]->getMemberNode()->addr, "CREATE OPERATION KEY: %s VALUE: %s at time: %d", key, value, par->getcurrtime());
+			mp2[number]->clientCreate(key, value);
+		}
+	}
+
+	// Step 1. Read a few hot keys over and over, so that the caches of the engine get hit
+	if ( time == FIRST_FAIL_TIME ) {
+		cout<<endl<<"Reading hot keys.... ... .. . ."<<endl;
+		for ( int i = 0; i < LOAD_HOT_KEYS * LOAD_HOT_READS; i++ ) {
+			sprintf(key, "loadKey%04d", i % LOAD_HOT_KEYS);
+			sprintf(value, "loadValue%04d", i % LOAD_HOT_KEYS);
+			number = findARandomNodeThatIsAlive();
+			log->LOG(&mp2[number]->getMemberNode()->addr, "READ OPERATION KEY: %s VALUE: %s at time: %d", key, value, par->getcurrtime());
+			mp2[number]->clientRead(key);
+		}
+	}
+
+	// Step 2. Overwrite every key, so that the engine compacts the tables holding the old values
+	if ( time >= updateTime && time < updateTime + LOAD_INSERTS / LOAD_INSERTS_PER_TICK ) {
+		for ( int i = (time - updateTime) * LOAD_INSERTS_PER_TICK; i < (time - updateTime + 1) * LOAD_INSERTS_PER_TICK; i++ ) {
+			sprintf(key, "loadKey%04d", i);
+			sprintf(value, "loadUpdate%04d", i);
+			number = findARandomNodeThatIsAlive();
+			log->LOG(&mp2[number]->getMemberNode()->addr, "UPDATE OPERATION KEY: %s VALUE: %s at time: %d", key, value, par->getcurrtime());
+			mp2[number]->clientUpdate(key, value);
+		}
+	}
+
+	/**
+	 * Test 2: Read back some of the overwritten keys
+	 */
+	if ( time == updateTime + STABILIZE_TIME ) {
+		cout<<endl<<"Reading overwritten keys.... ... .. . ."<<endl;
+		for ( int i = 0; i < LOAD_CHECKS; i++ ) {
+			sprintf(key, "loadKey%04d", i * (LOAD_INSERTS / LOAD_CHECKS));
+			sprintf(value, "loadUpdate%04d", i * (LOAD_INSERTS / LOAD_CHECKS));
+			number = findARandomNodeThatIsAlive();
+			log->LOG(&mp2[number]->getMemberNode()->addr, "READ OPERATION KEY: %s VALUE: %s at time: %d", key, value, par->getcurrtime());
+			mp2[number]->clientRead(key);
+		}
+	}
+
+	/** end of test 2 **/
+}
+
+/**
+ * FUNCTION NAME: hintTest
+ *
+ * DESCRIPTION: Tests hinted handoff to a replica that misses a write while it is down. Needs a HINT_WINDOW.
+ */
+void Application::hintTest() {
+	map<string, string>::iterator it = testKVPairs.begin();
+	string newValue = "newValue";
+	vector<Node> replicas;
+	int number;
+
+	/**
+	 * Test 1: Fail the primary replica of the key, update the key once the failure is detected,
+	 * then recover the replica before it is removed from the ring
+	 */
+	if ( par->getcurrtime() == TEST_TIME ) {
+		number = findARandomNodeThatIsAlive();
+		replicas = mp2[number]->findNodes(it->first);
+		for ( int i = 0; i < par->EN_GPSZ; i++ ) {
+			if ( mp2[i]->getMemberNode()->addr.getAddress() == replicas.at(PRIMARY).getAddress()->getAddress() ) {
+				hintedNode = i;
+				cout<<endl<<"Failing a replica node"<<endl;
+				log->LOG(&mp2[i]->getMemberNode()->addr, "Node failed at time=%d", par->getcurrtime());
+				mp2[i]->getMemberNode()->bFailed = true;
+				mp1[i]->getMemberNode()->bFailed = true;
+				break;
+			}
+		}
+	}
+
+	if ( par->getcurrtime() == (TEST_TIME + 2 * TFAIL) ) {
+		number = findARandomNodeThatIsAlive();
+		cout<<endl<<"Updating a key with a failed replica.... ... .. . ."<<endl;
+		log->LOG(&mp2[number]->getMemberNode()->addr, "UPDATE OPERATION KEY: %s VALUE: %s at time: %d", it->first.c_str(), newValue.c_str(), par->getcurrtime());
+		mp2[number]->clientUpdate(it->first, newValue);
+	}
+
+	if ( par->getcurrtime() == (TEST_TIME + 3 * TFAIL) && hintedNode >= 0 ) {
+		cout<<endl<<"Recovering the replica node"<<endl;
+		log->LOG(&mp2[hintedNode]->getMemberNode()->addr, "Node recovered at time=%d", par->getcurrtime());
+		mp2[hintedNode]->getMemberNode()->bFailed = false;
+		mp1[hintedNode]->getMemberNode()->bFailed = false;
+	}
+
+	/** end of test 1 **/
+
+	/**
+	 * Test 2: Read the key once the hints were replayed
+	 */
+	if ( par->getcurrtime() == (TEST_TIME + 2 * FIRST_FAIL_TIME) ) {
+		number = findARandomNodeThatIsAlive();
+		cout<<endl<<"Reading a valid key.... ... .. . ."<<endl;
+		log->LOG(&mp2[number]->getMemberNode()->addr, "READ OPERATION KEY: %s VALUE: %s at time: %d", it->first.c_str(), newValue.c_str(), par->getcurrtime());
+		mp2[number]->clientRead(it->first);
+	}
+
+	/** end of test 2 **/
+}
+
+/**
+ * FUNCTION NAME: repairTest
+ *
+ * DESCRIPTION: Tests anti-entropy repair of a key only one replica holds. Needs a REPAIR_PERIOD.
+ */
+void Application::repairTest() {
+	string key = "repairKey";
+	string value = "repairValue";
+	vector<Node> replicas;
+	int number;
+
+	/**
+	 * Test 1: Write a key to its primary replica only, as if the writes to the other replicas were lost
+	 */
+	if ( par->getcurrtime() == TEST_TIME ) {
+		number = findARandomNodeThatIsAlive();
+		replicas = mp2[number]->findNodes(key);
+		for ( int i = 0; i < par->EN_GPSZ; i++ ) {
+			if ( mp2[i]->getMemberNode()->addr.getAddress() == replicas.at(PRIMARY).getAddress()->getAddress() ) {
+				cout<<endl<<"Writing a key to one replica only"<<endl;
+				log->LOG(&mp2[i]->getMemberNode()->addr, "Key %s written to this replica only at time=%d", key.c_str(), par->getcurrtime());
+				mp2[i]->createKeyValue(key, value, PRIMARY);
+				break;
+			}
+		}
+	}
+
+	/** end of test 1 **/
+
+	/**
+	 * Test 2: Read the key once the replicas had time to repair it
+	 */
+	if ( par->getcurrtime() == (TEST_TIME + FIRST_FAIL_TIME) ) {
+		number = findARandomNodeThatIsAlive();
+		cout<<endl<<"Reading a repaired key.... ... .. . ."<<endl;
+		log->LOG(&mp2[number]->getMemberNode()->addr, "READ OPERATION KEY: %s VALUE: %s at time: %d", key.c_str(), value.c_str(), par->getcurrtime());
+		mp2[number]->clientRead(key);
+	}
+
+	/** end of test 2 **/
+}
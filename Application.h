@@ -40,6 +40,15 @@ static const char alphanum[] =
 #define RF 3
 #define NUMBER_OF_INSERTS 100
 #define KEY_LENGTH 5
+#define TTL_TIME 20
+#define SCAN_PAGE_SIZE 4
+#define FULL_INSERTS 3000
+#define FULL_INSERTS_PER_TICK 100
+#define LOAD_INSERTS 1000
+#define LOAD_INSERTS_PER_TICK 50
+#define LOAD_HOT_KEYS 5
+#define LOAD_HOT_READS 4
+#define LOAD_CHECKS 10
 
 /**
  * CLASS NAME: Application
@@ -58,6 +67,8 @@ private:
 	MP2Node **mp2;
 	Params *par;
 	map<string, string> testKVPairs;
+	// Node the hint test fails and recovers, -1 until it fails one
+	int hintedNode;
 public:
 	Application(char *);
 	virtual ~Application();
@@ -72,6 +83,14 @@ public:
 	void deleteTest();
 	void readTest();
 	void updateTest();
+	void ttlTest();
+	void readAtTest();
+	void scanTest();
+	void memoryFullTest();
+	void restartTest();
+	void loadTest();
+	void hintTest();
+	void repairTest();
 };
 
 #endif /* _APPLICATION_H__ */
@@ -0,0 +1,320 @@
+/**********************************
+ * FILE NAME: Arena.cpp
+ *
+ * DESCRIPTION: Storage engine Arena class definition
+ **********************************/
+
+#include "Arena.h"
+
+/*
+ * Value size classes, spaced so that a block wastes at most a third of its size
+ */
+static const size_t classSizes[ARENA_SIZE_CLASSES] = {
+	16, 32, 48, 64, 96, 128, 192, 256, 384, 512, 768, 1024, 1536, 2048, 3072, ARENA_MAX_CLASS_SIZE
+};
+
+/**
+ * Constructor
+ */
+Arena::Arena(): keyChunk(NULL), keyChunkUsed(0), reservedBytes(0), liveKeyBytes(0), deadKeyBytes(0),
+		liveValueBytes(0), freeValueBytes(0), largeValueBytes(0), generation(0) {
+	for ( int i = 0; i < ARENA_SIZE_CLASSES; i++ ) {
+		slab[i] = NULL;
+		slabUsed[i] = 0;
+		freeList[i] = NULL;
+	}
+}
+
+/**
+ * Destructor
+ *
+ * Large values are owned by their records, the arena only frees its chunks
+ */
+Arena::~Arena() {
+	for ( unsigned int i = 0; i < chunks.size(); i++ ) {
+		free(chunks[i]);
+	}
+	for ( unsigned int i = 0; i < oldChunks.size(); i++ ) {
+		free(oldChunks[i]);
+	}
+}
+
+/**
+ * FUNCTION NAME: sizeClass
+ *
+ * DESCRIPTION: Returns the size class a value of the given size is allocated from
+ *
+ * RETURNS:
+ * size class index
+ * -1 if the value is larger than the largest class
+ */
+int Arena::sizeClass(size_t size) {
+	for ( int i = 0; i < ARENA_SIZE_CLASSES; i++ ) {
+		if ( size <= classSizes[i] ) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+/**
+ * FUNCTION NAME: classSize
+ *
+ * DESCRIPTION: Returns the block size of a size class
+ */
+size_t Arena::classSize(int sizeClass) {
+	return classSizes[sizeClass];
+}
+
+/**
+ * FUNCTION NAME: newChunk
+ *
+ * DESCRIPTION: Reserves a new chunk in the current generation
+ */
+char *Arena::newChunk(size_t size) {
+	char *chunk = (char *) malloc(size);
+	chunks.push_back(chunk);
+	reservedBytes += size;
+	return chunk;
+}
+
+/**
+ * FUNCTION NAME: allocateKey
+ *
+ * DESCRIPTION: Bump allocates size bytes for a key.
+ * 				Keys too big to share a chunk get a chunk of their own.
+ */
+char *Arena::allocateKey(size_t size) {
+	char *key;
+	liveKeyBytes += size;
+	if ( size > ARENA_CHUNK_SIZE / 4 ) {
+		return newChunk(size);
+	}
+	if ( keyChunk == NULL || keyChunkUsed + size > ARENA_CHUNK_SIZE ) {
+		keyChunk = newChunk(ARENA_CHUNK_SIZE);
+		keyChunkUsed = 0;
+	}
+	key = keyChunk + keyChunkUsed;
+	keyChunkUsed += size;
+	return key;
+}
+
+/**
+ * FUNCTION NAME: releaseKey
+ *
+ * DESCRIPTION: Marks size key bytes as dead. They are reclaimed by the next compaction.
+ */
+void Arena::releaseKey(size_t size) {
+	liveKeyBytes -= size;
+	deadKeyBytes += size;
+}
+
+/**
+ * FUNCTION NAME: allocateFromSlab
+ *
+ * DESCRIPTION: Carves a new block of the size class from its slab
+ */
+char *Arena::allocateFromSlab(int sizeClass) {
+	size_t blockSize = classSizes[sizeClass];
+	if ( slab[sizeClass] == NULL || slabUsed[sizeClass] + blockSize > ARENA_CHUNK_SIZE ) {
+		slab[sizeClass] = newChunk(ARENA_CHUNK_SIZE);
+		slabUsed[sizeClass] = 0;
+	}
+	char *block = slab[sizeClass] + slabUsed[sizeClass];
+	slabUsed[sizeClass] += blockSize;
+	return block;
+}
+
+/**
+ * FUNCTION NAME: allocateValue
+ *
+ * DESCRIPTION: Allocates a block of at least size bytes for a value
+ */
+char *Arena::allocateValue(size_t size) {
+	int cls = sizeClass(size);
+	if ( cls < 0 ) {
+		largeValueBytes += size;
+		return (char *) malloc(size);
+	}
+	liveValueBytes += classSizes[cls];
+	if ( freeList[cls] != NULL ) {
+		char *block = freeList[cls];
+		memcpy(&freeList[cls], block, sizeof(char *));
+		freeValueBytes -= classSizes[cls];
+		return block;
+	}
+	return allocateFromSlab(cls);
+}
+
+/**
+ * FUNCTION NAME: releaseValue
+ *
+ * DESCRIPTION: Returns a value block of the given size to the free list of its class
+ */
+void Arena::releaseValue(char *block, size_t size) {
+	int cls = sizeClass(size);
+	if ( cls < 0 ) {
+		largeValueBytes -= size;
+		free(block);
+		return;
+	}
+	memcpy(block, &freeList[cls], sizeof(char *));
+	freeList[cls] = block;
+	liveValueBytes -= classSizes[cls];
+	freeValueBytes += classSizes[cls];
+}
+
+/**
+ * FUNCTION NAME: fragmentation
+ *
+ * DESCRIPTION: Fraction of the allocated chunk bytes that hold dead keys or free value blocks
+ */
+double Arena::fragmentation() {
+	size_t dead = deadKeyBytes + freeValueBytes;
+	size_t used = liveKeyBytes + liveValueBytes + dead;
+	if ( used == 0 ) {
+		return 0;
+	}
+	return (double) dead / used;
+}
+
+/**
+ * FUNCTION NAME: needsCompaction
+ *
+ * DESCRIPTION: Returns true once enough of the arena is dead for compaction to pay off
+ */
+bool Arena::needsCompaction() {
+	return reservedBytes >= ARENA_COMPACTION_MIN_BYTES && fragmentation() > ARENA_COMPACTION_THRESHOLD;
+}
+
+/**
+ * FUNCTION NAME: beginCompaction
+ *
+ * DESCRIPTION: Starts a new generation. Every live key and value must then be moved
+ * 				with relocateKey()/relocateValue() before endCompaction() is called.
+ */
+void Arena::beginCompaction() {
+	generation++;
+	oldChunks.swap(chunks);
+	chunks.clear();
+	keyChunk = NULL;
+	keyChunkUsed = 0;
+	for ( int i = 0; i < ARENA_SIZE_CLASSES; i++ ) {
+		slab[i] = NULL;
+		slabUsed[i] = 0;
+		freeList[i] = NULL;
+	}
+	reservedBytes = 0;
+	liveKeyBytes = 0;
+	deadKeyBytes = 0;
+	liveValueBytes = 0;
+	freeValueBytes = 0;
+}
+
+/**
+ * FUNCTION NAME: relocateKey
+ *
+ * DESCRIPTION: Copies a live key into the new generation
+ */
+char *Arena::relocateKey(const char *key, size_t size) {
+	char *moved = allocateKey(size);
+	memcpy(moved, key, size);
+	return moved;
+}
+
+/**
+ * FUNCTION NAME: relocateValue
+ *
+ * DESCRIPTION: Copies a live value into the new generation.
+ * 				Large values are not chunk allocated and stay where they are.
+ */
+char *Arena::relocateValue(char *value, size_t size) {
+	if ( sizeClass(size) < 0 ) {
+		return value;
+	}
+	char *moved = allocateValue(size);
+	memcpy(moved, value, size);
+	return moved;
+}
+
+/**
+ * FUNCTION NAME: releaseChunk
+ *
+ * DESCRIPTION: Frees a chunk of a previous generation
+ */
+void Arena::releaseChunk(void *owner, void *chunk, size_t size, uint64_t tag) {
+	free(chunk);
+}
+
+/**
+ * FUNCTION NAME: endCompaction
+ *
+ * DESCRIPTION: Frees the chunks of the previous generation, or hands them to limbo
+ * 				if readers may still be looking at them
+ */
+void Arena::endCompaction(EpochLimbo *limbo) {
+	for ( unsigned int i = 0; i < oldChunks.size(); i++ ) {
+		if ( limbo != NULL ) {
+			limbo->retire(this, oldChunks[i], 0, generation, &Arena::releaseChunk);
+		}
+		else {
+			releaseChunk(this, oldChunks[i], 0, generation);
+		}
+	}
+	oldChunks.clear();
+}
+
+/**
+ * FUNCTION NAME: getGeneration
+ *
+ * DESCRIPTION: Returns the number of compactions so far
+ */
+uint64_t Arena::getGeneration() {
+	return generation;
+}
+
+/**
+ * FUNCTION NAME: getReservedBytes
+ *
+ * DESCRIPTION: Returns the bytes held by the arena, including large values
+ */
+size_t Arena::getReservedBytes() {
+	return reservedBytes + largeValueBytes;
+}
+
+/**
+ * FUNCTION NAME: getLiveBytes
+ *
+ * DESCRIPTION: Returns the bytes of live keys and values
+ */
+size_t Arena::getLiveBytes() {
+	return liveKeyBytes + liveValueBytes + largeValueBytes;
+}
+
+/**
+ * FUNCTION NAME: getLiveKeyBytes
+ *
+ * DESCRIPTION: Returns the bytes of live keys
+ */
+size_t Arena::getLiveKeyBytes() {
+	return liveKeyBytes;
+}
+
+/**
+ * FUNCTION NAME: getLiveValueBytes
+ *
+ * DESCRIPTION: Returns the bytes of live values, large ones included
+ */
+size_t Arena::getLiveValueBytes() {
+	return liveValueBytes + largeValueBytes;
+}
+
+/**
+ * FUNCTION NAME: getDeadBytes
+ *
+ * DESCRIPTION: Returns the bytes of dead keys and free value blocks, which stay held until
+ * 				the next compaction. The unused tails of the chunks are not included.
+ */
+size_t Arena::getDeadBytes() {
+	return deadKeyBytes + freeValueBytes;
+}
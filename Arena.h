@@ -0,0 +1,107 @@
+/**********************************
+ * FILE NAME: Arena.h
+ *
+ * DESCRIPTION: Header file of the storage engine Arena class
+ **********************************/
+
+#ifndef ARENA_H_
+#define ARENA_H_
+
+/**
+ * Header files
+ */
+#include "stdincludes.h"
+#include <stdint.h>
+#include "Epoch.h"
+
+/*
+ * Macros
+ */
+// Size of the chunks keys are bump allocated from and slabs are carved from
+#define ARENA_CHUNK_SIZE (64 * 1024)
+// Number of value size classes
+#define ARENA_SIZE_CLASSES 16
+// Values bigger than the largest size class get their own allocation
+#define ARENA_MAX_CLASS_SIZE 4096
+// Compact once this fraction of the arena holds dead bytes
+#define ARENA_COMPACTION_THRESHOLD 0.5
+// Arenas smaller than this are never worth compacting
+#define ARENA_COMPACTION_MIN_BYTES (4 * ARENA_CHUNK_SIZE)
+
+/**
+ * CLASS NAME: Arena
+ *
+ * DESCRIPTION: Owns the key and value bytes of a HashTable.
+ * 				1) Keys never change once written, so they are bump allocated and
+ * 				   only reclaimed by compaction
+ * 				2) Values are rounded up to a size class and carved from per class
+ * 				   slabs. Freed value blocks go on the free list of their class
+ * 				3) Compaction copies the live bytes into fresh chunks and drops the
+ * 				   old ones. The owner drives it because only the owner knows where
+ * 				   the live bytes are:
+ * 				   beginCompaction(), relocateKey()/relocateValue() for every record,
+ * 				   endCompaction()
+ * 				   A value block released after the compaction that moved its chunk
+ * 				   away must not be released to the arena, getGeneration() tells
+ * 				   the owner when that happened.
+ */
+class Arena {
+private:
+	// Chunk keys are currently bump allocated from
+	char *keyChunk;
+	size_t keyChunkUsed;
+	// Slab currently carved into value blocks, per size class
+	char *slab[ARENA_SIZE_CLASSES];
+	size_t slabUsed[ARENA_SIZE_CLASSES];
+	// Intrusive free list of value blocks, per size class
+	char *freeList[ARENA_SIZE_CLASSES];
+	// All chunks of the current generation
+	vector<char *> chunks;
+	// Chunks of the generation being compacted away
+	vector<char *> oldChunks;
+	// Accounting
+	size_t reservedBytes;
+	size_t liveKeyBytes;
+	size_t deadKeyBytes;
+	size_t liveValueBytes;
+	size_t freeValueBytes;
+	size_t largeValueBytes;
+	// Number of compactions so far
+	uint64_t generation;
+
+	char *newChunk(size_t size);
+	char *allocateFromSlab(int sizeClass);
+	static void releaseChunk(void *owner, void *chunk, size_t size, uint64_t tag);
+
+	// Forbid copies, the arena owns raw chunks
+	Arena(const Arena &anotherArena);
+	Arena& operator =(const Arena &anotherArena);
+
+public:
+	Arena();
+	virtual ~Arena();
+	static int sizeClass(size_t size);
+	static size_t classSize(int sizeClass);
+	// keys
+	char *allocateKey(size_t size);
+	void releaseKey(size_t size);
+	// values
+	char *allocateValue(size_t size);
+	void releaseValue(char *block, size_t size);
+	// compaction
+	double fragmentation();
+	bool needsCompaction();
+	void beginCompaction();
+	char *relocateKey(const char *key, size_t size);
+	char *relocateValue(char *value, size_t size);
+	void endCompaction(EpochLimbo *limbo = NULL);
+	uint64_t getGeneration();
+	// accounting
+	size_t getReservedBytes();
+	size_t getLiveBytes();
+	size_t getLiveKeyBytes();
+	size_t getLiveValueBytes();
+	size_t getDeadBytes();
+};
+
+#endif /* ARENA_H_ */
@@ -0,0 +1,367 @@
+/**********************************
+ * FILE NAME: Block.cpp
+ *
+ * DESCRIPTION: Definition of the BlockBuilder and BlockReader classes and of the block codec
+ **********************************/
+
+#include "Block.h"
+#include "Coding.h"
+
+/**
+ * Constructor
+ */
+BlockBuilder::BlockBuilder(): counter(0), finished(false) {
+	restarts.push_back(0);
+}
+
+/**
+ * FUNCTION NAME: add
+ *
+ * DESCRIPTION: Appends a record. Keys must come in increasing order.
+ */
+void BlockBuilder::add(const string &key, const string &payload) {
+	size_t shared = 0;
+	if ( counter < BLOCK_RESTART_INTERVAL ) {
+		size_t most = min(lastKey.size(), key.size());
+		while ( shared < most && lastKey[shared] == key[shared] ) {
+			shared++;
+		}
+	}
+	else {
+		restarts.push_back((uint32_t)buffer.size());
+		counter = 0;
+	}
+	putVarint32(buffer, (uint32_t)shared);
+	putVarint32(buffer, (uint32_t)(key.size() - shared));
+	putVarint32(buffer, (uint32_t)payload.size());
+	buffer.append(key, shared, string::npos);
+	buffer.append(payload);
+	lastKey.assign(key);
+	counter++;
+}
+
+/**
+ * FUNCTION NAME: finish
+ *
+ * DESCRIPTION: Appends the restart array and returns the block, valid until reset()
+ */
+const string & BlockBuilder::finish() {
+	if ( !finished ) {
+		for ( unsigned int i = 0; i < restarts.size(); i++ ) {
+			putUint32(buffer, restarts[i]);
+		}
+		putUint32(buffer, (uint32_t)restarts.size());
+		finished = true;
+	}
+	return buffer;
+}
+
+/**
+ * FUNCTION NAME: reset
+ *
+ * DESCRIPTION: Empties the builder for the next block
+ */
+void BlockBuilder::reset() {
+	buffer.clear();
+	restarts.clear();
+	restarts.push_back(0);
+	counter = 0;
+	lastKey.clear();
+	finished = false;
+}
+
+/**
+ * FUNCTION NAME: empty
+ *
+ * DESCRIPTION: Returns true if no record was added since the last reset
+ */
+bool BlockBuilder::empty() const {
+	return buffer.empty();
+}
+
+/**
+ * FUNCTION NAME: sizeEstimate
+ *
+ * DESCRIPTION: Returns the size the block would have if it was finished now
+ */
+size_t BlockBuilder::sizeEstimate() const {
+	return buffer.size() + (finished ? 0 : (restarts.size() + 1) * sizeof(uint32_t));
+}
+
+/**
+ * Constructor of the reader, positioned before the first record
+ */
+BlockReader::BlockReader(const StringView &block): data(block), restartOffset(0), restartCount(0), pos(0), corrupt(false) {
+	size_t end = block.size;
+	if ( end < sizeof(uint32_t) ) {
+		corrupt = true;
+		return;
+	}
+	end -= sizeof(uint32_t);
+	getUint32(block, end, restartCount);
+	end -= sizeof(uint32_t);
+	if ( restartCount == 0 || restartCount > end / sizeof(uint32_t) ) {
+		corrupt = true;
+		restartCount = 0;
+		return;
+	}
+	restartOffset = end - restartCount * sizeof(uint32_t);
+}
+
+/**
+ * FUNCTION NAME: restartPoint
+ *
+ * DESCRIPTION: Returns the offset of the i-th restart point
+ */
+uint32_t BlockReader::restartPoint(uint32_t i) const {
+	size_t at = restartOffset + i * sizeof(uint32_t);
+	uint32_t offset;
+	getUint32(data, at, offset);
+	return offset;
+}
+
+/**
+ * FUNCTION NAME: restartKey
+ *
+ * DESCRIPTION: Views the whole key stored at the i-th restart point
+ */
+bool BlockReader::restartKey(uint32_t i, StringView &key) const {
+	size_t at = restartPoint(i);
+	uint32_t shared, unshared, payloadSize;
+	if ( at >= restartOffset || !getVarint32(data, at, shared) || !getVarint32(data, at, unshared) ||
+			!getVarint32(data, at, payloadSize) || shared != 0 || at + unshared > restartOffset ) {
+		return false;
+	}
+	key = StringView(data.data + at, unshared);
+	return true;
+}
+
+/**
+ * FUNCTION NAME: next
+ *
+ * DESCRIPTION: Decodes the next record
+ *
+ * RETURNS:
+ * true if a record was decoded
+ * false at the end of the block or on a corrupt record
+ */
+bool BlockReader::next() {
+	if ( corrupt || pos >= restartOffset ) {
+		return false;
+	}
+	uint32_t shared, unshared, payloadSize;
+	if ( !getVarint32(data, pos, shared) || !getVarint32(data, pos, unshared) || !getVarint32(data, pos, payloadSize) ||
+			shared > currentKey.size() || (uint64_t)pos + unshared + payloadSize > restartOffset ) {
+		corrupt = true;
+		return false;
+	}
+	currentKey.resize(shared);
+	currentKey.append(data.data + pos, unshared);
+	pos += unshared;
+	currentPayload = StringView(data.data + pos, payloadSize);
+	pos += payloadSize;
+	return true;
+}
+
+/**
+ * FUNCTION NAME: seek
+ *
+ * DESCRIPTION: Moves to the last restart point whose key is < target, so that the records
+ * 				from target on are reached by calling next()
+ */
+void BlockReader::seek(const StringView &target) {
+	if ( corrupt ) {
+		return;
+	}
+	uint32_t low = 0;
+	uint32_t high = restartCount - 1;
+	while ( low < high ) {
+		uint32_t middle = low + (high - low + 1) / 2;
+		StringView key;
+		if ( !restartKey(middle, key) ) {
+			corrupt = true;
+			return;
+		}
+		if ( key < target ) {
+			low = middle;
+		}
+		else {
+			high = middle - 1;
+		}
+	}
+	pos = restartPoint(low);
+	currentKey.clear();
+}
+
+bool BlockReader::failed() const {
+	return corrupt;
+}
+
+const string & BlockReader::key() const {
+	return currentKey;
+}
+
+const StringView & BlockReader::payload() const {
+	return currentPayload;
+}
+
+/**
+ * FUNCTION NAME: lzLiterals
+ *
+ * DESCRIPTION: Appends bytes [from, to) of in as literal runs of at most 32 bytes,
+ * 				each after a control byte holding its length - 1
+ */
+static void lzLiterals(const string &in, size_t from, size_t to, string &out) {
+	while ( from < to ) {
+		size_t run = min(to - from, (size_t)32);
+		out.push_back((char)(run - 1));
+		out.append(in, from, run);
+		from += run;
+	}
+}
+
+/**
+ * FUNCTION NAME: lzCompress
+ *
+ * DESCRIPTION: LZ77 compression: the size of in as a varint, then literal runs and matches.
+ * 				A match is a control byte holding length - 2 in its top 3 bits, 7 meaning
+ * 				that a byte with the rest of the length follows, and the high bits of
+ * 				distance - 1 in its low 5 bits, then the low byte of distance - 1.
+ * 				Matches are found through a table of the last position of every 3 byte hash.
+ */
+static void lzCompress(const string &in, string &out) {
+	putVarint32(out, (uint32_t)in.size());
+	vector<int> table(1 << 13, -1);
+	size_t literalStart = 0;
+	size_t i = 0;
+	while ( i + 2 < in.size() ) {
+		uint32_t bytes = ((unsigned char)in[i] << 16) | ((unsigned char)in[i + 1] << 8) | (unsigned char)in[i + 2];
+		uint32_t slot = (bytes * 2654435761U) >> 19;
+		int candidate = table[slot];
+		table[slot] = (int)i;
+		if ( candidate < 0 || i - candidate > BLOCK_LZ_WINDOW || memcmp(&in[candidate], &in[i], 3) != 0 ) {
+			i++;
+			continue;
+		}
+		size_t length = 3;
+		size_t most = min(in.size() - i, (size_t)BLOCK_LZ_MAX_MATCH);
+		while ( length < most && in[candidate + length] == in[i + length] ) {
+			length++;
+		}
+		lzLiterals(in, literalStart, i, out);
+		size_t distance = i - candidate - 1;
+		size_t code = length - 2;
+		if ( code < 7 ) {
+			out.push_back((char)((code << 5) | (distance >> 8)));
+		}
+		else {
+			out.push_back((char)((7 << 5) | (distance >> 8)));
+			out.push_back((char)(code - 7));
+		}
+		out.push_back((char)(distance & 0xff));
+		i += length;
+		literalStart = i;
+	}
+	lzLiterals(in, literalStart, in.size(), out);
+}
+
+/**
+ * FUNCTION NAME: lzUncompress
+ *
+ * DESCRIPTION: Reverses lzCompress
+ *
+ * RETURNS:
+ * true on SUCCESS
+ * false if in is corrupt
+ */
+static bool lzUncompress(const StringView &in, string &out) {
+	size_t pos = 0;
+	uint32_t size;
+	if ( !getVarint32(in, pos, size) ) {
+		return false;
+	}
+	out.clear();
+	out.reserve(size);
+	while ( pos < in.size ) {
+		unsigned int control = (unsigned char)in.data[pos++];
+		if ( control < 32 ) {
+			size_t run = control + 1;
+			if ( pos + run > in.size || out.size() + run > size ) {
+				return false;
+			}
+			out.append(in.data + pos, run);
+			pos += run;
+			continue;
+		}
+		size_t code = control >> 5;
+		if ( code == 7 ) {
+			if ( pos >= in.size ) {
+				return false;
+			}
+			code += (unsigned char)in.data[pos++];
+		}
+		if ( pos >= in.size ) {
+			return false;
+		}
+		size_t distance = (((size_t)control & 31) << 8) + (unsigned char)in.data[pos++] + 1;
+		size_t length = code + 2;
+		if ( distance > out.size() || out.size() + length > size ) {
+			return false;
+		}
+		// Byte by byte: a match may overlap the bytes it produces
+		size_t from = out.size() - distance;
+		for ( size_t k = 0; k < length; k++ ) {
+			out.push_back(out[from + k]);
+		}
+	}
+	return out.size() == size;
+}
+
+/**
+ * FUNCTION NAME: encodeBlock
+ *
+ * DESCRIPTION: Appends contents to stored with the codec asked for, or raw when compressing
+ * 				does not pay, then the byte naming the codec used
+ */
+void encodeBlock(const string &contents, int codec, string &stored) {
+	if ( codec == BLOCK_LZ ) {
+		size_t start = stored.size();
+		lzCompress(contents, stored);
+		if ( stored.size() - start < contents.size() - contents.size() / 8 ) {
+			stored.push_back((char)BLOCK_LZ);
+			return;
+		}
+		stored.resize(start);
+	}
+	stored.append(contents);
+	stored.push_back((char)BLOCK_RAW);
+}
+
+/**
+ * FUNCTION NAME: decodeBlock
+ *
+ * DESCRIPTION: Points contents at the block stored in stored: at its bytes when it is raw,
+ * 				otherwise at buffer, which it is uncompressed into
+ *
+ * RETURNS:
+ * true on SUCCESS
+ * false if the block is corrupt
+ */
+bool decodeBlock(const StringView &stored, string &buffer, StringView &contents) {
+	if ( stored.size == 0 ) {
+		return false;
+	}
+	StringView body(stored.data, stored.size - 1);
+	switch ( stored.data[stored.size - 1] ) {
+		case BLOCK_RAW:
+			contents = body;
+			return true;
+		case BLOCK_LZ:
+			if ( !lzUncompress(body, buffer) ) {
+				return false;
+			}
+			contents = StringView(buffer);
+			return true;
+	}
+	return false;
+}
@@ -0,0 +1,100 @@
+/**********************************
+ * FILE NAME: Block.h
+ *
+ * DESCRIPTION: Header file of the BlockBuilder and BlockReader classes
+ **********************************/
+
+#ifndef BLOCK_H_
+#define BLOCK_H_
+
+/**
+ * Header files
+ */
+#include "stdincludes.h"
+#include "StringView.h"
+#include <stdint.h>
+
+/*
+ * Macros
+ */
+// Every this many records a block stores a whole key, which a seek can binary search
+#define BLOCK_RESTART_INTERVAL 16
+// Codec of a stored block, its last byte
+#define BLOCK_RAW 0
+#define BLOCK_LZ 1
+// Farthest back and longest an LZ match reaches
+#define BLOCK_LZ_WINDOW 8192
+#define BLOCK_LZ_MAX_MATCH 264
+
+/**
+ * CLASS NAME: BlockBuilder
+ *
+ * DESCRIPTION: Builds a block of (key, payload) records added in key order.
+ * 				A record is: bytes shared with the previous key, bytes not shared,
+ * 				payload size, all three as varints, then the unshared bytes of the
+ * 				key and the payload. Keys sharing a long prefix so cost little more
+ * 				than their suffix. Every BLOCK_RESTART_INTERVAL records the key is
+ * 				stored whole: a restart point. The block ends with the offsets of its
+ * 				restart points and their count, 4 bytes each.
+ */
+class BlockBuilder {
+private:
+	string buffer;
+	vector<uint32_t> restarts;
+	unsigned int counter;
+	string lastKey;
+	bool finished;
+
+	BlockBuilder(const BlockBuilder &anotherBuilder);
+	BlockBuilder& operator =(const BlockBuilder &anotherBuilder);
+
+public:
+	BlockBuilder();
+	void add(const string &key, const string &payload);
+	const string & finish();
+	void reset();
+	bool empty() const;
+	size_t sizeEstimate() const;
+};
+
+/**
+ * CLASS NAME: BlockReader
+ *
+ * DESCRIPTION: Reads the records of a block built by BlockBuilder. The block is not copied
+ * 				and must outlive the reader. next() moves to the next record; seek()
+ * 				binary searches the restart points, so that the next() calls that follow
+ * 				only go through the records of one restart interval before the key.
+ * 				payload() views the block, key() is rebuilt in a buffer of the reader.
+ */
+class BlockReader {
+private:
+	StringView data;
+	// Offset of the restart array, which ends the records
+	size_t restartOffset;
+	uint32_t restartCount;
+	// Offset of the next record
+	size_t pos;
+	string currentKey;
+	StringView currentPayload;
+	bool corrupt;
+
+	uint32_t restartPoint(uint32_t i) const;
+	bool restartKey(uint32_t i, StringView &key) const;
+
+public:
+	BlockReader(const StringView &block);
+	bool next();
+	void seek(const StringView &target);
+	bool failed() const;
+	const string & key() const;
+	const StringView & payload() const;
+};
+
+/*
+ * Codec of the blocks of a file: a built block is stored raw or LZ compressed, followed by the
+ * byte naming its codec. Compression is only kept when it saves at least an eighth of the block.
+ */
+void encodeBlock(const string &contents, int codec, string &stored);
+bool decodeBlock(const StringView &stored, string &buffer, StringView &contents);
+
+#endif /* BLOCK_H_ */
@@ -0,0 +1,192 @@
+/**********************************
+ * FILE NAME: BloomFilter.cpp
+ *
+ * DESCRIPTION: Definition of the BloomFilter class
+ **********************************/
+
+#include "BloomFilter.h"
+#include "Coding.h"
+#include "StringView.h"
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/**
+ * Constructor
+ */
+BloomFilter::BloomFilter(): blocks(NULL), numBlocks(0), numProbes(0) {}
+
+/**
+ * Destructor
+ */
+BloomFilter::~BloomFilter() {
+	free(blocks);
+}
+
+/**
+ * FUNCTION NAME: allocate
+ *
+ * DESCRIPTION: Allocates numBlocks zeroed, cache line aligned blocks
+ */
+void BloomFilter::allocate(uint32_t numBlocks) {
+	free(blocks);
+	blocks = NULL;
+	this->numBlocks = 0;
+	void *memory;
+	if ( numBlocks == 0 || posix_memalign(&memory, BLOOM_BLOCK_BYTES, (size_t)numBlocks * BLOOM_BLOCK_BYTES) != 0 ) {
+		return;
+	}
+	blocks = static_cast<uint64_t *>(memory);
+	memset(blocks, 0, (size_t)numBlocks * BLOOM_BLOCK_BYTES);
+	this->numBlocks = numBlocks;
+}
+
+/**
+ * FUNCTION NAME: build
+ *
+ * DESCRIPTION: Sizes an empty filter for numKeys keys and the given false positive rate
+ */
+void BloomFilter::build(unsigned long numKeys, double falsePositiveRate) {
+	if ( falsePositiveRate <= 0 || falsePositiveRate >= 1 ) {
+		falsePositiveRate = 0.01;
+	}
+	// Optimal bits per key and probes of a standard Bloom filter
+	double bitsPerKey = -log(falsePositiveRate) / (M_LN2 * M_LN2);
+	numProbes = (uint32_t)max(1.0, min((double)BLOOM_MAX_PROBES, round(bitsPerKey * M_LN2)));
+	double bits = max(1.0, numKeys * bitsPerKey);
+	allocate((uint32_t)ceil(bits / BLOOM_BLOCK_BITS));
+}
+
+/**
+ * FUNCTION NAME: blockOf
+ *
+ * DESCRIPTION: Returns the block the key with the given hash belongs to
+ */
+const uint64_t * BloomFilter::blockOf(uint64_t hash) const {
+	uint64_t block = ((hash >> 32) * numBlocks) >> 32;
+	return blocks + block * BLOOM_BLOCK_WORDS;
+}
+
+/**
+ * FUNCTION NAME: makeMask
+ *
+ * DESCRIPTION: Sets in mask the bits the probes of the key with the given hash land on
+ */
+void BloomFilter::makeMask(uint64_t hash, uint64_t *mask) const {
+	memset(mask, 0, BLOOM_BLOCK_BYTES);
+	uint32_t probe = (uint32_t)hash;
+	// Odd so that the probes of a key walk different bits
+	uint32_t delta = (uint32_t)((hash >> 17) | (hash << 47)) | 1;
+	for ( uint32_t i = 0; i < numProbes; i++ ) {
+		uint32_t bit = probe % BLOOM_BLOCK_BITS;
+		mask[bit / 64] |= (uint64_t)1 << (bit % 64);
+		probe += delta;
+	}
+}
+
+/**
+ * FUNCTION NAME: hashOf
+ *
+ * DESCRIPTION: Returns the hash of a key, for callers that collect hashes before sizing the filter
+ */
+uint64_t BloomFilter::hashOf(const string &key) {
+	return hashBytes(key.data(), key.size());
+}
+
+/**
+ * FUNCTION NAME: add
+ *
+ * DESCRIPTION: Adds a key to the filter
+ */
+void BloomFilter::add(const string &key) {
+	addHash(hashOf(key));
+}
+
+/**
+ * FUNCTION NAME: addHash
+ *
+ * DESCRIPTION: Adds the key with the given hash to the filter
+ */
+void BloomFilter::addHash(uint64_t hash) {
+	if ( numBlocks == 0 ) {
+		return;
+	}
+	uint64_t mask[BLOOM_BLOCK_WORDS];
+	makeMask(hash, mask);
+	uint64_t *block = const_cast<uint64_t *>(blockOf(hash));
+	for ( int i = 0; i < BLOOM_BLOCK_WORDS; i++ ) {
+		block[i] |= mask[i];
+	}
+}
+
+/**
+ * FUNCTION NAME: mayContain
+ *
+ * DESCRIPTION: Checks if a key may have been added
+ *
+ * RETURNS:
+ * false if the key was certainly not added
+ * true otherwise
+ */
+bool BloomFilter::mayContain(const string &key) const {
+	if ( numBlocks == 0 ) {
+		return true;
+	}
+	uint64_t hash = hashOf(key);
+	uint64_t mask[BLOOM_BLOCK_WORDS] __attribute__((aligned(16)));
+	makeMask(hash, mask);
+	const uint64_t *block = blockOf(hash);
+#if defined(__SSE2__)
+	// Every mask bit must be set in the block: (block & mask) == mask, 16 bytes at a time
+	__m128i missing = _mm_setzero_si128();
+	for ( int i = 0; i < BLOOM_BLOCK_WORDS; i += 2 ) {
+		__m128i want = _mm_load_si128(reinterpret_cast<const __m128i *>(mask + i));
+		__m128i have = _mm_load_si128(reinterpret_cast<const __m128i *>(block + i));
+		missing = _mm_or_si128(missing, _mm_andnot_si128(have, want));
+	}
+	return _mm_movemask_epi8(_mm_cmpeq_epi8(missing, _mm_setzero_si128())) == 0xFFFF;
+#else
+	uint64_t missing = 0;
+	for ( int i = 0; i < BLOOM_BLOCK_WORDS; i++ ) {
+		missing |= mask[i] & ~block[i];
+	}
+	return missing == 0;
+#endif
+}
+
+/**
+ * FUNCTION NAME: encode
+ *
+ * DESCRIPTION: Appends the filter to out: block count, probe count, then the blocks
+ */
+void BloomFilter::encode(string &out) const {
+	putUint32(out, numBlocks);
+	putUint32(out, numProbes);
+	out.append(reinterpret_cast<const char *>(blocks), (size_t)numBlocks * BLOOM_BLOCK_BYTES);
+}
+
+/**
+ * FUNCTION NAME: decode
+ *
+ * DESCRIPTION: Loads a filter written by encode
+ *
+ * RETURNS:
+ * true on SUCCESS
+ * false if in is not a valid filter
+ */
+bool BloomFilter::decode(const string &in) {
+	size_t pos = 0;
+	uint32_t count;
+	uint32_t probes;
+	if ( !getUint32(in, pos, count) || !getUint32(in, pos, probes) || probes > BLOOM_MAX_PROBES ||
+			in.size() - pos != (size_t)count * BLOOM_BLOCK_BYTES ) {
+		return false;
+	}
+	allocate(count);
+	if ( count > 0 && blocks == NULL ) {
+		return false;
+	}
+	memcpy(blocks, in.data() + pos, (size_t)count * BLOOM_BLOCK_BYTES);
+	numProbes = probes;
+	return true;
+}
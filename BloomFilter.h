@@ -0,0 +1,63 @@
+/**********************************
+ * FILE NAME: BloomFilter.h
+ *
+ * DESCRIPTION: Header file of the BloomFilter class
+ **********************************/
+
+#ifndef BLOOMFILTER_H_
+#define BLOOMFILTER_H_
+
+/**
+ * Header files
+ */
+#include "stdincludes.h"
+#include <stdint.h>
+
+/*
+ * Macros
+ */
+// A filter block is one cache line of 512 bits
+#define BLOOM_BLOCK_BYTES 64
+#define BLOOM_BLOCK_WORDS (BLOOM_BLOCK_BYTES / 8)
+#define BLOOM_BLOCK_BITS (BLOOM_BLOCK_BYTES * 8)
+#define BLOOM_MAX_PROBES 16
+
+/**
+ * CLASS NAME: BloomFilter
+ *
+ * DESCRIPTION: Blocked Bloom filter over a set of keys.
+ * 				The key hash picks one cache line sized block and all the probes of
+ * 				the key set bits in that block, so a lookup touches one cache line.
+ * 				The probes of a key are gathered in a 512 bit mask that is checked
+ * 				against the block with SSE2 when available.
+ * 				The number of bits per key and of probes follow from the false
+ * 				positive rate asked for. A filter that was never built says every
+ * 				key may be present.
+ */
+class BloomFilter {
+private:
+	// Cache line aligned
+	uint64_t *blocks;
+	uint32_t numBlocks;
+	uint32_t numProbes;
+
+	void allocate(uint32_t numBlocks);
+	void makeMask(uint64_t hash, uint64_t *mask) const;
+	const uint64_t * blockOf(uint64_t hash) const;
+
+	BloomFilter(const BloomFilter &anotherFilter);
+	BloomFilter& operator =(const BloomFilter &anotherFilter);
+
+public:
+	BloomFilter();
+	static uint64_t hashOf(const string &key);
+	void build(unsigned long numKeys, double falsePositiveRate);
+	void add(const string &key);
+	void addHash(uint64_t hash);
+	bool mayContain(const string &key) const;
+	void encode(string &out) const;
+	bool decode(const string &in);
+	virtual ~BloomFilter();
+};
+
+#endif /* BLOOMFILTER_H_ */
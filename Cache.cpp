@@ -0,0 +1,304 @@
+/**********************************
+ * FILE NAME: Cache.cpp
+ *
+ * DESCRIPTION: Definition of the FrequencySketch and TinyLfuCache classes
+ **********************************/
+
+#include "Cache.h"
+
+/**
+ * Constructor
+ */
+FrequencySketch::FrequencySketch(): rowMask(0), increments(0), sampleSize(0) {}
+
+/**
+ * FUNCTION NAME: resize
+ *
+ * DESCRIPTION: Gives every row width counters, rounded up to a power of 2, and resets them
+ */
+void FrequencySketch::resize(uint64_t width) {
+	uint64_t rounded = 16;
+	while ( rounded < width ) {
+		rounded <<= 1;
+	}
+	counters.assign(rounded * CACHE_SKETCH_DEPTH, 0);
+	rowMask = rounded - 1;
+	increments = 0;
+	sampleSize = rounded * CACHE_SKETCH_SAMPLE;
+}
+
+/**
+ * FUNCTION NAME: slot
+ *
+ * DESCRIPTION: Returns the counter of a key hash in a row
+ */
+uint64_t FrequencySketch::slot(uint64_t hash, int row) const {
+	uint64_t mixed = (hash + row * 0x9e3779b97f4a7c15ULL) * 0xff51afd7ed558ccdULL;
+	mixed ^= mixed >> 32;
+	return row * (rowMask + 1) + (mixed & rowMask);
+}
+
+/**
+ * FUNCTION NAME: increment
+ *
+ * DESCRIPTION: Records one more request for the key, halving every counter once the sample is full
+ */
+void FrequencySketch::increment(uint64_t hash) {
+	if ( counters.empty() ) {
+		return;
+	}
+	for ( int row = 0; row < CACHE_SKETCH_DEPTH; row++ ) {
+		unsigned char &counter = counters[slot(hash, row)];
+		if ( counter < CACHE_SKETCH_MAX ) {
+			counter++;
+		}
+	}
+	if ( ++increments >= sampleSize ) {
+		for ( unsigned int i = 0; i < counters.size(); i++ ) {
+			counters[i] >>= 1;
+		}
+		increments /= 2;
+	}
+}
+
+/**
+ * FUNCTION NAME: estimate
+ *
+ * DESCRIPTION: Returns how often the key was requested lately, possibly overestimated
+ */
+int FrequencySketch::estimate(uint64_t hash) const {
+	if ( counters.empty() ) {
+		return 0;
+	}
+	int smallest = CACHE_SKETCH_MAX;
+	for ( int row = 0; row < CACHE_SKETCH_DEPTH; row++ ) {
+		smallest = min(smallest, (int)counters[slot(hash, row)]);
+	}
+	return smallest;
+}
+
+/**
+ * FUNCTION NAME: clear
+ *
+ * DESCRIPTION: Forgets every request
+ */
+void FrequencySketch::clear() {
+	fill(counters.begin(), counters.end(), 0);
+	increments = 0;
+}
+
+/**
+ * Constructor
+ */
+template <class Value>
+TinyLfuCache<Value>::TinyLfuCache(size_t capacity): capacity(capacity), windowBytes(0), probationBytes(0), protectedBytes(0),
+		hits(0), misses(0) {
+	windowCapacity = capacity * CACHE_WINDOW_PERCENT / 100;
+	protectedCapacity = (capacity - windowCapacity) * CACHE_PROTECTED_PERCENT / 100;
+	if ( capacity > 0 ) {
+		// Assume entries of about 64 bytes
+		sketch.resize(min(capacity / 64, (size_t)1 << 20));
+	}
+}
+
+/**
+ * Destructor
+ */
+template <class Value>
+TinyLfuCache<Value>::~TinyLfuCache() {}
+
+template <class Value>
+list<typename TinyLfuCache<Value>::Node> & TinyLfuCache<Value>::segmentList(Segment segment) {
+	return segment == WINDOW ? window : (segment == PROBATION ? probation : protectedList);
+}
+
+template <class Value>
+size_t & TinyLfuCache<Value>::segmentBytes(Segment segment) {
+	return segment == WINDOW ? windowBytes : (segment == PROBATION ? probationBytes : protectedBytes);
+}
+
+/**
+ * FUNCTION NAME: moveTo
+ *
+ * DESCRIPTION: Makes an entry the most recently used one of a segment
+ */
+template <class Value>
+void TinyLfuCache<Value>::moveTo(Position position, Segment segment) {
+	segmentBytes(position->segment) -= position->charge;
+	segmentList(segment).splice(segmentList(segment).begin(), segmentList(position->segment), position);
+	position->segment = segment;
+	segmentBytes(segment) += position->charge;
+}
+
+/**
+ * FUNCTION NAME: evict
+ *
+ * DESCRIPTION: Drops an entry
+ */
+template <class Value>
+void TinyLfuCache<Value>::evict(Position position) {
+	segmentBytes(position->segment) -= position->charge;
+	positions.erase(position->key);
+	segmentList(position->segment).erase(position);
+}
+
+/**
+ * FUNCTION NAME: admit
+ *
+ * DESCRIPTION: Moves an entry pushed out of the window to probation if it is requested more
+ * 				often than each entry it has to evict there; drops it otherwise
+ */
+template <class Value>
+void TinyLfuCache<Value>::admit(Position candidate) {
+	int frequency = sketch.estimate(candidate->hash);
+	while ( probationBytes + protectedBytes + candidate->charge > capacity - windowCapacity ) {
+		if ( probation.empty() && protectedList.empty() ) {
+			evict(candidate);
+			return;
+		}
+		Position victim = probation.empty() ? --protectedList.end() : --probation.end();
+		if ( frequency > sketch.estimate(victim->hash) ) {
+			evict(victim);
+		}
+		else {
+			evict(candidate);
+			return;
+		}
+	}
+	moveTo(candidate, PROBATION);
+}
+
+/**
+ * FUNCTION NAME: find
+ *
+ * DESCRIPTION: Looks up key and records the request
+ *
+ * RETURNS:
+ * the cached value, valid until the next call that changes the cache, if found
+ * NULL otherwise
+ */
+template <class Value>
+const Value * TinyLfuCache<Value>::find(const string &key) {
+	if ( capacity == 0 ) {
+		misses++;
+		return NULL;
+	}
+	sketch.increment(hashBytes(key.data(), key.size()));
+	typename unordered_map<string, Position, KeyHash>::iterator search = positions.find(key);
+	if ( search == positions.end() ) {
+		misses++;
+		return NULL;
+	}
+	hits++;
+	Position position = search->second;
+	if ( position->segment == PROBATION ) {
+		moveTo(position, PROTECTED);
+		while ( protectedBytes > protectedCapacity ) {
+			moveTo(--protectedList.end(), PROBATION);
+		}
+	}
+	else {
+		moveTo(position, position->segment);
+	}
+	return &position->value;
+}
+
+/**
+ * FUNCTION NAME: insert
+ *
+ * DESCRIPTION: Caches value under key, charged charge bytes, replacing any value the key had.
+ * 				The request was already recorded by the find that missed.
+ */
+template <class Value>
+void TinyLfuCache<Value>::insert(const string &key, const Value &value, size_t charge) {
+	erase(key);
+	if ( charge > capacity - windowCapacity ) {
+		return;
+	}
+	Node node;
+	node.key = key;
+	node.value = value;
+	node.hash = hashBytes(key.data(), key.size());
+	node.charge = charge;
+	node.segment = WINDOW;
+	window.push_front(node);
+	windowBytes += charge;
+	positions[key] = window.begin();
+	while ( windowBytes > windowCapacity ) {
+		admit(--window.end());
+	}
+}
+
+/**
+ * FUNCTION NAME: erase
+ *
+ * DESCRIPTION: Drops the value of key, if cached
+ */
+template <class Value>
+void TinyLfuCache<Value>::erase(const string &key) {
+	typename unordered_map<string, Position, KeyHash>::iterator search = positions.find(key);
+	if ( search != positions.end() ) {
+		evict(search->second);
+	}
+}
+
+/**
+ * FUNCTION NAME: clear
+ *
+ * DESCRIPTION: Drops every value. The hit and miss counters are kept.
+ */
+template <class Value>
+void TinyLfuCache<Value>::clear() {
+	positions.clear();
+	window.clear();
+	probation.clear();
+	protectedList.clear();
+	windowBytes = probationBytes = protectedBytes = 0;
+	sketch.clear();
+}
+
+/**
+ * FUNCTION NAME: size
+ *
+ * DESCRIPTION: Returns the number of cached values
+ */
+template <class Value>
+size_t TinyLfuCache<Value>::size() {
+	return positions.size();
+}
+
+/**
+ * FUNCTION NAME: bytes
+ *
+ * DESCRIPTION: Returns the bytes charged for the cached values
+ */
+template <class Value>
+size_t TinyLfuCache<Value>::bytes() {
+	return windowBytes + probationBytes + protectedBytes;
+}
+
+/**
+ * FUNCTION NAME: getHits
+ *
+ * DESCRIPTION: Returns the number of lookups that found their key
+ */
+template <class Value>
+uint64_t TinyLfuCache<Value>::getHits() {
+	return hits;
+}
+
+/**
+ * FUNCTION NAME: getMisses
+ *
+ * DESCRIPTION: Returns the number of lookups that did not find their key
+ */
+template <class Value>
+uint64_t TinyLfuCache<Value>::getMisses() {
+	return misses;
+}
+
+/*
+ * The caches of the LSM engine
+ */
+template class TinyLfuCache<Entry>;
+template class TinyLfuCache<string>;
@@ -0,0 +1,137 @@
+/**********************************
+ * FILE NAME: Cache.h
+ *
+ * DESCRIPTION: Header file of the TinyLfuCache class
+ **********************************/
+
+#ifndef CACHE_H_
+#define CACHE_H_
+
+/**
+ * Header files
+ */
+#include "stdincludes.h"
+#include <stdint.h>
+#include <list>
+#include <unordered_map>
+#include "Entry.h"
+#include "StringView.h"
+
+/*
+ * Macros
+ */
+// Share of the capacity given to the admission window, in percent
+#define CACHE_WINDOW_PERCENT 1
+// Share of the main space given to the protected segment, in percent
+#define CACHE_PROTECTED_PERCENT 80
+// Frequency counters of the sketch saturate at this value
+#define CACHE_SKETCH_MAX 15
+// Number of sketch rows, each indexed by its own part of the key hash
+#define CACHE_SKETCH_DEPTH 4
+// The sketch halves its counters after this many increments per counter of a row
+#define CACHE_SKETCH_SAMPLE 10
+
+/**
+ * CLASS NAME: FrequencySketch
+ *
+ * DESCRIPTION: Count-min sketch of how often keys were asked for lately.
+ * 				Every key has one saturating counter per row; its estimate is
+ * 				the smallest of them. Once enough increments were recorded every
+ * 				counter is halved, so that old popularity fades away.
+ */
+class FrequencySketch {
+private:
+	vector<unsigned char> counters;
+	uint64_t rowMask;
+	uint64_t increments;
+	uint64_t sampleSize;
+
+	uint64_t slot(uint64_t hash, int row) const;
+
+public:
+	FrequencySketch();
+	void resize(uint64_t width);
+	void increment(uint64_t hash);
+	int estimate(uint64_t hash) const;
+	void clear();
+};
+
+/**
+ * CLASS NAME: TinyLfuCache
+ *
+ * DESCRIPTION: Cache of values by string key, capped in bytes, with W-TinyLFU eviction:
+ * 				1) New entries go to a small LRU window
+ * 				2) An entry pushed out of the window only enters the main space if the
+ * 				   sketch says it is asked for more often than the entries it would
+ * 				   evict, so a scan over cold keys cannot flush the hot ones
+ * 				3) The main space is a segmented LRU: a hit in the probation segment
+ * 				   promotes the entry to the protected segment, whose oldest entries
+ * 				   are demoted back to probation
+ * 				Every entry is charged the bytes the caller gives for it.
+ * 				The cache does not lock: the owner serializes the calls.
+ * 				Member functions are defined in Cache.cpp and instantiated there for
+ * 				the RowCache and the BlockCache.
+ */
+template <class Value>
+class TinyLfuCache {
+private:
+	enum Segment { WINDOW, PROBATION, PROTECTED };
+
+	typedef struct Node {
+		string key;
+		Value value;
+		uint64_t hash;
+		size_t charge;
+		Segment segment;
+	}Node;
+	typedef typename list<Node>::iterator Position;
+
+	struct KeyHash {
+		size_t operator()(const string &key) const {
+			return (size_t)hashBytes(key.data(), key.size());
+		}
+	};
+
+	size_t capacity;
+	size_t windowCapacity;
+	size_t protectedCapacity;
+	// Most recently used first
+	list<Node> window;
+	list<Node> probation;
+	list<Node> protectedList;
+	size_t windowBytes;
+	size_t probationBytes;
+	size_t protectedBytes;
+	unordered_map<string, Position, KeyHash> positions;
+	FrequencySketch sketch;
+	uint64_t hits;
+	uint64_t misses;
+
+	list<Node> & segmentList(Segment segment);
+	size_t & segmentBytes(Segment segment);
+	void moveTo(Position position, Segment segment);
+	void evict(Position position);
+	void admit(Position candidate);
+
+	TinyLfuCache(const TinyLfuCache &anotherCache);
+	TinyLfuCache& operator =(const TinyLfuCache &anotherCache);
+
+public:
+	TinyLfuCache(size_t capacity);
+	const Value * find(const string &key);
+	void insert(const string &key, const Value &value, size_t charge);
+	void erase(const string &key);
+	void clear();
+	size_t size();
+	size_t bytes();
+	uint64_t getHits();
+	uint64_t getMisses();
+	virtual ~TinyLfuCache();
+};
+
+// Decoded entries by key
+typedef TinyLfuCache<Entry> RowCache;
+// SSTable data blocks by table id and block offset
+typedef TinyLfuCache<string> BlockCache;
+
+#endif /* CACHE_H_ */
@@ -0,0 +1,151 @@
+/**********************************
+ * FILE NAME: Coding.h
+ *
+ * DESCRIPTION: Encoding of fixed width integers and byte strings in on disk records and messages
+ **********************************/
+
+#ifndef CODING_H_
+#define CODING_H_
+
+/**
+ * Header files
+ */
+#include "stdincludes.h"
+#include "StringView.h"
+#include <stdint.h>
+
+/*
+ * Integers are stored in host byte order: the files are only read back by the node that wrote them
+ */
+inline void putUint32(string &out, uint32_t value) {
+	out.append((const char *)&value, sizeof(value));
+}
+
+inline void putUint64(string &out, uint64_t value) {
+	out.append((const char *)&value, sizeof(value));
+}
+
+inline void putBytes(string &out, const string &value) {
+	putUint32(out, (uint32_t)value.size());
+	out.append(value);
+}
+
+inline void putBytes(string &out, const StringView &value) {
+	putUint32(out, (uint32_t)value.size);
+	out.append(value.data, value.size);
+}
+
+inline bool getUint32(const string &in, size_t &pos, uint32_t &value) {
+	if ( pos + sizeof(value) > in.size() ) {
+		return false;
+	}
+	memcpy(&value, in.data() + pos, sizeof(value));
+	pos += sizeof(value);
+	return true;
+}
+
+inline bool getUint64(const string &in, size_t &pos, uint64_t &value) {
+	if ( pos + sizeof(value) > in.size() ) {
+		return false;
+	}
+	memcpy(&value, in.data() + pos, sizeof(value));
+	pos += sizeof(value);
+	return true;
+}
+
+inline bool getBytes(const string &in, size_t &pos, string &value) {
+	uint32_t size;
+	if ( !getUint32(in, pos, size) || pos + size > in.size() ) {
+		return false;
+	}
+	value.assign(in.data() + pos, size);
+	pos += size;
+	return true;
+}
+
+/*
+ * The same decoders over bytes owned elsewhere, e.g. a mapped file. getBytes returns a view into in.
+ */
+inline bool getUint32(const StringView &in, size_t &pos, uint32_t &value) {
+	if ( pos + sizeof(value) > in.size ) {
+		return false;
+	}
+	memcpy(&value, in.data + pos, sizeof(value));
+	pos += sizeof(value);
+	return true;
+}
+
+inline bool getUint64(const StringView &in, size_t &pos, uint64_t &value) {
+	if ( pos + sizeof(value) > in.size ) {
+		return false;
+	}
+	memcpy(&value, in.data + pos, sizeof(value));
+	pos += sizeof(value);
+	return true;
+}
+
+inline bool getBytes(const StringView &in, size_t &pos, StringView &value) {
+	uint32_t size;
+	if ( !getUint32(in, pos, size) || pos + size > in.size ) {
+		return false;
+	}
+	value = StringView(in.data + pos, size);
+	pos += size;
+	return true;
+}
+
+/*
+ * Variable width integers: 7 bits per byte, low bits first, the high bit set on every byte but the last
+ */
+inline void putVarint64(string &out, uint64_t value) {
+	while ( value >= 0x80 ) {
+		out.push_back((char)(value | 0x80));
+		value >>= 7;
+	}
+	out.push_back((char)value);
+}
+
+inline void putVarint32(string &out, uint32_t value) {
+	putVarint64(out, value);
+}
+
+inline bool getVarint64(const StringView &in, size_t &pos, uint64_t &value) {
+	value = 0;
+	for ( unsigned int shift = 0; shift < 64 && pos < in.size; shift += 7 ) {
+		uint64_t byte = (unsigned char)in.data[pos++];
+		value |= (byte & 0x7f) << shift;
+		if ( byte < 0x80 ) {
+			return true;
+		}
+	}
+	return false;
+}
+
+inline bool getVarint32(const StringView &in, size_t &pos, uint32_t &value) {
+	uint64_t wide;
+	if ( !getVarint64(in, pos, wide) || wide > UINT32_MAX ) {
+		return false;
+	}
+	value = (uint32_t)wide;
+	return true;
+}
+
+/*
+ * Byte strings after their varint length. getVarBytes returns a view into in.
+ */
+inline void putVarBytes(string &out, const StringView &value) {
+	putVarint32(out, (uint32_t)value.size);
+	out.append(value.data, value.size);
+}
+
+inline bool getVarBytes(const StringView &in, size_t &pos, StringView &value) {
+	uint32_t size;
+	if ( !getVarint32(in, pos, size) || pos + size > in.size ) {
+		return false;
+	}
+	value = StringView(in.data + pos, size);
+	pos += size;
+	return true;
+}
+
+#endif /* CODING_H_ */
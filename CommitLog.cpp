@@ -0,0 +1,388 @@
+/**********************************
+ * FILE NAME: CommitLog.cpp
+ *
+ * DESCRIPTION: Definition of the CommitLog class
+ **********************************/
+
+#include "CommitLog.h"
+#include "Coding.h"
+#include "StringView.h"
+#include <errno.h>
+#include <dirent.h>
+
+/**
+ * Constructor
+ */
+CommitLog::CommitLog(const string &directory, int syncMode, long segmentSize, int syncPeriod): directory(directory),
+		syncMode(syncMode), segmentSize(segmentSize), syncPeriod(syncPeriod), nextId(1), fd(-1), position(0),
+		dirty(false), lastSync(0) {}
+
+/**
+ * Destructor
+ */
+CommitLog::~CommitLog() {
+	sync();
+	if ( fd >= 0 ) {
+		close(fd);
+	}
+}
+
+/**
+ * FUNCTION NAME: open
+ *
+ * DESCRIPTION: Opens the commit log kept in directory, which must exist
+ *
+ * RETURNS:
+ * the log on SUCCESS
+ * NULL on FAILURE
+ */
+CommitLog * CommitLog::open(const string &directory, int syncMode, long segmentSize, int syncPeriod) {
+	CommitLog *log = new CommitLog(directory, syncMode, segmentSize, syncPeriod);
+	if ( !log->load() ) {
+		delete log;
+		return NULL;
+	}
+	return log;
+}
+
+/**
+ * FUNCTION NAME: load
+ *
+ * DESCRIPTION: Lists the segments and the recycled files of the directory
+ */
+bool CommitLog::load() {
+	DIR *dir = opendir(directory.c_str());
+	if ( dir == NULL ) {
+		return false;
+	}
+	vector<uint64_t> ids;
+	struct dirent *file;
+	while ( (file = readdir(dir)) != NULL ) {
+		unsigned long long id;
+		char suffix[8];
+		if ( sscanf(file->d_name, "commitlog-%llu.%7s", &id, suffix) == 2 && 0 == strcmp(suffix, "log") ) {
+			ids.push_back(id);
+		}
+		else if ( sscanf(file->d_name, "recycled-%llu.%7s", &id, suffix) == 2 ) {
+			string path = directory + "/" + file->d_name;
+			if ( recycled.size() < COMMITLOG_RECYCLE_SEGMENTS ) {
+				recycled.push_back(path);
+			}
+			else {
+				unlink(path.c_str());
+			}
+		}
+	}
+	closedir(dir);
+
+	sort(ids.begin(), ids.end());
+	for ( unsigned int i = 0; i < ids.size(); i++ ) {
+		LogSegment segment;
+		segment.id = ids[i];
+		segment.path = segmentPath(ids[i]);
+		segments.push_back(segment);
+		nextId = max(nextId, ids[i] + 1);
+	}
+	return true;
+}
+
+/**
+ * FUNCTION NAME: segmentPath
+ *
+ * DESCRIPTION: Returns the path of the segment with the given id
+ */
+string CommitLog::segmentPath(uint64_t id) {
+	char name[40];
+	sprintf(name, "/commitlog-%llu.log", (unsigned long long)id);
+	return directory + name;
+}
+
+/**
+ * FUNCTION NAME: checksum
+ *
+ * DESCRIPTION: Checksum of a record, seeded with the id of the segment it belongs to
+ */
+uint32_t CommitLog::checksum(uint64_t segmentId, const char *data, size_t size) {
+	uint64_t hash = hashBytes(data, size) ^ (segmentId * 0x9e3779b97f4a7c15ULL);
+	return (uint32_t)(hash ^ (hash >> 32));
+}
+
+/**
+ * FUNCTION NAME: replay
+ *
+ * DESCRIPTION: Hands every mutation logged from segment fromSegment on to apply, oldest first
+ *
+ * RETURNS:
+ * true on SUCCESS
+ * false if a segment could not be read
+ */
+bool CommitLog::replay(ReplayFunction apply, void *owner, uint64_t fromSegment) {
+	bool ok = true;
+	for ( unsigned int i = 0; i < segments.size(); i++ ) {
+		if ( segments[i].id >= fromSegment ) {
+			ok = replaySegment(segments[i], apply, owner) && ok;
+		}
+	}
+	return ok;
+}
+
+/**
+ * FUNCTION NAME: replaySegment
+ *
+ * DESCRIPTION: Replays the records of one segment, up to the first torn or stale one
+ */
+bool CommitLog::replaySegment(const LogSegment &segment, ReplayFunction apply, void *owner) {
+	int segmentFd = ::open(segment.path.c_str(), O_RDONLY);
+	if ( segmentFd < 0 ) {
+		return false;
+	}
+	string contents;
+	char buffer[65536];
+	ssize_t got;
+	while ( (got = read(segmentFd, buffer, sizeof(buffer))) > 0 ) {
+		contents.append(buffer, got);
+	}
+	close(segmentFd);
+	if ( got < 0 ) {
+		return false;
+	}
+
+	size_t pos = 0;
+	uint32_t magic;
+	uint64_t id;
+	if ( !getUint32(contents, pos, magic) || !getUint64(contents, pos, id) || magic != COMMITLOG_MAGIC || id != segment.id ) {
+		// Never got its header written: nothing to replay
+		return true;
+	}
+	uint32_t size;
+	uint32_t sum;
+	while ( getUint32(contents, pos, size) && getUint32(contents, pos, sum) && pos + size <= contents.size() ) {
+		if ( checksum(id, contents.data() + pos, size) != sum ) {
+			break;
+		}
+		string record(contents, pos, size);
+		pos += size;
+
+		size_t recordPos = 0;
+		string key;
+		Entry entry;
+		uint32_t timestamp;
+		uint32_t expiry;
+		if ( record.empty() ) {
+			break;
+		}
+		MessageType op = static_cast<MessageType>((unsigned char)record[recordPos++]);
+		if ( !getBytes(record, recordPos, key) || !getBytes(record, recordPos, entry.value) ||
+				!getUint32(record, recordPos, timestamp) || !getUint32(record, recordPos, expiry) || recordPos + 2 > record.size() ) {
+			break;
+		}
+		entry.timestamp = (int)timestamp;
+		entry.expiry = (int)expiry;
+		entry.replica = static_cast<ReplicaType>((unsigned char)record[recordPos++]);
+		entry.flags = (unsigned char)record[recordPos++];
+		apply(owner, op, key, entry);
+	}
+	return true;
+}
+
+/**
+ * FUNCTION NAME: startSegment
+ *
+ * DESCRIPTION: Makes a new active segment, reusing a recycled file if there is one
+ */
+bool CommitLog::startSegment() {
+	LogSegment segment;
+	segment.id = nextId++;
+	segment.path = segmentPath(segment.id);
+	if ( !recycled.empty() && rename(recycled.back().c_str(), segment.path.c_str()) == 0 ) {
+		recycled.pop_back();
+		fd = ::open(segment.path.c_str(), O_WRONLY);
+	}
+	else {
+		fd = ::open(segment.path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	}
+	if ( fd < 0 ) {
+		return false;
+	}
+
+	string header;
+	putUint32(header, COMMITLOG_MAGIC);
+	putUint64(header, segment.id);
+	if ( write(fd, header.data(), header.size()) != (ssize_t)header.size() || fdatasync(fd) != 0 ) {
+		close(fd);
+		fd = -1;
+		return false;
+	}
+	// Make the new file name durable
+	int dirFd = ::open(directory.c_str(), O_RDONLY);
+	if ( dirFd >= 0 ) {
+		fsync(dirFd);
+		close(dirFd);
+	}
+	segments.push_back(segment);
+	position = header.size();
+	return true;
+}
+
+/**
+ * FUNCTION NAME: writePending
+ *
+ * DESCRIPTION: Writes the buffered appends to the active segment
+ */
+bool CommitLog::writePending() {
+	size_t written = 0;
+	while ( written < pending.size() ) {
+		ssize_t done = write(fd, pending.data() + written, pending.size() - written);
+		if ( done < 0 ) {
+			if ( errno == EINTR ) {
+				continue;
+			}
+			return false;
+		}
+		written += done;
+	}
+	pending.clear();
+	return true;
+}
+
+/**
+ * FUNCTION NAME: append
+ *
+ * DESCRIPTION: Logs one mutation. op is CREATE, UPDATE or DELETE.
+ *
+ * RETURNS:
+ * true if the mutation is logged as durably as the sync mode promises
+ * false on FAILURE
+ */
+bool CommitLog::append(MessageType op, const StringView &key, const EntryView &entry) {
+	string record;
+	record.push_back((char)op);
+	putBytes(record, key);
+	putBytes(record, entry.value);
+	putUint32(record, (uint32_t)entry.timestamp);
+	putUint32(record, (uint32_t)entry.expiry);
+	record.push_back((char)entry.replica);
+	record.push_back((char)entry.flags);
+
+	const long frameSize = 2 * sizeof(uint32_t) + record.size();
+	if ( fd >= 0 && position + frameSize > segmentSize ) {
+		// Roll over to a new segment
+		bool ok = sync();
+		close(fd);
+		fd = -1;
+		if ( !ok ) {
+			return false;
+		}
+	}
+	if ( fd < 0 && !startSegment() ) {
+		return false;
+	}
+
+	string frame;
+	putUint32(frame, (uint32_t)record.size());
+	putUint32(frame, checksum(segments.back().id, record.data(), record.size()));
+	frame.append(record);
+	pending.append(frame);
+	position += frameSize;
+	dirty = true;
+
+	if ( syncMode == COMMITLOG_BATCH ) {
+		return true;
+	}
+	if ( !writePending() ) {
+		return false;
+	}
+	return syncMode != COMMITLOG_PER_WRITE || sync();
+}
+
+/**
+ * FUNCTION NAME: sync
+ *
+ * DESCRIPTION: Writes the buffered appends and syncs the active segment.
+ * 				In BATCH mode this is the group commit of every append since the last sync.
+ *
+ * RETURNS:
+ * true on SUCCESS
+ * false on FAILURE
+ */
+bool CommitLog::sync() {
+	if ( fd < 0 || !dirty ) {
+		return true;
+	}
+	if ( !writePending() || fdatasync(fd) != 0 ) {
+		return false;
+	}
+	dirty = false;
+	return true;
+}
+
+/**
+ * FUNCTION NAME: tick
+ *
+ * DESCRIPTION: Syncs a PERIODIC log once syncPeriod time units went by since the last sync
+ */
+void CommitLog::tick(int currentTime) {
+	if ( syncMode == COMMITLOG_PERIODIC && currentTime - lastSync >= syncPeriod ) {
+		sync();
+		lastSync = currentTime;
+	}
+}
+
+/**
+ * FUNCTION NAME: defersReplies
+ *
+ * DESCRIPTION: Returns true if the replies to logged mutations must wait for the next sync()
+ */
+bool CommitLog::defersReplies() {
+	return syncMode == COMMITLOG_BATCH;
+}
+
+/**
+ * FUNCTION NAME: rollover
+ *
+ * DESCRIPTION: Syncs and closes the active segment, so that the next append starts a new one
+ *
+ * RETURNS:
+ * the id of the first segment that will hold the mutations logged from now on
+ */
+uint64_t CommitLog::rollover() {
+	if ( fd >= 0 ) {
+		sync();
+		close(fd);
+		fd = -1;
+	}
+	return nextId;
+}
+
+/**
+ * FUNCTION NAME: markClean
+ *
+ * DESCRIPTION: Called once the logged mutations of the segments before beforeSegment are
+ * 				durable in the storage engine, by default all of them. Recycles those
+ * 				segments; the next append starts a new one if the active one went.
+ */
+void CommitLog::markClean(uint64_t beforeSegment) {
+	if ( fd >= 0 && segments.back().id < beforeSegment ) {
+		close(fd);
+		fd = -1;
+		pending.clear();
+		dirty = false;
+	}
+	vector<LogSegment> kept;
+	for ( unsigned int i = 0; i < segments.size(); i++ ) {
+		if ( segments[i].id >= beforeSegment ) {
+			kept.push_back(segments[i]);
+			continue;
+		}
+		char name[40];
+		sprintf(name, "/recycled-%llu.log", (unsigned long long)segments[i].id);
+		string path = directory + name;
+		if ( recycled.size() < COMMITLOG_RECYCLE_SEGMENTS && rename(segments[i].path.c_str(), path.c_str()) == 0 ) {
+			recycled.push_back(path);
+		}
+		else {
+			unlink(segments[i].path.c_str());
+		}
+	}
+	segments.swap(kept);
+}
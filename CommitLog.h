@@ -0,0 +1,106 @@
+/**********************************
+ * FILE NAME: CommitLog.h
+ *
+ * DESCRIPTION: Header file of the CommitLog class
+ **********************************/
+
+#ifndef COMMITLOG_H_
+#define COMMITLOG_H_
+
+/**
+ * Header files
+ */
+#include "stdincludes.h"
+#include <stdint.h>
+#include "Params.h"
+#include "Message.h"
+#include "Entry.h"
+
+/*
+ * Macros
+ */
+// First 4 bytes of every segment, followed by the 8 byte segment id
+#define COMMITLOG_MAGIC 0x4b56434d
+// Clean segments kept around to be reused instead of creating new files
+#define COMMITLOG_RECYCLE_SEGMENTS 2
+
+/**
+ * STRUCT NAME: LogSegment
+ *
+ * DESCRIPTION: One file of the commit log
+ */
+typedef struct LogSegment {
+	uint64_t id;
+	string path;
+}LogSegment;
+
+/**
+ * CLASS NAME: CommitLog
+ *
+ * DESCRIPTION: Append only log of the mutations a node applied, kept in segment files
+ * 				of about segmentSize bytes. A mutation is appended before it is applied
+ * 				and acknowledged, and the log is replayed into the storage engine when
+ * 				the node starts.
+ * 				How appends reach the disk depends on the sync mode:
+ * 				1) PER_WRITE: every append is written and synced before it returns
+ * 				2) BATCH: appends are buffered until sync(), which writes and syncs
+ * 				   them all at once. The caller holds back the replies of the
+ * 				   buffered mutations until then (group commit).
+ * 				3) PERIODIC: every append is written, and tick() syncs once every
+ * 				   syncPeriod time units. A crash of the machine loses at most
+ * 				   the last period.
+ * 				Every record carries a checksum seeded with the id of its segment.
+ * 				Once the storage engine has made the logged mutations durable,
+ * 				markClean() recycles the segments: a recycled file is renamed and
+ * 				overwritten from the start, and replay stops at the first record
+ * 				whose checksum does not match, so stale records are never replayed.
+ * 				A snapshot of the engine calls rollover() to seal the active segment
+ * 				and learn the first segment it does not cover; once the snapshot is
+ * 				written, markClean(mark) recycles the segments before the mark.
+ */
+class CommitLog {
+public:
+	// Applies one replayed mutation. op is CREATE, UPDATE or DELETE.
+	typedef void (*ReplayFunction)(void *owner, MessageType op, const string &key, const Entry &entry);
+
+private:
+	string directory;
+	int syncMode;
+	long segmentSize;
+	int syncPeriod;
+	// Segments holding mutations, oldest first, the active one last
+	vector<LogSegment> segments;
+	// Clean segment files waiting to be reused
+	vector<string> recycled;
+	uint64_t nextId;
+	int fd;
+	long position;
+	// BATCH mode appends not written yet
+	string pending;
+	bool dirty;
+	int lastSync;
+
+	CommitLog(const string &directory, int syncMode, long segmentSize, int syncPeriod);
+	bool load();
+	bool replaySegment(const LogSegment &segment, ReplayFunction apply, void *owner);
+	bool startSegment();
+	bool writePending();
+	string segmentPath(uint64_t id);
+	static uint32_t checksum(uint64_t segmentId, const char *data, size_t size);
+
+	CommitLog(const CommitLog &anotherLog);
+	CommitLog& operator =(const CommitLog &anotherLog);
+
+public:
+	static CommitLog * open(const string &directory, int syncMode, long segmentSize, int syncPeriod);
+	bool replay(ReplayFunction apply, void *owner, uint64_t fromSegment = 0);
+	bool append(MessageType op, const StringView &key, const EntryView &entry);
+	bool sync();
+	void tick(int currentTime);
+	bool defersReplies();
+	uint64_t rollover();
+	void markClean(uint64_t beforeSegment = UINT64_MAX);
+	virtual ~CommitLog();
+};
+
+#endif /* COMMITLOG_H_ */
@@ -5,37 +5,50 @@
  **********************************/
 #include "Entry.h"
 
+/**
+ * constructor
+ */
+Entry::Entry(): timestamp(0), replica(PRIMARY), flags(0), expiry(0) {}
+
 /**
  * constructor
  */
 Entry::Entry(string _value, int _timestamp, ReplicaType _replica){
-	this->delimiter = ":";
 	value = _value;
 	timestamp = _timestamp;
 	replica = _replica;
+	flags = 0;
+	expiry = 0;
+}
+
+/**
+ * constructor
+ *
+ * DESCRIPTION: Copies the value viewed by view, for storage that owns its values
+ */
+Entry::Entry(const EntryView &view){
+	value = view.value.toString();
+	timestamp = view.timestamp;
+	replica = view.replica;
+	flags = view.flags;
+	expiry = view.expiry;
 }
 
 /**
  * constructor
  *
- * DESCRIPTION: Convert string to get an Entry object
+ * DESCRIPTION: Convert string to get an Entry object.
+ * 				The string is split from the right so that values may contain the delimiter.
  */
-Entry::Entry(string entry){
-	vector<string> tuple;
-	this->delimiter = ":";
-	size_t pos = entry.find(delimiter);
-	size_t start = 0;
-	while (pos != string::npos) {
-		string field = entry.substr(start, pos-start);
-		tuple.push_back(field);
-		start = pos + delimiter.size();
-		pos = entry.find(delimiter, start);
-	}
-	tuple.push_back(entry.substr(start));
+Entry::Entry(const string &entry){
+	size_t replicaPos = entry.rfind(ENTRY_DELIMITER);
+	size_t timestampPos = entry.rfind(ENTRY_DELIMITER, replicaPos - 1);
 
-	value = tuple.at(0);
-	timestamp = stoi(tuple.at(1));
-	replica = static_cast<ReplicaType>(stoi(tuple.at(2)));
+	value = entry.substr(0, timestampPos);
+	timestamp = atoi(entry.c_str() + timestampPos + 1);
+	replica = static_cast<ReplicaType>(atoi(entry.c_str() + replicaPos + 1));
+	flags = 0;
+	expiry = 0;
 }
 
 /**
@@ -43,6 +56,74 @@ Entry::Entry(string entry){
  *
  * DESCRIPTION: Convert the object to a string representation
  */
-string Entry::convertToString() {
-	return value + delimiter + to_string(timestamp) + delimiter + to_string(replica);
+string Entry::convertToString() const {
+	string entry;
+	entry.reserve(value.size() + 16);
+	entry += value;
+	entry += ENTRY_DELIMITER;
+	entry += to_string(timestamp);
+	entry += ENTRY_DELIMITER;
+	entry += to_string(replica);
+	return entry;
+}
+
+/**
+ * FUNCTION NAME: expiredAt
+ *
+ * DESCRIPTION: Returns true if the entry has a TTL that ran out at or before time
+ */
+bool Entry::expiredAt(int time) const {
+	return expiry != 0 && expiry <= time;
+}
+
+/**
+ * constructor
+ */
+EntryView::EntryView(): timestamp(0), replica(PRIMARY), flags(0), expiry(0) {}
+
+/**
+ * constructor
+ *
+ * DESCRIPTION: Views entry without copying its value, which must outlive the view.
+ * 				Lets an Entry be passed where the storage engine takes an EntryView.
+ */
+EntryView::EntryView(const Entry &entry): value(entry.value), timestamp(entry.timestamp), replica(entry.replica),
+		flags(entry.flags), expiry(entry.expiry) {}
+
+/**
+ * FUNCTION NAME: assign
+ *
+ * DESCRIPTION: Makes the view hold a copy of entry, for entries that are not stored immutably
+ */
+void EntryView::assign(const Entry &entry) {
+	std::shared_ptr<string> copy = std::make_shared<string>(entry.value);
+	value = StringView(*copy);
+	pin = copy;
+	timestamp = entry.timestamp;
+	replica = entry.replica;
+	flags = entry.flags;
+	expiry = entry.expiry;
+}
+
+/**
+ * FUNCTION NAME: appendString
+ *
+ * DESCRIPTION: Appends the string representation of Entry::convertToString to out,
+ * 				copying the value straight from where it is viewed
+ */
+void EntryView::appendString(string &out) const {
+	out.append(value.data, value.size);
+	out += ENTRY_DELIMITER;
+	out += to_string(timestamp);
+	out += ENTRY_DELIMITER;
+	out += to_string(replica);
+}
+
+/**
+ * FUNCTION NAME: expiredAt
+ *
+ * DESCRIPTION: Returns true if the entry has a TTL that ran out at or before time
+ */
+bool EntryView::expiredAt(int time) const {
+	return expiry != 0 && expiry <= time;
 }
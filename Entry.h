@@ -4,22 +4,71 @@
  * DESCRIPTION: Header file Entry class
  **********************************/
 
+#ifndef ENTRY_H_
+#define ENTRY_H_
+
 #include "stdincludes.h"
 #include "Message.h"
+#include "StringView.h"
+#include <memory>
+
+/*
+ * Macros
+ */
+// Delimiter of the string representation value:timestamp:replica
+#define ENTRY_DELIMITER ':'
+// Entry flags
+// The key was deleted: the entry shadows older versions of the key in the LSM engine
+#define ENTRY_TOMBSTONE 0x01
 
 /**
  * CLASS NAME: Entry
  *
- * DESCRIPTION: This class describes the entry for each key in the DHT
+ * DESCRIPTION: This class describes the entry for each key in the DHT.
+ * 				Entries are stored typed in the HashTable and only converted
+ * 				to their string representation at the wire boundary.
  */
+class EntryView;
+
 class Entry{
 public:
 	string value;
 	int timestamp;
 	ReplicaType replica;
-	string delimiter;
+	// Bitmask of per entry markers, 0 for a plain value
+	unsigned char flags;
+	// Time the entry expires at, 0 if it never does
+	int expiry;
 
-	Entry(string entry);
+	Entry();
+	Entry(const string &entry);
 	Entry(string _value, int _timestamp, ReplicaType _replica);
-	string convertToString();
+	explicit Entry(const EntryView &view);
+	string convertToString() const;
+	bool expiredAt(int time) const;
+};
+
+/**
+ * CLASS NAME: EntryView
+ *
+ * DESCRIPTION: An Entry whose value is viewed where it is stored rather than copied.
+ * 				pin keeps the viewed bytes alive for as long as the view: the mapping
+ * 				of the SSTable they are in, or a copy owned by the view.
+ */
+class EntryView {
+public:
+	StringView value;
+	int timestamp;
+	ReplicaType replica;
+	unsigned char flags;
+	int expiry;
+	std::shared_ptr<const void> pin;
+
+	EntryView();
+	EntryView(const Entry &entry);
+	void assign(const Entry &entry);
+	void appendString(string &out) const;
+	bool expiredAt(int time) const;
 };
+
+#endif /* ENTRY_H_ */
@@ -0,0 +1,204 @@
+/**********************************
+ * FILE NAME: Epoch.cpp
+ *
+ * DESCRIPTION: Definition of the epoch based memory reclamation classes
+ **********************************/
+
+#include "Epoch.h"
+
+/**
+ * CLASS NAME: ThreadSlot
+ *
+ * DESCRIPTION: Gives the slot of a thread back to the EpochManager when the thread exits
+ */
+class ThreadSlot {
+public:
+	int slot;
+	ThreadSlot(): slot(-1) {}
+	~ThreadSlot() {
+		if ( slot >= 0 ) {
+			EpochManager::instance().releaseSlot(slot);
+		}
+	}
+};
+
+static thread_local ThreadSlot currentThread;
+// Read sections can nest, only the outermost one publishes an epoch
+static thread_local int readDepth = 0;
+
+/**
+ * Constructor
+ */
+EpochManager::EpochManager(): globalEpoch(EPOCH_IDLE + 1) {
+	for ( int i = 0; i < EPOCH_MAX_THREADS; i++ ) {
+		threads[i].epoch.store(EPOCH_IDLE);
+		threads[i].used.store(false);
+	}
+}
+
+/**
+ * FUNCTION NAME: instance
+ *
+ * DESCRIPTION: Returns the process wide EpochManager
+ */
+EpochManager & EpochManager::instance() {
+	static EpochManager manager;
+	return manager;
+}
+
+/**
+ * FUNCTION NAME: threadSlot
+ *
+ * DESCRIPTION: Returns the slot of the calling thread, claiming a free one on first use
+ */
+int EpochManager::threadSlot() {
+	if ( currentThread.slot < 0 ) {
+		for ( int i = 0; i < EPOCH_MAX_THREADS; i++ ) {
+			bool expected = false;
+			if ( threads[i].used.compare_exchange_strong(expected, true) ) {
+				currentThread.slot = i;
+				break;
+			}
+		}
+		// More concurrent readers than EPOCH_MAX_THREADS
+		assert(currentThread.slot >= 0);
+	}
+	return currentThread.slot;
+}
+
+/**
+ * FUNCTION NAME: releaseSlot
+ *
+ * DESCRIPTION: Frees the slot of an exiting thread
+ */
+void EpochManager::releaseSlot(int slot) {
+	threads[slot].epoch.store(EPOCH_IDLE);
+	threads[slot].used.store(false);
+}
+
+/**
+ * FUNCTION NAME: enter
+ *
+ * DESCRIPTION: Starts a read section. Memory retired from now on is not
+ * 				released before the matching exit().
+ */
+void EpochManager::enter() {
+	if ( readDepth++ > 0 ) {
+		return;
+	}
+	ThreadEpoch &thread = threads[threadSlot()];
+	thread.epoch.store(globalEpoch.load());
+	// The epoch must be visible before any shared pointer is loaded
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+/**
+ * FUNCTION NAME: exit
+ *
+ * DESCRIPTION: Ends a read section
+ */
+void EpochManager::exit() {
+	if ( --readDepth > 0 ) {
+		return;
+	}
+	threads[threadSlot()].epoch.store(EPOCH_IDLE, std::memory_order_release);
+}
+
+/**
+ * FUNCTION NAME: advance
+ *
+ * DESCRIPTION: Moves to the next epoch
+ *
+ * RETURNS:
+ * the epoch that just ended, which memory unlinked before the call is tagged with
+ */
+uint64_t EpochManager::advance() {
+	return globalEpoch.fetch_add(1);
+}
+
+/**
+ * FUNCTION NAME: safeEpoch
+ *
+ * DESCRIPTION: Memory retired in an epoch older than the returned one can no longer be seen by any reader
+ */
+uint64_t EpochManager::safeEpoch() {
+	uint64_t safe = UINT64_MAX;
+	for ( int i = 0; i < EPOCH_MAX_THREADS; i++ ) {
+		uint64_t epoch = threads[i].epoch.load();
+		if ( epoch != EPOCH_IDLE && epoch < safe ) {
+			safe = epoch;
+		}
+	}
+	return safe;
+}
+
+/**
+ * Constructor
+ */
+EpochLimbo::EpochLimbo() {}
+
+/**
+ * Destructor
+ */
+EpochLimbo::~EpochLimbo() {
+	drain();
+}
+
+/**
+ * FUNCTION NAME: retire
+ *
+ * DESCRIPTION: Hands over memory that was just unlinked from every shared structure
+ */
+void EpochLimbo::retire(void *owner, void *ptr, size_t size, uint64_t tag, Release release) {
+	Retired entry;
+	entry.owner = owner;
+	entry.ptr = ptr;
+	entry.size = size;
+	entry.tag = tag;
+	entry.epoch = EpochManager::instance().advance();
+	entry.release = release;
+	retired.push_back(entry);
+}
+
+/**
+ * FUNCTION NAME: reclaim
+ *
+ * DESCRIPTION: Releases the memory no reader can see anymore
+ */
+void EpochLimbo::reclaim() {
+	if ( retired.empty() ) {
+		return;
+	}
+	uint64_t safe = EpochManager::instance().safeEpoch();
+	unsigned int kept = 0;
+	for ( unsigned int i = 0; i < retired.size(); i++ ) {
+		if ( retired[i].epoch < safe ) {
+			retired[i].release(retired[i].owner, retired[i].ptr, retired[i].size, retired[i].tag);
+		}
+		else {
+			retired[kept++] = retired[i];
+		}
+	}
+	retired.resize(kept);
+}
+
+/**
+ * FUNCTION NAME: drain
+ *
+ * DESCRIPTION: Releases everything. Only valid once no reader can be left.
+ */
+void EpochLimbo::drain() {
+	for ( unsigned int i = 0; i < retired.size(); i++ ) {
+		retired[i].release(retired[i].owner, retired[i].ptr, retired[i].size, retired[i].tag);
+	}
+	retired.clear();
+}
+
+/**
+ * FUNCTION NAME: empty
+ *
+ * DESCRIPTION: Returns true if nothing is waiting to be released
+ */
+bool EpochLimbo::empty() {
+	return retired.empty();
+}
@@ -0,0 +1,112 @@
+/**********************************
+ * FILE NAME: Epoch.h
+ *
+ * DESCRIPTION: Header file of the epoch based memory reclamation classes
+ **********************************/
+
+#ifndef EPOCH_H_
+#define EPOCH_H_
+
+/**
+ * Header files
+ */
+#include "stdincludes.h"
+#include <stdint.h>
+#include <atomic>
+
+/*
+ * Macros
+ */
+// Maximum number of threads that can be inside a read section at the same time
+#define EPOCH_MAX_THREADS 64
+// Epoch of a thread that is not inside a read section
+#define EPOCH_IDLE 0
+
+/**
+ * CLASS NAME: EpochManager
+ *
+ * DESCRIPTION: Tracks which epoch every reading thread entered its read section in.
+ * 				Memory unlinked by a writer is tagged with the epoch it was retired in
+ * 				(see EpochLimbo) and only released once no reader that could
+ * 				still see it is left.
+ */
+class EpochManager {
+private:
+	// Padded so that threads entering and leaving do not share a cache line
+	typedef struct ThreadEpoch {
+		std::atomic<uint64_t> epoch;
+		std::atomic<bool> used;
+		char pad[64 - sizeof(std::atomic<uint64_t>) - sizeof(std::atomic<bool>)];
+	}ThreadEpoch;
+
+	std::atomic<uint64_t> globalEpoch;
+	ThreadEpoch threads[EPOCH_MAX_THREADS];
+
+	EpochManager();
+	EpochManager(const EpochManager &anotherManager);
+	EpochManager& operator =(const EpochManager &anotherManager);
+	int threadSlot();
+
+public:
+	static EpochManager & instance();
+	void enter();
+	void exit();
+	uint64_t advance();
+	uint64_t safeEpoch();
+	void releaseSlot(int slot);
+};
+
+/**
+ * CLASS NAME: EpochGuard
+ *
+ * DESCRIPTION: Read section of the calling thread for as long as the guard lives
+ */
+class EpochGuard {
+public:
+	EpochGuard() {
+		EpochManager::instance().enter();
+	}
+	~EpochGuard() {
+		EpochManager::instance().exit();
+	}
+private:
+	EpochGuard(const EpochGuard &anotherGuard);
+	EpochGuard& operator =(const EpochGuard &anotherGuard);
+};
+
+/**
+ * CLASS NAME: EpochLimbo
+ *
+ * DESCRIPTION: Memory a writer has unlinked but readers may still look at.
+ * 				Not thread safe, every limbo belongs to the writer lock it is used under.
+ */
+class EpochLimbo {
+public:
+	// Called once the memory is safe to release. tag is the value given to retire().
+	typedef void (*Release)(void *owner, void *ptr, size_t size, uint64_t tag);
+
+private:
+	typedef struct Retired {
+		void *owner;
+		void *ptr;
+		size_t size;
+		uint64_t tag;
+		uint64_t epoch;
+		Release release;
+	}Retired;
+
+	vector<Retired> retired;
+
+	EpochLimbo(const EpochLimbo &anotherLimbo);
+	EpochLimbo& operator =(const EpochLimbo &anotherLimbo);
+
+public:
+	EpochLimbo();
+	virtual ~EpochLimbo();
+	void retire(void *owner, void *ptr, size_t size, uint64_t tag, Release release);
+	void reclaim();
+	void drain();
+	bool empty();
+};
+
+#endif /* EPOCH_H_ */
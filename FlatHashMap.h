@@ -0,0 +1,533 @@
+/**********************************
+ * FILE NAME: FlatHashMap.h
+ *
+ * DESCRIPTION: Open addressing hash map with SwissTable style control bytes
+ **********************************/
+
+#ifndef FLATHASHMAP_H_
+#define FLATHASHMAP_H_
+
+/**
+ * Header files
+ */
+#include "stdincludes.h"
+#include <stdint.h>
+#include <functional>
+#include <utility>
+#include "Epoch.h"
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/*
+ * Macros
+ */
+// Number of control bytes probed together
+#define FLAT_GROUP_WIDTH 16
+// Control byte of a slot that was never used
+#define FLAT_CTRL_EMPTY ((int8_t)-128)
+// Control byte of a slot whose element was erased
+#define FLAT_CTRL_DELETED ((int8_t)-2)
+
+/**
+ * CLASS NAME: FlatGroup
+ *
+ * DESCRIPTION: A group of FLAT_GROUP_WIDTH control bytes.
+ * 				A full slot stores the low 7 bits of its hash (H2), so a single
+ * 				compare over the group filters out almost every non matching slot
+ * 				before the key itself is touched.
+ */
+class FlatGroup {
+public:
+	const int8_t *ctrl;
+
+	explicit FlatGroup(const int8_t *ctrl): ctrl(ctrl) {}
+
+	// Bitmask of the slots whose control byte equals h2
+	uint32_t match(int8_t h2) const {
+#if defined(__SSE2__)
+		__m128i group = _mm_loadu_si128((const __m128i *)ctrl);
+		return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(h2), group));
+#else
+		uint32_t mask = 0;
+		for ( int i = 0; i < FLAT_GROUP_WIDTH; i++ ) {
+			mask |= (uint32_t)(ctrl[i] == h2) << i;
+		}
+		return mask;
+#endif
+	}
+
+	// Bitmask of the slots that were never used
+	uint32_t matchEmpty() const {
+		return match(FLAT_CTRL_EMPTY);
+	}
+
+	// Bitmask of the slots that can take a new element (empty or deleted)
+	uint32_t matchEmptyOrDeleted() const {
+#if defined(__SSE2__)
+		return (uint32_t)_mm_movemask_epi8(_mm_loadu_si128((const __m128i *)ctrl));
+#else
+		uint32_t mask = 0;
+		for ( int i = 0; i < FLAT_GROUP_WIDTH; i++ ) {
+			mask |= (uint32_t)(ctrl[i] < 0) << i;
+		}
+		return mask;
+#endif
+	}
+};
+
+/**
+ * CLASS NAME: FlatHashMap
+ *
+ * DESCRIPTION: Cache friendly replacement for the map provided by C++ STL.
+ * 				Elements live in one flat slot array next to a control byte array.
+ * 				Lookups probe one group of control bytes at a time and only
+ * 				compare keys whose 7 bit hash tag matches.
+ * 				Lookup functions are templates so that callers can search with any
+ * 				type that Hash and Equal accept, without building a Key.
+ * 				All members but findShared() need the caller to serialize access.
+ * 				findShared() may run concurrently with one writer if the map was given
+ * 				an EpochLimbo, the reader is inside an EpochGuard and the reader
+ * 				validates what it found (see SeqLock). Key and Value must then be
+ * 				trivially copyable, since a reader can look at an erased element.
+ */
+template <class Key, class Value, class Hash = std::hash<Key>, class Equal = std::equal_to<Key> >
+class FlatHashMap {
+public:
+	typedef std::pair<Key, Value> value_type;
+
+	/**
+	 * CLASS NAME: iterator
+	 *
+	 * DESCRIPTION: Forward iterator over the full slots of the map
+	 */
+	class iterator {
+	public:
+		iterator(): map(NULL), index(0) {}
+		iterator(FlatHashMap *map, size_t index): map(map), index(index) {
+			skipEmpty();
+		}
+		value_type & operator *() const { return map->slots[index]; }
+		value_type * operator ->() const { return &map->slots[index]; }
+		iterator & operator ++() {
+			++index;
+			skipEmpty();
+			return *this;
+		}
+		iterator operator ++(int) {
+			iterator old = *this;
+			++(*this);
+			return old;
+		}
+		bool operator ==(const iterator &another) const { return index == another.index; }
+		bool operator !=(const iterator &another) const { return index != another.index; }
+		// Position of the element in the slot array, see at()
+		size_t slot() const { return index; }
+	private:
+		friend class FlatHashMap;
+		FlatHashMap *map;
+		size_t index;
+		void skipEmpty() {
+			while ( index < map->capacity && map->ctrl[index] < 0 ) {
+				++index;
+			}
+		}
+	};
+
+	FlatHashMap(): storage(NULL), ctrl(NULL), slots(NULL), capacity(0), elements(0), growthLeft(0), rehashes(0), limbo(NULL) {}
+
+	virtual ~FlatHashMap() {
+		destroy();
+	}
+
+	iterator begin() { return iterator(this, 0); }
+	iterator end() { return iterator(this, capacity); }
+
+	/**
+	 * FUNCTION NAME: find
+	 *
+	 * DESCRIPTION: Looks up the element stored under key
+	 *
+	 * RETURNS:
+	 * iterator to the element if found
+	 * end() otherwise
+	 */
+	template <class Lookup>
+	iterator find(const Lookup &key) {
+		return iterator(this, findIndex(key, hasher(key)));
+	}
+
+	/**
+	 * FUNCTION NAME: findValue
+	 *
+	 * DESCRIPTION: Looks up the value stored under key
+	 *
+	 * RETURNS:
+	 * pointer to the value if found
+	 * NULL otherwise
+	 */
+	template <class Lookup>
+	Value * findValue(const Lookup &key) {
+		size_t index = findIndex(key, hasher(key));
+		return index == capacity ? NULL : &slots[index].second;
+	}
+
+	/**
+	 * FUNCTION NAME: findShared
+	 *
+	 * DESCRIPTION: Looks up key without holding the writer lock.
+	 * 				The slot array is loaded once, so a concurrent rehash is never seen
+	 * 				half done, and the probe sequence is bounded, so a concurrent insert
+	 * 				or erase cannot make it loop. Keys and values may still be read
+	 * 				while a writer changes them: the result is only meaningful if the
+	 * 				caller validates it afterwards.
+	 *
+	 * RETURNS:
+	 * true and a copy of the value if found
+	 * false otherwise
+	 */
+	template <class Lookup>
+	bool findShared(const Lookup &key, Value &value) const {
+		const Storage *current = __atomic_load_n(&storage, __ATOMIC_ACQUIRE);
+		if ( current == NULL ) {
+			return false;
+		}
+		size_t hash = hasher(key);
+		size_t groups = current->capacity / FLAT_GROUP_WIDTH;
+		size_t group = h1(hash) & (groups - 1);
+		int8_t tag = h2(hash);
+		for ( size_t probe = 1; probe <= groups; probe++ ) {
+			FlatGroup g(current->ctrl + group * FLAT_GROUP_WIDTH);
+			uint32_t candidates = g.match(tag);
+			while ( candidates ) {
+				size_t index = group * FLAT_GROUP_WIDTH + __builtin_ctz(candidates);
+				if ( equalFunc(current->slots[index].first, key) ) {
+					value = current->slots[index].second;
+					return true;
+				}
+				candidates &= candidates - 1;
+			}
+			if ( g.matchEmpty() ) {
+				return false;
+			}
+			group = (group + probe) & (groups - 1);
+		}
+		return false;
+	}
+
+	/**
+	 * FUNCTION NAME: setLimbo
+	 *
+	 * DESCRIPTION: Slot arrays replaced by a rehash or a clear are handed to limbo
+	 * 				instead of being freed, so that findShared() readers can finish with them
+	 */
+	void setLimbo(EpochLimbo *limbo) {
+		this->limbo = limbo;
+	}
+
+	/**
+	 * FUNCTION NAME: insert
+	 *
+	 * DESCRIPTION: Inserts (key, value) if the key is not present yet.
+	 * 				Like std::map::emplace an existing value is left untouched.
+	 *
+	 * RETURNS:
+	 * pair of an iterator to the element and true if it was inserted
+	 */
+	std::pair<iterator, bool> insert(const Key &key, const Value &value) {
+		size_t hash = hasher(key);
+		size_t index = findIndex(key, hash);
+		if ( index != capacity ) {
+			return std::make_pair(iterator(this, index), false);
+		}
+		index = prepareInsert(hash);
+		new (&slots[index]) value_type(key, value);
+		publish(index, hash);
+		return std::make_pair(iterator(this, index), true);
+	}
+
+	/**
+	 * FUNCTION NAME: insertWith
+	 *
+	 * DESCRIPTION: Looks up key and, only if it is not present, stores the element
+	 * 				returned by make(). This lets the caller build the stored key
+	 * 				(e.g. copy it into an arena) after the lookup says it is needed.
+	 * 				make() must return an element whose key equals the lookup key.
+	 *
+	 * RETURNS:
+	 * pair of an iterator to the element and true if it was inserted
+	 */
+	template <class Lookup, class Make>
+	std::pair<iterator, bool> insertWith(const Lookup &key, Make make) {
+		size_t hash = hasher(key);
+		size_t index = findIndex(key, hash);
+		if ( index != capacity ) {
+			return std::make_pair(iterator(this, index), false);
+		}
+		index = prepareInsert(hash);
+		new (&slots[index]) value_type(make());
+		publish(index, hash);
+		return std::make_pair(iterator(this, index), true);
+	}
+
+	/**
+	 * FUNCTION NAME: erase
+	 *
+	 * DESCRIPTION: Erases the element stored under key
+	 *
+	 * RETURNS:
+	 * number of erased elements (0 or 1)
+	 */
+	template <class Lookup>
+	size_t erase(const Lookup &key) {
+		size_t index = findIndex(key, hasher(key));
+		if ( index == capacity ) {
+			return 0;
+		}
+		eraseAt(index);
+		return 1;
+	}
+
+	/**
+	 * FUNCTION NAME: erase
+	 *
+	 * DESCRIPTION: Erases the element the iterator points to
+	 */
+	void erase(iterator it) {
+		eraseAt(it.index);
+	}
+
+	template <class Lookup>
+	size_t count(const Lookup &key) {
+		return findIndex(key, hasher(key)) == capacity ? 0 : 1;
+	}
+
+	size_t size() const { return elements; }
+	bool empty() const { return elements == 0; }
+	size_t bucketCount() const { return capacity; }
+	// Number of times the elements moved to other slots, so that callers can tell when a slot they kept is stale
+	uint64_t rehashCount() const { return rehashes; }
+
+	/**
+	 * FUNCTION NAME: at
+	 *
+	 * DESCRIPTION: Returns the element in the given slot, which must be full.
+	 * 				An element keeps its slot until it is erased or until the next rehash.
+	 */
+	value_type & at(size_t slot) { return slots[slot]; }
+	const value_type & at(size_t slot) const { return slots[slot]; }
+
+	/**
+	 * FUNCTION NAME: clear
+	 *
+	 * DESCRIPTION: Erases all elements and releases the slot array
+	 */
+	void clear() {
+		destroy();
+		storage = NULL;
+		ctrl = NULL;
+		slots = NULL;
+		capacity = 0;
+		elements = 0;
+		growthLeft = 0;
+	}
+
+private:
+	/**
+	 * STRUCT NAME: Storage
+	 *
+	 * DESCRIPTION: Header of the single allocation holding the control bytes and the slots.
+	 * 				Readers load it through one pointer, so they always see a matching
+	 * 				capacity, control byte array and slot array.
+	 */
+	typedef struct Storage {
+		size_t capacity;
+		int8_t *ctrl;
+		value_type *slots;
+	}Storage;
+
+	Storage *storage;
+	// Writer side copies of the fields of storage
+	int8_t *ctrl;
+	value_type *slots;
+	size_t capacity;
+	size_t elements;
+	// Number of empty slots that can still be used before a rehash
+	size_t growthLeft;
+	uint64_t rehashes;
+	Hash hashFunc;
+	Equal equalFunc;
+	EpochLimbo *limbo;
+
+	// Forbid copies, the map owns raw slot memory
+	FlatHashMap(const FlatHashMap &another);
+	FlatHashMap & operator =(const FlatHashMap &another);
+
+	// Mix the user hash so that both H1 and H2 get well distributed bits
+	template <class Lookup>
+	size_t hasher(const Lookup &key) const {
+		uint64_t hash = (uint64_t)hashFunc(key);
+		hash ^= hash >> 33;
+		hash *= 0xff51afd7ed558ccdULL;
+		hash ^= hash >> 33;
+		return (size_t)hash;
+	}
+
+	static int8_t h2(size_t hash) {
+		return (int8_t)(hash & 0x7f);
+	}
+
+	static size_t h1(size_t hash) {
+		return hash >> 7;
+	}
+
+	template <class Lookup>
+	size_t findIndex(const Lookup &key, size_t hash) const {
+		if ( capacity == 0 ) {
+			return capacity;
+		}
+		size_t groupMask = capacity / FLAT_GROUP_WIDTH - 1;
+		size_t group = h1(hash) & groupMask;
+		int8_t tag = h2(hash);
+		for ( size_t probe = 1; ; probe++ ) {
+			FlatGroup g(ctrl + group * FLAT_GROUP_WIDTH);
+			uint32_t candidates = g.match(tag);
+			while ( candidates ) {
+				size_t index = group * FLAT_GROUP_WIDTH + __builtin_ctz(candidates);
+				if ( equalFunc(slots[index].first, key) ) {
+					return index;
+				}
+				candidates &= candidates - 1;
+			}
+			if ( g.matchEmpty() ) {
+				// Key not found
+				return capacity;
+			}
+			// Triangular probing visits every group when the group count is a power of 2
+			group = (group + probe) & groupMask;
+		}
+	}
+
+	size_t findInsertSlot(size_t hash) const {
+		size_t groupMask = capacity / FLAT_GROUP_WIDTH - 1;
+		size_t group = h1(hash) & groupMask;
+		for ( size_t probe = 1; ; probe++ ) {
+			uint32_t available = FlatGroup(ctrl + group * FLAT_GROUP_WIDTH).matchEmptyOrDeleted();
+			if ( available ) {
+				return group * FLAT_GROUP_WIDTH + __builtin_ctz(available);
+			}
+			group = (group + probe) & groupMask;
+		}
+	}
+
+	size_t prepareInsert(size_t hash) {
+		if ( capacity == 0 ) {
+			rehash(FLAT_GROUP_WIDTH);
+		}
+		size_t index = findInsertSlot(hash);
+		if ( growthLeft == 0 && ctrl[index] == FLAT_CTRL_EMPTY ) {
+			// Out of empty slots: drop tombstones, and double the table if it is really full
+			rehash(elements * 2 >= capacity * 7 / 8 ? capacity * 2 : capacity);
+			index = findInsertSlot(hash);
+		}
+		if ( ctrl[index] == FLAT_CTRL_EMPTY ) {
+			growthLeft--;
+		}
+		elements++;
+		return index;
+	}
+
+	// Marks a slot full once its element is constructed, so a reader never matches a half built slot
+	void publish(size_t index, size_t hash) {
+		__atomic_store_n(&ctrl[index], h2(hash), __ATOMIC_RELEASE);
+	}
+
+	void eraseAt(size_t index) {
+		elements--;
+		// A group that still has an empty slot never caused a probe to continue past it,
+		// so the slot can go straight back to empty instead of becoming a tombstone
+		size_t group = index / FLAT_GROUP_WIDTH;
+		if ( FlatGroup(ctrl + group * FLAT_GROUP_WIDTH).matchEmpty() ) {
+			__atomic_store_n(&ctrl[index], FLAT_CTRL_EMPTY, __ATOMIC_RELEASE);
+			growthLeft++;
+		}
+		else {
+			__atomic_store_n(&ctrl[index], FLAT_CTRL_DELETED, __ATOMIC_RELEASE);
+		}
+		slots[index].~value_type();
+	}
+
+	static Storage * allocateStorage(size_t capacity) {
+		// Slots start at the first suitably aligned offset after the control bytes
+		size_t align = alignof(value_type);
+		size_t slotsOffset = (sizeof(Storage) + capacity + align - 1) / align * align;
+		char *block = static_cast<char *>(::operator new(slotsOffset + capacity * sizeof(value_type)));
+		Storage *created = reinterpret_cast<Storage *>(block);
+		created->capacity = capacity;
+		created->ctrl = reinterpret_cast<int8_t *>(block + sizeof(Storage));
+		created->slots = reinterpret_cast<value_type *>(block + slotsOffset);
+		memset(created->ctrl, FLAT_CTRL_EMPTY, capacity);
+		return created;
+	}
+
+	static void releaseStorage(void *owner, void *ptr, size_t size, uint64_t tag) {
+		::operator delete(ptr);
+	}
+
+	// Frees a storage the elements of which have already been destroyed or moved out
+	void retireStorage(Storage *old) {
+		if ( old == NULL ) {
+			return;
+		}
+		if ( limbo != NULL ) {
+			limbo->retire(this, old, old->capacity, 0, &FlatHashMap::releaseStorage);
+		}
+		else {
+			releaseStorage(this, old, old->capacity, 0);
+		}
+	}
+
+	void rehash(size_t newCapacity) {
+		Storage *old = storage;
+		int8_t *oldCtrl = ctrl;
+		value_type *oldSlots = slots;
+		size_t oldCapacity = capacity;
+
+		Storage *created = allocateStorage(newCapacity);
+		ctrl = created->ctrl;
+		slots = created->slots;
+		capacity = newCapacity;
+		growthLeft = newCapacity - newCapacity / 8 - elements;
+		rehashes++;
+
+		for ( size_t i = 0; i < oldCapacity; i++ ) {
+			if ( oldCtrl[i] >= 0 ) {
+				size_t hash = hasher(oldSlots[i].first);
+				size_t index = findInsertSlot(hash);
+				ctrl[index] = h2(hash);
+				new (&slots[index]) value_type(std::move(oldSlots[i]));
+			}
+		}
+		// Readers switch over only once the new storage is complete
+		__atomic_store_n(&storage, created, __ATOMIC_RELEASE);
+		for ( size_t i = 0; i < oldCapacity; i++ ) {
+			if ( oldCtrl[i] >= 0 ) {
+				oldSlots[i].~value_type();
+			}
+		}
+		retireStorage(old);
+	}
+
+	void destroy() {
+		for ( size_t i = 0; i < capacity; i++ ) {
+			if ( ctrl[i] >= 0 ) {
+				slots[i].~value_type();
+			}
+		}
+		Storage *old = storage;
+		__atomic_store_n(&storage, (Storage *)NULL, __ATOMIC_RELEASE);
+		retireStorage(old);
+	}
+};
+
+#endif /* FLATHASHMAP_H_ */
@@ -6,21 +6,198 @@
 
 #include "HashTable.h"
 
-HashTable::HashTable() {}
+template <class KeyPolicy>
+BasicHashTable<KeyPolicy>::BasicHashTable(): index(&BasicHashTable::indexKey, this), tombstones(0), maxVersions(1) {
+	hashTable.setLimbo(&limbo);
+}
+
+template <class KeyPolicy>
+BasicHashTable<KeyPolicy>::~BasicHashTable() {
+	clear();
+	limbo.drain();
+}
+
+/**
+ * FUNCTION NAME: blockSize
+ *
+ * DESCRIPTION: Returns the number of arena bytes a value block was allocated with
+ */
+template <class KeyPolicy>
+size_t BasicHashTable<KeyPolicy>::blockSize(const ValueBlock *block) {
+	return sizeof(ValueBlock) + block->size;
+}
 
-HashTable::~HashTable() {}
+/**
+ * FUNCTION NAME: storeEntry
+ *
+ * DESCRIPTION: Copies the entry into a new value block, linked to the previous version of its key
+ */
+template <class KeyPolicy>
+ValueBlock * BasicHashTable<KeyPolicy>::storeEntry(const EntryView &entry, uint32_t token, ValueBlock *previous) {
+	ValueBlock *block = reinterpret_cast<ValueBlock *>(arena.allocateValue(sizeof(ValueBlock) + entry.value.size));
+	block->previous = previous;
+	block->size = (uint32_t)entry.value.size;
+	block->timestamp = entry.timestamp;
+	block->expiry = entry.expiry;
+	block->token = token;
+	block->replica = (unsigned char)entry.replica;
+	block->flags = entry.flags;
+	memcpy(const_cast<char *>(block->bytes()), entry.value.data, block->size);
+	return block;
+}
+
+/**
+ * FUNCTION NAME: retireEntry
+ *
+ * DESCRIPTION: Hands a value block that was just unlinked to the limbo
+ */
+template <class KeyPolicy>
+void BasicHashTable<KeyPolicy>::retireEntry(ValueBlock *block) {
+	limbo.retire(this, block, blockSize(block), arena.getGeneration(), &BasicHashTable::releaseEntry);
+}
+
+/**
+ * FUNCTION NAME: retireChain
+ *
+ * DESCRIPTION: Retires a value block that was just unlinked and every older version after it
+ */
+template <class KeyPolicy>
+void BasicHashTable<KeyPolicy>::retireChain(ValueBlock *block) {
+	while ( block != NULL ) {
+		ValueBlock *previous = block->previous;
+		retireEntry(block);
+		block = previous;
+	}
+}
+
+/**
+ * FUNCTION NAME: trimVersions
+ *
+ * DESCRIPTION: Cuts the version chain starting at block after maxVersions versions
+ */
+template <class KeyPolicy>
+void BasicHashTable<KeyPolicy>::trimVersions(ValueBlock *block) {
+	for ( unsigned int kept = 1; kept < maxVersions && block->previous != NULL; kept++ ) {
+		block = block->previous;
+	}
+	ValueBlock *dropped = block->previous;
+	if ( dropped != NULL ) {
+		// Readers that already followed the link are covered by the limbo
+		__atomic_store_n(&block->previous, (ValueBlock *)NULL, __ATOMIC_RELEASE);
+		retireChain(dropped);
+	}
+}
+
+/**
+ * FUNCTION NAME: releaseEntry
+ *
+ * DESCRIPTION: Gives the bytes of a retired value block back to the arena.
+ * 				A block whose chunk was compacted away since it was retired goes
+ * 				with its chunk.
+ */
+template <class KeyPolicy>
+void BasicHashTable<KeyPolicy>::releaseEntry(void *owner, void *block, size_t size, uint64_t generation) {
+	BasicHashTable *table = static_cast<BasicHashTable *>(owner);
+	if ( generation == table->arena.getGeneration() || Arena::sizeClass(size) < 0 ) {
+		table->arena.releaseValue(static_cast<char *>(block), size);
+	}
+}
+
+/**
+ * FUNCTION NAME: toEntry
+ *
+ * DESCRIPTION: Builds an Entry from its value block
+ */
+template <class KeyPolicy>
+Entry BasicHashTable<KeyPolicy>::toEntry(const ValueBlock *block) {
+	Entry entry(string(block->bytes(), block->size), block->timestamp, static_cast<ReplicaType>(block->replica));
+	entry.flags = block->flags;
+	entry.expiry = block->expiry;
+	return entry;
+}
+
+/**
+ * FUNCTION NAME: compact
+ *
+ * DESCRIPTION: Moves every live key and value, older versions included, into fresh arena
+ * 				chunks so that the chunks holding dead bytes can be freed.
+ * 				Readers are not held off: every record is copied in full before its
+ * 				pointer is swapped, and the old chunks stay in limbo until the readers
+ * 				that may still see them are gone.
+ */
+template <class KeyPolicy>
+void BasicHashTable<KeyPolicy>::compact() {
+	arena.beginCompaction();
+	for ( typename Table::iterator it = hashTable.begin(); it != hashTable.end(); ++it ) {
+		KeyPolicy::relocate(it->first, arena);
+		ValueBlock *moved = reinterpret_cast<ValueBlock *>(arena.relocateValue(reinterpret_cast<char *>(it->second), blockSize(it->second)));
+		// The copies are linked up before the new head is published
+		for ( ValueBlock *copy = moved; copy->previous != NULL; copy = copy->previous ) {
+			ValueBlock *previous = reinterpret_cast<ValueBlock *>(arena.relocateValue(reinterpret_cast<char *>(copy->previous), blockSize(copy->previous)));
+			// Blocks too big for the arena are not copied, so this block may be published
+			__atomic_store_n(&copy->previous, previous, __ATOMIC_RELEASE);
+		}
+		__atomic_store_n(&it->second, moved, __ATOMIC_RELEASE);
+	}
+	arena.endCompaction(&limbo);
+}
+
+/**
+ * FUNCTION NAME: afterWrite
+ *
+ * DESCRIPTION: Housekeeping at the end of every write. The write is published first,
+ * 				so readers go on while the writer lock is held for the housekeeping.
+ */
+template <class KeyPolicy>
+void BasicHashTable<KeyPolicy>::afterWrite(WriteGuard &guard) {
+	guard.publish();
+	if ( arena.needsCompaction() ) {
+		compact();
+	}
+	limbo.reclaim();
+}
 
 /**
  * FUNCTION NAME: create
  *
- * DESCRIPTION: This function inserts they (key,value) pair into the local hash table
+ * DESCRIPTION: This function inserts they (key,entry) pair into the local hash table.
+ * 				The entry replaces the tombstone of a deleted key unless the
+ * 				tombstone is newer than it.
  *
  * RETURNS:
  * true on SUCCESS
  * false in FAILURE
  */
-bool HashTable::create(string key, string value) {
-	hashTable.emplace(key, value);
+template <class KeyPolicy>
+bool BasicHashTable<KeyPolicy>::create(const Lookup &key, uint32_t token, const EntryView &entry) {
+	WriteGuard guard(lock);
+	uint64_t rehashes = hashTable.rehashCount();
+	std::pair<typename Table::iterator, bool> inserted = hashTable.insertWith(key, [&]() {
+		return typename Table::value_type(KeyPolicy::store(key, arena), storeEntry(entry, token));
+	});
+	bool indexed = inserted.second;
+	ValueBlock *old = inserted.first->second;
+	if ( !inserted.second && (old->flags & ENTRY_TOMBSTONE) ) {
+		if ( old->timestamp > entry.timestamp ) {
+			// The key was deleted after this entry was written
+			return false;
+		}
+		ValueBlock *block = storeEntry(entry, old->token, old);
+		__atomic_store_n(&inserted.first->second, block, __ATOMIC_RELEASE);
+		trimVersions(block);
+		tombstones--;
+		indexed = true;
+	}
+	// Readers do not use the index
+	guard.publish();
+	if ( inserted.second && hashTable.rehashCount() != rehashes ) {
+		// Every slot the index refers to moved, the new key included
+		reindex();
+	}
+	else if ( indexed ) {
+		index.insert((unsigned char)entry.replica, inserted.first->second->token, (uint32_t)inserted.first.slot());
+	}
+	afterWrite(guard);
 	return true;
 }
 
@@ -28,45 +205,96 @@ bool HashTable::create(string key, string value) {
  * FUNCTION NAME: read
  *
  * DESCRIPTION: This function searches for the key in the hash table
+ * 				and copies its entry out. It does not take the writer lock.
  *
  * RETURNS:
- * string value if found
- * else it returns a NULL
+ * true if found
+ * false otherwise
  */
-string HashTable::read(string key) {
-	map<string, string>::iterator search;
+template <class KeyPolicy>
+bool BasicHashTable<KeyPolicy>::read(const Lookup &key, Entry &entry) {
+	EpochGuard guard;
+	ValueBlock *block = NULL;
+	bool found;
+	unsigned int start;
+
+	do {
+		start = lock.readBegin();
+		found = hashTable.findShared(key, block);
+	} while ( lock.readRetry(start) );
 
-	search = hashTable.find(key);
-	if ( search != hashTable.end() ) {
-		// Value found
-		return search->second;
+	if ( found && !(block->flags & ENTRY_TOMBSTONE) ) {
+		// Value found, the block cannot change and is kept alive by the guard
+		entry = toEntry(block);
+		return true;
 	}
 	else {
 		// Value not found
-		return "";
+		return false;
+	}
+}
+
+/**
+ * FUNCTION NAME: readAt
+ *
+ * DESCRIPTION: This function copies out the newest version of the key written at or before
+ * 				timestamp. It does not take the writer lock.
+ *
+ * RETURNS:
+ * true if the key had a value at that time
+ * false otherwise
+ */
+template <class KeyPolicy>
+bool BasicHashTable<KeyPolicy>::readAt(const Lookup &key, int timestamp, Entry &entry) {
+	EpochGuard guard;
+	ValueBlock *block = NULL;
+	bool found;
+	unsigned int start;
+
+	do {
+		start = lock.readBegin();
+		found = hashTable.findShared(key, block);
+	} while ( lock.readRetry(start) );
+
+	while ( found && block != NULL && block->timestamp > timestamp ) {
+		block = __atomic_load_n(&block->previous, __ATOMIC_ACQUIRE);
 	}
+	if ( !found || block == NULL || (block->flags & ENTRY_TOMBSTONE) ) {
+		return false;
+	}
+	entry = toEntry(block);
+	return true;
 }
 
 /**
  * FUNCTION NAME: update
  *
- * DESCRIPTION: This function updates the given key with the updated value passed in
+ * DESCRIPTION: This function updates the given key with the updated entry passed in
  * 				if the key is found
  *
  * RETURNS:
  * true on SUCCESS
  * false on FAILURE
  */
-bool HashTable::update(string key, string newValue) {
-	map<string, string>::iterator update;
+template <class KeyPolicy>
+bool BasicHashTable<KeyPolicy>::update(const Lookup &key, const EntryView &newEntry) {
+	WriteGuard guard(lock);
+	typename Table::iterator update = hashTable.find(key);
 
-	if (read(key).empty()) {
+	if ( update == hashTable.end() || (update->second->flags & ENTRY_TOMBSTONE) ) {
 		// Key not found
 		return false;
 	}
 	// Key found
-	//update = hashTable.at(key) = newValue;
-	hashTable.at(key) = newValue;
+	ValueBlock *old = update->second;
+	uint32_t slot;
+	if ( old->replica != (unsigned char)newEntry.replica && index.erase(old->replica, old->token, KeyPolicy::view(update->first), slot) ) {
+		index.insert((unsigned char)newEntry.replica, old->token, slot);
+	}
+	ValueBlock *block = storeEntry(newEntry, old->token, old);
+	__atomic_store_n(&update->second, block, __ATOMIC_RELEASE);
+	trimVersions(block);
+	afterWrite(guard);
 	// Update successful
 	return true;
 }
@@ -74,28 +302,400 @@ bool HashTable::update(string key, string newValue) {
 /**
  * FUNCTION NAME: deleteKey
  *
- * DESCRIPTION: This function deletes the given key and the corresponding value if the key is found
+ * DESCRIPTION: This function replaces the value of the given key with a tombstone stamped
+ * 				with timestamp if the key is found
  *
  * RETURNS:
  * true on SUCCESS
  * false on FAILURE
  */
-bool HashTable::deleteKey(string key) {
-	uint eraseCount = 0;
+template <class KeyPolicy>
+bool BasicHashTable<KeyPolicy>::deleteKey(const Lookup &key, int timestamp) {
+	WriteGuard guard(lock);
+	typename Table::iterator search = hashTable.find(key);
 
-	if (read(key).empty()) {
+	if ( search == hashTable.end() || (search->second->flags & ENTRY_TOMBSTONE) ) {
 		// Key not found
 		return false;
 	}
-	eraseCount = hashTable.erase(key);
-	if ( eraseCount < 1 ) {
-		// Could not erase
+	ValueBlock *old = search->second;
+	Entry tombstone("", timestamp, static_cast<ReplicaType>(old->replica));
+	tombstone.flags = ENTRY_TOMBSTONE;
+	uint32_t slot;
+	index.erase(old->replica, old->token, KeyPolicy::view(search->first), slot);
+	ValueBlock *block = storeEntry(tombstone, old->token, old);
+	__atomic_store_n(&search->second, block, __ATOMIC_RELEASE);
+	trimVersions(block);
+	tombstones++;
+	afterWrite(guard);
+	// Delete was successful
+	return true;
+}
+
+/**
+ * FUNCTION NAME: purgeTombstone
+ *
+ * DESCRIPTION: Erases the given key if it holds a tombstone written at or before deadline
+ *
+ * RETURNS:
+ * true if the tombstone was erased
+ * false otherwise
+ */
+template <class KeyPolicy>
+bool BasicHashTable<KeyPolicy>::purgeTombstone(const Lookup &key, int deadline) {
+	WriteGuard guard(lock);
+	typename Table::iterator search = hashTable.find(key);
+
+	if ( search == hashTable.end() || !(search->second->flags & ENTRY_TOMBSTONE) || search->second->timestamp > deadline ) {
 		return false;
 	}
-	// Delete was successful
+	ValueBlock *old = search->second;
+	KeyPolicy::release(search->first, arena);
+	hashTable.erase(search);
+	retireChain(old);
+	tombstones--;
+	afterWrite(guard);
+	return true;
+}
+
+/**
+ * FUNCTION NAME: isEmpty
+ *
+ * DESCRIPTION: Returns if the hash table is empty
+ *
+ * RETURNS:
+ * true if hash table is empty
+ * false otherwise
+ */
+template <class KeyPolicy>
+bool BasicHashTable<KeyPolicy>::isEmpty() {
+	return currentSize() == 0;
+}
+
+/**
+ * FUNCTION NAME: currentSize
+ *
+ * DESCRIPTION: Returns the current size of the hash table
+ *
+ * RETURNS:
+ * size of the table as unit
+ */
+template <class KeyPolicy>
+unsigned long BasicHashTable<KeyPolicy>::currentSize() {
+	size_t size;
+	unsigned int start;
+	do {
+		start = lock.readBegin();
+		size = hashTable.size() - tombstones;
+	} while ( lock.readRetry(start) );
+	return (unsigned long)size;
+}
+
+/**
+ * FUNCTION NAME: clear
+ *
+ * DESCRIPTION: Clear all contents from the hash table
+ */
+template <class KeyPolicy>
+void BasicHashTable<KeyPolicy>::clear() {
+	WriteGuard guard(lock);
+	for ( typename Table::iterator it = hashTable.begin(); it != hashTable.end(); ++it ) {
+		retireChain(it->second);
+	}
+	hashTable.clear();
+	index.clear();
+	tombstones = 0;
+	// An empty generation drops every chunk
+	arena.beginCompaction();
+	arena.endCompaction(&limbo);
+	limbo.reclaim();
+}
+
+/**
+ * FUNCTION NAME: count
+ *
+ * DESCRIPTION: Returns the count of the number of values for the passed in key
+ *
+ * RETURNS:
+ * unsigned long count (Should be always 1)
+ */
+template <class KeyPolicy>
+unsigned long BasicHashTable<KeyPolicy>::count(const Lookup &key) {
+	EpochGuard guard;
+	ValueBlock *block = NULL;
+	bool found;
+	unsigned int start;
+
+	do {
+		start = lock.readBegin();
+		found = hashTable.findShared(key, block);
+	} while ( lock.readRetry(start) );
+	return found && !(block->flags & ENTRY_TOMBSTONE) ? 1 : 0;
+}
+
+/**
+ * FUNCTION NAME: setMaxVersions
+ *
+ * DESCRIPTION: Sets how many versions of a key are kept, the newest included.
+ * 				Longer chains are cut by the next write of their key.
+ */
+template <class KeyPolicy>
+void BasicHashTable<KeyPolicy>::setMaxVersions(unsigned int versions) {
+	WriteGuard guard(lock);
+	maxVersions = max(versions, 1u);
+}
+
+/**
+ * FUNCTION NAME: addMemoryUsage
+ *
+ * DESCRIPTION: Adds the bytes the shard holds to usage. Keys stored inline count
+ * 				as keys, the rest of the full slots as metadata.
+ * 				Capacity reserved ahead of use, the empty slots of the table and
+ * 				the unused tails of the arena chunks, is left out: an empty shard
+ * 				holds no bytes, and a small cap is not used up before the first write.
+ */
+template <class KeyPolicy>
+void BasicHashTable<KeyPolicy>::addMemoryUsage(MemoryUsage &usage) {
+	// The arena is counted anew while it is compacted, which readers do not wait for
+	WritersGuard guard(lock);
+	size_t inlineKeyBytes = hashTable.size() * sizeof(Key);
+	usage.keyBytes += arena.getLiveKeyBytes() + inlineKeyBytes;
+	usage.valueBytes += arena.getLiveValueBytes();
+	usage.metadataBytes += hashTable.size() * (sizeof(typename Table::value_type) + 1) - inlineKeyBytes
+			+ arena.getDeadBytes() + index.memoryUsage();
+}
+
+/**
+ * FUNCTION NAME: begin
+ *
+ * DESCRIPTION: Returns an iterator to the first (key, entry) pair
+ */
+template <class KeyPolicy>
+typename BasicHashTable<KeyPolicy>::iterator BasicHashTable<KeyPolicy>::begin() {
+	return iterator(hashTable.begin());
+}
+
+/**
+ * FUNCTION NAME: end
+ *
+ * DESCRIPTION: Returns the past the end iterator
+ */
+template <class KeyPolicy>
+typename BasicHashTable<KeyPolicy>::iterator BasicHashTable<KeyPolicy>::end() {
+	return iterator(hashTable.end());
+}
+
+/**
+ * FUNCTION NAME: getIndex
+ *
+ * DESCRIPTION: Returns the TokenIndex of the shard
+ */
+template <class KeyPolicy>
+const TokenIndex & BasicHashTable<KeyPolicy>::getIndex() {
+	return index;
+}
+
+/**
+ * FUNCTION NAME: indexKey
+ *
+ * DESCRIPTION: KeyFunction of the index: returns the key stored in the given slot of the table
+ */
+template <class KeyPolicy>
+StringView BasicHashTable<KeyPolicy>::indexKey(const void *owner, uint32_t slot) {
+	return KeyPolicy::view(static_cast<const BasicHashTable *>(owner)->hashTable.at(slot).first);
+}
+
+/**
+ * FUNCTION NAME: reindex
+ *
+ * DESCRIPTION: Rebuilds the index from the table, once a rehash moved the keys to other slots
+ */
+template <class KeyPolicy>
+void BasicHashTable<KeyPolicy>::reindex() {
+	vector<IndexEntry> entries;
+	entries.reserve(hashTable.size() - tombstones);
+	for ( typename Table::iterator it = hashTable.begin(); it != hashTable.end(); ++it ) {
+		if ( !(it->second->flags & ENTRY_TOMBSTONE) ) {
+			IndexEntry entry;
+			entry.replica = it->second->replica;
+			entry.token = it->second->token;
+			entry.ref = (uint32_t)it.slot();
+			entries.push_back(entry);
+		}
+	}
+	index.rebuild(entries);
+}
+
+/*
+ * The key policies HashTable is built from
+ */
+template class BasicHashTable<HashTable::FixedKeyPolicy>;
+template class BasicHashTable<VarKey>;
+
+HashTable::HashTable(TokenFunction tokenOf, LsmEngine *lsm, size_t memoryCap, unsigned int maxVersions): tokenOf(tokenOf), lsm(lsm),
+		memoryCap(memoryCap) {
+	for ( int i = 0; i < HT_SHARDS; i++ ) {
+		fixedKeys[i].setMaxVersions(maxVersions);
+		varKeys[i].setMaxVersions(maxVersions);
+	}
+}
+
+HashTable::~HashTable() {
+	delete lsm;
+}
+
+/**
+ * FUNCTION NAME: create
+ *
+ * DESCRIPTION: This function inserts they (key,entry) pair into the shard the key belongs to
+ *
+ * RETURNS:
+ * true on SUCCESS
+ * false in FAILURE
+ */
+bool HashTable::create(const StringView &key, const EntryView &entry) {
+	if ( lsm != NULL ) {
+		return lsm->create(key, entry);
+	}
+	uint32_t token = tokenOf != NULL ? (uint32_t)tokenOf(key) : 0;
+	if ( FixedKeyPolicy::accepts(key) ) {
+		FixedKeyPolicy::Lookup lookup = FixedKeyPolicy::lookup(key);
+		return fixedKeys[shardOf<FixedKeyPolicy>(lookup)].create(lookup, token, entry);
+	}
+	VarKey::Lookup lookup = VarKey::lookup(key);
+	return varKeys[shardOf<VarKey>(lookup)].create(lookup, token, entry);
+}
+
+/**
+ * FUNCTION NAME: read
+ *
+ * DESCRIPTION: This function searches for the key in its shard and copies its entry out
+ *
+ * RETURNS:
+ * true if found
+ * false otherwise
+ */
+bool HashTable::read(const StringView &key, Entry &entry) {
+	if ( lsm != NULL ) {
+		return lsm->read(key, entry);
+	}
+	if ( FixedKeyPolicy::accepts(key) ) {
+		FixedKeyPolicy::Lookup lookup = FixedKeyPolicy::lookup(key);
+		return fixedKeys[shardOf<FixedKeyPolicy>(lookup)].read(lookup, entry);
+	}
+	VarKey::Lookup lookup = VarKey::lookup(key);
+	return varKeys[shardOf<VarKey>(lookup)].read(lookup, entry);
+}
+
+/**
+ * FUNCTION NAME: readAt
+ *
+ * DESCRIPTION: This function copies out the version of the key that was the newest at timestamp
+ *
+ * RETURNS:
+ * true if the key had a value at that time
+ * false otherwise
+ */
+bool HashTable::readAt(const StringView &key, int timestamp, Entry &entry) {
+	if ( lsm != NULL ) {
+		return lsm->readAt(key, timestamp, entry);
+	}
+	if ( FixedKeyPolicy::accepts(key) ) {
+		FixedKeyPolicy::Lookup lookup = FixedKeyPolicy::lookup(key);
+		return fixedKeys[shardOf<FixedKeyPolicy>(lookup)].readAt(lookup, timestamp, entry);
+	}
+	VarKey::Lookup lookup = VarKey::lookup(key);
+	return varKeys[shardOf<VarKey>(lookup)].readAt(lookup, timestamp, entry);
+}
+
+/**
+ * FUNCTION NAME: readView
+ *
+ * DESCRIPTION: Like read, but lets the LSM engine hand out values found in its SSTables
+ * 				without copying them. Values of the in memory shards are copied into the view.
+ *
+ * RETURNS:
+ * true if found
+ * false otherwise
+ */
+bool HashTable::readView(const StringView &key, EntryView &entry) {
+	if ( lsm != NULL ) {
+		return lsm->readView(key, entry);
+	}
+	Entry copy;
+	if ( !read(key, copy) ) {
+		return false;
+	}
+	entry.assign(copy);
 	return true;
 }
 
+/**
+ * FUNCTION NAME: update
+ *
+ * DESCRIPTION: This function updates the given key with the updated entry passed in
+ * 				if the key is found
+ *
+ * RETURNS:
+ * true on SUCCESS
+ * false on FAILURE
+ */
+bool HashTable::update(const StringView &key, const EntryView &newEntry) {
+	if ( lsm != NULL ) {
+		return lsm->update(key, newEntry);
+	}
+	if ( FixedKeyPolicy::accepts(key) ) {
+		FixedKeyPolicy::Lookup lookup = FixedKeyPolicy::lookup(key);
+		return fixedKeys[shardOf<FixedKeyPolicy>(lookup)].update(lookup, newEntry);
+	}
+	VarKey::Lookup lookup = VarKey::lookup(key);
+	return varKeys[shardOf<VarKey>(lookup)].update(lookup, newEntry);
+}
+
+/**
+ * FUNCTION NAME: deleteKey
+ *
+ * DESCRIPTION: This function replaces the value of the given key with a tombstone stamped
+ * 				with timestamp if the key is found
+ *
+ * RETURNS:
+ * true on SUCCESS
+ * false on FAILURE
+ */
+bool HashTable::deleteKey(const StringView &key, int timestamp) {
+	if ( lsm != NULL ) {
+		return lsm->deleteKey(key, timestamp);
+	}
+	if ( FixedKeyPolicy::accepts(key) ) {
+		FixedKeyPolicy::Lookup lookup = FixedKeyPolicy::lookup(key);
+		return fixedKeys[shardOf<FixedKeyPolicy>(lookup)].deleteKey(lookup, timestamp);
+	}
+	VarKey::Lookup lookup = VarKey::lookup(key);
+	return varKeys[shardOf<VarKey>(lookup)].deleteKey(lookup, timestamp);
+}
+
+/**
+ * FUNCTION NAME: purgeTombstone
+ *
+ * DESCRIPTION: Erases the given key if it holds a tombstone written at or before deadline.
+ * 				The LSM engine drops its tombstones when it compacts, so this is a no-op there.
+ *
+ * RETURNS:
+ * true if the tombstone was erased
+ * false otherwise
+ */
+bool HashTable::purgeTombstone(const StringView &key, int deadline) {
+	if ( lsm != NULL ) {
+		return false;
+	}
+	if ( FixedKeyPolicy::accepts(key) ) {
+		FixedKeyPolicy::Lookup lookup = FixedKeyPolicy::lookup(key);
+		return fixedKeys[shardOf<FixedKeyPolicy>(lookup)].purgeTombstone(lookup, deadline);
+	}
+	VarKey::Lookup lookup = VarKey::lookup(key);
+	return varKeys[shardOf<VarKey>(lookup)].purgeTombstone(lookup, deadline);
+}
+
 /**
  * FUNCTION NAME: isEmpty
  *
@@ -106,7 +706,7 @@ bool HashTable::deleteKey(string key) {
  * false otherwise
  */
 bool HashTable::isEmpty() {
-	return hashTable.empty();
+	return currentSize() == 0;
 }
 
 /**
@@ -118,7 +718,14 @@ bool HashTable::isEmpty() {
  * size of the table as unit
  */
 unsigned long HashTable::currentSize() {
-	return (unsigned  long)hashTable.size();
+	if ( lsm != NULL ) {
+		return lsm->currentSize();
+	}
+	unsigned long size = 0;
+	for ( int i = 0; i < HT_SHARDS; i++ ) {
+		size += fixedKeys[i].currentSize() + varKeys[i].currentSize();
+	}
+	return size;
 }
 
 /**
@@ -127,7 +734,14 @@ unsigned long HashTable::currentSize() {
  * DESCRIPTION: Clear all contents from the hash table
  */
 void HashTable::clear() {
-	hashTable.clear();
+	if ( lsm != NULL ) {
+		lsm->clear();
+		return;
+	}
+	for ( int i = 0; i < HT_SHARDS; i++ ) {
+		fixedKeys[i].clear();
+		varKeys[i].clear();
+	}
 }
 
 /**
@@ -138,6 +752,244 @@ void HashTable::clear() {
  * RETURNS:
  * unsigned long count (Should be always 1)
  */
-unsigned long HashTable::count(string key) {
-	return (unsigned long) hashTable.count(key);
+unsigned long HashTable::count(const string &key) {
+	if ( lsm != NULL ) {
+		return lsm->count(key);
+	}
+	StringView view(key);
+	if ( FixedKeyPolicy::accepts(view) ) {
+		FixedKeyPolicy::Lookup lookup = FixedKeyPolicy::lookup(view);
+		return fixedKeys[shardOf<FixedKeyPolicy>(lookup)].count(lookup);
+	}
+	VarKey::Lookup lookup = VarKey::lookup(view);
+	return varKeys[shardOf<VarKey>(lookup)].count(lookup);
+}
+
+/**
+ * FUNCTION NAME: memoryUsage
+ *
+ * DESCRIPTION: Returns the bytes of memory held by the shards, or by the LSM engine
+ */
+MemoryUsage HashTable::memoryUsage() {
+	if ( lsm != NULL ) {
+		return lsm->memoryUsage();
+	}
+	MemoryUsage usage = MemoryUsage();
+	for ( int i = 0; i < HT_SHARDS; i++ ) {
+		fixedKeys[i].addMemoryUsage(usage);
+		varKeys[i].addMemoryUsage(usage);
+	}
+	return usage;
+}
+
+/**
+ * FUNCTION NAME: hasRoom
+ *
+ * DESCRIPTION: Tells whether writing a key and value of the given sizes keeps the table under its memory cap
+ *
+ * RETURNS:
+ * true if the write fits, or if there is no cap
+ * false otherwise
+ */
+bool HashTable::hasRoom(size_t keySize, size_t valueSize) {
+	if ( memoryCap == 0 ) {
+		return true;
+	}
+	return memoryUsage().total() + keySize + valueSize + HT_KEY_OVERHEAD <= memoryCap;
+}
+
+/**
+ * FUNCTION NAME: begin
+ *
+ * DESCRIPTION: Returns an iterator to the first (key, entry) pair
+ */
+HashTable::iterator HashTable::begin() {
+	return iterator(this, 0);
+}
+
+/**
+ * FUNCTION NAME: end
+ *
+ * DESCRIPTION: Returns the past the end iterator
+ */
+HashTable::iterator HashTable::end() {
+	return iterator(this, 2 * HT_SHARDS);
+}
+
+/**
+ * Constructor of the iterator, positioned on the first pair of shard or of a later shard
+ */
+HashTable::iterator::iterator(HashTable *table, int shard): table(table), shard(shard) {
+	if ( shard < HT_SHARDS ) {
+		fixedIt = table->fixedKeys[shard].begin();
+	}
+	else if ( shard < 2 * HT_SHARDS ) {
+		varIt = table->varKeys[shard - HT_SHARDS].begin();
+	}
+	settle();
+}
+
+/**
+ * FUNCTION NAME: settle
+ *
+ * DESCRIPTION: Moves past the end of exhausted shards
+ */
+void HashTable::iterator::settle() {
+	while ( shard < 2 * HT_SHARDS ) {
+		if ( shard < HT_SHARDS ) {
+			if ( fixedIt != table->fixedKeys[shard].end() ) {
+				return;
+			}
+		}
+		else if ( varIt != table->varKeys[shard - HT_SHARDS].end() ) {
+			return;
+		}
+		shard++;
+		if ( shard < HT_SHARDS ) {
+			fixedIt = table->fixedKeys[shard].begin();
+		}
+		else if ( shard < 2 * HT_SHARDS ) {
+			varIt = table->varKeys[shard - HT_SHARDS].begin();
+		}
+	}
+}
+
+string HashTable::iterator::key() const {
+	return shard < HT_SHARDS ? fixedIt.key() : varIt.key();
+}
+
+string HashTable::iterator::value() const {
+	return shard < HT_SHARDS ? fixedIt.value() : varIt.value();
+}
+
+ReplicaType HashTable::iterator::replica() const {
+	return shard < HT_SHARDS ? fixedIt.replica() : varIt.replica();
+}
+
+Entry HashTable::iterator::entry() const {
+	return shard < HT_SHARDS ? fixedIt.entry() : varIt.entry();
+}
+
+HashTable::iterator & HashTable::iterator::operator ++() {
+	if ( shard < HT_SHARDS ) {
+		++fixedIt;
+	}
+	else {
+		++varIt;
+	}
+	settle();
+	return *this;
+}
+
+bool HashTable::iterator::operator !=(const iterator &another) const {
+	if ( shard != another.shard ) {
+		return true;
+	}
+	if ( shard < HT_SHARDS ) {
+		return fixedIt != another.fixedIt;
+	}
+	if ( shard < 2 * HT_SHARDS ) {
+		return varIt != another.varIt;
+	}
+	return false;
+}
+
+/**
+ * FUNCTION NAME: rangeBegin
+ *
+ * DESCRIPTION: Returns an iterator to the first key held as replica with a token in [firstToken, lastToken]
+ */
+HashTable::range_iterator HashTable::rangeBegin(ReplicaType replica, size_t firstToken, size_t lastToken) {
+	return range_iterator(this, replica, firstToken, lastToken);
+}
+
+/**
+ * FUNCTION NAME: rangeEnd
+ *
+ * DESCRIPTION: Returns the past the end range iterator
+ */
+HashTable::range_iterator HashTable::rangeEnd() {
+	return range_iterator();
+}
+
+/**
+ * Constructor of the past the end range iterator
+ */
+HashTable::range_iterator::range_iterator(): current(-1) {}
+
+/**
+ * Constructor of the range iterator, positioned on the smallest key of the range
+ */
+HashTable::range_iterator::range_iterator(HashTable *table, ReplicaType replica, size_t firstToken, size_t lastToken): current(-1) {
+	if ( firstToken > lastToken || firstToken > UINT32_MAX ) {
+		return;
+	}
+	uint32_t first = (uint32_t)firstToken;
+	uint32_t last = (uint32_t)min(lastToken, (size_t)UINT32_MAX);
+	for ( int i = 0; i < HT_SHARDS; i++ ) {
+		addCursor(table->fixedKeys[i].getIndex(), replica, first, last);
+		addCursor(table->varKeys[i].getIndex(), replica, first, last);
+	}
+	if ( table->lsm != NULL ) {
+		addCursor(table->lsm->getIndex(), replica, first, last);
+	}
+	pickSmallest();
+}
+
+/**
+ * FUNCTION NAME: addCursor
+ *
+ * DESCRIPTION: Adds the keys of index held as replica with a token in [firstToken, lastToken]
+ */
+void HashTable::range_iterator::addCursor(const TokenIndex &index, ReplicaType replica, uint32_t firstToken, uint32_t lastToken) {
+	Cursor cursor;
+	cursor.index = &index;
+	cursor.at = index.lowerBound((unsigned char)replica, firstToken);
+	cursor.end = index.upperBound((unsigned char)replica, lastToken);
+	cursors.push_back(cursor);
+}
+
+/**
+ * FUNCTION NAME: pickSmallest
+ *
+ * DESCRIPTION: Points current to the cursor holding the smallest key
+ */
+void HashTable::range_iterator::pickSmallest() {
+	current = -1;
+	for ( unsigned int i = 0; i < cursors.size(); i++ ) {
+		if ( cursors[i].at == cursors[i].end ) {
+			continue;
+		}
+		if ( current < 0 ) {
+			current = i;
+			continue;
+		}
+		// All the cursors hold the same replica type
+		const Cursor &cursor = cursors[i], &smallest = cursors[current];
+		if ( cursor.at->token < smallest.at->token
+				|| (cursor.at->token == smallest.at->token && cursor.index->key(*cursor.at) < smallest.index->key(*smallest.at)) ) {
+			current = i;
+		}
+	}
+}
+
+StringView HashTable::range_iterator::key() const {
+	return cursors[current].index->key(*cursors[current].at);
+}
+
+size_t HashTable::range_iterator::token() const {
+	return cursors[current].at->token;
+}
+
+HashTable::range_iterator & HashTable::range_iterator::operator ++() {
+	++cursors[current].at;
+	pickSmallest();
+	return *this;
+}
+
+bool HashTable::range_iterator::operator !=(const range_iterator &another) const {
+	if ( current < 0 || another.current < 0 ) {
+		return current >= 0 || another.current >= 0;
+	}
+	return &*cursors[current].at != &*another.cursors[another.current].at;
 }
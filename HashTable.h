@@ -13,26 +13,290 @@
 #include "stdincludes.h"
 #include "common.h"
 #include "Entry.h"
+#include "FlatHashMap.h"
+#include "Arena.h"
+#include "StringView.h"
+#include "KeyPolicy.h"
+#include "Epoch.h"
+#include "SeqLock.h"
+#include "TokenIndex.h"
+#include "LsmEngine.h"
+
+/*
+ * Macros
+ */
+// The HashTable is split in 2^HT_SHARD_BITS shards per key partition
+#define HT_SHARD_BITS 3
+#define HT_SHARDS (1 << HT_SHARD_BITS)
+// Bytes a new key is expected to cost on top of its key and value bytes, when checking the memory cap
+#define HT_KEY_OVERHEAD 128
+
+/**
+ * STRUCT NAME: ValueBlock
+ *
+ * DESCRIPTION: In table representation of an Entry, allocated from the Arena with
+ * 				the value bytes right after it. A block is never modified once
+ * 				published, but for its link to the previous version: an update
+ * 				publishes a new block that links to the old one.
+ */
+typedef struct ValueBlock {
+	// Previous version of the key, NULL for the oldest one kept
+	struct ValueBlock *previous;
+	uint32_t size;
+	int timestamp;
+	// 0 if the entry never expires
+	int expiry;
+	// Ring token of the key, so that its TokenIndex entry can be found again
+	uint32_t token;
+	unsigned char replica;
+	unsigned char flags;
+
+	const char *bytes() const {
+		return reinterpret_cast<const char *>(this + 1);
+	}
+}ValueBlock;
+
+/**
+ * CLASS NAME: BasicHashTable
+ *
+ * DESCRIPTION: One shard of the storage engine, specialized on a key policy (see KeyPolicy.h).
+ * 				Keys are stored the way the policy says: in the Arena for VarKey,
+ * 				inline for FixedKey. Values are ValueBlocks in the Arena, which is
+ * 				compacted once too much of it is dead. A TokenIndex orders the
+ * 				keys by (ReplicaType, ring token). It refers to a key by its slot
+ * 				in the table, and is rebuilt whenever the table rehashes.
+ * 				A deleted key keeps a tombstone block, stamped with the time of the
+ * 				delete, until purgeTombstone() drops it. Tombstones are not indexed
+ * 				and are invisible to read, update, count and currentSize.
+ * 				Every key keeps a chain of its last maxVersions versions, newest
+ * 				first, so that readAt() can serve the value a key had at a past
+ * 				time. Writers cut the chain and retire the versions it drops;
+ * 				readers walk it without locking, like they read the newest one.
+ * 				Writers serialize on a SeqLock. Readers do not lock: they retry
+ * 				while a writer changes the table, and memory a writer unlinks stays
+ * 				allocated until every reader that may have seen it is done (see
+ * 				Epoch.h). Rebuilding the index and compacting the arena keep only
+ * 				the writer lock, so readers never wait on them.
+ * 				Iterating, over the table or over the index, needs the caller
+ * 				to keep writers away.
+ * 				Member functions are defined in HashTable.cpp and instantiated
+ * 				there for the policies HashTable uses.
+ */
+template <class KeyPolicy>
+class BasicHashTable {
+public:
+	typedef typename KeyPolicy::Stored Key;
+	typedef typename KeyPolicy::Lookup Lookup;
+	typedef FlatHashMap<Key, ValueBlock *, typename KeyPolicy::Hash, typename KeyPolicy::Equal> Table;
+
+	/**
+	 * CLASS NAME: iterator
+	 *
+	 * DESCRIPTION: Iterates over the (key, entry) pairs of the table, tombstones included
+	 */
+	class iterator {
+	public:
+		iterator() {}
+		iterator(typename Table::iterator it): it(it) {}
+		string key() const {
+			return KeyPolicy::toString(it->first);
+		}
+		string value() const {
+			return string(it->second->bytes(), it->second->size);
+		}
+		ReplicaType replica() const {
+			return static_cast<ReplicaType>(it->second->replica);
+		}
+		Entry entry() const {
+			return toEntry(it->second);
+		}
+		iterator & operator ++() {
+			++it;
+			return *this;
+		}
+		bool operator !=(const iterator &another) const {
+			return it != another.it;
+		}
+	private:
+		typename Table::iterator it;
+	};
+
+private:
+	// Declared first so that it is destroyed last
+	EpochLimbo limbo;
+	SeqLock lock;
+	Table hashTable;
+	Arena arena;
+	TokenIndex index;
+	// Keys of the table that hold a tombstone
+	unsigned long tombstones;
+	// Versions kept per key, the newest included
+	unsigned int maxVersions;
+	ValueBlock * storeEntry(const EntryView &entry, uint32_t token, ValueBlock *previous = NULL);
+	void retireEntry(ValueBlock *block);
+	void retireChain(ValueBlock *block);
+	void trimVersions(ValueBlock *block);
+	static void releaseEntry(void *owner, void *block, size_t size, uint64_t generation);
+	void compact();
+	void afterWrite(WriteGuard &guard);
+	static size_t blockSize(const ValueBlock *block);
+	static Entry toEntry(const ValueBlock *block);
+	static StringView indexKey(const void *owner, uint32_t slot);
+	void reindex();
+
+	BasicHashTable(const BasicHashTable &anotherTable);
+	BasicHashTable& operator =(const BasicHashTable &anotherTable);
+
+public:
+	BasicHashTable();
+	bool create(const Lookup &key, uint32_t token, const EntryView &entry);
+	bool read(const Lookup &key, Entry &entry);
+	bool readAt(const Lookup &key, int timestamp, Entry &entry);
+	bool update(const Lookup &key, const EntryView &newEntry);
+	bool deleteKey(const Lookup &key, int timestamp);
+	bool purgeTombstone(const Lookup &key, int deadline);
+	bool isEmpty();
+	unsigned long currentSize();
+	void clear();
+	unsigned long count(const Lookup &key);
+	void setMaxVersions(unsigned int versions);
+	void addMemoryUsage(MemoryUsage &usage);
+	iterator begin();
+	iterator end();
+	const TokenIndex & getIndex();
+	virtual ~BasicHashTable();
+};
 
 /**
  * CLASS NAME: HashTable
  *
- * DESCRIPTION: This class is a wrapper to the map provided by C++ STL.
+ * DESCRIPTION: The storage engine of a node.
+ * 				Keys of at most FIXED_KEY_SIZE bytes go to a FixedKey partition,
+ * 				so the common short key path stores keys inline and compares them
+ * 				a word at a time. Longer keys go to a VarKey partition.
+ * 				Picking the partition is the only branch on the key length.
+ * 				Each partition is split in HT_SHARDS shards by key hash, so that
+ * 				requests on different keys can be served from several threads:
+ * 				create, read, update, deleteKey and count are safe to call
+ * 				concurrently and are linearizable per key. Iterating and clear()
+ * 				need the caller to keep other threads away.
+ * 				Keys are also indexed by ReplicaType and ring token (given by the
+ * 				TokenFunction), so that the keys of a token range can be listed
+ * 				without scanning the table.
+ * 				Deletes leave a timestamped tombstone behind, and a create older
+ * 				than the tombstone of its key is refused, so that a stale copy of a
+ * 				deleted key cannot be written back. Tombstones are dropped by
+ * 				purgeTombstone() in memory and by compaction in the LSM engine.
+ * 				readAt() reads a key as it was at a past time, from the last
+ * 				maxVersions versions of the key. The LSM engine keeps only the
+ * 				newest version of a key, so there it only serves times at or
+ * 				after the last write.
+ * 				memoryUsage() accounts for the bytes of keys, values and metadata.
+ * 				Given a memory cap, hasRoom() tells whether a write still fits; the
+ * 				table does not refuse writes itself, so that recovery never fails.
+ * 				Given an LsmEngine, the table forwards every operation to it instead
+ * 				(see LsmEngine.h). iterator only walks the in memory shards; use
+ * 				range_iterator to list the keys of either engine.
  *
  */
 class HashTable {
 public:
-	map<string, string> hashTable;
-//public:
-	HashTable();
-	bool create(string key, string value);
-	string read(string key);
-	bool update(string key, string newValue);
-	bool deleteKey(string key);
+	typedef FixedKey<FIXED_KEY_SIZE> FixedKeyPolicy;
+	typedef BasicHashTable<FixedKeyPolicy> FixedKeyTable;
+	typedef BasicHashTable<VarKey> VarKeyTable;
+	// Position of a key on the ring
+	typedef size_t (*TokenFunction)(const StringView &key);
+
+	/**
+	 * CLASS NAME: iterator
+	 *
+	 * DESCRIPTION: Iterates over the fixed width shards, then over the variable width ones
+	 */
+	class iterator {
+	public:
+		iterator(HashTable *table, int shard);
+		string key() const;
+		string value() const;
+		ReplicaType replica() const;
+		Entry entry() const;
+		iterator & operator ++();
+		bool operator !=(const iterator &another) const;
+	private:
+		HashTable *table;
+		// Shards 0 .. HT_SHARDS-1 are fixed width, HT_SHARDS .. 2*HT_SHARDS-1 variable width
+		int shard;
+		FixedKeyTable::iterator fixedIt;
+		VarKeyTable::iterator varIt;
+		void settle();
+	};
+
+	/**
+	 * CLASS NAME: range_iterator
+	 *
+	 * DESCRIPTION: Iterates in token order over the keys held as one replica type
+	 * 				in a token range, merging the indexes of all the shards
+	 */
+	class range_iterator {
+	public:
+		range_iterator();
+		range_iterator(HashTable *table, ReplicaType replica, size_t firstToken, size_t lastToken);
+		StringView key() const;
+		size_t token() const;
+		range_iterator & operator ++();
+		bool operator !=(const range_iterator &another) const;
+	private:
+		/**
+		 * STRUCT NAME: Cursor
+		 *
+		 * DESCRIPTION: Current position and end of the range in the index of one shard
+		 */
+		typedef struct Cursor {
+			const TokenIndex *index;
+			TokenIndex::iterator at;
+			TokenIndex::iterator end;
+		}Cursor;
+
+		vector<Cursor> cursors;
+		// Cursor holding the smallest key, -1 once the range is exhausted
+		int current;
+		void addCursor(const TokenIndex &index, ReplicaType replica, uint32_t firstToken, uint32_t lastToken);
+		void pickSmallest();
+	};
+
+private:
+	FixedKeyTable fixedKeys[HT_SHARDS];
+	VarKeyTable varKeys[HT_SHARDS];
+	TokenFunction tokenOf;
+	// Owned, NULL unless the LSM engine is selected
+	LsmEngine *lsm;
+	// Bytes of memory the table may hold, 0 for no limit
+	size_t memoryCap;
+
+	template <class KeyPolicy>
+	static unsigned int shardOf(const typename KeyPolicy::Lookup &key) {
+		typename KeyPolicy::Hash hash;
+		return (unsigned int)((uint64_t)hash(key) >> (64 - HT_SHARD_BITS));
+	}
+
+public:
+	HashTable(TokenFunction tokenOf = NULL, LsmEngine *lsm = NULL, size_t memoryCap = 0, unsigned int maxVersions = 1);
+	bool create(const StringView &key, const EntryView &entry);
+	bool read(const StringView &key, Entry &entry);
+	bool readAt(const StringView &key, int timestamp, Entry &entry);
+	bool readView(const StringView &key, EntryView &entry);
+	bool update(const StringView &key, const EntryView &newEntry);
+	bool deleteKey(const StringView &key, int timestamp);
+	bool purgeTombstone(const StringView &key, int deadline);
 	bool isEmpty();
 	unsigned long currentSize();
 	void clear();
-	unsigned long count(string key);
+	unsigned long count(const string &key);
+	MemoryUsage memoryUsage();
+	bool hasRoom(size_t keySize, size_t valueSize);
+	iterator begin();
+	iterator end();
+	range_iterator rangeBegin(ReplicaType replica, size_t firstToken, size_t lastToken);
+	range_iterator rangeEnd();
 	virtual ~HashTable();
 };
 
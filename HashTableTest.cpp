@@ -0,0 +1,185 @@
+/**********************************
+ * FILE NAME: HashTableTest.cpp
+ *
+ * DESCRIPTION: Concurrent reader/writer test of the in memory HashTable.
+ * 				Writer threads update their keys over and over with growing
+ * 				counters, with values of alternating sizes so that the arenas
+ * 				compact, and keep adding and deleting keys so that the shards
+ * 				rehash and reindex. Reader threads read the same keys meanwhile
+ * 				and check that every read finds its key, returns a whole value
+ * 				of that key and never goes back to an older counter.
+ **********************************/
+
+#include "HashTable.h"
+#include <thread>
+#include <atomic>
+
+/*
+ * Macros
+ */
+#define TEST_WRITERS 2
+#define TEST_READERS 4
+#define TEST_KEYS 256
+#define TEST_ROUNDS 400
+#define TEST_SMALL_VALUE 24
+#define TEST_LARGE_VALUE 400
+
+static std::atomic<int> writersLeft(TEST_WRITERS);
+static std::atomic<unsigned long> errors(0);
+static std::atomic<unsigned long> reads(0);
+
+/**
+ * FUNCTION NAME: testKey
+ *
+ * DESCRIPTION: Returns the name of a key of a writer. Short keys are stored inline,
+ * 				so every other key is long enough to live in the arena.
+ */
+static string testKey(int writer, int key) {
+	string name = "w" + to_string(writer) + "-k" + to_string(key);
+	if ( key % 2 ) {
+		name += "-with-a-name-too-long-to-be-stored-inline";
+	}
+	return name;
+}
+
+/**
+ * FUNCTION NAME: testValue
+ *
+ * DESCRIPTION: Returns the value holding the given counter for a key
+ */
+static string testValue(const string &key, unsigned long counter) {
+	string value = key + "#" + to_string(counter) + "#";
+	value.append(counter % 2 ? TEST_LARGE_VALUE : TEST_SMALL_VALUE, (char)('a' + counter % 26));
+	return value;
+}
+
+/**
+ * FUNCTION NAME: checkValue
+ *
+ * DESCRIPTION: Checks that value is a whole value written for key
+ *
+ * RETURNS:
+ * counter the value was written with
+ * -1 if the value is torn or belongs to another key
+ */
+static long checkValue(const string &key, const string &value) {
+	if ( value.compare(0, key.size() + 1, key + "#") != 0 ) {
+		return -1;
+	}
+	size_t end = value.find('#', key.size() + 1);
+	if ( end == string::npos ) {
+		return -1;
+	}
+	unsigned long counter = stoul(value.substr(key.size() + 1, end - key.size() - 1));
+	return value == testValue(key, counter) ? (long)counter : -1;
+}
+
+/**
+ * FUNCTION NAME: writer
+ *
+ * DESCRIPTION: Body of a writer thread
+ */
+static void writer(HashTable *table, int id) {
+	for ( unsigned long round = 1; round <= TEST_ROUNDS; round++ ) {
+		for ( int k = 0; k < TEST_KEYS; k++ ) {
+			string key = testKey(id, k);
+			Entry entry(testValue(key, round), (int)round, PRIMARY);
+			if ( !table->update(key, entry) ) {
+				errors++;
+			}
+		}
+		// Short lived keys grow and shrink the table under the readers
+		string extra = testKey(id, TEST_KEYS + (int)round);
+		Entry entry(testValue(extra, round), (int)round, PRIMARY);
+		table->create(extra, entry);
+		if ( round > 8 ) {
+			string old = testKey(id, TEST_KEYS + (int)round - 8);
+			table->deleteKey(old, (int)round);
+			table->purgeTombstone(old, (int)round);
+		}
+	}
+	writersLeft--;
+}
+
+/**
+ * FUNCTION NAME: reader
+ *
+ * DESCRIPTION: Body of a reader thread
+ */
+static void reader(HashTable *table, int id) {
+	vector<long> lastSeen(TEST_WRITERS * TEST_KEYS, 0);
+	unsigned long next = (unsigned long)id;
+	while ( writersLeft.load() > 0 ) {
+		next = next * 6364136223846793005UL + 1442695040888963407UL;
+		int w = (int)((next >> 33) % TEST_WRITERS);
+		int k = (int)((next >> 40) % TEST_KEYS);
+		string key = testKey(w, k);
+		Entry entry;
+		if ( !table->read(key, entry) ) {
+			errors++;
+			continue;
+		}
+		long counter = checkValue(key, entry.value);
+		long &last = lastSeen[w * TEST_KEYS + k];
+		if ( counter < 0 || counter < last ) {
+			errors++;
+		}
+		else {
+			last = counter;
+		}
+		reads++;
+	}
+}
+
+/**
+ * FUNCTION NAME: main
+ *
+ * DESCRIPTION: Runs the writers and readers, then checks the final state of the table
+ */
+int main(int argc, char *argv[]) {
+	HashTable table;
+	for ( int w = 0; w < TEST_WRITERS; w++ ) {
+		for ( int k = 0; k < TEST_KEYS; k++ ) {
+			string key = testKey(w, k);
+			table.create(key, Entry(testValue(key, 0), 0, PRIMARY));
+		}
+	}
+
+	vector<std::thread> threads;
+	for ( int i = 0; i < TEST_READERS; i++ ) {
+		threads.push_back(std::thread(reader, &table, i + 1));
+	}
+	for ( int i = 0; i < TEST_WRITERS; i++ ) {
+		threads.push_back(std::thread(writer, &table, i));
+	}
+	for ( unsigned int i = 0; i < threads.size(); i++ ) {
+		threads[i].join();
+	}
+
+	// Every key holds its last value, and the index lists every live key once
+	for ( int w = 0; w < TEST_WRITERS; w++ ) {
+		for ( int k = 0; k < TEST_KEYS; k++ ) {
+			string key = testKey(w, k);
+			Entry entry;
+			if ( !table.read(key, entry) || checkValue(key, entry.value) != TEST_ROUNDS ) {
+				errors++;
+			}
+		}
+	}
+	unsigned long indexed = 0;
+	for ( HashTable::range_iterator it = table.rangeBegin(PRIMARY, 0, ~(size_t)0); it != table.rangeEnd(); ++it ) {
+		indexed++;
+	}
+	if ( indexed != table.currentSize() ) {
+		errors++;
+	}
+
+	cout << "Reads: " << reads.load() << ", writes: " << TEST_WRITERS * TEST_ROUNDS * (TEST_KEYS + 3)
+			<< ", keys: " << table.currentSize() << ", errors: " << errors.load() << endl;
+	if ( errors.load() != 0 ) {
+		cout << "CONCURRENT TEST FAILED" << endl;
+		return 1;
+	}
+	cout << "CONCURRENT TEST PASSED" << endl;
+	return 0;
+}
@@ -0,0 +1,236 @@
+/**********************************
+ * FILE NAME: HintStore.cpp
+ *
+ * DESCRIPTION: Definition of the HintStore class
+ **********************************/
+
+#include "HintStore.h"
+#include "Coding.h"
+#include <dirent.h>
+#include <errno.h>
+#include <sys/stat.h>
+
+/**
+ * Constructor
+ */
+HintStore::HintStore(const string &directory, int window, size_t maxHints): directory(directory), window(window),
+		maxHints(maxHints), dropped(0) {}
+
+/**
+ * Destructor
+ */
+HintStore::~HintStore() {}
+
+/**
+ * FUNCTION NAME: path
+ *
+ * DESCRIPTION: Returns the path of the hint file of the replica at address target
+ */
+string HintStore::path(const string &target) {
+	string name = target;
+	replace(name.begin(), name.end(), ':', '_');
+	return directory + "/" + HINT_FILE_PREFIX + name;
+}
+
+/**
+ * FUNCTION NAME: load
+ *
+ * DESCRIPTION: Reads the hint files of the directory back. A file cut short by a crash
+ * 				keeps the hints before its last complete record.
+ *
+ * RETURNS:
+ * true on SUCCESS
+ * false if the directory could not be listed
+ */
+bool HintStore::load() {
+	if ( directory.empty() ) {
+		return true;
+	}
+	DIR *dir = opendir(directory.c_str());
+	if ( dir == NULL ) {
+		return errno == ENOENT;
+	}
+	const size_t prefixSize = strlen(HINT_FILE_PREFIX);
+	struct dirent *file;
+	while ( (file = readdir(dir)) != NULL ) {
+		string name = file->d_name;
+		if ( name.compare(0, prefixSize, HINT_FILE_PREFIX) != 0 ) {
+			continue;
+		}
+		string target = name.substr(prefixSize);
+		replace(target.begin(), target.end(), '_', ':');
+		ifstream in((directory + "/" + name).c_str(), ios::binary);
+		string data((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+		size_t pos = 0;
+		uint32_t magic;
+		if ( !getUint32(data, pos, magic) || magic != HINT_MAGIC ) {
+			continue;
+		}
+		deque<Hint> &queue = hints[target];
+		uint32_t time;
+		Hint hint;
+		while ( getUint32(data, pos, time) && getBytes(data, pos, hint.message) ) {
+			hint.time = (int)time;
+			queue.push_back(hint);
+		}
+	}
+	closedir(dir);
+	return true;
+}
+
+/**
+ * FUNCTION NAME: add
+ *
+ * DESCRIPTION: Keeps message for the replica at address target, unless it already has
+ * 				maxHints hints waiting
+ *
+ * RETURNS:
+ * true if the hint was kept
+ * false if it was dropped
+ */
+bool HintStore::add(const string &target, const string &message, int now) {
+	deque<Hint> &queue = hints[target];
+	expire(queue, now);
+	if ( queue.size() >= maxHints ) {
+		dropped++;
+		return false;
+	}
+	Hint hint;
+	hint.time = now;
+	hint.message = message;
+	queue.push_back(hint);
+	if ( directory.empty() ) {
+		return true;
+	}
+
+	if ( queue.size() == 1 ) {
+		// First hint waiting: start the file over rather than append to hints that expired
+		return rewrite(target);
+	}
+	string record;
+	putUint32(record, (uint32_t)hint.time);
+	putBytes(record, hint.message);
+	int fd = ::open(path(target).c_str(), O_WRONLY | O_APPEND);
+	if ( fd < 0 ) {
+		return rewrite(target);
+	}
+	bool ok = write(fd, record.data(), record.size()) == (ssize_t)record.size();
+	close(fd);
+	return ok;
+}
+
+/**
+ * FUNCTION NAME: take
+ *
+ * DESCRIPTION: Removes up to most of the oldest hints of the replica at address target
+ * 				and appends them to batch, dropping the ones older than the window first
+ *
+ * RETURNS:
+ * the number of hints appended
+ */
+size_t HintStore::take(const string &target, size_t most, int now, vector<Hint> &batch) {
+	map<string, deque<Hint> >::iterator found = hints.find(target);
+	if ( found == hints.end() ) {
+		return 0;
+	}
+	deque<Hint> &queue = found->second;
+	size_t before = queue.size();
+	expire(queue, now);
+	size_t taken = 0;
+	while ( taken < most && !queue.empty() ) {
+		batch.push_back(queue.front());
+		queue.pop_front();
+		taken++;
+	}
+	if ( queue.size() != before ) {
+		rewrite(target);
+	}
+	if ( queue.empty() ) {
+		hints.erase(found);
+	}
+	return taken;
+}
+
+/**
+ * FUNCTION NAME: expire
+ *
+ * DESCRIPTION: Drops the hints of queue older than the window
+ */
+void HintStore::expire(deque<Hint> &queue, int now) {
+	while ( !queue.empty() && queue.front().time + window < now ) {
+		queue.pop_front();
+		dropped++;
+	}
+}
+
+/**
+ * FUNCTION NAME: rewrite
+ *
+ * DESCRIPTION: Replaces the hint file of target with the hints it has left, or deletes it
+ * 				when there are none. The file is written under a temporary name first.
+ */
+bool HintStore::rewrite(const string &target) {
+	if ( directory.empty() ) {
+		return true;
+	}
+	string file = path(target);
+	map<string, deque<Hint> >::iterator found = hints.find(target);
+	if ( found == hints.end() || found->second.empty() ) {
+		return unlink(file.c_str()) == 0 || errno == ENOENT;
+	}
+	string data;
+	putUint32(data, HINT_MAGIC);
+	for ( deque<Hint>::iterator it = found->second.begin(); it != found->second.end(); ++it ) {
+		putUint32(data, (uint32_t)it->time);
+		putBytes(data, it->message);
+	}
+	string temporary = file + ".tmp";
+	int fd = ::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if ( fd < 0 ) {
+		return false;
+	}
+	bool ok = write(fd, data.data(), data.size()) == (ssize_t)data.size();
+	ok = close(fd) == 0 && ok;
+	if ( !ok || rename(temporary.c_str(), file.c_str()) != 0 ) {
+		unlink(temporary.c_str());
+		return false;
+	}
+	return true;
+}
+
+/**
+ * FUNCTION NAME: targets
+ *
+ * DESCRIPTION: Returns the addresses of the replicas that have hints waiting
+ */
+vector<string> HintStore::targets() {
+	vector<string> result;
+	for ( map<string, deque<Hint> >::iterator it = hints.begin(); it != hints.end(); ++it ) {
+		if ( !it->second.empty() ) {
+			result.push_back(it->first);
+		}
+	}
+	return result;
+}
+
+/**
+ * FUNCTION NAME: count
+ *
+ * DESCRIPTION: Returns the number of hints waiting, for every replica
+ */
+unsigned long HintStore::count() {
+	unsigned long total = 0;
+	for ( map<string, deque<Hint> >::iterator it = hints.begin(); it != hints.end(); ++it ) {
+		total += it->second.size();
+	}
+	return total;
+}
+
+/**
+ * FUNCTION NAME: droppedCount
+ *
+ * DESCRIPTION: Returns the number of hints dropped, over the bound or the window
+ */
+unsigned long HintStore::droppedCount() {
+	return dropped;
+}
@@ -0,0 +1,77 @@
+/**********************************
+ * FILE NAME: HintStore.h
+ *
+ * DESCRIPTION: Header file of the HintStore class
+ **********************************/
+
+#ifndef HINTSTORE_H_
+#define HINTSTORE_H_
+
+/**
+ * Header files
+ */
+#include "stdincludes.h"
+#include <stdint.h>
+#include <deque>
+
+/*
+ * Macros
+ */
+// First 4 bytes of a hint file
+#define HINT_MAGIC 0x4b564854
+// Hint files are named this prefix followed by the address of their replica
+#define HINT_FILE_PREFIX "hints-"
+
+/**
+ * STRUCT NAME: Hint
+ *
+ * DESCRIPTION: A write a replica missed: the time the coordinator took it, and the
+ * 				serialized CREATE or UPDATE to send to the replica once it is back
+ */
+typedef struct Hint {
+	int time;
+	string message;
+}Hint;
+
+/**
+ * CLASS NAME: HintStore
+ *
+ * DESCRIPTION: Writes a coordinator could not send because the membership protocol reports
+ * 				their replica failed, oldest first, by replica address.
+ * 				A hint lives window time units: a replica down for longer is left to
+ * 				stabilization, and its hints are dropped. At most maxHints are kept per
+ * 				replica; the hints past the bound are dropped as they come.
+ * 				Given a directory, the hints of a replica are kept in one file:
+ * 				HINT_MAGIC, then (time, message) records. add() appends to it, and take()
+ * 				rewrites it with the hints left, or deletes it once there are none, so
+ * 				hints survive a restart of the coordinator. Hints are not synced: losing
+ * 				the last ones to a crash only leaves the repair to stabilization.
+ */
+class HintStore {
+private:
+	// Empty to keep the hints in memory only
+	string directory;
+	int window;
+	size_t maxHints;
+	map<string, deque<Hint> > hints;
+	unsigned long dropped;
+
+	string path(const string &target);
+	bool rewrite(const string &target);
+	void expire(deque<Hint> &queue, int now);
+
+	HintStore(const HintStore &anotherStore);
+	HintStore& operator =(const HintStore &anotherStore);
+
+public:
+	HintStore(const string &directory, int window, size_t maxHints);
+	bool load();
+	bool add(const string &target, const string &message, int now);
+	size_t take(const string &target, size_t most, int now, vector<Hint> &batch);
+	vector<string> targets();
+	unsigned long count();
+	unsigned long droppedCount();
+	virtual ~HintStore();
+};
+
+#endif /* HINTSTORE_H_ */
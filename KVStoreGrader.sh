@@ -50,6 +50,18 @@ QUORUMPLUSONE=3
 UPDATE_OPERATION="UPDATE OPERATION"
 UPDATE_SUCCESS="update success"
 UPDATE_FAILURE="update fail"
+MEMORY_CAP_REACHED="memory cap"
+CREATE_FAILURE="create fail"
+REPLICA_FULL="over its memory cap"
+RESTARTING="Restarting with"
+RECOVERED="Recovered [0-9]* keys"
+TTL_WRITE="OPERATION KEY: .* TTL:"
+READ_AT_TIMESTAMP="TIMESTAMP:"
+LSM_STATS="LSM compactions:"
+NODE_FAILED="Node failed at"
+HINTS_REPLAYED="Replayed [1-9][0-9]* hints"
+WRITTEN_TO_ONE_REPLICA="written to this replica only"
+REPLICAS_DIFFER="differ in [1-9][0-9]* token ranges"
 
 echo ""
 echo "############################"
@@ -69,6 +81,7 @@ then
     	echo "COMPILATION ERROR !!!"
     	exit
     fi
+    rm -rf data
     ./Application ./testcases/create.conf > /dev/null 2>&1
 else
 	make clean
@@ -78,6 +91,7 @@ else
     	echo "COMPILATION ERROR !!!"
     	exit
     fi
+	rm -rf data
 	./Application ./testcases/create.conf
 fi
 
@@ -139,6 +153,7 @@ then
     	echo "COMPILATION ERROR !!!"
     	exit
     fi
+    rm -rf data
     ./Application ./testcases/delete.conf > /dev/null 2>&1
 else
 	make clean
@@ -148,6 +163,7 @@ else
     	echo "COMPILATION ERROR !!!"
     	exit
     fi
+	rm -rf data
 	./Application ./testcases/delete.conf
 fi
 
@@ -237,6 +253,7 @@ then
     	echo "COMPILATION ERROR !!!"
     	exit
     fi
+    rm -rf data
     ./Application ./testcases/read.conf > /dev/null 2>&1
 else
 	make clean
@@ -246,6 +263,7 @@ else
     	echo "COMPILATION ERROR !!!"
     	exit
     fi
+	rm -rf data
 	./Application ./testcases/read.conf
 fi
 
@@ -445,6 +463,7 @@ then
     	echo "COMPILATION ERROR !!!"
     	exit
     fi
+    rm -rf data
     ./Application ./testcases/update.conf > /dev/null 2>&1
 else
 	make clean
@@ -454,6 +473,7 @@ else
     	echo "COMPILATION ERROR !!!"
     	exit
     fi
+	rm -rf data
 	./Application ./testcases/update.conf
 fi
 
@@ -626,5 +646,1003 @@ GRADE=`echo ${GRADE} ${UPDATE_TEST5_SCORE} | awk '{print $1 + $2}'`
 #echo ""
 
 echo ""
-echo "TOTAL GRADE: ${GRADE} / 90" 
+echo "############################"
+echo " MEMORY CAP TEST"
+echo "############################"
+echo ""
+
+MEMCAP_TEST_STATUS="${SUCCESS}"
+MEMCAP_TEST_SCORE=0
+
+if [ "${verbose}" -eq 0 ]
+then
+    make clean > /dev/null 2>&1
+    make > /dev/null 2>&1
+    if [ $? -ne "${SUCCESS}" ]
+    then
+    	echo "COMPILATION ERROR !!!"
+    	exit
+    fi
+    rm -rf data
+    ./Application ./testcases/memcap.conf > /dev/null 2>&1
+else
+	make clean
+	make
+	if [ $? -ne "${SUCCESS}" ]
+	then
+    	echo "COMPILATION ERROR !!!"
+    	exit
+    fi
+	rm -rf data
+	./Application ./testcases/memcap.conf
+fi
+
+echo "TEST 1: Create 3 replicas of every key under a memory cap of 100000 bytes per node"
+
+create_count=`grep -i "${CREATE_OPERATION}" dbg.log | wc -l`
+create_success_count=`grep -i "${CREATE_SUCCESS}" dbg.log | wc -l`
+expected_count=$(( ${create_count} * ${RFPLUSONE} ))
+cap_reached_count=`grep -i "${MEMORY_CAP_REACHED}" dbg.log | wc -l`
+
+if [ ${create_success_count} -ne ${expected_count} -o ${cap_reached_count} -ne 0 ]
+then
+	MEMCAP_TEST_STATUS="${FAILURE}"
+fi
+
+if [ "${MEMCAP_TEST_STATUS}" -eq "${SUCCESS}" ]
+then
+	MEMCAP_TEST_SCORE=3
+fi
+
+# Display score
+echo "TEST 1 SCORE..................: ${MEMCAP_TEST_SCORE} / 3"
+# Add to grade
+GRADE=$(( ${GRADE} + ${MEMCAP_TEST_SCORE} ))
+
+echo ""
+echo "############################"
+echo " MEMORY FULL TEST"
+echo "############################"
+echo ""
+
+MEMFULL_TEST1_STATUS="${FAILURE}"
+MEMFULL_TEST1_SCORE=0
+MEMFULL_TEST2_STATUS="${FAILURE}"
+MEMFULL_TEST2_SCORE=0
+MEMFULL_TEST3_STATUS="${FAILURE}"
+MEMFULL_TEST3_SCORE=0
+
+if [ "${verbose}" -eq 0 ]
+then
+    make clean > /dev/null 2>&1
+    make > /dev/null 2>&1
+    if [ $? -ne "${SUCCESS}" ]
+    then
+    	echo "COMPILATION ERROR !!!"
+    	exit
+    fi
+    rm -rf data
+    ./Application ./testcases/memfull.conf > /dev/null 2>&1
+else
+	make clean
+	make
+	if [ $? -ne "${SUCCESS}" ]
+	then
+    	echo "COMPILATION ERROR !!!"
+    	exit
+    fi
+	rm -rf data
+	./Application ./testcases/memfull.conf
+fi
+
+echo "TEST 1: Create keys until the memory cap is reached. Nodes should refuse creates with REPLY_FULL once they are full"
+echo "TEST 2: Create one more key once the nodes are full. Create should fail"
+echo "TEST 3: Read a key created before the nodes were full. Read should succeed"
+
+# Keys written before the cap was reached, caps reached and replicas refusing writes
+full_create_success_count=`grep -i "coordinator: ${CREATE_SUCCESS}" dbg.log | grep "key=fullKey[0-9]" | wc -l`
+cap_reached_count=`grep -i "${MEMORY_CAP_REACHED} of .* reached" dbg.log | wc -l`
+replica_full_count=`grep -i "${REPLICA_FULL}" dbg.log | wc -l`
+if [ "${full_create_success_count}" -gt 0 -a "${cap_reached_count}" -gt 0 -a "${replica_full_count}" -gt 0 ]
+then
+	MEMFULL_TEST1_STATUS="${SUCCESS}"
+fi
+
+late_create_fail_count=`grep -i "coordinator: ${CREATE_FAILURE}" dbg.log | grep "key=fullKeyLate," | wc -l`
+late_create_success_count=`grep -i "${CREATE_SUCCESS}" dbg.log | grep "key=fullKeyLate," | wc -l`
+if [ "${late_create_fail_count}" -eq 1 -a "${late_create_success_count}" -lt "${QUORUM}" ]
+then
+	MEMFULL_TEST2_STATUS="${SUCCESS}"
+fi
+
+read_key=`grep -i "${READ_OPERATION}" dbg.log | cut -d" " -f7`
+read_value=`grep -i "${READ_OPERATION}" dbg.log | cut -d" " -f9`
+read_success_count=`grep -i "${READ_SUCCESS}" dbg.log | grep "key=${read_key}, value=${read_value}" | wc -l`
+if [ "${read_key}" -a \( "${read_success_count}" -eq "${QUORUMPLUSONE}" -o "${read_success_count}" -eq "${RFPLUSONE}" \) ]
+then
+	MEMFULL_TEST3_STATUS="${SUCCESS}"
+fi
+
+if [ "${MEMFULL_TEST1_STATUS}" -eq "${SUCCESS}" ]
+then
+	MEMFULL_TEST1_SCORE=3
+fi
+if [ "${MEMFULL_TEST2_STATUS}" -eq "${SUCCESS}" ]
+then
+	MEMFULL_TEST2_SCORE=3
+fi
+if [ "${MEMFULL_TEST3_STATUS}" -eq "${SUCCESS}" ]
+then
+	MEMFULL_TEST3_SCORE=3
+fi
+
+# Display score
+echo "TEST 1 SCORE..................: ${MEMFULL_TEST1_SCORE} / 3"
+echo "TEST 2 SCORE..................: ${MEMFULL_TEST2_SCORE} / 3"
+echo "TEST 3 SCORE..................: ${MEMFULL_TEST3_SCORE} / 3"
+# Add to grade
+GRADE=$(( ${GRADE} + ${MEMFULL_TEST1_SCORE} ))
+GRADE=$(( ${GRADE} + ${MEMFULL_TEST2_SCORE} ))
+GRADE=$(( ${GRADE} + ${MEMFULL_TEST3_SCORE} ))
+
+echo ""
+echo "############################"
+echo " TTL TEST"
+echo "############################"
+echo ""
+
+TTL_TEST1_STATUS="${SUCCESS}"
+TTL_TEST1_SCORE=0
+TTL_TEST2_STATUS="${SUCCESS}"
+TTL_TEST2_SCORE=0
+
+if [ "${verbose}" -eq 0 ]
+then
+    make clean > /dev/null 2>&1
+    make > /dev/null 2>&1
+    if [ $? -ne "${SUCCESS}" ]
+    then
+    	echo "COMPILATION ERROR !!!"
+    	exit
+    fi
+    rm -rf data
+    ./Application ./testcases/ttl.conf > /dev/null 2>&1
+else
+	make clean
+	make
+	if [ $? -ne "${SUCCESS}" ]
+	then
+    	echo "COMPILATION ERROR !!!"
+    	exit
+    fi
+	rm -rf data
+	./Application ./testcases/ttl.conf
+fi
+
+echo "TEST 1: Create a key and update another one with a TTL. Check for their values being read at least in quorum of replicas before the TTL is over"
+echo "TEST 2: Read both keys after the TTL is over. Reads should fail"
+
+# Time of the reads before and after the TTL is over
+ttl_read_times=`grep -i "${READ_OPERATION}" dbg.log | sed 's/^[^[]*\[\([0-9]*\)\].*/\1/' | sort -n | uniq`
+ttl_test1_time=`echo "${ttl_read_times}" | head -1`
+ttl_test2_time=`echo "${ttl_read_times}" | sed -n 2p`
+
+ttl_keys=`grep -i "${TTL_WRITE}" dbg.log | cut -d" " -f7`
+if [ -z "${ttl_keys}" -o -z "${ttl_test2_time}" ]
+then
+	TTL_TEST1_STATUS="${FAILURE}"
+	TTL_TEST2_STATUS="${FAILURE}"
+fi
+for key in ${ttl_keys}
+do
+	value=`grep -i "${TTL_WRITE}" dbg.log | grep " ${key} " | cut -d" " -f9`
+	ttl_test1_success_count=0
+	ttl_test2_fail_count=0
+	for time in `grep -i "${READ_SUCCESS}" dbg.log | grep "key=${key}, value=${value}" | sed 's/^[^[]*\[\([0-9]*\)\].*/\1/'`
+	do
+		if [ "${time}" -ge "${ttl_test1_time}" -a "${time}" -lt "${ttl_test2_time}" ]
+		then
+			ttl_test1_success_count=$(( ${ttl_test1_success_count} + 1 ))
+		fi
+	done
+	for time in `grep -i "${READ_FAILURE}" dbg.log | grep "key=${key}$" | sed 's/^[^[]*\[\([0-9]*\)\].*/\1/'`
+	do
+		if [ "${time}" -ge "${ttl_test2_time}" ]
+		then
+			ttl_test2_fail_count=$(( ${ttl_test2_fail_count} + 1 ))
+		fi
+	done
+	if [ "${ttl_test1_success_count}" -ne "${QUORUMPLUSONE}" -a "${ttl_test1_success_count}" -ne "${RFPLUSONE}" ]
+	then
+		TTL_TEST1_STATUS="${FAILURE}"
+	fi
+	if [ "${ttl_test2_fail_count}" -ne "${QUORUMPLUSONE}" -a "${ttl_test2_fail_count}" -ne "${RFPLUSONE}" ]
+	then
+		TTL_TEST2_STATUS="${FAILURE}"
+	fi
+done
+
+if [ "${TTL_TEST1_STATUS}" -eq "${SUCCESS}" ]
+then
+	TTL_TEST1_SCORE=3
+fi
+if [ "${TTL_TEST2_STATUS}" -eq "${SUCCESS}" ]
+then
+	TTL_TEST2_SCORE=3
+fi
+
+# Display score
+echo "TEST 1 SCORE..................: ${TTL_TEST1_SCORE} / 3"
+echo "TEST 2 SCORE..................: ${TTL_TEST2_SCORE} / 3"
+# Add to grade
+GRADE=$(( ${GRADE} + ${TTL_TEST1_SCORE} ))
+GRADE=$(( ${GRADE} + ${TTL_TEST2_SCORE} ))
+
+echo ""
+echo "############################"
+echo " READ AT TEST"
+echo "############################"
+echo ""
+
+READ_AT_TEST1_STATUS="${FAILURE}"
+READ_AT_TEST1_SCORE=0
+READ_AT_TEST2_STATUS="${FAILURE}"
+READ_AT_TEST2_SCORE=0
+
+if [ "${verbose}" -eq 0 ]
+then
+    make clean > /dev/null 2>&1
+    make > /dev/null 2>&1
+    if [ $? -ne "${SUCCESS}" ]
+    then
+    	echo "COMPILATION ERROR !!!"
+    	exit
+    fi
+    rm -rf data
+    ./Application ./testcases/readat.conf > /dev/null 2>&1
+else
+	make clean
+	make
+	if [ $? -ne "${SUCCESS}" ]
+	then
+    	echo "COMPILATION ERROR !!!"
+    	exit
+    fi
+	rm -rf data
+	./Application ./testcases/readat.conf
+fi
+
+echo "TEST 1: Update a key, then read it at a time before the update. Check for the old value being read at least in quorum of replicas"
+echo "TEST 2: Read the key at a time before it was created. Read should fail"
+
+read_at_test1_time=`grep -i "${READ_OPERATION}" dbg.log | grep "${READ_AT_TIMESTAMP}" | sed 's/^[^[]*\[\([0-9]*\)\].*/\1/' | sort -n | head -1`
+read_at_test2_time=`grep -i "${READ_OPERATION}" dbg.log | grep "${READ_AT_TIMESTAMP}" | sed 's/^[^[]*\[\([0-9]*\)\].*/\1/' | sort -n | sed -n 2p`
+read_at_key=`grep -i "${READ_OPERATION}" dbg.log | grep "${READ_AT_TIMESTAMP}" | head -1 | cut -d" " -f7`
+read_at_value=`grep -i "${READ_OPERATION}" dbg.log | grep "${READ_AT_TIMESTAMP}" | head -1 | cut -d" " -f9`
+
+read_at_test1_success_count=0
+read_at_test2_fail_count=0
+if [ "${read_at_key}" -a "${read_at_test2_time}" ]
+then
+	for time in `grep -i "${READ_SUCCESS}" dbg.log | grep "key=${read_at_key}, value=${read_at_value}:\|key=${read_at_key}, value=${read_at_value}$" | sed 's/^[^[]*\[\([0-9]*\)\].*/\1/'`
+	do
+		if [ "${time}" -ge "${read_at_test1_time}" -a "${time}" -lt "${read_at_test2_time}" ]
+		then
+			read_at_test1_success_count=$(( ${read_at_test1_success_count} + 1 ))
+		fi
+	done
+	for time in `grep -i "${READ_FAILURE}" dbg.log | grep "key=${read_at_key}$" | sed 's/^[^[]*\[\([0-9]*\)\].*/\1/'`
+	do
+		if [ "${time}" -ge "${read_at_test2_time}" ]
+		then
+			read_at_test2_fail_count=$(( ${read_at_test2_fail_count} + 1 ))
+		fi
+	done
+fi
+
+if [ "${read_at_test1_success_count}" -eq "${QUORUMPLUSONE}" -o "${read_at_test1_success_count}" -eq "${RFPLUSONE}" ]
+then
+	READ_AT_TEST1_STATUS="${SUCCESS}"
+fi
+if [ "${read_at_test2_fail_count}" -eq "${QUORUMPLUSONE}" -o "${read_at_test2_fail_count}" -eq "${RFPLUSONE}" ]
+then
+	READ_AT_TEST2_STATUS="${SUCCESS}"
+fi
+
+if [ "${READ_AT_TEST1_STATUS}" -eq "${SUCCESS}" ]
+then
+	READ_AT_TEST1_SCORE=3
+fi
+if [ "${READ_AT_TEST2_STATUS}" -eq "${SUCCESS}" ]
+then
+	READ_AT_TEST2_SCORE=3
+fi
+
+# Display score
+echo "TEST 1 SCORE..................: ${READ_AT_TEST1_SCORE} / 3"
+echo "TEST 2 SCORE..................: ${READ_AT_TEST2_SCORE} / 3"
+# Add to grade
+GRADE=$(( ${GRADE} + ${READ_AT_TEST1_SCORE} ))
+GRADE=$(( ${GRADE} + ${READ_AT_TEST2_SCORE} ))
+
+echo ""
+echo "############################"
+echo " SCAN TEST"
+echo "############################"
+echo ""
+
+SCAN_TEST1_STATUS="${FAILURE}"
+SCAN_TEST1_SCORE=0
+SCAN_TEST2_STATUS="${FAILURE}"
+SCAN_TEST2_SCORE=0
+SCAN_TEST3_STATUS="${FAILURE}"
+SCAN_TEST3_SCORE=0
+
+if [ "${verbose}" -eq 0 ]
+then
+    make clean > /dev/null 2>&1
+    make > /dev/null 2>&1
+    if [ $? -ne "${SUCCESS}" ]
+    then
+    	echo "COMPILATION ERROR !!!"
+    	exit
+    fi
+    rm -rf data
+    ./Application ./testcases/scan.conf > /dev/null 2>&1
+else
+	make clean
+	make
+	if [ $? -ne "${SUCCESS}" ]
+	then
+    	echo "COMPILATION ERROR !!!"
+    	exit
+    fi
+	rm -rf data
+	./Application ./testcases/scan.conf
+fi
+
+echo "TEST 1: Scan the whole ring one page at a time. Scan should be done without any failed page"
+echo "TEST 2: Check that the scan lists every key exactly once, with its newest value"
+echo "TEST 3: Check that the ranges holding more than a page continue after the last key of a page"
+
+scan_done=`grep "Scan [0-9]* done" dbg.log`
+scan_done_count=`grep "Scan [0-9]* done" dbg.log | wc -l`
+scan_fail_count=`grep "Scan [0-9]* .*failed" dbg.log | wc -l`
+if [ "${scan_done_count}" -eq 1 -a "${scan_fail_count}" -eq 0 ]
+then
+	SCAN_TEST1_STATUS="${SUCCESS}"
+fi
+
+if [ "${scan_done}" ]
+then
+	scan_id=`echo "${scan_done}" | sed 's/.*Scan \([0-9]*\) done.*/\1/'`
+	# Keys with the value of their last create or update, against the keys the scan listed
+	expected_keys=`grep -i "${CREATE_OPERATION}\|${UPDATE_OPERATION}" dbg.log | awk '{ value[$6] = $8 } END { for ( key in value ) print key, value[key] }' | sort`
+	scanned_keys=`grep "Scan ${scan_id}: key=" dbg.log | sed 's/.*key=\([^ ]*\) value=\(.*\)$/\1 \2/' | sort`
+	if [ "${expected_keys}" -a "${expected_keys}" == "${scanned_keys}" ]
+	then
+		SCAN_TEST2_STATUS="${SUCCESS}"
+	fi
+	scan_continued_count=`grep "Scan ${scan_id} page of .* continues after" dbg.log | wc -l`
+	if [ "${scan_continued_count}" -gt 0 ]
+	then
+		SCAN_TEST3_STATUS="${SUCCESS}"
+	fi
+fi
+
+if [ "${SCAN_TEST1_STATUS}" -eq "${SUCCESS}" ]
+then
+	SCAN_TEST1_SCORE=3
+fi
+if [ "${SCAN_TEST2_STATUS}" -eq "${SUCCESS}" ]
+then
+	SCAN_TEST2_SCORE=4
+fi
+if [ "${SCAN_TEST3_STATUS}" -eq "${SUCCESS}" ]
+then
+	SCAN_TEST3_SCORE=3
+fi
+
+# Display score
+echo "TEST 1 SCORE..................: ${SCAN_TEST1_SCORE} / 3"
+echo "TEST 2 SCORE..................: ${SCAN_TEST2_SCORE} / 4"
+echo "TEST 3 SCORE..................: ${SCAN_TEST3_SCORE} / 3"
+# Add to grade
+GRADE=$(( ${GRADE} + ${SCAN_TEST1_SCORE} ))
+GRADE=$(( ${GRADE} + ${SCAN_TEST2_SCORE} ))
+GRADE=$(( ${GRADE} + ${SCAN_TEST3_SCORE} ))
+
+
+echo ""
+echo "############################"
+echo " CONCURRENT TEST"
+echo "############################"
+echo ""
+
+CONCURRENT_TEST_STATUS="${FAILURE}"
+CONCURRENT_TEST_SCORE=0
+
+if [ "${verbose}" -eq 0 ]
+then
+    make clean > /dev/null 2>&1
+    make HashTableTest > /dev/null 2>&1
+    if [ $? -ne "${SUCCESS}" ]
+    then
+    	echo "COMPILATION ERROR !!!"
+    	exit
+    fi
+    ./HashTableTest > test.log 2>&1
+else
+	make clean
+	make HashTableTest
+	if [ $? -ne "${SUCCESS}" ]
+	then
+    	echo "COMPILATION ERROR !!!"
+    	exit
+    fi
+	./HashTableTest | tee test.log
+fi
+
+echo "TEST 1: Readers and writers share the table while it rehashes and compacts. Every read should find a whole value, never an older one"
+
+concurrent_pass_count=`grep "CONCURRENT TEST PASSED" test.log | wc -l`
+if [ "${concurrent_pass_count}" -eq 1 ]
+then
+	CONCURRENT_TEST_STATUS="${SUCCESS}"
+fi
+
+if [ "${CONCURRENT_TEST_STATUS}" -eq "${SUCCESS}" ]
+then
+	CONCURRENT_TEST_SCORE=3
+fi
+
+# Display score
+echo "TEST 1 SCORE..................: ${CONCURRENT_TEST_SCORE} / 3"
+# Add to grade
+GRADE=$(( ${GRADE} + ${CONCURRENT_TEST_SCORE} ))
+
+echo ""
+echo "############################"
+echo " COMMIT LOG TEST"
+echo "############################"
+echo ""
+
+COMMITLOG_TEST1_STATUS="${FAILURE}"
+COMMITLOG_TEST1_SCORE=0
+COMMITLOG_TEST2_STATUS="${FAILURE}"
+COMMITLOG_TEST2_SCORE=0
+
+if [ "${verbose}" -eq 0 ]
+then
+    make clean > /dev/null 2>&1
+    make > /dev/null 2>&1
+    if [ $? -ne "${SUCCESS}" ]
+    then
+    	echo "COMPILATION ERROR !!!"
+    	exit
+    fi
+    rm -rf data
+    ./Application ./testcases/commitlog.conf > /dev/null 2>&1
+else
+	make clean
+	make
+	if [ $? -ne "${SUCCESS}" ]
+	then
+    	echo "COMPILATION ERROR !!!"
+    	exit
+    fi
+	rm -rf data
+	./Application ./testcases/commitlog.conf
+fi
+
+echo "TEST 1: Update a key, then restart its primary replica. The node should replay every key it held from its commit log"
+echo "TEST 2: Read the updated key once the node is back. Read should succeed on the restarted replica too"
+
+restart_line=`grep "${RESTARTING}" dbg.log | head -1`
+restarted_node=`echo "${restart_line}" | cut -d" " -f2`
+keys_before=`echo "${restart_line}" | sed 's/.*Restarting with \([0-9]*\) keys.*/\1/'`
+recovered_line=`grep "${RECOVERED}" dbg.log | grep "^ ${restarted_node} " | tail -1`
+keys_after=`echo "${recovered_line}" | sed 's/.*Recovered \([0-9]*\) keys.*/\1/'`
+recovered_records=`echo "${recovered_line}" | sed 's/.*, \([0-9]*\) replayed from the commit log.*/\1/'`
+if [ "${restart_line}" -a "${recovered_line}" ]
+then
+	if [ "${keys_before}" -gt 0 -a "${keys_before}" -eq "${keys_after}" -a "${recovered_records}" -gt 0 ]
+	then
+		COMMITLOG_TEST1_STATUS="${SUCCESS}"
+	fi
+fi
+
+read_key=`grep -i "${READ_OPERATION}" dbg.log | cut -d" " -f7`
+read_value=`grep -i "${READ_OPERATION}" dbg.log | cut -d" " -f9`
+read_success_count=`grep -i "${READ_SUCCESS}" dbg.log | grep "key=${read_key}, value=${read_value}" | wc -l`
+restarted_read_count=`grep -i "server: ${READ_SUCCESS}" dbg.log | grep "^ ${restarted_node} " | grep "key=${read_key}, value=${read_value}:" | wc -l`
+if [ "${read_key}" -a "${restarted_read_count}" -eq 1 ]
+then
+	if [ "${read_success_count}" -eq "${QUORUMPLUSONE}" -o "${read_success_count}" -eq "${RFPLUSONE}" ]
+	then
+		COMMITLOG_TEST2_STATUS="${SUCCESS}"
+	fi
+fi
+
+if [ "${COMMITLOG_TEST1_STATUS}" -eq "${SUCCESS}" ]
+then
+	COMMITLOG_TEST1_SCORE=3
+fi
+if [ "${COMMITLOG_TEST2_STATUS}" -eq "${SUCCESS}" ]
+then
+	COMMITLOG_TEST2_SCORE=3
+fi
+
+# Display score
+echo "TEST 1 SCORE..................: ${COMMITLOG_TEST1_SCORE} / 3"
+echo "TEST 2 SCORE..................: ${COMMITLOG_TEST2_SCORE} / 3"
+# Add to grade
+GRADE=$(( ${GRADE} + ${COMMITLOG_TEST1_SCORE} ))
+GRADE=$(( ${GRADE} + ${COMMITLOG_TEST2_SCORE} ))
+
+echo ""
+echo "############################"
+echo " SNAPSHOT TEST"
+echo "############################"
+echo ""
+
+SNAPSHOT_TEST1_STATUS="${FAILURE}"
+SNAPSHOT_TEST1_SCORE=0
+SNAPSHOT_TEST2_STATUS="${FAILURE}"
+SNAPSHOT_TEST2_SCORE=0
+
+if [ "${verbose}" -eq 0 ]
+then
+    make clean > /dev/null 2>&1
+    make > /dev/null 2>&1
+    if [ $? -ne "${SUCCESS}" ]
+    then
+    	echo "COMPILATION ERROR !!!"
+    	exit
+    fi
+    rm -rf data
+    ./Application ./testcases/snapshot.conf > /dev/null 2>&1
+else
+	make clean
+	make
+	if [ $? -ne "${SUCCESS}" ]
+	then
+    	echo "COMPILATION ERROR !!!"
+    	exit
+    fi
+	rm -rf data
+	./Application ./testcases/snapshot.conf
+fi
+
+echo "TEST 1: Restart the primary replica of an updated key. Without a commit log it should load every key it held from its last snapshot"
+echo "TEST 2: Read the updated key once the node is back. Read should succeed on the restarted replica too"
+
+restart_line=`grep "${RESTARTING}" dbg.log | head -1`
+restarted_node=`echo "${restart_line}" | cut -d" " -f2`
+keys_before=`echo "${restart_line}" | sed 's/.*Restarting with \([0-9]*\) keys.*/\1/'`
+recovered_line=`grep "${RECOVERED}" dbg.log | grep "^ ${restarted_node} " | tail -1`
+keys_after=`echo "${recovered_line}" | sed 's/.*Recovered \([0-9]*\) keys.*/\1/'`
+# Only the snapshot can bring the keys back, no commit log is kept
+recovered_records=`echo "${recovered_line}" | sed 's/.*: \([0-9]*\) records loaded from the snapshot.*/\1/'`
+if [ "${restart_line}" -a "${recovered_line}" ]
+then
+	if [ "${keys_before}" -gt 0 -a "${keys_before}" -eq "${keys_after}" -a "${recovered_records}" -gt 0 ]
+	then
+		SNAPSHOT_TEST1_STATUS="${SUCCESS}"
+	fi
+fi
+
+read_key=`grep -i "${READ_OPERATION}" dbg.log | cut -d" " -f7`
+read_value=`grep -i "${READ_OPERATION}" dbg.log | cut -d" " -f9`
+read_success_count=`grep -i "${READ_SUCCESS}" dbg.log | grep "key=${read_key}, value=${read_value}" | wc -l`
+restarted_read_count=`grep -i "server: ${READ_SUCCESS}" dbg.log | grep "^ ${restarted_node} " | grep "key=${read_key}, value=${read_value}:" | wc -l`
+if [ "${read_key}" -a "${restarted_read_count}" -eq 1 ]
+then
+	if [ "${read_success_count}" -eq "${QUORUMPLUSONE}" -o "${read_success_count}" -eq "${RFPLUSONE}" ]
+	then
+		SNAPSHOT_TEST2_STATUS="${SUCCESS}"
+	fi
+fi
+
+if [ "${SNAPSHOT_TEST1_STATUS}" -eq "${SUCCESS}" ]
+then
+	SNAPSHOT_TEST1_SCORE=3
+fi
+if [ "${SNAPSHOT_TEST2_STATUS}" -eq "${SUCCESS}" ]
+then
+	SNAPSHOT_TEST2_SCORE=3
+fi
+
+# Display score
+echo "TEST 1 SCORE..................: ${SNAPSHOT_TEST1_SCORE} / 3"
+echo "TEST 2 SCORE..................: ${SNAPSHOT_TEST2_SCORE} / 3"
+# Add to grade
+GRADE=$(( ${GRADE} + ${SNAPSHOT_TEST1_SCORE} ))
+GRADE=$(( ${GRADE} + ${SNAPSHOT_TEST2_SCORE} ))
+
+echo ""
+echo "############################"
+echo " COMPACTION TEST"
+echo "############################"
+echo ""
+
+for strategy in size_tiered leveled
+do
+	COMPACTION_TEST1_STATUS="${FAILURE}"
+	COMPACTION_TEST1_SCORE=0
+	COMPACTION_TEST2_STATUS="${SUCCESS}"
+	COMPACTION_TEST2_SCORE=0
+
+	if [ "${verbose}" -eq 0 ]
+	then
+	    make clean > /dev/null 2>&1
+	    make > /dev/null 2>&1
+	    if [ $? -ne "${SUCCESS}" ]
+	    then
+	    	echo "COMPILATION ERROR !!!"
+	    	exit
+	    fi
+	    rm -rf data
+	    ./Application ./testcases/compaction_${strategy}.conf > /dev/null 2>&1
+	else
+		make clean
+		make
+		if [ $? -ne "${SUCCESS}" ]
+		then
+	    	echo "COMPILATION ERROR !!!"
+	    	exit
+	    fi
+		rm -rf data
+		./Application ./testcases/compaction_${strategy}.conf
+	fi
+
+	echo "TEST 1 (${strategy}): Create and overwrite enough keys to flush many tables. Nodes should compact them, writing every byte more than once"
+	echo "TEST 2 (${strategy}): Read back overwritten keys. Check for their new values being read at least in quorum of replicas"
+
+	# Write amplification stays at 1 until a table gets rewritten by a compaction
+	compaction_count=`grep -i "${LSM_STATS}" dbg.log | wc -l`
+	write_amplification=`grep -i "${LSM_STATS}" dbg.log | sed 's/.*write amplification: \([0-9.]*\).*/\1/' | sort -n | tail -1`
+	if [ "${compaction_count}" -gt 0 ] && [ `echo "${write_amplification}" | awk '{print ($1 > 1)}'` -eq 1 ]
+	then
+		COMPACTION_TEST1_STATUS="${SUCCESS}"
+	fi
+
+	read_count=0
+	for read_key in `grep -i "${READ_OPERATION}" dbg.log | grep "VALUE: loadUpdate" | cut -d" " -f7`
+	do
+		read_count=$(( ${read_count} + 1 ))
+		read_value=`echo "${read_key}" | sed 's/loadKey/loadUpdate/'`
+		read_success_count=`grep -i "${READ_SUCCESS}" dbg.log | grep "key=${read_key}, value=${read_value}" | wc -l`
+		if [ "${read_success_count}" -ne "${QUORUMPLUSONE}" -a "${read_success_count}" -ne "${RFPLUSONE}" ]
+		then
+			COMPACTION_TEST2_STATUS="${FAILURE}"
+		fi
+	done
+	if [ "${read_count}" -eq 0 ]
+	then
+		COMPACTION_TEST2_STATUS="${FAILURE}"
+	fi
+
+	if [ "${COMPACTION_TEST1_STATUS}" -eq "${SUCCESS}" ]
+	then
+		COMPACTION_TEST1_SCORE=3
+	fi
+	if [ "${COMPACTION_TEST2_STATUS}" -eq "${SUCCESS}" ]
+	then
+		COMPACTION_TEST2_SCORE=3
+	fi
+
+	# Display score
+	echo "TEST 1 (${strategy}) SCORE..................: ${COMPACTION_TEST1_SCORE} / 3"
+	echo "TEST 2 (${strategy}) SCORE..................: ${COMPACTION_TEST2_SCORE} / 3"
+	# Add to grade
+	GRADE=$(( ${GRADE} + ${COMPACTION_TEST1_SCORE} ))
+	GRADE=$(( ${GRADE} + ${COMPACTION_TEST2_SCORE} ))
+done
+
+echo ""
+echo "############################"
+echo " CACHE TEST"
+echo "############################"
+echo ""
+
+CACHE_TEST1_STATUS="${FAILURE}"
+CACHE_TEST1_SCORE=0
+CACHE_TEST2_STATUS="${FAILURE}"
+CACHE_TEST2_SCORE=0
+CACHE_TEST3_STATUS="${FAILURE}"
+CACHE_TEST3_SCORE=0
+
+if [ "${verbose}" -eq 0 ]
+then
+    make clean > /dev/null 2>&1
+    make > /dev/null 2>&1
+    if [ $? -ne "${SUCCESS}" ]
+    then
+    	echo "COMPILATION ERROR !!!"
+    	exit
+    fi
+    rm -rf data
+    ./Application ./testcases/cache.conf > /dev/null 2>&1
+else
+	make clean
+	make
+	if [ $? -ne "${SUCCESS}" ]
+	then
+    	echo "COMPILATION ERROR !!!"
+    	exit
+    fi
+	rm -rf data
+	./Application ./testcases/cache.conf
+fi
+
+echo "TEST 1: Read a few hot keys over and over. Repeated reads should be served by the row cache"
+echo "TEST 2: Create and overwrite keys stored in tables. Lookups of keys sharing a block should be served by the block cache"
+echo "TEST 3: Read the hot keys. Every read should succeed with the value of the key"
+
+row_cache_hit_rate=`grep -i "${LSM_STATS}" dbg.log | sed 's/.*row cache hit rate: \([0-9.]*\).*/\1/' | sort -n | tail -1`
+if [ "${row_cache_hit_rate}" ] && [ `echo "${row_cache_hit_rate}" | awk '{print ($1 > 0)}'` -eq 1 ]
+then
+	CACHE_TEST1_STATUS="${SUCCESS}"
+fi
+
+block_cache_hit_rate=`grep -i "${LSM_STATS}" dbg.log | sed 's/.*block cache hit rate: \([0-9.]*\).*/\1/' | sort -n | tail -1`
+if [ "${block_cache_hit_rate}" ] && [ `echo "${block_cache_hit_rate}" | awk '{print ($1 > 0)}'` -eq 1 ]
+then
+	CACHE_TEST2_STATUS="${SUCCESS}"
+fi
+
+hot_read_count=`grep -i "${READ_OPERATION}" dbg.log | grep "VALUE: loadValue" | wc -l`
+hot_read_success_count=`grep -i "coordinator: ${READ_SUCCESS}" dbg.log | grep "key=loadKey\([0-9]*\), value=loadValue\1$" | wc -l`
+read_fail_count=`grep -i "coordinator: ${READ_FAILURE}" dbg.log | wc -l`
+if [ "${hot_read_count}" -gt 0 -a "${hot_read_success_count}" -eq "${hot_read_count}" -a "${read_fail_count}" -eq 0 ]
+then
+	CACHE_TEST3_STATUS="${SUCCESS}"
+fi
+
+if [ "${CACHE_TEST1_STATUS}" -eq "${SUCCESS}" ]
+then
+	CACHE_TEST1_SCORE=3
+fi
+if [ "${CACHE_TEST2_STATUS}" -eq "${SUCCESS}" ]
+then
+	CACHE_TEST2_SCORE=3
+fi
+if [ "${CACHE_TEST3_STATUS}" -eq "${SUCCESS}" ]
+then
+	CACHE_TEST3_SCORE=3
+fi
+
+# Display score
+echo "TEST 1 SCORE..................: ${CACHE_TEST1_SCORE} / 3"
+echo "TEST 2 SCORE..................: ${CACHE_TEST2_SCORE} / 3"
+echo "TEST 3 SCORE..................: ${CACHE_TEST3_SCORE} / 3"
+# Add to grade
+GRADE=$(( ${GRADE} + ${CACHE_TEST1_SCORE} ))
+GRADE=$(( ${GRADE} + ${CACHE_TEST2_SCORE} ))
+GRADE=$(( ${GRADE} + ${CACHE_TEST3_SCORE} ))
+
+echo ""
+echo "############################"
+echo " COMPRESSION TEST"
+echo "############################"
+echo ""
+
+COMPRESSION_TEST1_STATUS="${FAILURE}"
+COMPRESSION_TEST1_SCORE=0
+COMPRESSION_TEST2_STATUS="${SUCCESS}"
+COMPRESSION_TEST2_SCORE=0
+
+if [ "${verbose}" -eq 0 ]
+then
+    make clean > /dev/null 2>&1
+    make > /dev/null 2>&1
+    if [ $? -ne "${SUCCESS}" ]
+    then
+    	echo "COMPILATION ERROR !!!"
+    	exit
+    fi
+    rm -rf data
+    ./Application ./testcases/compression.conf > /dev/null 2>&1
+else
+	make clean
+	make
+	if [ $? -ne "${SUCCESS}" ]
+	then
+    	echo "COMPILATION ERROR !!!"
+    	exit
+    fi
+	rm -rf data
+	./Application ./testcases/compression.conf
+fi
+
+echo "TEST 1: Create and overwrite keys with LZ compressed blocks. The tables should take fewer bytes than the live keys and values"
+echo "TEST 2: Read back overwritten keys from the compressed tables. Check for their new values being read at least in quorum of replicas"
+
+# Uncompressed tables hold at least the bytes of the live keys and values
+compaction_count=`grep -i "${LSM_STATS}" dbg.log | wc -l`
+space_amplification=`grep -i "${LSM_STATS}" dbg.log | sed 's/.*space amplification: \([0-9.]*\).*/\1/' | sort -n | tail -1`
+if [ "${compaction_count}" -gt 0 ] && [ `echo "${space_amplification}" | awk '{print ($1 < 1)}'` -eq 1 ]
+then
+	COMPRESSION_TEST1_STATUS="${SUCCESS}"
+fi
+
+read_count=0
+for read_key in `grep -i "${READ_OPERATION}" dbg.log | grep "VALUE: loadUpdate" | cut -d" " -f7`
+do
+	read_count=$(( ${read_count} + 1 ))
+	read_value=`echo "${read_key}" | sed 's/loadKey/loadUpdate/'`
+	read_success_count=`grep -i "${READ_SUCCESS}" dbg.log | grep "key=${read_key}, value=${read_value}" | wc -l`
+	if [ "${read_success_count}" -ne "${QUORUMPLUSONE}" -a "${read_success_count}" -ne "${RFPLUSONE}" ]
+	then
+		COMPRESSION_TEST2_STATUS="${FAILURE}"
+	fi
+done
+if [ "${read_count}" -eq 0 ]
+then
+	COMPRESSION_TEST2_STATUS="${FAILURE}"
+fi
+
+if [ "${COMPRESSION_TEST1_STATUS}" -eq "${SUCCESS}" ]
+then
+	COMPRESSION_TEST1_SCORE=3
+fi
+if [ "${COMPRESSION_TEST2_STATUS}" -eq "${SUCCESS}" ]
+then
+	COMPRESSION_TEST2_SCORE=3
+fi
+
+# Display score
+echo "TEST 1 SCORE..................: ${COMPRESSION_TEST1_SCORE} / 3"
+echo "TEST 2 SCORE..................: ${COMPRESSION_TEST2_SCORE} / 3"
+# Add to grade
+GRADE=$(( ${GRADE} + ${COMPRESSION_TEST1_SCORE} ))
+GRADE=$(( ${GRADE} + ${COMPRESSION_TEST2_SCORE} ))
+
+echo ""
+echo "############################"
+echo " HINTED HANDOFF TEST"
+echo "############################"
+echo ""
+
+HINT_TEST1_STATUS="${FAILURE}"
+HINT_TEST1_SCORE=0
+HINT_TEST2_STATUS="${FAILURE}"
+HINT_TEST2_SCORE=0
+
+if [ "${verbose}" -eq 0 ]
+then
+    make clean > /dev/null 2>&1
+    make > /dev/null 2>&1
+    if [ $? -ne "${SUCCESS}" ]
+    then
+    	echo "COMPILATION ERROR !!!"
+    	exit
+    fi
+    rm -rf data
+    ./Application ./testcases/hints.conf > /dev/null 2>&1
+else
+	make clean
+	make
+	if [ $? -ne "${SUCCESS}" ]
+	then
+    	echo "COMPILATION ERROR !!!"
+    	exit
+    fi
+	rm -rf data
+	./Application ./testcases/hints.conf
+fi
+
+echo "TEST 1: Update a key while one of its replicas is down, then recover the replica. The coordinator should replay its hint to the replica"
+echo "TEST 2: Read the updated key once the replica is back. Read should succeed on the recovered replica too"
+
+failed_node=`grep "${NODE_FAILED}" dbg.log | head -1 | cut -d" " -f2`
+failed_node_id=`echo "${failed_node}" | cut -d"." -f1`
+update_coordinator=`grep -i "coordinator: ${UPDATE_SUCCESS}" dbg.log | head -1 | cut -d" " -f2`
+replayed_count=`grep "^ ${update_coordinator} " dbg.log | grep "${HINTS_REPLAYED} to ${failed_node_id}:" | wc -l`
+if [ "${failed_node}" -a "${update_coordinator}" -a "${replayed_count}" -gt 0 ]
+then
+	HINT_TEST1_STATUS="${SUCCESS}"
+fi
+
+read_key=`grep -i "${READ_OPERATION}" dbg.log | cut -d" " -f7`
+read_value=`grep -i "${READ_OPERATION}" dbg.log | cut -d" " -f9`
+read_success_count=`grep -i "${READ_SUCCESS}" dbg.log | grep "key=${read_key}, value=${read_value}" | wc -l`
+recovered_read_count=`grep -i "server: ${READ_SUCCESS}" dbg.log | grep "^ ${failed_node} " | grep "key=${read_key}, value=${read_value}:" | wc -l`
+if [ "${read_key}" -a "${recovered_read_count}" -eq 1 ]
+then
+	if [ "${read_success_count}" -eq "${QUORUMPLUSONE}" -o "${read_success_count}" -eq "${RFPLUSONE}" ]
+	then
+		HINT_TEST2_STATUS="${SUCCESS}"
+	fi
+fi
+
+if [ "${HINT_TEST1_STATUS}" -eq "${SUCCESS}" ]
+then
+	HINT_TEST1_SCORE=3
+fi
+if [ "${HINT_TEST2_STATUS}" -eq "${SUCCESS}" ]
+then
+	HINT_TEST2_SCORE=3
+fi
+
+# Display score
+echo "TEST 1 SCORE..................: ${HINT_TEST1_SCORE} / 3"
+echo "TEST 2 SCORE..................: ${HINT_TEST2_SCORE} / 3"
+# Add to grade
+GRADE=$(( ${GRADE} + ${HINT_TEST1_SCORE} ))
+GRADE=$(( ${GRADE} + ${HINT_TEST2_SCORE} ))
+
+echo ""
+echo "############################"
+echo " MERKLE REPAIR TEST"
+echo "############################"
+echo ""
+
+REPAIR_TEST1_STATUS="${FAILURE}"
+REPAIR_TEST1_SCORE=0
+REPAIR_TEST2_STATUS="${FAILURE}"
+REPAIR_TEST2_SCORE=0
+
+if [ "${verbose}" -eq 0 ]
+then
+    make clean > /dev/null 2>&1
+    make > /dev/null 2>&1
+    if [ $? -ne "${SUCCESS}" ]
+    then
+    	echo "COMPILATION ERROR !!!"
+    	exit
+    fi
+    rm -rf data
+    ./Application ./testcases/repair.conf > /dev/null 2>&1
+else
+	make clean
+	make
+	if [ $? -ne "${SUCCESS}" ]
+	then
+    	echo "COMPILATION ERROR !!!"
+    	exit
+    fi
+	rm -rf data
+	./Application ./testcases/repair.conf
+fi
+
+echo "TEST 1: Write a key to its primary replica only. The other replicas should find that their Merkle trees differ from the primary's"
+echo "TEST 2: Read the key once the replicas had time to repair it. Read should succeed on every replica"
+
+primary_node=`grep "${WRITTEN_TO_ONE_REPLICA}" dbg.log | head -1 | cut -d" " -f2`
+primary_node_id=`echo "${primary_node}" | cut -d"." -f1`
+differ_count=`grep "${REPLICAS_DIFFER}" dbg.log | grep "Replicas of ${primary_node_id}:" | cut -d" " -f2 | sort -u | wc -l`
+if [ "${primary_node}" -a "${differ_count}" -eq 2 ]
+then
+	REPAIR_TEST1_STATUS="${SUCCESS}"
+fi
+
+# Only the primary got the write: a quorum read needs a repaired replica, every replica answering needs both
+read_key=`grep -i "${READ_OPERATION}" dbg.log | cut -d" " -f7`
+read_value=`grep -i "${READ_OPERATION}" dbg.log | cut -d" " -f9`
+read_success_count=`grep -i "${READ_SUCCESS}" dbg.log | grep "key=${read_key}, value=${read_value}" | wc -l`
+if [ "${read_key}" -a "${read_success_count}" -eq "${RFPLUSONE}" ]
+then
+	REPAIR_TEST2_STATUS="${SUCCESS}"
+fi
+
+if [ "${REPAIR_TEST1_STATUS}" -eq "${SUCCESS}" ]
+then
+	REPAIR_TEST1_SCORE=3
+fi
+if [ "${REPAIR_TEST2_STATUS}" -eq "${SUCCESS}" ]
+then
+	REPAIR_TEST2_SCORE=3
+fi
+
+# Display score
+echo "TEST 1 SCORE..................: ${REPAIR_TEST1_SCORE} / 3"
+echo "TEST 2 SCORE..................: ${REPAIR_TEST2_SCORE} / 3"
+# Add to grade
+GRADE=$(( ${GRADE} + ${REPAIR_TEST1_SCORE} ))
+GRADE=$(( ${GRADE} + ${REPAIR_TEST2_SCORE} ))
+
+echo ""
+echo "TOTAL GRADE: ${GRADE} / 178" 
 echo ""
@@ -0,0 +1,189 @@
+/**********************************
+ * FILE NAME: KeyPolicy.h
+ *
+ * DESCRIPTION: Key policies the storage engine is specialized on
+ **********************************/
+
+#ifndef KEYPOLICY_H_
+#define KEYPOLICY_H_
+
+/**
+ * Header files
+ */
+#include "stdincludes.h"
+#include <stdint.h>
+#include "Arena.h"
+#include "StringView.h"
+
+/*
+ * Macros
+ */
+// Keys up to this many bytes are stored inline by the fixed width partition of the HashTable
+#define FIXED_KEY_SIZE 15
+
+/**
+ * STRUCT NAME: ArenaKey
+ *
+ * DESCRIPTION: Key record owned by the Arena of the HashTable: the key length
+ * 				followed by the key bytes. Being a single pointer, a reader that
+ * 				loads it always sees a length that matches the bytes.
+ */
+typedef struct ArenaKey {
+	const char *record;
+
+	uint32_t size() const {
+		uint32_t size;
+		memcpy(&size, record, sizeof(size));
+		return size;
+	}
+	const char *bytes() const {
+		return record + sizeof(uint32_t);
+	}
+}ArenaKey;
+
+/**
+ * STRUCT NAME: HashedKey
+ *
+ * DESCRIPTION: Lookup key with its hash, computed once per request
+ */
+typedef struct HashedKey {
+	StringView view;
+	uint64_t hash;
+}HashedKey;
+
+/**
+ * STRUCT NAME: ArenaKeyHash
+ *
+ * DESCRIPTION: Hashes stored keys and lookup keys the same way
+ */
+struct ArenaKeyHash {
+	size_t operator()(const ArenaKey &key) const {
+		return (size_t)hashBytes(key.bytes(), key.size());
+	}
+	size_t operator()(const HashedKey &key) const {
+		return (size_t)key.hash;
+	}
+};
+
+/**
+ * STRUCT NAME: ArenaKeyEqual
+ *
+ * DESCRIPTION: Compares a stored key with a lookup key
+ */
+struct ArenaKeyEqual {
+	bool operator()(const ArenaKey &key, const HashedKey &lookup) const {
+		return key.size() == lookup.view.size && memcmp(key.bytes(), lookup.view.data, lookup.view.size) == 0;
+	}
+};
+
+/**
+ * CLASS NAME: VarKey
+ *
+ * DESCRIPTION: Key policy for keys of any length.
+ * 				The key bytes are copied into the Arena and looked up through a HashedKey.
+ */
+class VarKey {
+public:
+	typedef ArenaKey Stored;
+	typedef HashedKey Lookup;
+	typedef ArenaKeyHash Hash;
+	typedef ArenaKeyEqual Equal;
+
+	static bool accepts(const StringView &key) {
+		return true;
+	}
+	static Lookup lookup(const StringView &key) {
+		Lookup hashed;
+		hashed.view = key;
+		hashed.hash = hashBytes(key.data, key.size);
+		return hashed;
+	}
+	static Stored store(const Lookup &key, Arena &arena) {
+		uint32_t size = (uint32_t)key.view.size;
+		char *record = arena.allocateKey(sizeof(size) + size);
+		memcpy(record, &size, sizeof(size));
+		memcpy(record + sizeof(size), key.view.data, size);
+		Stored stored;
+		stored.record = record;
+		return stored;
+	}
+	static void release(const Stored &key, Arena &arena) {
+		arena.releaseKey(sizeof(uint32_t) + key.size());
+	}
+	static void relocate(Stored &key, Arena &arena) {
+		const char *moved = arena.relocateKey(key.record, sizeof(uint32_t) + key.size());
+		__atomic_store_n(&key.record, moved, __ATOMIC_RELEASE);
+	}
+	static StringView view(const Stored &key) {
+		return StringView(key.bytes(), key.size());
+	}
+	static string toString(const Stored &key) {
+		return string(key.bytes(), key.size());
+	}
+};
+
+/**
+ * CLASS NAME: FixedKey
+ *
+ * DESCRIPTION: Key policy, and stored key, for keys of at most N bytes.
+ * 				The key is kept inline, zero padded to whole 64 bit words, and
+ * 				its length sits in the last byte. Two keys are then equal exactly
+ * 				when all their words are, so comparing and hashing never branch
+ * 				on the key bytes and never touch the Arena.
+ */
+template <size_t N>
+class FixedKey {
+public:
+	static const size_t WORDS = (N + 1 + 7) / 8;
+
+	uint64_t words[WORDS];
+
+	struct Hash {
+		size_t operator()(const FixedKey &key) const {
+			uint64_t hash = 0;
+			for ( size_t i = 0; i < WORDS; i++ ) {
+				hash = (hash ^ key.words[i]) * 0x9e3779b97f4a7c15ULL;
+			}
+			return (size_t)hash;
+		}
+	};
+
+	struct Equal {
+		bool operator()(const FixedKey &key, const FixedKey &lookup) const {
+			uint64_t diff = 0;
+			for ( size_t i = 0; i < WORDS; i++ ) {
+				diff |= key.words[i] ^ lookup.words[i];
+			}
+			return diff == 0;
+		}
+	};
+
+	typedef FixedKey Stored;
+	typedef FixedKey Lookup;
+
+	static bool accepts(const StringView &key) {
+		return key.size <= N;
+	}
+	static Lookup lookup(const StringView &key) {
+		FixedKey fixed;
+		memset(fixed.words, 0, sizeof(fixed.words));
+		char *bytes = (char *)fixed.words;
+		memcpy(bytes, key.data, key.size);
+		bytes[sizeof(fixed.words) - 1] = (char)key.size;
+		return fixed;
+	}
+	static Stored store(const Lookup &key, Arena &arena) {
+		return key;
+	}
+	static void release(const Stored &key, Arena &arena) {}
+	static void relocate(Stored &key, Arena &arena) {}
+	static StringView view(const Stored &key) {
+		const char *bytes = (const char *)key.words;
+		return StringView(bytes, (unsigned char)bytes[sizeof(key.words) - 1]);
+	}
+	static string toString(const Stored &key) {
+		return view(key).toString();
+	}
+};
+
+#endif /* KEYPOLICY_H_ */
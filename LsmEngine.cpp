@@ -0,0 +1,992 @@
+/**********************************
+ * FILE NAME: LsmEngine.cpp
+ *
+ * DESCRIPTION: Definition of the LsmEngine class
+ **********************************/
+
+#include "LsmEngine.h"
+#include <dirent.h>
+#include <set>
+#include <chrono>
+
+/*
+ * Read order of the tables: by level, then newest first
+ */
+static bool readOrder(SSTable *table, SSTable *another) {
+	if ( table->getLevel() != another->getLevel() ) {
+		return table->getLevel() < another->getLevel();
+	}
+	return table->getSequence() > another->getSequence();
+}
+
+static bool byFirstKey(SSTable *table, SSTable *another) {
+	return table->getFirstKey() < another->getFirstKey();
+}
+
+/**
+ * Constructor
+ */
+LsmEngine::LsmEngine(const string &directory, const LsmOptions &options, TokenFunction tokenOf): directory(directory),
+		options(options), tokenOf(tokenOf), memtableBytes(0), memtableKeyBytes(0), nextNumber(1), index(&LsmEngine::indexedKey, this),
+		indexKeyBytes(0), flushListener(NULL),
+		flushOwner(NULL), clock(0), stats(), rowCache(options.rowCacheSize), blockCache(options.blockCacheSize), stopping(false), compacting(false) {}
+
+/**
+ * Destructor
+ */
+LsmEngine::~LsmEngine() {
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		stopping = true;
+	}
+	compactionWakeup.notify_all();
+	if ( compactor.joinable() ) {
+		compactor.join();
+	}
+	flush();
+	for ( unsigned int i = 0; i < tables.size(); i++ ) {
+		delete tables[i];
+	}
+}
+
+/**
+ * FUNCTION NAME: open
+ *
+ * DESCRIPTION: Opens the engine kept in directory, which must exist, and starts its compaction thread
+ *
+ * RETURNS:
+ * the engine on SUCCESS
+ * NULL on FAILURE
+ */
+LsmEngine * LsmEngine::open(const string &directory, const LsmOptions &options, TokenFunction tokenOf) {
+	LsmEngine *engine = new LsmEngine(directory, options, tokenOf);
+	if ( !engine->load() ) {
+		delete engine;
+		return NULL;
+	}
+	if ( options.compaction != NO_COMPACTION ) {
+		engine->compactor = std::thread(&LsmEngine::compactionLoop, engine);
+	}
+	return engine;
+}
+
+/**
+ * FUNCTION NAME: setFlushListener
+ *
+ * DESCRIPTION: Registers the function called, under the engine lock, after every flush
+ */
+void LsmEngine::setFlushListener(FlushListener listener, void *owner) {
+	std::lock_guard<std::mutex> guard(lock);
+	flushListener = listener;
+	flushOwner = owner;
+}
+
+/**
+ * FUNCTION NAME: load
+ *
+ * DESCRIPTION: Opens the SSTables listed in the MANIFEST and rebuilds the TokenIndex from them.
+ * 				Tables left out of the MANIFEST by an interrupted flush or compaction are deleted.
+ */
+bool LsmEngine::load() {
+	DIR *dir = opendir(directory.c_str());
+	if ( dir == NULL ) {
+		return false;
+	}
+	set<string> files;
+	struct dirent *file;
+	while ( (file = readdir(dir)) != NULL ) {
+		unsigned long long number;
+		char suffix[8];
+		if ( sscanf(file->d_name, "sst-%llu.%7s", &number, suffix) != 2 ) {
+			continue;
+		}
+		if ( 0 == strcmp(suffix, "db") ) {
+			files.insert(file->d_name);
+		}
+		else {
+			// Leftover of a table that was never finished
+			unlink((directory + "/" + file->d_name).c_str());
+		}
+	}
+	closedir(dir);
+
+	FILE *fp = fopen((directory + "/" + LSM_MANIFEST).c_str(), "r");
+	if ( fp != NULL ) {
+		char name[64];
+		int level;
+		unsigned long long sequence;
+		while ( fscanf(fp, "%63s %d %llu", name, &level, &sequence) == 3 ) {
+			SSTable *table = SSTable::open(directory + "/" + name, sequence, level);
+			if ( table == NULL ) {
+				fclose(fp);
+				return false;
+			}
+			tables.push_back(table);
+			files.erase(name);
+		}
+		fclose(fp);
+		for ( set<string>::iterator it = files.begin(); it != files.end(); ++it ) {
+			unlink((directory + "/" + *it).c_str());
+		}
+	}
+	else {
+		// No MANIFEST yet: every table is a level 0 table whose sequence is its file number
+		for ( set<string>::iterator it = files.begin(); it != files.end(); ++it ) {
+			unsigned long long number;
+			sscanf(it->c_str(), "sst-%llu", &number);
+			SSTable *table = SSTable::open(directory + "/" + *it, number, 0);
+			if ( table == NULL ) {
+				return false;
+			}
+			tables.push_back(table);
+		}
+	}
+	for ( unsigned int i = 0; i < tables.size(); i++ ) {
+		unsigned long long number = 0;
+		sscanf(tables[i]->getPath().c_str() + directory.size(), "/sst-%llu", &number);
+		nextNumber = max(nextNumber, (uint64_t)max(number, (unsigned long long)tables[i]->getSequence()) + 1);
+	}
+	sortTables();
+
+	// Oldest first, so that newer records replace older ones
+	map<string, Entry> latest;
+	vector<pair<string, Entry> > records;
+	for ( int i = (int)tables.size() - 1; i >= 0; i-- ) {
+		records.clear();
+		if ( !tables[i]->scan(records) ) {
+			return false;
+		}
+		for ( unsigned int j = 0; j < records.size(); j++ ) {
+			latest[records[j].first] = records[j].second;
+		}
+	}
+	vector<IndexEntry> entries;
+	for ( map<string, Entry>::iterator it = latest.begin(); it != latest.end(); ++it ) {
+		clock = max(clock, it->second.timestamp);
+		if ( !(it->second.flags & ENTRY_TOMBSTONE) ) {
+			IndexEntry entry;
+			entry.replica = it->second.replica;
+			entry.token = tokenFor(it->first);
+			entry.ref = addIndexKey(it->first);
+			entries.push_back(entry);
+			stats.liveBytes += it->first.size() + it->second.value.size();
+		}
+	}
+	index.rebuild(entries);
+	return true;
+}
+
+/**
+ * FUNCTION NAME: saveManifest
+ *
+ * DESCRIPTION: Rewrites the MANIFEST with the current tables: name, level and sequence of each.
+ * 				The new MANIFEST replaces the old one atomically.
+ */
+bool LsmEngine::saveManifest() {
+	string path = directory + "/" + LSM_MANIFEST;
+	string temporary = path + ".tmp";
+	FILE *fp = fopen(temporary.c_str(), "w");
+	if ( fp == NULL ) {
+		return false;
+	}
+	bool ok = true;
+	for ( unsigned int i = 0; i < tables.size(); i++ ) {
+		const string &tablePath = tables[i]->getPath();
+		ok = ok && fprintf(fp, "%s %d %llu\n", tablePath.c_str() + directory.size() + 1, tables[i]->getLevel(),
+				(unsigned long long)tables[i]->getSequence()) > 0;
+	}
+	ok = ok && fflush(fp) == 0 && fsync(fileno(fp)) == 0;
+	fclose(fp);
+	if ( !ok || rename(temporary.c_str(), path.c_str()) != 0 ) {
+		unlink(temporary.c_str());
+		return false;
+	}
+	return true;
+}
+
+/**
+ * FUNCTION NAME: sortTables
+ *
+ * DESCRIPTION: Puts the tables back in read order
+ */
+void LsmEngine::sortTables() {
+	sort(tables.begin(), tables.end(), readOrder);
+}
+
+/**
+ * FUNCTION NAME: tablePath
+ *
+ * DESCRIPTION: Returns the path of the SSTable with the given file number
+ */
+string LsmEngine::tablePath(uint64_t number) {
+	char name[32];
+	sprintf(name, "/sst-%llu.db", (unsigned long long)number);
+	return directory + name;
+}
+
+/**
+ * FUNCTION NAME: blockCodec
+ *
+ * DESCRIPTION: Returns the codec the data blocks of new SSTables are stored with
+ */
+int LsmEngine::blockCodec() {
+	return options.compression == LZ_COMPRESSION ? BLOCK_LZ : BLOCK_RAW;
+}
+
+/**
+ * FUNCTION NAME: tokenFor
+ *
+ * DESCRIPTION: Returns the ring token of key
+ */
+uint32_t LsmEngine::tokenFor(const StringView &key) {
+	return tokenOf != NULL ? (uint32_t)tokenOf(key) : 0;
+}
+
+/**
+ * FUNCTION NAME: lookup
+ *
+ * DESCRIPTION: Copies key into lookupKey, whose capacity is reused from one operation to the
+ * 				next, and returns it. The memtable and the row cache are looked up by string.
+ * 				Only valid under the lock, until the next operation.
+ */
+const string & LsmEngine::lookup(const StringView &viewed) {
+	lookupKey.assign(viewed.data, viewed.size);
+	return lookupKey;
+}
+
+/**
+ * FUNCTION NAME: addIndexKey
+ *
+ * DESCRIPTION: Stores key for the index, in a free position if there is one, and returns its ref
+ */
+uint32_t LsmEngine::addIndexKey(const string &key) {
+	uint32_t ref;
+	if ( !freeIndexKeys.empty() ) {
+		ref = freeIndexKeys.back();
+		freeIndexKeys.pop_back();
+		indexKeys[ref] = key;
+	}
+	else {
+		ref = (uint32_t)indexKeys.size();
+		indexKeys.push_back(key);
+	}
+	indexKeyBytes += key.size();
+	return ref;
+}
+
+/**
+ * FUNCTION NAME: indexKey
+ *
+ * DESCRIPTION: Adds key to the index, held as the given replica type at the given ring token
+ */
+void LsmEngine::indexKey(unsigned char replica, uint32_t token, const string &key) {
+	index.insert(replica, token, addIndexKey(key));
+}
+
+/**
+ * FUNCTION NAME: unindexKey
+ *
+ * DESCRIPTION: Removes key from the index and frees its position in indexKeys
+ */
+void LsmEngine::unindexKey(unsigned char replica, uint32_t token, const string &key) {
+	uint32_t ref;
+	if ( index.erase(replica, token, key, ref) ) {
+		indexKeyBytes -= indexKeys[ref].size();
+		string().swap(indexKeys[ref]);
+		freeIndexKeys.push_back(ref);
+	}
+}
+
+/**
+ * FUNCTION NAME: indexedKey
+ *
+ * DESCRIPTION: KeyFunction of the index: returns the key stored under ref
+ */
+StringView LsmEngine::indexedKey(const void *owner, uint32_t ref) {
+	return StringView(static_cast<const LsmEngine *>(owner)->indexKeys[ref]);
+}
+
+/**
+ * FUNCTION NAME: find
+ *
+ * DESCRIPTION: Finds the newest record of key, tombstones included
+ *
+ * RETURNS:
+ * true if a record was found
+ * false otherwise
+ */
+bool LsmEngine::find(const string &key, Entry &entry) {
+	map<string, Entry>::iterator search = memtable.find(key);
+	if ( search != memtable.end() ) {
+		entry = search->second;
+		return true;
+	}
+	for ( unsigned int i = 0; i < tables.size(); i++ ) {
+		if ( tables[i]->get(key, entry, &blockCache) ) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+ * FUNCTION NAME: findLive
+ *
+ * DESCRIPTION: Finds the value of key
+ *
+ * RETURNS:
+ * true if the key has a value
+ * false if it has none or was deleted
+ */
+bool LsmEngine::findLive(const string &key, Entry &entry) {
+	return find(key, entry) && !(entry.flags & ENTRY_TOMBSTONE);
+}
+
+/**
+ * FUNCTION NAME: put
+ *
+ * DESCRIPTION: Writes a record to the memtable, drops the key from the row cache and flushes
+ * 				the memtable once it is full
+ */
+void LsmEngine::put(const string &key, const Entry &entry) {
+	rowCache.erase(key);
+	map<string, Entry>::iterator search = memtable.find(key);
+	if ( search != memtable.end() ) {
+		memtableBytes -= search->second.value.size();
+		search->second = entry;
+	}
+	else {
+		memtable[key] = entry;
+		memtableBytes += key.size() + LSM_RECORD_OVERHEAD;
+		memtableKeyBytes += key.size();
+	}
+	memtableBytes += entry.value.size();
+	clock = max(clock, entry.timestamp);
+	if ( memtableBytes > options.memtableSize ) {
+		flush();
+	}
+}
+
+/**
+ * FUNCTION NAME: flush
+ *
+ * DESCRIPTION: Writes the memtable to a new level 0 SSTable and empties it.
+ * 				The memtable is kept if the SSTable cannot be written.
+ */
+bool LsmEngine::flush() {
+	if ( memtable.empty() ) {
+		return true;
+	}
+	uint64_t number = nextNumber;
+	string path = tablePath(number);
+	if ( !SSTable::write(path, memtable, options.bloomFpr, blockCodec()) ) {
+		return false;
+	}
+	SSTable *table = SSTable::open(path, number, 0);
+	if ( table == NULL ) {
+		unlink(path.c_str());
+		return false;
+	}
+	tables.push_back(table);
+	sortTables();
+	if ( !saveManifest() ) {
+		tables.erase(std::find(tables.begin(), tables.end(), table));
+		table->remove();
+		delete table;
+		return false;
+	}
+	nextNumber++;
+	stats.flushedBytes += table->getFileSize();
+	memtable.clear();
+	memtableBytes = 0;
+	memtableKeyBytes = 0;
+	if ( flushListener != NULL ) {
+		flushListener(flushOwner);
+	}
+	compactionWakeup.notify_one();
+	return true;
+}
+
+/**
+ * FUNCTION NAME: create
+ *
+ * DESCRIPTION: Inserts the (key, entry) pair unless the key already has a value,
+ * 				or was deleted after the entry was written
+ *
+ * RETURNS:
+ * true on SUCCESS
+ * false on FAILURE
+ */
+bool LsmEngine::create(const StringView &viewed, const EntryView &entry) {
+	std::lock_guard<std::mutex> guard(lock);
+	const string &key = lookup(viewed);
+	Entry existing;
+	if ( find(key, existing) && (!(existing.flags & ENTRY_TOMBSTONE) || existing.timestamp > entry.timestamp) ) {
+		return false;
+	}
+	Entry stored(entry);
+	stored.flags &= ~ENTRY_TOMBSTONE;
+	put(key, stored);
+	indexKey(stored.replica, tokenFor(key), key);
+	stats.liveBytes += key.size() + stored.value.size();
+	return true;
+}
+
+/**
+ * FUNCTION NAME: read
+ *
+ * DESCRIPTION: Copies out the value of key, from the row cache when it is there
+ *
+ * RETURNS:
+ * true if found
+ * false otherwise
+ */
+bool LsmEngine::read(const StringView &viewed, Entry &entry) {
+	std::lock_guard<std::mutex> guard(lock);
+	const string &key = lookup(viewed);
+	const Entry *cached = rowCache.find(key);
+	if ( cached != NULL ) {
+		entry = *cached;
+		return true;
+	}
+	if ( !findLive(key, entry) ) {
+		return false;
+	}
+	rowCache.insert(key, entry, key.size() + entry.value.size() + LSM_RECORD_OVERHEAD);
+	return true;
+}
+
+/**
+ * FUNCTION NAME: readView
+ *
+ * DESCRIPTION: Like read, but a value found in an SSTable is not copied: entry views it in
+ * 				the mapping of the table. A copy still goes to the row cache, so that
+ * 				the next reads of a hot key skip the block search and decoding.
+ *
+ * RETURNS:
+ * true if found
+ * false otherwise
+ */
+bool LsmEngine::readView(const StringView &viewed, EntryView &entry) {
+	std::lock_guard<std::mutex> guard(lock);
+	const string &key = lookup(viewed);
+	const Entry *cached = rowCache.find(key);
+	if ( cached != NULL ) {
+		entry.assign(*cached);
+		return true;
+	}
+	map<string, Entry>::iterator search = memtable.find(key);
+	if ( search != memtable.end() ) {
+		entry.assign(search->second);
+		return !(entry.flags & ENTRY_TOMBSTONE);
+	}
+	for ( unsigned int i = 0; i < tables.size(); i++ ) {
+		if ( tables[i]->view(key, entry) ) {
+			if ( entry.flags & ENTRY_TOMBSTONE ) {
+				return false;
+			}
+			rowCache.insert(key, Entry(entry), key.size() + entry.value.size + LSM_RECORD_OVERHEAD);
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+ * FUNCTION NAME: readAt
+ *
+ * DESCRIPTION: Copies out the value key had at timestamp. Only the newest version of a key
+ * 				is kept, so a key written after timestamp is not found.
+ *
+ * RETURNS:
+ * true if found
+ * false otherwise
+ */
+bool LsmEngine::readAt(const StringView &viewed, int timestamp, Entry &entry) {
+	std::lock_guard<std::mutex> guard(lock);
+	return findLive(lookup(viewed), entry) && entry.timestamp <= timestamp;
+}
+
+/**
+ * FUNCTION NAME: update
+ *
+ * DESCRIPTION: Replaces the value of key if the key has one
+ *
+ * RETURNS:
+ * true on SUCCESS
+ * false on FAILURE
+ */
+bool LsmEngine::update(const StringView &viewed, const EntryView &newEntry) {
+	std::lock_guard<std::mutex> guard(lock);
+	const string &key = lookup(viewed);
+	Entry existing;
+	if ( !findLive(key, existing) ) {
+		return false;
+	}
+	Entry stored(newEntry);
+	stored.flags &= ~ENTRY_TOMBSTONE;
+	put(key, stored);
+	if ( existing.replica != stored.replica ) {
+		uint32_t token = tokenFor(key);
+		uint32_t ref;
+		if ( index.erase(existing.replica, token, key, ref) ) {
+			index.insert(stored.replica, token, ref);
+		}
+	}
+	stats.liveBytes = stats.liveBytes - existing.value.size() + stored.value.size();
+	return true;
+}
+
+/**
+ * FUNCTION NAME: deleteKey
+ *
+ * DESCRIPTION: Writes a tombstone, stamped with timestamp, for key if the key has a value
+ *
+ * RETURNS:
+ * true on SUCCESS
+ * false on FAILURE
+ */
+bool LsmEngine::deleteKey(const StringView &viewed, int timestamp) {
+	std::lock_guard<std::mutex> guard(lock);
+	const string &key = lookup(viewed);
+	Entry existing;
+	if ( !findLive(key, existing) ) {
+		return false;
+	}
+	Entry tombstone = existing;
+	tombstone.value.clear();
+	tombstone.timestamp = timestamp;
+	tombstone.flags |= ENTRY_TOMBSTONE;
+	put(key, tombstone);
+	unindexKey(existing.replica, tokenFor(key), key);
+	stats.liveBytes -= key.size() + existing.value.size();
+	return true;
+}
+
+/**
+ * FUNCTION NAME: currentSize
+ *
+ * DESCRIPTION: Returns the number of keys that have a value
+ */
+unsigned long LsmEngine::currentSize() {
+	std::lock_guard<std::mutex> guard(lock);
+	return index.size();
+}
+
+/**
+ * FUNCTION NAME: clear
+ *
+ * DESCRIPTION: Drops the memtable and deletes every SSTable, once the running compaction is done
+ */
+void LsmEngine::clear() {
+	std::unique_lock<std::mutex> guard(lock);
+	while ( compacting ) {
+		compactionDone.wait(guard);
+	}
+	vector<SSTable *> dropped;
+	dropped.swap(tables);
+	saveManifest();
+	for ( unsigned int i = 0; i < dropped.size(); i++ ) {
+		dropped[i]->remove();
+		delete dropped[i];
+	}
+	memtable.clear();
+	memtableBytes = 0;
+	memtableKeyBytes = 0;
+	index.clear();
+	vector<string>().swap(indexKeys);
+	vector<uint32_t>().swap(freeIndexKeys);
+	indexKeyBytes = 0;
+	stats.liveBytes = 0;
+	rowCache.clear();
+	blockCache.clear();
+}
+
+/**
+ * FUNCTION NAME: count
+ *
+ * DESCRIPTION: Returns 1 if key has a value, 0 otherwise
+ */
+unsigned long LsmEngine::count(const string &key) {
+	std::lock_guard<std::mutex> guard(lock);
+	Entry entry;
+	return findLive(key, entry) ? 1 : 0;
+}
+
+/**
+ * FUNCTION NAME: getIndex
+ *
+ * DESCRIPTION: Returns the TokenIndex of the live keys.
+ * 				As for the memory engine, the caller keeps writers away while iterating it.
+ */
+const TokenIndex & LsmEngine::getIndex() {
+	return index;
+}
+
+/**
+ * FUNCTION NAME: getStats
+ *
+ * DESCRIPTION: Returns the counters of the engine
+ */
+LsmStats LsmEngine::getStats() {
+	std::lock_guard<std::mutex> guard(lock);
+	LsmStats current = stats;
+	current.tables = tables.size();
+	current.rowCacheHits = rowCache.getHits();
+	current.rowCacheMisses = rowCache.getMisses();
+	current.blockCacheHits = blockCache.getHits();
+	current.blockCacheMisses = blockCache.getMisses();
+	current.diskBytes = 0;
+	for ( unsigned int i = 0; i < tables.size(); i++ ) {
+		current.diskBytes += tables[i]->getFileSize();
+	}
+	return current;
+}
+
+/**
+ * FUNCTION NAME: memoryUsage
+ *
+ * DESCRIPTION: Returns the bytes of memory held by the memtable, the TokenIndex and the caches
+ */
+MemoryUsage LsmEngine::memoryUsage() {
+	std::lock_guard<std::mutex> guard(lock);
+	MemoryUsage usage;
+	size_t recordBytes = memtable.size() * LSM_RECORD_OVERHEAD;
+	usage.keyBytes = memtableKeyBytes;
+	usage.valueBytes = memtableBytes - memtableKeyBytes - recordBytes;
+	usage.metadataBytes = recordBytes + index.memoryUsage() + indexKeyBytes + indexKeys.size() * sizeof(string)
+			+ rowCache.bytes() + blockCache.bytes();
+	return usage;
+}
+
+/**
+ * FUNCTION NAME: compactionLoop
+ *
+ * DESCRIPTION: Body of the compaction thread: picks a compaction under the lock, runs it
+ * 				without the lock and swaps its outputs in under the lock, until the
+ * 				engine is destroyed. Sleeps until the next flush when there is nothing to do.
+ */
+void LsmEngine::compactionLoop() {
+	std::unique_lock<std::mutex> guard(lock);
+	while ( !stopping ) {
+		CompactionJob job;
+		if ( !pickCompaction(job) ) {
+			compactionWakeup.wait(guard);
+			continue;
+		}
+		compacting = true;
+		guard.unlock();
+		vector<SSTable *> outputs;
+		bool ok = runCompaction(job, outputs);
+		guard.lock();
+		if ( ok && !installCompaction(job, outputs) ) {
+			for ( unsigned int i = 0; i < outputs.size(); i++ ) {
+				outputs[i]->remove();
+				delete outputs[i];
+			}
+			ok = false;
+		}
+		compacting = false;
+		compactionDone.notify_all();
+		if ( !ok && !stopping ) {
+			// Do not spin on a compaction that keeps failing
+			compactionWakeup.wait_for(guard, std::chrono::seconds(1));
+		}
+	}
+}
+
+/**
+ * FUNCTION NAME: pickCompaction
+ *
+ * DESCRIPTION: Picks the next compaction of the configured strategy
+ *
+ * RETURNS:
+ * true if there is one
+ * false otherwise
+ */
+bool LsmEngine::pickCompaction(CompactionJob &job) {
+	job.outputSequence = 0;
+	job.now = clock;
+	if ( options.compaction == SIZE_TIERED_COMPACTION ) {
+		return pickSizeTiered(job);
+	}
+	if ( options.compaction == LEVELED_COMPACTION ) {
+		return pickLeveled(job);
+	}
+	return false;
+}
+
+/**
+ * FUNCTION NAME: pickSizeTiered
+ *
+ * DESCRIPTION: Picks the oldest run of adjacent level 0 tables of similar size.
+ * 				The run is merged into one table that takes the place, and the
+ * 				sequence, of the newest table of the run.
+ */
+bool LsmEngine::pickSizeTiered(CompactionJob &job) {
+	int count = 0;
+	while ( count < (int)tables.size() && tables[count]->getLevel() == 0 ) {
+		count++;
+	}
+	for ( int oldest = count - 1; oldest >= STCS_MIN_THRESHOLD - 1; oldest-- ) {
+		double total = tables[oldest]->getFileSize();
+		int newest = oldest;
+		while ( newest > 0 && oldest - newest + 1 < STCS_MAX_THRESHOLD ) {
+			double size = tables[newest - 1]->getFileSize();
+			double average = total / (oldest - newest + 1);
+			if ( size < average * STCS_BUCKET_LOW || size > average * STCS_BUCKET_HIGH ) {
+				break;
+			}
+			total += size;
+			newest--;
+		}
+		if ( oldest - newest + 1 >= STCS_MIN_THRESHOLD ) {
+			job.inputs.assign(tables.begin() + newest, tables.begin() + oldest + 1);
+			job.older.assign(tables.begin() + oldest + 1, tables.end());
+			job.outputLevel = 0;
+			job.outputSequence = tables[newest]->getSequence();
+			job.splitOutputs = false;
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+ * FUNCTION NAME: pickLeveled
+ *
+ * DESCRIPTION: Picks level 0 and the level 1 tables it overlaps once level 0 has LCS_L0_TRIGGER
+ * 				tables. Otherwise picks, in the first level over its size, the table after the
+ * 				one compacted last and the tables of the next level it overlaps.
+ */
+bool LsmEngine::pickLeveled(CompactionJob &job) {
+	job.splitOutputs = true;
+	int level0 = 0;
+	while ( level0 < (int)tables.size() && tables[level0]->getLevel() == 0 ) {
+		level0++;
+	}
+	if ( level0 >= LCS_L0_TRIGGER ) {
+		string first = tables[0]->getFirstKey();
+		string last = tables[0]->getLastKey();
+		for ( int i = 1; i < level0; i++ ) {
+			first = min(first, tables[i]->getFirstKey());
+			last = max(last, tables[i]->getLastKey());
+		}
+		job.inputs.assign(tables.begin(), tables.begin() + level0);
+		for ( unsigned int i = level0; i < tables.size(); i++ ) {
+			if ( tables[i]->getLevel() == 1 && tables[i]->overlaps(first, last) ) {
+				job.inputs.push_back(tables[i]);
+			}
+			else if ( tables[i]->getLevel() > 1 ) {
+				job.older.push_back(tables[i]);
+			}
+		}
+		job.outputLevel = 1;
+		return true;
+	}
+
+	double limit = options.memtableSize;
+	for ( int level = 1; level < LCS_MAX_LEVEL; level++ ) {
+		limit *= LCS_FANOUT;
+		vector<SSTable *> members;
+		uint64_t bytes = 0;
+		for ( unsigned int i = 0; i < tables.size(); i++ ) {
+			if ( tables[i]->getLevel() == level ) {
+				members.push_back(tables[i]);
+				bytes += tables[i]->getFileSize();
+			}
+		}
+		if ( bytes <= limit ) {
+			continue;
+		}
+		sort(members.begin(), members.end(), byFirstKey);
+		SSTable *picked = members[0];
+		for ( unsigned int i = 0; i < members.size(); i++ ) {
+			if ( members[i]->getFirstKey() > compactionCursor[level] ) {
+				picked = members[i];
+				break;
+			}
+		}
+		compactionCursor[level] = picked->getLastKey();
+		job.inputs.push_back(picked);
+		for ( unsigned int i = 0; i < tables.size(); i++ ) {
+			if ( tables[i]->getLevel() == level + 1 && tables[i]->overlaps(picked->getFirstKey(), picked->getLastKey()) ) {
+				job.inputs.push_back(tables[i]);
+			}
+			else if ( tables[i]->getLevel() > level + 1 ) {
+				job.older.push_back(tables[i]);
+			}
+		}
+		job.outputLevel = level + 1;
+		return true;
+	}
+	return false;
+}
+
+/**
+ * FUNCTION NAME: runCompaction
+ *
+ * DESCRIPTION: Merges the inputs of a compaction into new tables, without the engine lock.
+ * 				For every key the record of the newest input wins. Expired tombstones
+ * 				are dropped when no older table may hold the key.
+ *
+ * RETURNS:
+ * true on SUCCESS, with the new tables in outputs
+ * false on FAILURE or if the engine is stopping, in which case nothing is left behind
+ */
+bool LsmEngine::runCompaction(const CompactionJob &job, vector<SSTable *> &outputs) {
+	vector<SSTable::Scanner *> scanners;
+	for ( unsigned int i = 0; i < job.inputs.size(); i++ ) {
+		scanners.push_back(new SSTable::Scanner(job.inputs[i]));
+	}
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	SSTableWriter *writer = NULL;
+	uint64_t number = 0;
+	uint64_t finishedBytes = 0;
+	uint64_t throttledBytes = 0;
+	bool ok = true;
+	while ( ok && !stopping ) {
+		// Inputs are newest first, so on equal keys the first scanner wins
+		int smallest = -1;
+		for ( unsigned int i = 0; i < scanners.size(); i++ ) {
+			if ( scanners[i]->valid() && (smallest < 0 || scanners[i]->key() < scanners[smallest]->key()) ) {
+				smallest = i;
+			}
+		}
+		if ( smallest < 0 ) {
+			break;
+		}
+		string key = scanners[smallest]->key();
+		Entry entry = scanners[smallest]->entry();
+		for ( unsigned int i = 0; i < scanners.size(); i++ ) {
+			if ( scanners[i]->valid() && scanners[i]->key() == key ) {
+				scanners[i]->next();
+			}
+		}
+
+		// An expired value is a tombstone written when it expired
+		if ( !(entry.flags & ENTRY_TOMBSTONE) && entry.expiredAt(job.now) ) {
+			entry.value.clear();
+			entry.timestamp = entry.expiry;
+			entry.expiry = 0;
+			entry.flags |= ENTRY_TOMBSTONE;
+		}
+		if ( (entry.flags & ENTRY_TOMBSTONE) && job.now - entry.timestamp >= options.tombstoneGcGrace ) {
+			bool shadows = false;
+			for ( unsigned int i = 0; i < job.older.size() && !shadows; i++ ) {
+				shadows = job.older[i]->mayContain(key);
+			}
+			if ( !shadows ) {
+				continue;
+			}
+		}
+
+		if ( writer == NULL ) {
+			{
+				std::lock_guard<std::mutex> guard(lock);
+				number = nextNumber++;
+			}
+			writer = new SSTableWriter(tablePath(number), options.bloomFpr, blockCodec());
+		}
+		writer->add(key, entry);
+		if ( job.splitOutputs && writer->bytesWritten() >= (uint64_t)options.memtableSize ) {
+			finishedBytes += writer->bytesWritten();
+			ok = finishOutput(writer, number, job, outputs);
+			writer = NULL;
+		}
+
+		if ( options.compactionThroughput > 0 ) {
+			uint64_t written = finishedBytes + (writer != NULL ? writer->bytesWritten() : 0);
+			if ( written - throttledBytes >= SSTABLE_BLOCK_SIZE ) {
+				throttledBytes = written;
+				std::chrono::duration<double> due((double)written / options.compactionThroughput);
+				std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+				// Sleep in short steps, so that stopping the engine is not held up
+				while ( due > elapsed && !stopping ) {
+					std::this_thread::sleep_for(min(due - elapsed, std::chrono::duration<double>(0.1)));
+					elapsed = std::chrono::steady_clock::now() - start;
+				}
+			}
+		}
+	}
+
+	for ( unsigned int i = 0; i < scanners.size(); i++ ) {
+		ok = ok && !scanners[i]->failed();
+		delete scanners[i];
+	}
+	ok = ok && !stopping;
+	if ( writer != NULL ) {
+		if ( ok && writer->count() > 0 ) {
+			ok = finishOutput(writer, number, job, outputs);
+		}
+		else {
+			delete writer;
+		}
+	}
+	if ( !ok ) {
+		for ( unsigned int i = 0; i < outputs.size(); i++ ) {
+			outputs[i]->remove();
+			delete outputs[i];
+		}
+		outputs.clear();
+	}
+	return ok;
+}
+
+/**
+ * FUNCTION NAME: finishOutput
+ *
+ * DESCRIPTION: Completes an output table of a compaction and opens it
+ */
+bool LsmEngine::finishOutput(SSTableWriter *writer, uint64_t number, const CompactionJob &job, vector<SSTable *> &outputs) {
+	bool ok = writer->finish();
+	delete writer;
+	if ( !ok ) {
+		return false;
+	}
+	string path = tablePath(number);
+	SSTable *table = SSTable::open(path, job.outputSequence != 0 ? job.outputSequence : number, job.outputLevel);
+	if ( table == NULL ) {
+		unlink(path.c_str());
+		return false;
+	}
+	outputs.push_back(table);
+	return true;
+}
+
+/**
+ * FUNCTION NAME: installCompaction
+ *
+ * DESCRIPTION: Replaces the inputs of a compaction with its outputs, under the engine lock.
+ * 				The inputs are deleted once the MANIFEST lists the outputs.
+ *
+ * RETURNS:
+ * true on SUCCESS
+ * false if the MANIFEST could not be written, in which case the tables are left as they were
+ */
+bool LsmEngine::installCompaction(const CompactionJob &job, const vector<SSTable *> &outputs) {
+	vector<SSTable *> previous = tables;
+	vector<SSTable *> next;
+	for ( unsigned int i = 0; i < tables.size(); i++ ) {
+		if ( std::find(job.inputs.begin(), job.inputs.end(), tables[i]) == job.inputs.end() ) {
+			next.push_back(tables[i]);
+		}
+	}
+	next.insert(next.end(), outputs.begin(), outputs.end());
+	tables.swap(next);
+	sortTables();
+	if ( !saveManifest() ) {
+		tables.swap(previous);
+		return false;
+	}
+
+	for ( unsigned int i = 0; i < job.inputs.size(); i++ ) {
+		job.inputs[i]->remove();
+		delete job.inputs[i];
+	}
+	stats.compactions++;
+	for ( unsigned int i = 0; i < outputs.size(); i++ ) {
+		stats.compactedBytes += outputs[i]->getFileSize();
+	}
+	return true;
+}
@@ -0,0 +1,239 @@
+/**********************************
+ * FILE NAME: LsmEngine.h
+ *
+ * DESCRIPTION: Header file of the LsmEngine class
+ **********************************/
+
+#ifndef LSMENGINE_H_
+#define LSMENGINE_H_
+
+/**
+ * Header files
+ */
+#include "stdincludes.h"
+#include <stdint.h>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include "Params.h"
+#include "Entry.h"
+#include "SSTable.h"
+#include "Cache.h"
+#include "TokenIndex.h"
+
+/*
+ * Macros
+ */
+// Bytes a memtable record costs on top of its key and value
+#define LSM_RECORD_OVERHEAD 64
+// File listing the live SSTables of the engine
+#define LSM_MANIFEST "MANIFEST"
+// Size tiered compaction merges this many adjacent tables of similar size
+#define STCS_MIN_THRESHOLD 4
+#define STCS_MAX_THRESHOLD 32
+// A table is similar in size to a run of tables if it is within these bounds of their average
+#define STCS_BUCKET_LOW 0.5
+#define STCS_BUCKET_HIGH 1.5
+// Leveled compaction moves level 0 to level 1 once it has this many tables
+#define LCS_L0_TRIGGER 4
+// Level n holds up to memtableSize * LCS_FANOUT^n bytes
+#define LCS_FANOUT 10
+#define LCS_MAX_LEVEL 7
+
+/**
+ * STRUCT NAME: LsmOptions
+ *
+ * DESCRIPTION: Settings of an LsmEngine, taken from Params
+ */
+typedef struct LsmOptions {
+	long memtableSize;
+	double bloomFpr;
+	// NO_COMPRESSION or LZ_COMPRESSION, codec of the data blocks of the SSTables
+	int compression;
+	// NO_COMPACTION, SIZE_TIERED_COMPACTION or LEVELED_COMPACTION
+	int compaction;
+	// Bytes per second compaction may write, 0 for no limit
+	long compactionThroughput;
+	int tombstoneGcGrace;
+	// Bytes of the row cache and of the block cache, 0 to turn one off
+	long rowCacheSize;
+	long blockCacheSize;
+}LsmOptions;
+
+/**
+ * STRUCT NAME: LsmStats
+ *
+ * DESCRIPTION: Counters of an LsmEngine.
+ * 				Write amplification is the bytes written to SSTables over the bytes flushed
+ * 				from the memtable. Space amplification is the bytes of the SSTables over
+ * 				the key and value bytes of the live keys.
+ */
+typedef struct LsmStats {
+	unsigned long tables;
+	unsigned long compactions;
+	uint64_t flushedBytes;
+	uint64_t compactedBytes;
+	uint64_t diskBytes;
+	uint64_t liveBytes;
+	uint64_t rowCacheHits;
+	uint64_t rowCacheMisses;
+	uint64_t blockCacheHits;
+	uint64_t blockCacheMisses;
+
+	double writeAmplification() const {
+		return flushedBytes == 0 ? 0 : (double)(flushedBytes + compactedBytes) / flushedBytes;
+	}
+	double spaceAmplification() const {
+		return liveBytes == 0 ? 0 : (double)diskBytes / liveBytes;
+	}
+	double rowCacheHitRate() const {
+		return rowCacheHits + rowCacheMisses == 0 ? 0 : (double)rowCacheHits / (rowCacheHits + rowCacheMisses);
+	}
+	double blockCacheHitRate() const {
+		return blockCacheHits + blockCacheMisses == 0 ? 0 : (double)blockCacheHits / (blockCacheHits + blockCacheMisses);
+	}
+}LsmStats;
+
+/**
+ * STRUCT NAME: CompactionJob
+ *
+ * DESCRIPTION: Tables a compaction merges and where its output goes
+ */
+typedef struct CompactionJob {
+	// Newest first
+	vector<SSTable *> inputs;
+	// Tables older than the inputs that may hold their keys: a tombstone is kept while one of them may
+	vector<SSTable *> older;
+	int outputLevel;
+	// Sequence of the single output, 0 to give every output a new one
+	uint64_t outputSequence;
+	// Cut the output in tables of about memtableSize bytes
+	bool splitOutputs;
+	int now;
+}CompactionJob;
+
+/**
+ * CLASS NAME: LsmEngine
+ *
+ * DESCRIPTION: Log structured storage engine of a node, kept in its own directory.
+ * 				Writes go to a sorted memtable. Once the memtable holds more than
+ * 				memtableSize bytes it is flushed to a new level 0 SSTable and emptied,
+ * 				so the data a node holds is not capped by its memory.
+ * 				A read looks at the memtable, then at the SSTables by level and, within
+ * 				a level, from the newest to the oldest; the first record found wins.
+ * 				SSTables whose Bloom filter rules the key out are skipped, so a key that
+ * 				is nowhere is usually answered without any I/O. Deleting writes a
+ * 				tombstone (ENTRY_TOMBSTONE) that shadows the older records. A create
+ * 				older than the tombstone of its key is refused.
+ * 				Hot keys are served from a row cache of decoded entries, and the
+ * 				data blocks of point reads are kept in a block cache; both evict
+ * 				with W-TinyLFU (see Cache.h), so a scan does not flush them.
+ * 				A background thread compacts the SSTables:
+ * 				1) SIZE_TIERED merges runs of adjacent tables of similar size
+ * 				2) LEVELED merges level 0 into level 1, and a table of an overfull
+ * 				   level n into the tables of level n+1 it overlaps. Levels from 1
+ * 				   on hold tables with disjoint key ranges.
+ * 				Merging keeps the newest record of every key and drops the tombstones
+ * 				older than tombstoneGcGrace that no older table may need to shadow.
+ * 				The engine clock is the newest timestamp written. Compaction writes
+ * 				are throttled to compactionThroughput bytes per second.
+ * 				The live tables are listed in the MANIFEST, rewritten atomically after
+ * 				every flush and compaction, so a crash never leaves a half swapped set.
+ * 				A TokenIndex of the live keys serves token range scans; it is rebuilt
+ * 				from the SSTables when the engine is opened. Its keys are kept in
+ * 				indexKeys, whose free positions are reused.
+ * 				The memtable is flushed when the engine is destroyed. Records that
+ * 				were never flushed are only as durable as the CommitLog the caller keeps.
+ * 				All the operations serialize on one mutex, which compaction only takes
+ * 				to pick its inputs and to swap in its outputs.
+ */
+class LsmEngine {
+public:
+	// Position of a key on the ring
+	typedef size_t (*TokenFunction)(const StringView &key);
+	// Called once a flush made every earlier write durable
+	typedef void (*FlushListener)(void *owner);
+
+private:
+	string directory;
+	LsmOptions options;
+	TokenFunction tokenOf;
+	std::mutex lock;
+	map<string, Entry> memtable;
+	// Key of the operation running, reused so that looking a viewed key up does not allocate
+	string lookupKey;
+	long memtableBytes;
+	// Key bytes of the memtable, part of memtableBytes
+	long memtableKeyBytes;
+	// By level, then newest first
+	vector<SSTable *> tables;
+	// Next file number, also the sequence of the next flushed table
+	uint64_t nextNumber;
+	TokenIndex index;
+	// Keys of the index, by ref. Free refs hold an empty key.
+	vector<string> indexKeys;
+	vector<uint32_t> freeIndexKeys;
+	size_t indexKeyBytes;
+	FlushListener flushListener;
+	void *flushOwner;
+	int clock;
+	LsmStats stats;
+	// Live entries read lately, dropped on every write to their key
+	RowCache rowCache;
+	// Data blocks point reads went to. Compaction reads around it.
+	BlockCache blockCache;
+	// Last key compacted out of every level, so that leveled compaction goes round the key space
+	string compactionCursor[LCS_MAX_LEVEL + 1];
+	std::thread compactor;
+	std::condition_variable compactionWakeup;
+	std::condition_variable compactionDone;
+	std::atomic<bool> stopping;
+	bool compacting;
+
+	LsmEngine(const string &directory, const LsmOptions &options, TokenFunction tokenOf);
+	bool load();
+	bool saveManifest();
+	void sortTables();
+	bool find(const string &key, Entry &entry);
+	bool findLive(const string &key, Entry &entry);
+	void put(const string &key, const Entry &entry);
+	bool flush();
+	string tablePath(uint64_t number);
+	int blockCodec();
+	uint32_t tokenFor(const StringView &key);
+	const string & lookup(const StringView &key);
+	uint32_t addIndexKey(const string &key);
+	void indexKey(unsigned char replica, uint32_t token, const string &key);
+	void unindexKey(unsigned char replica, uint32_t token, const string &key);
+	static StringView indexedKey(const void *owner, uint32_t ref);
+	void compactionLoop();
+	bool pickCompaction(CompactionJob &job);
+	bool pickSizeTiered(CompactionJob &job);
+	bool pickLeveled(CompactionJob &job);
+	bool runCompaction(const CompactionJob &job, vector<SSTable *> &outputs);
+	bool finishOutput(SSTableWriter *writer, uint64_t number, const CompactionJob &job, vector<SSTable *> &outputs);
+	bool installCompaction(const CompactionJob &job, const vector<SSTable *> &outputs);
+
+	LsmEngine(const LsmEngine &anotherEngine);
+	LsmEngine& operator =(const LsmEngine &anotherEngine);
+
+public:
+	static LsmEngine * open(const string &directory, const LsmOptions &options, TokenFunction tokenOf);
+	void setFlushListener(FlushListener listener, void *owner);
+	bool create(const StringView &key, const EntryView &entry);
+	bool read(const StringView &key, Entry &entry);
+	bool readView(const StringView &key, EntryView &entry);
+	bool readAt(const StringView &key, int timestamp, Entry &entry);
+	bool update(const StringView &key, const EntryView &newEntry);
+	bool deleteKey(const StringView &key, int timestamp);
+	unsigned long currentSize();
+	void clear();
+	unsigned long count(const string &key);
+	const TokenIndex & getIndex();
+	LsmStats getStats();
+	MemoryUsage memoryUsage();
+	virtual ~LsmEngine();
+};
+
+#endif /* LSMENGINE_H_ */
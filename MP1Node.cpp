@@ -6,6 +6,7 @@
  **********************************/
 
 #include "MP1Node.h"
+#include "Coding.h"
 
 /**
  * Overloaded Constructor
@@ -191,6 +192,8 @@ void MP1Node::checkMessages() {
     	size = memberNode->mp1q.front().size;
     	memberNode->mp1q.pop();
     	recvCallBack((void *)memberNode, (char *)ptr, size);
+    	// ENrecv allocated the message, the handlers keep nothing of it
+    	free(ptr);
     }
     return;
 }
@@ -262,19 +265,9 @@ void MP1Node::processJoinReq(void *env, char *data, int size) {
     int id = *(int*)(&newaddr.addr);
     short port = *(short*)(&newaddr.addr[4]);
 
-    //second serialize the table(put it in a string form)
-    char *table = serialize(node);
-
-    //next construct a message: type: JOINREPLY, content: table
-    size_t sz = sizeof(MessageHdr) + 1 + strlen(table);
-    MessageHdr *msg = (MessageHdr *) malloc(sz * sizeof(char));
-    msg->msgType = JOINREP;
-    char * ptr = (char *) (msg+1);
-    memcpy(ptr, table, strlen(table)+1);
-
-    emulNet->ENsend(&node->addr, &newaddr, (char *)msg, (int)sz);
-    free(msg);
-    free(table);
+    //second reply with the table: type: JOINREPLY, content: table
+    encodeTable(JOINREP);
+    emulNet->ENsend(&node->addr, &newaddr, &gossipBuffer[0], (int)gossipBuffer.size());
 
     vector<MemberListEntry>::iterator it;
     it = searchList(id, port);
@@ -298,7 +291,7 @@ void MP1Node::processJoinRep(void *env, char *data, int size) {
     char *s1 = s;
     s1 += sprintf(s1, "Received neighbor list:");
 #endif
-    deserializeAndUpdateTable(data);
+    deserializeAndUpdateTable(StringView(data, size));
     memberNode->inGroup = true;
     return;
 }
@@ -322,7 +315,7 @@ void MP1Node::processUpdateReq(void *env, char *data, int size) {
  * data: the real message (the table without the type )
  */
 void MP1Node::processUpdateRep(void *env, char *data, int size) {
-    deserializeAndUpdateTable(data);
+    deserializeAndUpdateTable(StringView(data, size));
     return;
 }
 
@@ -351,23 +344,15 @@ void MP1Node::nodeLoopOps() {
     }
 
 	if ( 0 == --(memberNode->pingCounter) ) {
-		char *table = serialize(memberNode);
-
-		size_t sz = sizeof(MessageHdr) + 1 + strlen(table);
-        MessageHdr *msg = (MessageHdr *)malloc(sz * sizeof(char));
-		msg->msgType = UPDATEREP;
-		char *ptr = (char *)(msg + 1);
-		memcpy(ptr, table, strlen(table)+1);
-
+		// The table is encoded once and sent to every member
+		encodeTable(UPDATEREP);
 		for (vector<MemberListEntry>::iterator it = memberNode->memberList.begin(); it != memberNode->memberList.end(); ++it ) {
             Address addr;
             decodeToAddress(&addr, (*(it)).getid(), (*(it)).getport());
 		    if ( memcmp(addr.addr, memberNode->addr.addr, sizeof(addr.addr)) != 0 ) {
-		        emulNet->ENsend(&memberNode->addr, &addr, (char *)msg, sz);
+		        emulNet->ENsend(&memberNode->addr, &addr, &gossipBuffer[0], (int)gossipBuffer.size());
 		    }
 		}
-		free(msg);
-		free(table);
 
 		memberNode->pingCounter = TFAIL;
 	}
@@ -476,66 +461,72 @@ vector<MemberListEntry>::iterator MP1Node::addEntryToMemberList(int id, short po
     return --it;
 }
 
+/**
+ * FUNCTION NAME: encodeTable
+ *
+ * DESCRIPTION: Encodes a message of type msgType carrying the membership list into gossipBuffer,
+ * 				which is reused from one message to the next
+ */
+void MP1Node::encodeTable(enum MsgTypes msgType) {
+    MessageHdr header;
+    header.msgType = msgType;
+    gossipBuffer.assign((const char *)&header, sizeof(MessageHdr));
+    serialize(memberNode, gossipBuffer);
+}
+
 /**
  * FUNCTION NAME: serialize
  *
- * DESCRIPTION: Serialize the membership list
+ * DESCRIPTION: Appends the membership list to out. Each entry is packed as varints:
+ * 				the id as a zigzag delta from the id of the previous entry, the port
+ * 				and the heartbeat. The timestamp is left out, the receiver stamps the
+ * 				entries it updates with its own time.
  */
-char* MP1Node::serialize(Member *node)
+void MP1Node::serialize(Member *node, string &out)
 {
-    char *buffer = NULL;
-    for ( unsigned int i = 0; i < memberNode->memberList.size(); i++ ) {
-    	char *entry = encode(memberNode->memberList.at(i).getid(), memberNode->memberList.at(i).getport(), memberNode->memberList.at(i).getheartbeat(), memberNode->memberList.at(i).gettimestamp());
-
-        if(!buffer) {
-            asprintf(&buffer, "%s|", entry);
-        }
-        else {
-            asprintf(&buffer, "%s%s|", buffer, entry);
-        }
-        if(entry) {
-            free(entry);
-        }
+    int previous = 0;
+    for ( vector<MemberListEntry>::iterator it = node->memberList.begin(); it != node->memberList.end(); ++it ) {
+        int32_t delta = (int32_t)((uint32_t)(*(it)).getid() - (uint32_t)previous);
+        putVarint32(out, ((uint32_t)delta << 1) ^ (uint32_t)(delta >> 31));
+        putVarint32(out, (unsigned short)(*(it)).getport());
+        putVarint64(out, (uint64_t)(*(it)).getheartbeat());
+        previous = (*(it)).getid();
     }
-    return buffer;
 }
 
 /**
  * FUNCTION NAME: deserializeAndUpdateTable
  *
- * DESCRIPTION: Deserialize the message and update the membership list
+ * DESCRIPTION: Decodes the membership list encoded by serialize and merges it into the membership list
+ *
+ * RETURNS:
+ * true on SUCCESS
+ * false if the table was cut short; the entries before the cut are merged
  */
-char* MP1Node::deserializeAndUpdateTable(const char *msg){
-    char *buffer = NULL;
-    asprintf(&buffer, "%s", msg);
-
-    char * pch;
-    pch = strtok (buffer,"|");
-    while (pch != NULL) {
-        char *row = NULL;
-        asprintf(&row, "%s", pch);
-        int id;
-        short port;
-        long heartbeat;
-        long timestamp;
-
-        sscanf(row,"%d:%hi~%ld~%ld", &id, &port, &heartbeat, &timestamp);
-        vector<MemberListEntry>::iterator found = searchList(id, port);
-    
+bool MP1Node::deserializeAndUpdateTable(const StringView &table){
+    size_t pos = 0;
+    int id = 0;
+    while ( pos < table.size ) {
+        uint32_t zigzag, port;
+        uint64_t heartbeat;
+        if ( !getVarint32(table, pos, zigzag) || !getVarint32(table, pos, port) || !getVarint64(table, pos, heartbeat) ) {
+            return false;
+        }
+        id = (int)((uint32_t)id + ((zigzag >> 1) ^ (0u - (zigzag & 1))));
+        vector<MemberListEntry>::iterator found = searchList(id, (short)port);
+
         // If the entry already exists and the new heartbeat is bigger, do an update
         if( found != memberNode->memberList.end() ) {
-            if( (*(found)).getheartbeat() < heartbeat ) {
-            	(*(found)).setheartbeat(heartbeat);
+            if( (*(found)).getheartbeat() < (long)heartbeat ) {
+            	(*(found)).setheartbeat((long)heartbeat);
             	(*(found)).settimestamp(par->getcurrtime());
             }
-        }   
+        }
         else {
-            addEntryToMemberList(id, port, heartbeat);
-        }     
-        pch = strtok (NULL, "|");
-
+            addEntryToMemberList(id, (short)port, (long)heartbeat);
+        }
     }
-    return NULL;
+    return true;
 }
 
 /**
@@ -553,17 +544,6 @@ vector<MemberListEntry>::iterator MP1Node::searchList(int id, short port) {
 	return it;
 }
 
-/**
- * FUNCTION NAME: encode
- *
- * DESCRIPTION: Encode the information
- */
-char* MP1Node::encode(int id, short port, long heartbeat, long timestamp ) {
-    char* buffer = NULL;
-    asprintf(&buffer, "%d:%hi~%ld~%ld", id, port, heartbeat, timestamp );
-    return buffer;
-}
-
 /**
  * FUNCTION NAME: decodeToAddress
  *
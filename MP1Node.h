@@ -14,6 +14,7 @@
 #include "Member.h"
 #include "EmulNet.h"
 #include "Queue.h"
+#include "StringView.h"
 
 /**
  * Macros
@@ -33,6 +34,8 @@ private:
 	Params *par;
 	Member *memberNode;
 	char NULLADDR[6];
+	// Reused by every gossip message this node sends
+	string gossipBuffer;
 
 public:
 //	MP1Node(Member *, Params *, Address *);
@@ -61,12 +64,12 @@ public:
 	void cleanMemberListTable(Member *memberNode);
 	vector<MemberListEntry>::iterator addEntryToMemberList(int id, short port, long heartbeat);
 	//void deleteEntryFromMemberList(member *node, struct Address *addr);
-	char* serialize(Member *node);
-	char* deserializeAndUpdateTable(const char *msg);
+	void serialize(Member *node, string &out);
+	bool deserializeAndUpdateTable(const StringView &table);
 	vector<MemberListEntry>::iterator searchList(int id, short port);
-	char* encode(int id, short port, long heartbeat, long timestamp );
 	void decodeToAddress(Address *addr, int id, short port);
 	void printAddress(Address *addr);
+	void encodeTable(enum MsgTypes msgType);
 	virtual ~MP1Node();
 };
 
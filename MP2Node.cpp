@@ -4,26 +4,151 @@
  * DESCRIPTION: MP2Node class definition
  **********************************/
 #include "MP2Node.h"
+#include "MP1Node.h"
+#include "Coding.h"
+#include <errno.h>
+#include <sys/stat.h>
 /**
  * Constructor
  */
-MP2Node::MP2Node(Member *memberNode, Params *par, EmulNet * emulNet, Log * log, Address * address) {
+MP2Node::MP2Node(Member *memberNode, Params *par, EmulNet * emulNet, Log * log, Address * address): expiries(par->getcurrtime()) {
 	this->memberNode = memberNode;
 	this->par = par;
 	this->emulNet = emulNet;
 	this->log = log;
-	ht = new HashTable();
 	this->memberNode->addr = *address;
+	this->lastRepair = par->getcurrtime();
+	this->appliedRecords = 0;
+	openStorage();
+}
+
+/**
+ * FUNCTION NAME: openStorage
+ *
+ * DESCRIPTION: Opens the storage of the node in its directory: the hash table and its engine, the
+ * 				snapshot and the commit log it recovers from, and the hints
+ */
+void MP2Node::openStorage() {
+	this->commitLog = NULL;
+	this->snapshot = NULL;
+	this->hints = NULL;
+	this->lastSnapshot = par->getcurrtime();
+	this->lsm = NULL;
+	this->reportedCompactions = 0;
+
+	// One directory per node, named after its address
+	string name = this->memberNode->addr.getAddress();
+	replace(name.begin(), name.end(), ':', '_');
+	string directory = par->DATA_DIR + "/" + name;
+	bool snapshots = par->STORAGE_ENGINE == MEMORY_ENGINE && par->SNAPSHOT_PERIOD > 0;
+	bool handoff = par->HINT_WINDOW > 0;
+	bool durable = par->STORAGE_ENGINE == LSM_ENGINE || par->COMMITLOG_SYNC != COMMITLOG_OFF || snapshots || handoff;
+	if ( durable && !makeDirectories(directory) ) {
+		printf("Could not create %s\n", directory.c_str());
+		exit(1);
+	}
+
+	if ( par->STORAGE_ENGINE == LSM_ENGINE ) {
+		LsmOptions options;
+		options.memtableSize = par->MEMTABLE_SIZE;
+		options.bloomFpr = par->BLOOM_FPR;
+		options.compression = par->SSTABLE_COMPRESSION;
+		options.compaction = par->COMPACTION;
+		options.compactionThroughput = par->COMPACTION_THROUGHPUT;
+		options.tombstoneGcGrace = par->TOMBSTONE_GC_GRACE;
+		options.rowCacheSize = par->ROW_CACHE_SIZE;
+		options.blockCacheSize = par->BLOCK_CACHE_SIZE;
+		lsm = LsmEngine::open(directory, options, &MP2Node::hashFunction);
+		if ( lsm == NULL ) {
+			printf("Could not open the storage engine in %s\n", directory.c_str());
+			exit(1);
+		}
+	}
+	ht = new HashTable(&MP2Node::hashFunction, lsm, par->MEMORY_CAP, par->MAX_VERSIONS);
+
+	// The snapshot brings the table back to its last point in time, the commit log replays what came after
+	uint64_t replayFrom = 0;
+	unsigned long loaded = 0;
+	appliedRecords = 0;
+	if ( snapshots ) {
+		snapshot = new Snapshot(directory);
+		if ( !snapshot->load(&MP2Node::applyLogRecord, this, replayFrom) ) {
+			printf("Could not load the snapshot in %s\n", directory.c_str());
+			exit(1);
+		}
+		loaded = appliedRecords;
+	}
+
+	if ( par->COMMITLOG_SYNC != COMMITLOG_OFF ) {
+		commitLog = CommitLog::open(directory, par->COMMITLOG_SYNC, par->COMMITLOG_SEGMENT_SIZE, par->COMMITLOG_SYNC_PERIOD);
+		if ( commitLog == NULL || !commitLog->replay(&MP2Node::applyLogRecord, this, replayFrom) ) {
+			printf("Could not replay the commit log in %s\n", directory.c_str());
+			exit(1);
+		}
+		// Segments can be recycled once the engine has flushed what they hold
+		if ( lsm != NULL ) {
+			lsm->setFlushListener(&MP2Node::onEngineFlush, this);
+		}
+	}
+	if ( durable ) {
+		scheduleStoredExpiries();
+	}
+
+	// Hints this node took as a coordinator before it restarted
+	if ( handoff ) {
+		hints = new HintStore(directory, par->HINT_WINDOW, par->MAX_HINTS);
+		if ( !hints->load() ) {
+			printf("Could not load the hints in %s\n", directory.c_str());
+			exit(1);
+		}
+	}
+	if ( appliedRecords > 0 ) {
+		log->LOG(&memberNode->addr, "Recovered %lu keys: %lu records loaded from the snapshot, %lu replayed from the commit log",
+				ht->currentSize(), loaded, appliedRecords - loaded);
+	}
 }
 
 /**
  * Destructor
  */
 MP2Node::~MP2Node() {
-	delete ht;
+	for (map<int, Transaction*>::iterator iterator=trInfo.begin(); iterator!=trInfo.end(); ++iterator){
+		delete iterator->second;
+	}
+	for (map<int, ScanRange*>::iterator scan=scanPages.begin(); scan!=scanPages.end(); ++scan){
+		delete scan->second;
+	}
+	closeStorage();
 	delete memberNode;
 }
 
+/**
+ * FUNCTION NAME: closeStorage
+ *
+ * DESCRIPTION: Closes everything openStorage() opened
+ */
+void MP2Node::closeStorage() {
+	delete hints;
+	// Waits for a snapshot being written
+	delete snapshot;
+	// The engine flushes on destruction and marks the commit log clean
+	delete ht;
+	delete commitLog;
+	expiries.clear();
+}
+
+/**
+ * FUNCTION NAME: restart
+ *
+ * DESCRIPTION: Restarts the storage of the node, which comes back with what it recovers from its
+ * 				directory. The membership and the transactions of the node are kept.
+ */
+void MP2Node::restart() {
+	log->LOG(&memberNode->addr, "Restarting with %lu keys", ht->currentSize());
+	closeStorage();
+	openStorage();
+}
+
 /**
  * FUNCTION NAME: updateRing
  *
@@ -57,35 +182,27 @@ void MP2Node::updateRing() {
                 switch(j){
                     case 0 : {
                     	// If this node is the starting node at location 0 then it has replicas of last 2 nodes in the ring
-                        Node *temp_node = new Node(ring[ring.size() - 1].nodeAddress);
-                        haveReplicasOf.push_back(*temp_node);
-                        temp_node = new Node(ring[ring.size() - 2].nodeAddress);
-                        haveReplicasOf.push_back(*temp_node);
+                        haveReplicasOf.push_back(Node(ring[ring.size() - 1].nodeAddress));
+                        haveReplicasOf.push_back(Node(ring[ring.size() - 2].nodeAddress));
                         break;
                     }
                     case 1 : {
                     	// If this node is at location 1, then assign first and last node in the ring to its haveReplicasOf
-                        Node *temp_node = new Node(ring[j-1].nodeAddress);
-                        haveReplicasOf.push_back(*temp_node);
-                        temp_node = new Node(ring[ring.size() - 1].nodeAddress);
-                        haveReplicasOf.push_back(*temp_node);
+                        haveReplicasOf.push_back(Node(ring[j-1].nodeAddress));
+                        haveReplicasOf.push_back(Node(ring[ring.size() - 1].nodeAddress));
                         break;
                     }
                     default : {
                     	// If node is not at 0 or 1 location then it will have replicas of previous 2 nodes in the ring
-                        Node *temp_node = new Node(ring[(j - 1) % ring.size()].nodeAddress);
-                        haveReplicasOf.push_back(*temp_node);
-                        temp_node = new Node(ring[(j - 2) % ring.size()].nodeAddress);
-                        haveReplicasOf.push_back(*temp_node);
+                        haveReplicasOf.push_back(Node(ring[(j - 1) % ring.size()].nodeAddress));
+                        haveReplicasOf.push_back(Node(ring[(j - 2) % ring.size()].nodeAddress));
                         break;
                     }
                 }
                 //The replicas of keys which are primary at this node will be the next 2 nodes in the ring
                 // Modulo Operator checks for boundary conditions when the node is last or previous to last in the ring.
-                Node *temp_node = new Node(ring[(j + 1) % ring.size()].nodeAddress);
-                hasMyReplicas.push_back(*temp_node);
-                temp_node = new Node(ring[(j + 2) % ring.size()].nodeAddress);
-                hasMyReplicas.push_back(*temp_node);
+                hasMyReplicas.push_back(Node(ring[(j + 1) % ring.size()].nodeAddress));
+                hasMyReplicas.push_back(Node(ring[(j + 2) % ring.size()].nodeAddress));
             }
         }
     }
@@ -137,14 +254,13 @@ vector<Node> MP2Node::getMembershipList() {
  *
  * DESCRIPTION: This functions hashes the key and returns the position on the ring
  * 				HASH FUNCTION USED FOR CONSISTENT HASHING
+ * 				The key is hashed where it lies, so a key viewed in a received message is not copied.
  *
  * RETURNS:
  * size_t position on the ring
  */
-size_t MP2Node::hashFunction(string key) {
-	std::hash<string> hashFunc;
-	size_t ret = hashFunc(key);
-	return ret%RING_SIZE;
+size_t MP2Node::hashFunction(const StringView &key) {
+	return hashBytes(key.data, key.size) % RING_SIZE;
 }
 
 /**
@@ -155,8 +271,9 @@ size_t MP2Node::hashFunction(string key) {
  * 				1) Constructs the message
  * 				2) Finds the replicas of this key
  * 				3) Sends a message to the replica
+ * 				A ttl > 0 makes the replicas expire the key ttl time units after they write it.
  */
-void MP2Node::clientCreate(string key, string value) {
+void MP2Node::clientCreate(string key, string value, int ttl) {
 
 	// Find the servers where the create message should go
     vector<Node> msg_recipients = findNodes(key);
@@ -164,21 +281,17 @@ void MP2Node::clientCreate(string key, string value) {
     // Send create message to primary server as well as its 2 replica
     // Message will contain the address where the message needs to be sent,
     // Message Type as create, key, value and type of replica to which message is being sent.
-    Message *messsage;
     
     int trId = g_transID; // Get transaction id from the global transaction id
 
-    messsage = new Message(trId, getMemberNode()->addr, CREATE, key, value, PRIMARY);
-    messsage->delimiter = "::";
-    emulNet->ENsend(&getMemberNode()->addr, msg_recipients[0].getAddress(), messsage->toString());
+    Message messsage(trId, getMemberNode()->addr, CREATE, key, value, PRIMARY, ttl);
+    sendWrite(msg_recipients[0].getAddress(), messsage);
 
-    messsage = new Message(trId, getMemberNode()->addr, CREATE, key, value, SECONDARY);
-    messsage->delimiter = "::";
-    emulNet->ENsend(&getMemberNode()->addr, msg_recipients[1].getAddress(), messsage->toString());
+    messsage.replica = SECONDARY;
+    sendWrite(msg_recipients[1].getAddress(), messsage);
 
-    messsage = new Message(trId, getMemberNode()->addr, CREATE, key, value, TERTIARY);
-    messsage->delimiter = "::";
-    emulNet->ENsend(&getMemberNode()->addr, msg_recipients[2].getAddress(), messsage->toString());
+    messsage.replica = TERTIARY;
+    sendWrite(msg_recipients[2].getAddress(), messsage);
 
     // Save the transaction details inside a datastructure so that it can be checked and updated later.
     trInfo[trId] = new Transaction(trId, static_cast<int>(CREATE), key, value, par->getcurrtime());
@@ -189,6 +302,84 @@ void MP2Node::clientCreate(string key, string value) {
 
 }
 
+/**
+ * FUNCTION NAME: sendWrite
+ *
+ * DESCRIPTION: Sends a CREATE or UPDATE to a replica of its key. With hinted handoff on, a write to
+ * 				a replica the membership protocol reports failed is kept as a hint instead,
+ * 				stamped with the time it was taken so that it never overwrites a newer write,
+ * 				and sent without expecting a reply once the replica is back (see replayHints).
+ * 				Hints do not count as replies: the transaction still needs its quorum.
+ */
+void MP2Node::sendWrite(Address *address, Message message) {
+    if (hints == NULL || isReachable(address)) {
+        sendMessage(address, message);
+        return;
+    }
+    message.transID = -100; // Like a stabilization message, applied without a reply
+    if (message.timestamp == 0)
+        message.timestamp = par->getcurrtime();
+    message.encode(sendBuffer);
+    if (!hints->add(address->getAddress(), sendBuffer, par->getcurrtime()))
+        log->LOG(&getMemberNode()->addr, "Hint for %s dropped, %lu hints dropped so far", address->getAddress().c_str(), hints->droppedCount());
+}
+
+/**
+ * FUNCTION NAME: isReachable
+ *
+ * DESCRIPTION: Tells whether the membership protocol holds the node at address alive: it is this
+ * 				node, or it is in the membership list and its heartbeat moved in the last TFAIL time units
+ */
+bool MP2Node::isReachable(Address *address) {
+    if (memcmp(address->addr, getMemberNode()->addr.addr, sizeof(address->addr)) == 0)
+        return true;
+    int id;
+    short port;
+    memcpy(&id, &address->addr[0], sizeof(int));
+    memcpy(&port, &address->addr[4], sizeof(short));
+    for (vector<MemberListEntry>::iterator member = memberNode->memberList.begin(); member != memberNode->memberList.end(); ++member) {
+        if (member->id == id && member->port == port)
+            return par->getcurrtime() - member->timestamp <= TFAIL;
+    }
+    return false;
+}
+
+/**
+ * FUNCTION NAME: replayHints
+ *
+ * DESCRIPTION: Sends the hints of every replica that is reachable again, at most HINT_REPLAY_RATE
+ * 				per replica each time unit. The TTL of a hinted write counts from when the
+ * 				coordinator took it; a hint whose key would already have expired is dropped.
+ */
+void MP2Node::replayHints() {
+    if (hints == NULL)
+        return;
+    int now = par->getcurrtime();
+    vector<string> targets = hints->targets();
+    for (unsigned int i = 0; i < targets.size(); i++) {
+        Address address(targets[i]);
+        if (!isReachable(&address))
+            continue;
+        vector<Hint> batch;
+        hints->take(targets[i], par->HINT_REPLAY_RATE, now, batch);
+        int sent = 0;
+        for (unsigned int j = 0; j < batch.size(); j++) {
+            MessageView view;
+            if (!view.decode(StringView(batch[j].message))) // Kept by a version with another encoding
+                continue;
+            Message message(view);
+            if (message.ttl > 0) {
+                message.ttl -= now - batch[j].time;
+                if (message.ttl <= 0)
+                    continue;
+            }
+            sendMessage(&address, message);
+            sent++;
+        }
+        log->LOG(&getMemberNode()->addr, "Replayed %d hints to %s, %lu hints left", sent, targets[i].c_str(), hints->count());
+    }
+}
+
 /**
  * FUNCTION NAME: clientRead
  *
@@ -197,8 +388,10 @@ void MP2Node::clientCreate(string key, string value) {
  * 				1) Constructs the message
  * 				2) Finds the replicas of this key
  * 				3) Sends a message to the replica
+ * 				A timestamp > 0 reads the value the key had at that time, so that reads of
+ * 				several keys at one timestamp see a consistent snapshot.
  */
-void MP2Node::clientRead(string key){
+void MP2Node::clientRead(string key, int timestamp){
 
 	// Find the servers where the read message should be sent
     vector<Node> msg_recipients = findNodes(key);
@@ -206,21 +399,21 @@ void MP2Node::clientRead(string key){
     // Send read message to primary server as well as its 2 replica
     // Message will contain the address where the message needs to be sent,
     // Message Type as read, and key for which message is being sent.
-    Message *messsage;
 
     int trId = g_transID;// Get transaction id from the global transaction id
 
-    messsage = new Message(trId, getMemberNode()->addr, READ, key);
-    messsage->delimiter = "::";
+    Message messsage(trId, getMemberNode()->addr, READ, key);
+    messsage.timestamp = timestamp;
 
-    emulNet->ENsend(&getMemberNode()->addr, msg_recipients[0].getAddress(), messsage->toString());
+    sendMessage(msg_recipients[0].getAddress(), messsage);
 
-    emulNet->ENsend(&getMemberNode()->addr, msg_recipients[1].getAddress(), messsage->toString());
+    sendMessage(msg_recipients[1].getAddress(), messsage);
 
-    emulNet->ENsend(&getMemberNode()->addr, msg_recipients[2].getAddress(), messsage->toString());
+    sendMessage(msg_recipients[2].getAddress(), messsage);
 	
 	// Save the transaction details inside a datastructure so that it can be checked and updated later.
     trInfo[trId] = new Transaction(trId, static_cast<int>(READ), key, "", par->getcurrtime());
+    trInfo[trId]->setReadTime(timestamp);
 
     g_transID++;// Increment the global transaction id
 
@@ -236,8 +429,10 @@ void MP2Node::clientRead(string key){
  * 				1) Constructs the message
  * 				2) Finds the replicas of this key
  * 				3) Sends a message to the replica
+ * 				A ttl > 0 makes the replicas expire the key ttl time units after they write it;
+ * 				without one the key no longer expires.
  */
-void MP2Node::clientUpdate(string key, string value){
+void MP2Node::clientUpdate(string key, string value, int ttl){
     
 	// Find the servers where the update message should be sent
     vector<Node> msg_recipients = findNodes(key);
@@ -245,22 +440,18 @@ void MP2Node::clientUpdate(string key, string value){
     // Send update message to primary server as well as its 2 replica
     // Message will contain the address where the message needs to be sent,
     // Message Type as update, key, new value and type of replica to which message is being sent.
-    Message *messsage;
 
     int trId = g_transID; // Get transaction id from the global transaction id
     
-    messsage = new Message(trId, getMemberNode()->addr, UPDATE, key, value, PRIMARY);
-    messsage->delimiter = "::";
+    Message messsage(trId, getMemberNode()->addr, UPDATE, key, value, PRIMARY, ttl);
 
-    emulNet->ENsend(&getMemberNode()->addr, msg_recipients[0].getAddress(), messsage->toString());
+    sendWrite(msg_recipients[0].getAddress(), messsage);
 
-    messsage = new Message(trId, getMemberNode()->addr, UPDATE, key, value, SECONDARY);
-    messsage->delimiter = "::";
-    emulNet->ENsend(&getMemberNode()->addr, msg_recipients[1].getAddress(), messsage->toString());
+    messsage.replica = SECONDARY;
+    sendWrite(msg_recipients[1].getAddress(), messsage);
 
-    messsage = new Message(trId, getMemberNode()->addr, UPDATE, key, value, TERTIARY);
-    messsage->delimiter = "::";
-    emulNet->ENsend(&getMemberNode()->addr, msg_recipients[2].getAddress(), messsage->toString());
+    messsage.replica = TERTIARY;
+    sendWrite(msg_recipients[2].getAddress(), messsage);
 
     // Save the transaction details inside a datastructure so that it can be checked and updated later.
     trInfo[trId] = new Transaction(trId, static_cast<int>(UPDATE), key, value, par->getcurrtime());
@@ -288,18 +479,16 @@ void MP2Node::clientDelete(string key){
     // Send delete message to primary server as well as its 2 replica
     // Message will contain the address where the message needs to be sent,
     // Message Type as delete, and key to be deleted.
-    Message *messsage;
 
     int trId = g_transID; // Get transaction id from the global transaction id
 
-    messsage = new Message(trId, getMemberNode()->addr, DELETE, key);
-    messsage->delimiter = "::";
+    Message messsage(trId, getMemberNode()->addr, DELETE, key);
 
-    emulNet->ENsend(&getMemberNode()->addr, msg_recipients[0].getAddress(), messsage->toString());
+    sendMessage(msg_recipients[0].getAddress(), messsage);
 
-    emulNet->ENsend(&getMemberNode()->addr, msg_recipients[1].getAddress(), messsage->toString());
+    sendMessage(msg_recipients[1].getAddress(), messsage);
 
-    emulNet->ENsend(&getMemberNode()->addr, msg_recipients[2].getAddress(), messsage->toString());
+    sendMessage(msg_recipients[2].getAddress(), messsage);
 
     // Save the transaction details inside a datastructure so that it can be checked and updated later.
     trInfo[trId] = new Transaction(trId, static_cast<int>(DELETE), key, "", par->getcurrtime());
@@ -310,6 +499,51 @@ void MP2Node::clientDelete(string key){
 
 }
 
+/**
+ * FUNCTION NAME: clientScan
+ *
+ * DESCRIPTION: client side SCAN API
+ * 				The function does the following:
+ * 				1) Splits [startToken, endToken] into the token ranges of the nodes of the ring
+ * 				2) Sends a SCAN for the first page of every range to its three replicas
+ * 				Each range then comes back one page at a time in (token, key) order: the
+ * 				replies to a page are merged once a quorum answered, its keys logged, and
+ * 				the next page requested from the continuation the page ended at.
+ * 				A startToken > endToken scans the range that wraps around the end of the ring.
+ */
+void MP2Node::clientScan(size_t startToken, size_t endToken, int pageSize) {
+
+    int scanId = g_transID; // The scan gets a transaction id of its own, every page another one
+    g_transID++;
+
+    if (ring.size() < 3 || pageSize <= 0 || startToken >= RING_SIZE || endToken >= RING_SIZE) {
+        log->LOG(&getMemberNode()->addr, "Scan %d of [%zu, %zu] failed", scanId, startToken, endToken);
+        return;
+    }
+
+    vector<pair<size_t, size_t>> wanted;
+    if (startToken <= endToken) {
+        wanted.push_back(make_pair(startToken, endToken));
+    } else {
+        wanted.push_back(make_pair(startToken, (size_t)RING_SIZE - 1));
+        wanted.push_back(make_pair((size_t)0, endToken));
+    }
+
+    // Node j owns the tokens in (ring[j-1], ring[j]], the first node also the tokens after the last one
+    pendingScans[scanId] = 0;
+    for (unsigned int w = 0; w < wanted.size(); w++) {
+        for (unsigned int j = 0; j < ring.size(); j++) {
+            size_t first = j == 0 ? 0 : ring[j - 1].getHashCode() + 1;
+            addScanRange(scanId, max(first, wanted[w].first), min((size_t)ring[j].getHashCode(), wanted[w].second), pageSize, j);
+        }
+        addScanRange(scanId, max((size_t)ring[ring.size() - 1].getHashCode() + 1, wanted[w].first), wanted[w].second, pageSize, 0);
+    }
+    if (pendingScans[scanId] == 0) { // No node owns a token of the range
+        log->LOG(&getMemberNode()->addr, "Scan %d done", scanId);
+        pendingScans.erase(scanId);
+    }
+}
+
 /**
  * FUNCTION NAME: createKeyValue
  *
@@ -318,12 +552,20 @@ void MP2Node::clientDelete(string key){
  * 			   	1) Inserts key value into the local hash table
  * 			   	2) Return true or false based on success or failure
  */
-bool MP2Node::createKeyValue(string key, string value, ReplicaType replica) {
+bool MP2Node::createKeyValue(const StringView &key, const StringView &value, ReplicaType replica, int ttl, int timestamp) {
 	
     cout << "Manish server create function" << endl;
-    Entry *entry = new Entry(value, par->getcurrtime(), replica); // An entry object that will hold value, time and replica type
-    bool create_status = ht->create(key, entry->convertToString()); // Try to insert into the local hashtable of the server
-    free(entry); // Free entry object
+    EntryView entry; // A view of the value, time and replica type: the value is copied once, into the hash table
+    entry.value = value;
+    entry.timestamp = timestamp > 0 ? timestamp : par->getcurrtime();
+    entry.replica = replica;
+    if (ttl > 0)
+        entry.expiry = par->getcurrtime() + ttl; // The key expires ttl time units from now
+    if (commitLog != NULL && !commitLog->append(CREATE, key, entry)) // Log the mutation before applying it
+        return false;
+    bool create_status = ht->create(key, entry); // Try to insert into the local hashtable of the server
+    if (create_status)
+        scheduleExpiry(key, entry);
     return create_status; // Return the status of create operation.
 }
 
@@ -333,14 +575,23 @@ bool MP2Node::createKeyValue(string key, string value, ReplicaType replica) {
  * DESCRIPTION: Server side READ API
  * 			    This function does the following:
  * 			    1) Read key from local hash table
- * 			    2) Return value
+ * 			    2) Return true and a view of the entry if the key has a value
+ * 			    The value is not copied when it lives in an SSTable: the view pins it in the
+ * 			    mapped file until the READREPLY is encoded.
+ * 			    A timestamp > 0 reads the version of the key that was the newest at that time.
  */
-string MP2Node::readKey(string key) {
-
-    string valueRead = ht->read(key); // Get the value corresponding to a key
-    if (valueRead.compare("") == 0)
-        cout << "Manish Read server function " << key << " and value is " << valueRead << endl;
-    return valueRead;
+bool MP2Node::readKey(const StringView &key, EntryView &entry, int timestamp) {
+
+    bool found;
+    if (timestamp > 0) {
+        Entry version;
+        found = ht->readAt(key, timestamp, version) && !version.expiredAt(timestamp); // Get the version of the key at that time, unless it had expired then
+        if (found)
+            entry.assign(version);
+    } else {
+        found = ht->readView(key, entry) && !entry.expiredAt(par->getcurrtime()); // Get the entry corresponding to a key, unless it expired
+    }
+    return found;
 }
 
 /**
@@ -351,12 +602,20 @@ string MP2Node::readKey(string key) {
  * 				1) Update the key to the new value in the local hash table
  * 				2) Return true or false based on success or failure
  */
-bool MP2Node::updateKeyValue(string key, string value, ReplicaType replica) {
+bool MP2Node::updateKeyValue(const StringView &key, const StringView &value, ReplicaType replica, int ttl, int timestamp) {
 
     cout << "Manish Update server function " << endl;
-    Entry *entry = new Entry(value, par->getcurrtime(), replica); // An entry object that will hold the value, current time and replica type
-    bool update_status = ht->update(key, entry->convertToString()); // Updated the hashtable to reflect the new value
-    free(entry);
+    EntryView entry; // A view of the value, write time and replica type
+    entry.value = value;
+    entry.timestamp = timestamp > 0 ? timestamp : par->getcurrtime();
+    entry.replica = replica;
+    if (ttl > 0)
+        entry.expiry = par->getcurrtime() + ttl; // The key expires ttl time units from now
+    if (commitLog != NULL && !commitLog->append(UPDATE, key, entry)) // Log the mutation before applying it
+        return false;
+    bool update_status = ht->update(key, entry); // Updated the hashtable to reflect the new value
+    if (update_status)
+        scheduleExpiry(key, entry);
     return update_status;
 
 }
@@ -366,19 +625,280 @@ bool MP2Node::updateKeyValue(string key, string value, ReplicaType replica) {
  *
  * DESCRIPTION: Server side DELETE API
  * 				This function does the following:
- * 				1) Delete the key from the local hash table
+ * 				1) Replace the value of the key with a tombstone in the local hash table
  * 				2) Return true or false based on success or failure
+ * 				The tombstone is kept for TOMBSTONE_GC_GRACE time units, so that a stale
+ * 				copy of the key streamed back by stabilization is refused.
  */
-bool MP2Node::deletekey(string key) {
+bool MP2Node::deletekey(const StringView &key) {
 
     cout << "Manish delete server function " << endl;
-    bool delete_status = ht->deleteKey(key); // Here deleted the key from Hashtable
-
-    if (key.compare("invalidKey") == 0)
+    Entry tombstone("", par->getcurrtime(), PRIMARY);
+    tombstone.flags |= ENTRY_TOMBSTONE;
+    if (commitLog != NULL && !commitLog->append(DELETE, key, tombstone)) // Log the mutation before applying it
+        return false;
+    bool delete_status = ht->deleteKey(key, tombstone.timestamp); // Here replaced the value of the key with a tombstone in the Hashtable
+    if (delete_status)
+        scheduleExpiry(key, tombstone); // The tombstone is dropped once the gc grace period is over
+
+    if (key == StringView("invalidKey", sizeof("invalidKey") - 1))
         cout << "Manish Invalid " << delete_status << endl;
     return delete_status;
 }
 
+/**
+ * FUNCTION NAME: scanKeys
+ *
+ * DESCRIPTION: Server side SCAN API
+ * 				Returns the keys this node holds as replica with a token in [first_token, last_token]
+ * 				as (key, value, timestamp) records in (token, key) order, starting after after_key
+ * 				when it is given. Stops at page_size keys or SCAN_REPLY_BYTES and sets more then,
+ * 				so that the coordinator asks for the next page. Expired keys are left out.
+ */
+string MP2Node::scanKeys(size_t first_token, size_t last_token, const string &after_key, int page_size, ReplicaType replica, bool &more) {
+
+    string records;
+    int keys = 0;
+    more = false;
+    for (HashTable::range_iterator key_itr = ht->rangeBegin(replica, first_token, last_token); key_itr != ht->rangeEnd(); ++key_itr) {
+        if (!after_key.empty() && key_itr.token() == first_token && !(StringView(after_key) < key_itr.key()))
+            continue; // Sent in an earlier page
+        EntryView entry;
+        if (!readKey(key_itr.key(), entry))
+            continue;
+        size_t record_size = key_itr.key().size + entry.value.size + 16;
+        if (keys == page_size || (keys > 0 && records.size() + record_size > SCAN_REPLY_BYTES)) {
+            more = true;
+            break;
+        }
+        putVarBytes(records, key_itr.key());
+        putVarBytes(records, entry.value); // Copied once, straight from where it is stored
+        putVarint32(records, (uint32_t)entry.timestamp);
+        keys++;
+    }
+    return records;
+}
+
+/**
+ * FUNCTION NAME: makeDirectories
+ *
+ * DESCRIPTION: Creates every missing directory of path
+ *
+ * RETURNS:
+ * true on SUCCESS
+ * false on FAILURE
+ */
+bool MP2Node::makeDirectories(string path) {
+	for ( size_t pos = path.find('/', 1); ; pos = path.find('/', pos + 1) ) {
+		string level = path.substr(0, pos);
+		if ( mkdir(level.c_str(), 0755) != 0 && errno != EEXIST ) {
+			return false;
+		}
+		if ( pos == string::npos ) {
+			return true;
+		}
+	}
+}
+
+/**
+ * FUNCTION NAME: applyLogRecord
+ *
+ * DESCRIPTION: Applies a mutation replayed from the commit log to the hash table of the node.
+ * 				The mutations are applied with the same outcome they had when they were logged.
+ */
+void MP2Node::applyLogRecord(void *owner, MessageType op, const string &key, const Entry &entry) {
+	MP2Node *node = static_cast<MP2Node *>(owner);
+	HashTable *table = node->ht;
+	node->appliedRecords++;
+	if ( op == CREATE ) {
+		table->create(key, entry);
+	}
+	else if ( op == UPDATE ) {
+		table->update(key, entry);
+	}
+	else if ( op == DELETE && table->deleteKey(key, entry.timestamp) ) {
+		// Tombstones are not found by the startup scan, their timers are armed here
+		Entry tombstone = entry;
+		tombstone.flags |= ENTRY_TOMBSTONE;
+		node->scheduleExpiry(key, tombstone);
+	}
+}
+
+/**
+ * FUNCTION NAME: onEngineFlush
+ *
+ * DESCRIPTION: The storage engine made every logged mutation durable: recycle the commit log
+ */
+void MP2Node::onEngineFlush(void *owner) {
+	static_cast<MP2Node *>(owner)->commitLog->markClean();
+}
+
+/**
+ * FUNCTION NAME: sendReply
+ *
+ * DESCRIPTION: Sends the REPLY to a mutation, or holds it back until the commit log syncs
+ */
+void MP2Node::sendReply(Address *address, const Message &reply) {
+	if ( commitLog != NULL && commitLog->defersReplies() ) {
+		reply.encode(sendBuffer);
+		deferredReplies.push_back(make_pair(*address, sendBuffer));
+		return;
+	}
+	sendMessage(address, reply);
+}
+
+/**
+ * FUNCTION NAME: sendMessage
+ *
+ * DESCRIPTION: Encodes message into the send buffer, which is reused from one message to the next, and sends it
+ */
+void MP2Node::sendMessage(Address *address, const Message &message) {
+	message.encode(sendBuffer);
+	emulNet->ENsend(&getMemberNode()->addr, address, &sendBuffer[0], (int)sendBuffer.size());
+}
+
+/**
+ * FUNCTION NAME: sendDeferredReplies
+ *
+ * DESCRIPTION: Syncs the commit log once for all the mutations handled since the last call,
+ * 				then sends their replies. A reply is dropped if the sync failed, so the
+ * 				coordinator times the mutation out instead of counting it as durable.
+ */
+void MP2Node::sendDeferredReplies() {
+	if ( commitLog == NULL ) {
+		return;
+	}
+	commitLog->tick(par->getcurrtime());
+	if ( deferredReplies.empty() ) {
+		return;
+	}
+	if ( commitLog->sync() ) {
+		for ( unsigned int i = 0; i < deferredReplies.size(); i++ ) {
+			emulNet->ENsend(&getMemberNode()->addr, &deferredReplies[i].first, deferredReplies[i].second);
+		}
+	}
+	deferredReplies.clear();
+}
+
+/**
+ * FUNCTION NAME: takeSnapshot
+ *
+ * DESCRIPTION: Starts a snapshot of the table once every SNAPSHOT_PERIOD time units, and
+ * 				recycles the commit log segments a completed snapshot covers
+ */
+void MP2Node::takeSnapshot() {
+	if ( snapshot == NULL ) {
+		return;
+	}
+	uint64_t mark;
+	if ( snapshot->poll(mark) && commitLog != NULL ) {
+		commitLog->markClean(mark);
+	}
+	if ( !snapshot->running() && par->getcurrtime() - lastSnapshot >= par->SNAPSHOT_PERIOD ) {
+		// Mutations logged from now on go to segments the snapshot does not cover
+		mark = commitLog != NULL ? commitLog->rollover() : 0;
+		if ( snapshot->start(ht, mark) ) {
+			lastSnapshot = par->getcurrtime();
+		}
+	}
+}
+
+/**
+ * FUNCTION NAME: scheduleExpiry
+ *
+ * DESCRIPTION: Arms the timer of a key that was just written with a TTL, or of a tombstone,
+ * 				which fires once the gc grace period of the tombstone is over
+ */
+void MP2Node::scheduleExpiry(const StringView &key, const EntryView &entry) {
+	if ( entry.flags & ENTRY_TOMBSTONE ) {
+		expiries.schedule(key.toString(), entry.timestamp + par->TOMBSTONE_GC_GRACE);
+	}
+	else if ( entry.expiry != 0 ) {
+		expiries.schedule(key.toString(), entry.expiry);
+	}
+}
+
+/**
+ * FUNCTION NAME: scheduleStoredExpiries
+ *
+ * DESCRIPTION: Arms the timers of the keys with a TTL the node recovered from disk.
+ * 				Runs once at startup, the only time the keys are all visited.
+ */
+void MP2Node::scheduleStoredExpiries() {
+	ReplicaType replicas[] = { PRIMARY, SECONDARY, TERTIARY };
+	for ( int i = 0; i < 3; i++ ) {
+		for ( HashTable::range_iterator it = ht->rangeBegin(replicas[i], 0, RING_SIZE - 1); it != ht->rangeEnd(); ++it ) {
+			Entry entry;
+			if ( ht->read(it.key(), entry) ) {
+				scheduleExpiry(it.key(), entry);
+			}
+		}
+	}
+}
+
+/**
+ * FUNCTION NAME: expireKeys
+ *
+ * DESCRIPTION: Deletes the keys whose TTL ran out since the last call, and drops the
+ * 				tombstones whose gc grace period is over. An expired key leaves a
+ * 				tombstone stamped with its expiry, like a delete would.
+ * 				A timer whose key was rewritten since it was armed finds the key
+ * 				unexpired, or its tombstone too recent, and leaves it alone.
+ */
+void MP2Node::expireKeys() {
+	int now = par->getcurrtime();
+	vector<string> fired;
+	expiries.advance(now, fired);
+	for ( unsigned int i = 0; i < fired.size(); i++ ) {
+		Entry entry;
+		if ( ht->read(fired[i], entry) ) {
+			if ( entry.expiredAt(now) && ht->deleteKey(fired[i], entry.expiry) ) {
+				Entry tombstone("", entry.expiry, entry.replica);
+				tombstone.flags |= ENTRY_TOMBSTONE;
+				scheduleExpiry(fired[i], tombstone);
+			}
+		}
+		else {
+			ht->purgeTombstone(fired[i], now - par->TOMBSTONE_GC_GRACE);
+		}
+	}
+}
+
+/**
+ * FUNCTION NAME: hasRoomFor
+ *
+ * DESCRIPTION: Tells whether the hash table can take a write of key and value under the
+ * 				memory cap, and logs the memory it holds when it cannot
+ */
+bool MP2Node::hasRoomFor(const StringView &key, const StringView &value) {
+	if ( ht->hasRoom(key.size, value.size) ) {
+		return true;
+	}
+	MemoryUsage usage = ht->memoryUsage();
+	log->LOG(&memberNode->addr, "Memory cap of %ld bytes reached: keys: %lu values: %lu metadata: %lu", par->MEMORY_CAP,
+			(unsigned long)usage.keyBytes, (unsigned long)usage.valueBytes, (unsigned long)usage.metadataBytes);
+	return false;
+}
+
+/**
+ * FUNCTION NAME: logEngineStats
+ *
+ * DESCRIPTION: Logs the amplification and the cache hit rates of the LSM engine after every compaction it finished
+ */
+void MP2Node::logEngineStats() {
+	if ( lsm == NULL ) {
+		return;
+	}
+	LsmStats stats = lsm->getStats();
+	if ( stats.compactions == reportedCompactions ) {
+		return;
+	}
+	reportedCompactions = stats.compactions;
+	log->LOG(&memberNode->addr, "LSM compactions: %lu tables: %lu write amplification: %.2f space amplification: %.2f"
+			" row cache hit rate: %.2f block cache hit rate: %.2f", stats.compactions, stats.tables, stats.writeAmplification(),
+			stats.spaceAmplification(), stats.rowCacheHitRate(), stats.blockCacheHitRate());
+}
+
 /**
  * FUNCTION NAME: checkMessages
  *
@@ -396,6 +916,12 @@ void MP2Node::checkMessages() {
 	 * Declare your local variables here
 	 */
 
+	// Delete the keys whose TTL ran out
+	expireKeys();
+
+	// Send the writes replicas missed to the ones that came back
+	replayHints();
+
 	// Dequeue all messages and handle them
 	while ( !memberNode->mp2q.empty() ) {
 		/*
@@ -404,156 +930,233 @@ void MP2Node::checkMessages() {
 		data = (char *)memberNode->mp2q.front().elt;
 		size = memberNode->mp2q.front().size;
 		memberNode->mp2q.pop();
-
-		string message(data, data + size);
+		// ENrecv allocated the bytes; they are freed once the message is handled
+		std::unique_ptr<char, void (*)(void *)> received(data, free);
 
 		/*
 		 * Handle the message types here
 		 */
 
-		// Retrieve the message in string format
-		 // Separate the message by delimiter and form a vector of strings that reflect each part of the message
-        string delimiter = "::";
-        size_t delim_loc = 0;
-        vector<string> message_by_parts;
-
-        while ((delim_loc = message.find(delimiter)) != string::npos) {
-            message_by_parts.emplace_back(message.substr(0, delim_loc));
-            message.erase(0, delim_loc + delimiter.length());
-        } // At each delimiter location add the message part into vector of strings
-        message_by_parts.push_back(message);
+        // Decode the binary message in place: its key and value are views into the received bytes,
+        // handed as is to the storage engine, which copies them once into the hash table
+        MessageView message;
+        if (!message.decode(StringView(data, size))) // Encoded by another version or cut short
+            continue;
+        Address rx_address = message.fromAddr; // Address of the sender
+        const StringView &key = message.key;
 
-        MessageType mtype = static_cast<MessageType>(atoi(message_by_parts[2].c_str())); // Get the message type.
+        MessageType mtype = message.type; // Get the message type.
 
         if (mtype == CREATE) { // If message type is create
             cout << "Create message request going to server" << endl;
-            bool return_status = createKeyValue(message_by_parts[3], message_by_parts[4], static_cast<ReplicaType>(atoi(message_by_parts[5].c_str()))); // Call server createKeyValue function with key, value and replica type from the message
-            int temp_trID = atoi(message_by_parts[0].c_str());
+            const StringView &value = message.value;
+            bool full = !hasRoomFor(key, value); // Refuse the create if it would go over the memory cap
+            bool return_status = !full && createKeyValue(key, value, message.replica, message.ttl, message.timestamp); // Call server createKeyValue function with key, value, replica type, TTL and write time from the message
+            int temp_trID = message.transID;
             if (temp_trID != -100){ // If message type is not type reserved for stablization message which doesn't neeed to send the reply.
-                Message *message;
-                message = new Message(temp_trID, getMemberNode()->addr, REPLY, return_status); // Send a reply message to the coordinator
-                message->delimiter = "::";
-                Address *rx_address = new Address(message_by_parts[1]); // Get the address of the coordinator
+                Message reply(temp_trID, getMemberNode()->addr, full ? REPLY_FULL : (return_status ? REPLY_SUCCESS : REPLY_FAILURE)); // Send a reply message to the coordinator
 
-                emulNet->ENsend(&getMemberNode()->addr, rx_address, message->toString()); // Send the reply message through emulnet
+                sendReply(&rx_address, reply); // Send the reply message through emulnet
                 
                 // If return status is true then log Create Success otherwise log create failure.
                 if (return_status == true){
-                    log->logCreateSuccess(&getMemberNode()->addr, false, temp_trID, message_by_parts[3], message_by_parts[4]);
+                    log->logCreateSuccess(&getMemberNode()->addr, false, temp_trID, key.toString(), value.toString());
                 }
                 else{
-                    log->logCreateFail(&getMemberNode()->addr, false, temp_trID, message_by_parts[3], message_by_parts[4]);
+                    log->logCreateFail(&getMemberNode()->addr, false, temp_trID, key.toString(), value.toString());
                 }
             }
         } else if (mtype == DELETE) { // If the message type is delete
             cout << "Delete message request going to server" << endl;
 
-            bool return_status = deletekey(message_by_parts[3]); // Call delete server operation with key
-            int temp_trID = atoi(message_by_parts[0].c_str()); // Get the transaction id of the message
-            Address *rx_address = new Address(message_by_parts[1]); //Get the address of the coordinator
+            bool return_status = deletekey(key); // Call delete server operation with key
+            int temp_trID = message.transID; // Get the transaction id of the message
 
-            Message *message;
-            message = new Message(temp_trID, getMemberNode()->addr, REPLY, return_status);// Construct a reply message to send to coordinator
-            message->delimiter = "::";
+            Message reply(temp_trID, getMemberNode()->addr, REPLY, return_status);// Construct a reply message to send to coordinator
 
-            emulNet->ENsend(&getMemberNode()->addr, rx_address, message->toString()); // Send the reply message through emulnet
+            sendReply(&rx_address, reply); // Send the reply message through emulnet
 
             
             // If return status is true then log Delete Success otherwise log delete failure.
             if (return_status == true){
-                log->logDeleteSuccess(&getMemberNode()->addr, false, temp_trID, message_by_parts[3]);
+                log->logDeleteSuccess(&getMemberNode()->addr, false, temp_trID, key.toString());
             }
             else {
-                log->logDeleteFail(&getMemberNode()->addr, false, temp_trID, message_by_parts[3]);
+                log->logDeleteFail(&getMemberNode()->addr, false, temp_trID, key.toString());
             }
 
         } else if (mtype == READ) { // If the message type is read
             cout<<"Manish read request going to server"<<endl;
-            string valueRead = readKey(message_by_parts[3]); // Call read server operation with key
-            int temp_trID = atoi(message_by_parts[0].c_str()); // Get the transaction id of the message
-            Address *rx_address = new Address(message_by_parts[1]); // Get the address of the coordinator
-
-            Message *message;
-            message = new Message(temp_trID, getMemberNode()->addr, valueRead); // Construct a read reply to the coordinator
-            message->delimiter = "::";
-
-            emulNet->ENsend(&getMemberNode()->addr, rx_address, message->toString()); // Send the read reply message through emulnet
+            EntryView entry;
+            bool found = readKey(key, entry, message.timestamp); // Call read server operation with key, at the time asked for if any
+            int temp_trID = message.transID; // Get the transaction id of the message
+
+            Message reply(temp_trID, getMemberNode()->addr, string()); // Construct the read reply to the coordinator
+            reply.success = found;
+            if (found) {
+                reply.timestamp = entry.timestamp;
+                reply.replica = entry.replica;
+                if (entry.expiry != 0)
+                    reply.ttl = entry.expiry - par->getcurrtime(); // The TTL left, for read repair to keep
+            }
+            reply.encode(sendBuffer, found ? entry.value : StringView()); // The value is copied once, straight from where it is stored
+            emulNet->ENsend(&getMemberNode()->addr, &rx_address, &sendBuffer[0], (int)sendBuffer.size()); // Send the read reply message through emulnet
 
-            if(valueRead.compare("") != 0) // If the value read is not of invalid key then log read success otherwise log failure
+            if(found) // If the value read is not of invalid key then log read success otherwise log failure
             {
-                log->logReadSuccess(&getMemberNode()->addr, false, temp_trID, message_by_parts[3], valueRead);
+                string logged;
+                entry.appendString(logged);
+                log->logReadSuccess(&getMemberNode()->addr, false, temp_trID, key.toString(), logged);
             }
             else
             {
-                log->logReadFail(&getMemberNode()->addr, false, temp_trID, message_by_parts[3]);
+                log->logReadFail(&getMemberNode()->addr, false, temp_trID, key.toString());
             }
         } else if (mtype == UPDATE) { // If the message type is update
-            bool return_status = updateKeyValue(message_by_parts[3], message_by_parts[4], static_cast<ReplicaType>(atoi(message_by_parts[5].c_str()))); // Call update with key and new value and pass the replica type
-            int temp_trID = atoi(message_by_parts[0].c_str());
+            const StringView &value = message.value;
+            bool full = !hasRoomFor(StringView(), value); // The key is already there, only the new value needs room
+            bool return_status = !full && updateKeyValue(key, value, message.replica, message.ttl, message.timestamp); // Call update with key and new value and pass the replica type, TTL and write time
+            int temp_trID = message.transID;
 
             if (temp_trID != -100){ // msg type should not be replied back to coordinator reserved for stablization message
-                Address *rx_address = new Address(message_by_parts[1]); // Get the address of the coordinator
+                Message reply(temp_trID, getMemberNode()->addr, full ? REPLY_FULL : (return_status ? REPLY_SUCCESS : REPLY_FAILURE)); // Construct a reply message to send to coordinator
 
-                Message *message;
-                message = new Message(temp_trID, getMemberNode()->addr, REPLY, return_status); // Construct a reply message to send to coordinator
-                message->delimiter = "::";
-
-                emulNet->ENsend(&getMemberNode()->addr, rx_address, message->toString()); // Send the reply message throguh the emulnet
+                sendReply(&rx_address, reply); // Send the reply message throguh the emulnet
 
                 // If the return status is true log update success otherwise log update failure
                 if (return_status == true){ 
-                    log->logUpdateSuccess(&getMemberNode()->addr, false, temp_trID, message_by_parts[3], message_by_parts[4]);
+                    log->logUpdateSuccess(&getMemberNode()->addr, false, temp_trID, key.toString(), value.toString());
                 } else {
-                    log->logUpdateFail(&getMemberNode()->addr, false, temp_trID, message_by_parts[3], message_by_parts[4]);
+                    log->logUpdateFail(&getMemberNode()->addr, false, temp_trID, key.toString(), value.toString());
                 }
             }
 
         } else if (mtype == REPLY) { // If the message type is reply
-            Address *sender_address = new Address(message_by_parts[1]); // Get the address of the node which sent the message
-            int temp_trId = atoi(message_by_parts[0].c_str()); // Get the transaction id of the message
-            int return_status = atoi(message_by_parts[3].c_str()); // Get the return status from the content of the message
-
-            int num_replies = trInfo[temp_trId]->getNumReplies(); // Get the reply count for this message having particular transaction id.
+            int temp_trId = message.transID; // Get the transaction id of the message
+            int return_status = message.status; // Get the return status from the content of the message
+
+            map<int, Transaction*>::iterator transaction = trInfo.find(temp_trId);
+            if (transaction == trInfo.end()) // The transaction is already done, nothing to count
+                continue;
+            if (transaction->second->getTypeOfMessage() == READ) { // A stale replica acknowledged the value a blocking read repair sent it
+                transaction->second->setRepairsPending(transaction->second->getRepairsPending() - 1);
+                continue;
+            }
+            int num_replies = transaction->second->getNumReplies(); // Get the reply count for this message having particular transaction id.
             
             // If the return status is 1, then increase the number of replies otherwise do nothing
-            if (return_status == 1){
-                trInfo[temp_trId]->setNumReplies(num_replies + 1);
-            } else {
-                ;
+            if (return_status == REPLY_SUCCESS){
+                transaction->second->setNumReplies(num_replies + 1);
+            } else if (return_status == REPLY_FULL) {
+                log->LOG(&getMemberNode()->addr, "Replica %s is over its memory cap, transaction %d", rx_address.getAddress().c_str(), temp_trId);
             }
+        } else if (mtype == SCAN) { // If the message type is scan, reply with the next page of the range
+            bool more;
+            string records = scanKeys(message.firstToken, message.lastToken, key.toString(), message.pageSize, message.replica, more); // The key is the continuation of the previous page
+
+            Message reply(message.transID, getMemberNode()->addr, SCANREPLY, more);
+            reply.encode(sendBuffer, StringView(records));
+            emulNet->ENsend(&getMemberNode()->addr, &rx_address, &sendBuffer[0], (int)sendBuffer.size());
+
+        } else if (mtype == SCANREPLY) { // If the message type is scanreply, merge it into the page
+            int temp_trId = message.transID;
+            map<int, ScanRange*>::iterator scan = scanPages.find(temp_trId);
+            if (scan == scanPages.end()) // The page is already done, nothing to merge
+                continue;
+            mergeScanReply(scan->second, message.success, message.value);
+            if (scan->second->replies >= SCAN_QUORUM)
+                finishScanPage(temp_trId, false);
+
+        } else if (mtype == MERKLE) { // If the message type is merkle, compare the tree of the primary with the keys held here
+            MerkleTree remote(message.firstToken, message.lastToken);
+            if (!remote.decodeLeaves(message.value))
+                continue;
+            MerkleTree local(message.firstToken, message.lastToken);
+            buildMerkleTree(message.replica, local, message.firstToken, message.lastToken);
+            vector<pair<size_t, size_t>> ranges = local.differences(remote);
+            if (ranges.empty()) // In sync, nothing to stream
+                continue;
+
+            streamRanges(&rx_address, message.replica, PRIMARY, ranges); // The primary keeps whichever copy was written last
+            Message reply(-100, getMemberNode()->addr, MERKLEDIFF, "", "");
+            reply.replica = message.replica;
+            for (unsigned int i = 0; i < ranges.size(); i++) {
+                putVarint64(reply.value, ranges[i].first);
+                putVarint64(reply.value, ranges[i].second);
+            }
+            sendMessage(&rx_address, reply);
+            log->LOG(&getMemberNode()->addr, "Replicas of %s differ in %d token ranges", rx_address.getAddress().c_str(), (int)ranges.size());
+
+        } else if (mtype == MERKLEDIFF) { // If the message type is merklediff, stream the differing ranges to the replica
+            vector<pair<size_t, size_t>> ranges;
+            size_t pos = 0;
+            uint64_t first, last;
+            while (getVarint64(message.value, pos, first) && getVarint64(message.value, pos, last))
+                ranges.push_back(make_pair((size_t)first, (size_t)last));
+
+            streamRanges(&rx_address, PRIMARY, message.replica, ranges);
+
+        } else if (mtype == REPAIR) { // If the message type is repair, keep the newer of the streamed and the local copy
+            repairKeyValue(key, message.value, message.replica, message.ttl, message.timestamp);
+            int temp_trID = message.transID;
+            if (temp_trID != -100) { // A blocking read repair waits for the acknowledgement, whether the value was stored or was already as new
+                Message reply(temp_trID, getMemberNode()->addr, REPLY_SUCCESS);
+                sendReply(&rx_address, reply);
+            }
+
         } else if (mtype == READREPLY) { // If the message type is readreply
-            Address *sender_address = new Address(message_by_parts[1]); // Get the address of the node which sent the message
-            int temp_trId = atoi(message_by_parts[0].c_str());// Get the transaction id of the message
+            int temp_trId = message.transID;// Get the transaction id of the message
 
-            string valueRead = message_by_parts[3]; // Get the value read by the main server
+            string valueRead = message.value.toString(); // Get the value read by the main server
 
             cout << "Manish reply with transaction id = " << temp_trId << " with value = " << valueRead << endl;
 
-            int num_replies = trInfo[temp_trId]->getNumReplies(); // Get the reply count for this message having particular transaction id.
+            map<int, Transaction*>::iterator transaction = trInfo.find(temp_trId);
+            if (transaction == trInfo.end()) // The transaction is already done, nothing to count
+                continue;
+            int num_replies = transaction->second->getNumReplies(); // Get the reply count for this message having particular transaction id.
 
-            if(valueRead.compare("") != 0) // If the value read is not empty, then increase the number of replies otherwise do nothing. Also, set the value of the value read in transaction info.
+            if(message.success) // If the replica found the key, then increase the number of replies otherwise do nothing. Also, keep the value read if it is the newest so far.
             {
-                trInfo[temp_trId]->setNumReplies(num_replies + 1);
-                Entry *entry = new Entry(valueRead);
-                trInfo[temp_trId]->setTrValue(entry->value);
-                free(entry);
+                transaction->second->setNumReplies(num_replies + 1);
+                transaction->second->addReadReply(rx_address, true, valueRead, message.timestamp, message.ttl > 0 ? par->getcurrtime() + message.ttl : 0);
             }
             else
             {
-                trInfo[temp_trId]->setTrValue(""); // Otherwise set the value of empty.
+                transaction->second->addReadReply(rx_address, false, "", 0, 0); // The replica does not have the key, read repair may send it
             }
         }
 
     }
-
+    sendDeferredReplies(); // Group commit of the mutations handled above
+    takeSnapshot();
+    antiEntropy();
+    logEngineStats();
 
     int current_system_time = par->getcurrtime(); // Get the current system time
 
+    // Fail the pages of scans that did not get a quorum of replies in time
+    for (map<int, ScanRange*>::iterator scan = scanPages.begin(); scan != scanPages.end(); ) {
+        int temp_trId = scan->first;
+        int page_time = scan->second->pageTime;
+        ++scan;
+        if (page_time + 3 <= current_system_time)
+            finishScanPage(temp_trId, true);
+    }
+
     for (map<int, Transaction*>::iterator iterator=trInfo.begin(); iterator!=trInfo.end(); ++iterator){ // Check for all the transactions which were coordinated by this node
         cout << iterator->first << " => " << iterator->second->getTransactionTime() << '\n';
         if (!iterator->second->isValid()) // Check if the transaction is valid
             continue;
         MessageType messageType = static_cast<MessageType>(iterator->second->getTypeOfMessage());
+        if (messageType == READ && iterator->second->isAnswered()) {
+            // The value was returned, the replies that come later are repaired in the background
+            if (iterator->second->getReadReplies().size() >= 3 || (iterator->second->getTransactionTime() + 3) <= current_system_time) {
+                readRepair(iterator->first, iterator->second, false);
+                iterator->second->setInactive();
+            }
+            continue;
+        }
         if (iterator->second->getNumReplies() < 2){ // If the number of replies is less than 2 and current time is already above timeout of the particular transaction then log the failure of that particular type of message for the coordinator.
             if ((iterator->second->getTransactionTime() + 3) <= current_system_time) {
                 if (messageType == CREATE){
@@ -580,12 +1183,19 @@ void MP2Node::checkMessages() {
                 log->logDeleteSuccess(&getMemberNode()->addr, true, iterator->first, iterator->second->getTrKey());
                 iterator->second->setInactive();
             } else if (messageType == READ) {
-                if (iterator->second->getTrValue() != ""){ // If the value read is not empty then log success otherwise log failure.
+                if (par->READ_REPAIR == BLOCKING_READ_REPAIR)
+                    readRepair(iterator->first, iterator->second, true);
+                if (iterator->second->getRepairsPending() > 0 && (iterator->second->getTransactionTime() + 3) > current_system_time)
+                    continue; // The value is returned once the stale replicas of the quorum acknowledged it
+                if (iterator->second->isTrFound()){ // If a replica had the key then log success otherwise log failure.
                     log->logReadSuccess(&getMemberNode()->addr, true, iterator->first, iterator->second->getTrKey(), iterator->second->getTrValue());
                 } else {
                     log->logReadFail(&getMemberNode()->addr, true, iterator->first, iterator->second->getTrKey());
                 }
-                iterator->second->setInactive();
+                if (par->READ_REPAIR == NO_READ_REPAIR)
+                    iterator->second->setInactive();
+                else
+                    iterator->second->setAnswered(); // Kept until every replica replied, for the replies still to come
             } else if (messageType == UPDATE) {
                 log->logUpdateSuccess(&getMemberNode()->addr, true, iterator->first, iterator->second->getTrKey(), iterator->second->getTrValue());
                 iterator->second->setInactive();
@@ -595,6 +1205,16 @@ void MP2Node::checkMessages() {
         }
     }
 
+    // Free the transactions that are done. Late replies for them are ignored.
+    for (map<int, Transaction*>::iterator iterator=trInfo.begin(); iterator!=trInfo.end(); ){
+        if (!iterator->second->isValid()) {
+            delete iterator->second;
+            trInfo.erase(iterator++);
+        } else {
+            ++iterator;
+        }
+    }
+
 
 	/*
 	 * This function should also ensure all READ and UPDATE operation
@@ -634,6 +1254,111 @@ vector<Node> MP2Node::findNodes(string key) {
 	return addr_vec;
 }
 
+/**
+ * FUNCTION NAME: addScanRange
+ *
+ * DESCRIPTION: Starts scanning [firstToken, lastToken] of a clientScan on the node at position
+ * 				owner of the ring and its two successors. Does nothing for an empty range.
+ */
+void MP2Node::addScanRange(int scanId, size_t firstToken, size_t lastToken, int pageSize, int owner) {
+    if (firstToken > lastToken)
+        return;
+    ScanRange *range = new ScanRange();
+    range->scanId = scanId;
+    range->firstToken = firstToken;
+    range->lastToken = lastToken;
+    range->pageSize = pageSize;
+    for (int i = 0; i < 3; i++)
+        range->replicas.push_back(ring.at((owner + i) % ring.size()));
+    pendingScans[scanId]++;
+    requestScanPage(range);
+}
+
+/**
+ * FUNCTION NAME: requestScanPage
+ *
+ * DESCRIPTION: Sends the SCAN for the next page of range to its replicas, each asked for
+ * 				the keys it holds as its replica type, under a new transaction id
+ */
+void MP2Node::requestScanPage(ScanRange *range) {
+    int trId = g_transID;
+    g_transID++;
+    for (unsigned int i = 0; i < range->replicas.size(); i++) {
+        Message message(trId, getMemberNode()->addr, range->firstToken, range->lastToken, range->pageSize, static_cast<ReplicaType>(i), range->afterKey);
+        sendMessage(range->replicas[i].getAddress(), message);
+    }
+    range->pageTime = par->getcurrtime();
+    range->replies = 0;
+    range->page.clear();
+    range->cut = false;
+    scanPages[trId] = range;
+}
+
+/**
+ * FUNCTION NAME: mergeScanReply
+ *
+ * DESCRIPTION: Merges the records of a SCANREPLY into the page of range, keeping the newest
+ * 				write of every key. A reply cut short only covers the keys up to its last
+ * 				one, so the page ends at the smallest such key.
+ */
+void MP2Node::mergeScanReply(ScanRange *range, bool more, const StringView &records) {
+    range->replies++;
+    pair<size_t, string> last;
+    bool any = false;
+    size_t pos = 0;
+    StringView key, value;
+    uint32_t timestamp;
+    while (getVarBytes(records, pos, key) && getVarBytes(records, pos, value) && getVarint32(records, pos, timestamp)) {
+        pair<size_t, string> position(hashFunction(key), key.toString());
+        map<pair<size_t, string>, Entry>::iterator merged = range->page.find(position);
+        if (merged == range->page.end() || merged->second.timestamp < (int)timestamp)
+            range->page[position] = Entry(value.toString(), (int)timestamp, PRIMARY);
+        last = position;
+        any = true;
+    }
+    if (more && any && (!range->cut || last < range->pageEnd)) {
+        range->cut = true;
+        range->pageEnd = last;
+    }
+}
+
+/**
+ * FUNCTION NAME: finishScanPage
+ *
+ * DESCRIPTION: Logs the merged page of the transaction trId, then requests the next page
+ * 				from where it ended, or retires the range once it is done or failed
+ */
+void MP2Node::finishScanPage(int trId, bool failed) {
+    ScanRange *range = scanPages[trId];
+    scanPages.erase(trId);
+
+    if (failed) {
+        log->LOG(&getMemberNode()->addr, "Scan %d of [%zu, %zu] failed with %d replies", range->scanId, range->firstToken, range->lastToken, range->replies);
+    } else {
+        int keys = 0;
+        for (map<pair<size_t, string>, Entry>::iterator item = range->page.begin(); item != range->page.end(); ++item) {
+            if (range->cut && range->pageEnd < item->first)
+                break; // Past the end of the page, some replica did not send its keys there yet
+            log->LOG(&getMemberNode()->addr, "Scan %d: key=%s value=%s", range->scanId, item->first.second.c_str(), item->second.value.c_str());
+            keys++;
+        }
+        if (range->cut) { // Continue after the last key of the page
+            log->LOG(&getMemberNode()->addr, "Scan %d page of [%zu, %zu]: %d keys, continues after %zu:%s", range->scanId, range->firstToken, range->lastToken, keys, range->pageEnd.first, range->pageEnd.second.c_str());
+            range->firstToken = range->pageEnd.first;
+            range->afterKey = range->pageEnd.second;
+            requestScanPage(range);
+            return;
+        }
+        log->LOG(&getMemberNode()->addr, "Scan %d page of [%zu, %zu]: %d keys, range done", range->scanId, range->firstToken, range->lastToken, keys);
+    }
+
+    if (--pendingScans[range->scanId] == 0) {
+        log->LOG(&getMemberNode()->addr, "Scan %d done", range->scanId);
+        pendingScans.erase(range->scanId);
+    }
+    delete range;
+}
+
 /**
  * FUNCTION NAME: recvLoop
  *
@@ -678,35 +1403,40 @@ void MP2Node::stabilizationProtocol() {
         if (memcmp(ring[j].getAddress()->addr, &getMemberNode()->addr, sizeof(Address)) == 0) { // Find the location of this node and assign new predecessors and successors according to the location in the ring.
             switch(j){
                 case 0 : {
-                    Node *temp_node = new Node(ring[ring.size() - 1].nodeAddress);
-                    to_be_predecessor.push_back(*temp_node);
-                    temp_node = new Node(ring[ring.size() - 2].nodeAddress);
-                    to_be_predecessor.push_back(*temp_node);
+                    to_be_predecessor.push_back(Node(ring[ring.size() - 1].nodeAddress));
+                    to_be_predecessor.push_back(Node(ring[ring.size() - 2].nodeAddress));
                     break;
                     }
                 case 1 : {
-                    Node *temp_node = new Node(ring[0].nodeAddress);
-                    to_be_predecessor.push_back(*temp_node);
-                    temp_node = new Node(ring[ring.size() - 1].nodeAddress);
-                    to_be_predecessor.push_back(*temp_node);
+                    to_be_predecessor.push_back(Node(ring[0].nodeAddress));
+                    to_be_predecessor.push_back(Node(ring[ring.size() - 1].nodeAddress));
                     break;
                 }
                 default : {
-                    Node *temp_node = new Node(ring[(j - 1) % ring.size()].nodeAddress);
-                    to_be_predecessor.push_back(*temp_node);
-                    temp_node = new Node(ring[(j - 2) % ring.size()].nodeAddress);
-                    to_be_predecessor.push_back(*temp_node);
+                    to_be_predecessor.push_back(Node(ring[(j - 1) % ring.size()].nodeAddress));
+                    to_be_predecessor.push_back(Node(ring[(j - 2) % ring.size()].nodeAddress));
                     break;
                 }
             }
-            Node *temp_node = new Node(ring[(j + 1) % ring.size()].nodeAddress);
-            to_be_successor.push_back(*temp_node);
-            temp_node = new Node(ring[(j + 2) % ring.size()].nodeAddress);
-            to_be_successor.push_back(*temp_node);
+            to_be_successor.push_back(Node(ring[(j + 1) % ring.size()].nodeAddress));
+            to_be_successor.push_back(Node(ring[(j + 2) % ring.size()].nodeAddress));
         }
     }
 
 
+    // The keys this node is primary for are the PRIMARY keys of its token range (predecessor, this node]
+    vector<pair<string, Entry>> my_primary_keys;
+    for (unsigned int j = 0; j < ring.size(); j++) {
+        if (memcmp(ring[j].getAddress()->addr, &getMemberNode()->addr, sizeof(Address)) == 0) {
+            if (j == 0) { // The range of the first node wraps around the end of the ring
+                collectPrimaryKeys(ring[ring.size() - 1].getHashCode() + 1, RING_SIZE - 1, my_primary_keys);
+                collectPrimaryKeys(0, ring[j].getHashCode(), my_primary_keys);
+            } else {
+                collectPrimaryKeys(ring[j - 1].getHashCode() + 1, ring[j].getHashCode(), my_primary_keys);
+            }
+        }
+    }
+
     // Check for change in replicas
     for (int j = 0; j < to_be_predecessor.size(); j++) {
         ReplicaType rt = static_cast<ReplicaType>(j + 1);
@@ -720,30 +1450,18 @@ void MP2Node::stabilizationProtocol() {
                     node_found = 1;
             }
             if (node_found == 1) {
-                vector<pair<string, string>> my_primary_keys;
-                for (map<string, string>::iterator key_val_itr = ht->hashTable.begin(); key_val_itr != ht->hashTable.end(); key_val_itr++){
-                    Entry temp_entry(key_val_itr->second);
-                    if (temp_entry.replica == PRIMARY){
-                        my_primary_keys.push_back(pair<string, string>(key_val_itr->first, temp_entry.value));
-                    }
-                }
-                Message *message;
                 for (int key_id = 0; key_id < my_primary_keys.size(); ++key_id) {
-                    message = new Message(-100, getMemberNode()->addr, UPDATE, my_primary_keys[key_id].first, my_primary_keys[key_id].second, rt);
-                    emulNet->ENsend(&getMemberNode()->addr, to_be_successor[j].getAddress(), message->toString());
+                    const Entry &entry = my_primary_keys[key_id].second;
+                    int ttl = entry.expiry != 0 ? entry.expiry - par->getcurrtime() : 0; // Replicas expire the key when this node does
+                    Message message(-100, getMemberNode()->addr, UPDATE, my_primary_keys[key_id].first, entry.value, rt, ttl, entry.timestamp);
+                    sendMessage(to_be_successor[j].getAddress(), message);
                 }
             } else {
-                vector<pair<string, string>> my_primary_keys;
-                for (map<string, string>::iterator key_val_itr = ht->hashTable.begin(); key_val_itr != ht->hashTable.end(); key_val_itr++){
-                    Entry temp_entry(key_val_itr->second);
-                    if (temp_entry.replica == PRIMARY){
-                        my_primary_keys.push_back(pair<string, string>(key_val_itr->first, temp_entry.value));
-                    }
-                }
-                Message *message;
                 for (int key_id = 0; key_id < my_primary_keys.size(); ++key_id) {
-                    message = new Message(-100, getMemberNode()->addr, CREATE, my_primary_keys[key_id].first, my_primary_keys[key_id].second, rt);
-                    emulNet->ENsend(&getMemberNode()->addr, to_be_successor[j].getAddress(), message->toString());
+                    const Entry &entry = my_primary_keys[key_id].second;
+                    int ttl = entry.expiry != 0 ? entry.expiry - par->getcurrtime() : 0; // Replicas expire the key when this node does
+                    Message message(-100, getMemberNode()->addr, CREATE, my_primary_keys[key_id].first, entry.value, rt, ttl, entry.timestamp); // The original write time lets a replica that deleted the key refuse it
+                    sendMessage(to_be_successor[j].getAddress(), message);
                 }
             }
         }
@@ -753,3 +1471,194 @@ void MP2Node::stabilizationProtocol() {
     hasMyReplicas = to_be_successor;
     haveReplicasOf = to_be_predecessor;
 }
+
+/**
+ * FUNCTION NAME: collectPrimaryKeys
+ *
+ * DESCRIPTION: Appends the (key, entry) pairs this node holds as PRIMARY with a ring token
+ * 				in [first_token, last_token]. Only the keys of the range are visited.
+ * 				Expired keys are left out, so that they are not streamed to the replicas.
+ */
+void MP2Node::collectPrimaryKeys(size_t first_token, size_t last_token, vector<pair<string, Entry>> &keys) {
+    collectKeys(PRIMARY, first_token, last_token, keys);
+}
+
+/**
+ * FUNCTION NAME: collectKeys
+ *
+ * DESCRIPTION: Appends the (key, entry) pairs this node holds as replica with a ring token in
+ * 				[first_token, last_token], which wraps around the end of the ring when
+ * 				first_token > last_token. Expired keys are left out.
+ */
+void MP2Node::collectKeys(ReplicaType replica, size_t first_token, size_t last_token, vector<pair<string, Entry>> &keys) {
+    if (first_token > last_token) { // Up to the end of the ring, then from its start
+        collectKeys(replica, first_token, RING_SIZE - 1, keys);
+        collectKeys(replica, 0, last_token, keys);
+        return;
+    }
+    int now = par->getcurrtime();
+    for (HashTable::range_iterator key_itr = ht->rangeBegin(replica, first_token, last_token); key_itr != ht->rangeEnd(); ++key_itr) {
+        Entry entry;
+        if (ht->read(key_itr.key(), entry) && !entry.expiredAt(now)) {
+            keys.push_back(pair<string, Entry>(key_itr.key().toString(), entry));
+        }
+    }
+}
+
+/**
+ * FUNCTION NAME: readRepair
+ *
+ * DESCRIPTION: Sends the newest value a READ found, with its write time, to the replicas that
+ * 				replied with an older one or without the key. Each reply is looked at once.
+ * 				A blocking repair asks for a REPLY to every REPAIR, and the coordinator holds the
+ * 				value back until they come (or the transaction times out); a background repair
+ * 				sends them without expecting a reply. A read at a timestamp is not repaired:
+ * 				it sees an older version on purpose.
+ */
+void MP2Node::readRepair(int trId, Transaction *transaction, bool blocking) {
+    if (transaction->getReadTime() > 0 || !transaction->isTrFound())
+        return;
+    int now = par->getcurrtime();
+    int expiry = transaction->getTrExpiry();
+    if (expiry != 0 && expiry <= now) // The newest value ran out meanwhile, the replicas expire it on their own
+        return;
+    vector<Node> replicas = findNodes(transaction->getTrKey());
+    vector<ReadReply> &replies = transaction->getReadReplies();
+    for (unsigned int i = 0; i < replies.size(); i++) {
+        if (replies[i].repaired)
+            continue;
+        replies[i].repaired = true;
+        if (replies[i].found && replies[i].timestamp >= transaction->getTrTimestamp())
+            continue; // Up to date
+        for (unsigned int j = 0; j < replicas.size(); j++) {
+            if (memcmp(replicas[j].getAddress()->addr, replies[i].from.addr, sizeof(Address)) != 0)
+                continue;
+            Message message(blocking ? trId : -100, getMemberNode()->addr, REPAIR, transaction->getTrKey(), transaction->getTrValue(),
+                            static_cast<ReplicaType>(j), expiry != 0 ? expiry - now : 0, transaction->getTrTimestamp());
+            sendMessage(&replies[i].from, message);
+            if (blocking)
+                transaction->setRepairsPending(transaction->getRepairsPending() + 1);
+            log->LOG(&getMemberNode()->addr, "Read repair of %s sent to %s", transaction->getTrKey().c_str(), replies[i].from.getAddress().c_str());
+        }
+    }
+}
+
+/**
+ * FUNCTION NAME: antiEntropy
+ *
+ * DESCRIPTION: Every REPAIR_PERIOD time units, builds the Merkle tree of the PRIMARY keys of the
+ * 				token range of this node and sends its leaves to the two nodes that have its
+ * 				replicas. Each of them compares it with the tree of the keys it holds as that
+ * 				replica, and only the token ranges whose hashes differ are streamed, both ways:
+ * 				the replica sends its keys of those ranges along with the MERKLEDIFF naming them,
+ * 				and this node answers with its own. Every node keeps the copy written last.
+ * 				Unlike stabilization, this repairs writes a replica missed while the ring held still.
+ */
+void MP2Node::antiEntropy() {
+    int now = par->getcurrtime();
+    if (par->REPAIR_PERIOD <= 0 || now - lastRepair < par->REPAIR_PERIOD || ring.size() < 3 || hasMyReplicas.size() < 2)
+        return;
+    lastRepair = now;
+
+    size_t first_token, last_token;
+    if (!primaryRange(first_token, last_token))
+        return;
+    MerkleTree tree(first_token, last_token);
+    buildMerkleTree(PRIMARY, tree, first_token, last_token);
+    string leaves;
+    tree.encodeLeaves(leaves);
+    for (int j = 0; j < 2; j++) {
+        Message message(-100, getMemberNode()->addr, MERKLE, "", leaves);
+        message.firstToken = first_token;
+        message.lastToken = last_token;
+        message.replica = static_cast<ReplicaType>(j + 1);
+        sendMessage(hasMyReplicas[j].getAddress(), message);
+    }
+}
+
+/**
+ * FUNCTION NAME: primaryRange
+ *
+ * DESCRIPTION: Sets [first_token, last_token] to the token range this node is primary for,
+ * 				(predecessor, this node], which wraps around the end of the ring for the first node
+ *
+ * RETURNS:
+ * true if this node is on the ring and owns a range
+ * false otherwise
+ */
+bool MP2Node::primaryRange(size_t &first_token, size_t &last_token) {
+    for (unsigned int j = 0; j < ring.size(); j++) {
+        if (memcmp(ring[j].getAddress()->addr, &getMemberNode()->addr, sizeof(Address)) == 0) {
+            size_t predecessor = ring[j == 0 ? ring.size() - 1 : j - 1].getHashCode();
+            if (predecessor == ring[j].getHashCode()) // Two nodes on the same token, the range is empty
+                return false;
+            first_token = (predecessor + 1) % RING_SIZE;
+            last_token = ring[j].getHashCode();
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * FUNCTION NAME: buildMerkleTree
+ *
+ * DESCRIPTION: Adds the keys this node holds as replica in [first_token, last_token] to tree and builds it
+ */
+void MP2Node::buildMerkleTree(ReplicaType replica, MerkleTree &tree, size_t first_token, size_t last_token) {
+    vector<pair<string, Entry>> keys;
+    collectKeys(replica, first_token, last_token, keys);
+    for (unsigned int i = 0; i < keys.size(); i++)
+        tree.add(hashFunction(keys[i].first), keys[i].first, keys[i].second);
+    tree.build();
+}
+
+/**
+ * FUNCTION NAME: streamRanges
+ *
+ * DESCRIPTION: Sends the keys this node holds as replica held in the token ranges to the node at
+ * 				address as REPAIR messages, to be stored there as replica sent. A key keeps its
+ * 				write time, and its TTL runs out when it does here.
+ */
+void MP2Node::streamRanges(Address *address, ReplicaType held, ReplicaType sent, const vector<pair<size_t, size_t>> &ranges) {
+    int now = par->getcurrtime();
+    for (unsigned int i = 0; i < ranges.size(); i++) {
+        vector<pair<string, Entry>> keys;
+        collectKeys(held, ranges[i].first, ranges[i].second, keys);
+        for (unsigned int key_id = 0; key_id < keys.size(); key_id++) {
+            const Entry &entry = keys[key_id].second;
+            int ttl = entry.expiry != 0 ? entry.expiry - now : 0;
+            Message message(-100, getMemberNode()->addr, REPAIR, keys[key_id].first, entry.value, sent, ttl, entry.timestamp);
+            sendMessage(address, message);
+        }
+    }
+}
+
+/**
+ * FUNCTION NAME: repairKeyValue
+ *
+ * DESCRIPTION: Server side of a REPAIR: stores the streamed value unless the local one was written
+ * 				at the same time or later. A key deleted after the streamed value was written
+ * 				stays deleted: its tombstone refuses the value. A local copy as new as the streamed
+ * 				one still takes its replica type, which a change of the ring may have left stale.
+ *
+ * RETURNS:
+ * true if the streamed value was stored
+ * false otherwise
+ */
+bool MP2Node::repairKeyValue(const StringView &key, const StringView &value, ReplicaType replica, int ttl, int timestamp) {
+    Entry local;
+    int now = par->getcurrtime();
+    bool present = ht->read(key, local);
+    if (present && !local.expiredAt(now) && local.timestamp >= timestamp) {
+        if (local.replica == replica)
+            return false; // The local copy is as new
+        // Kept under the replica type of a ring before stabilization: only the type moves
+        return updateKeyValue(key, local.value, replica, local.expiry != 0 ? local.expiry - now : 0, local.timestamp);
+    }
+    if (!hasRoomFor(present ? StringView() : key, value))
+        return false;
+    if (present)
+        return updateKeyValue(key, value, replica, ttl, timestamp);
+    return createKeyValue(key, value, replica, ttl, timestamp);
+}
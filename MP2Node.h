@@ -14,11 +14,24 @@
 #include "EmulNet.h"
 #include "Node.h"
 #include "HashTable.h"
+#include "CommitLog.h"
+#include "Snapshot.h"
+#include "HintStore.h"
+#include "MerkleTree.h"
+#include "TimerWheel.h"
 #include "Log.h"
 #include "Params.h"
 #include "Message.h"
 #include "Queue.h"
 
+/*
+ * Macros
+ */
+// Replies a page of a scan needs before it is merged
+#define SCAN_QUORUM 2
+// Bytes of records a SCANREPLY carries at most, so that it fits in one message
+#define SCAN_REPLY_BYTES 3000
+
 /**
  * CLASS NAME: MP2Node
  *
@@ -27,8 +40,22 @@
  * 				1) Ring
  * 				2) Stabilization Protocol
  * 				3) Server side CRUD APIs
- * 				4) Client side CRUD APIs
+ * 				4) Client side CRUD and token range scan APIs
+ * 				5) Anti-entropy repair between a node and its replicas
+ */
+
+/**
+ * STRUCT NAME: ReadReply
+ *
+ * DESCRIPTION: What one replica answered to a READ: whether it had the key, and the write
+ * 				time of its value. repaired is set once read repair looked at the reply.
  */
+typedef struct ReadReply {
+	Address from;
+	bool found;
+	int timestamp;
+	bool repaired;
+}ReadReply;
 
 // Transaction class that stores the details of the transactions. It stores the transaction id, transaction time, reply count, type of msg, key, val and validity. Class also provide its setter and getter methods.
 class Transaction {
@@ -40,6 +67,16 @@ private :
     string trKey;
     string trVal;
 	int valid;
+	// Of a READ: the time it reads the key at, 0 for its newest value, whether a replica had
+	// the key, the write time and expiry of the newest value replied so far, and every reply
+	int readTime;
+	bool trFound;
+	int trTimestamp;
+	int trExpiry;
+	vector<ReadReply> readReplies;
+	// Of a READ: REPAIR acknowledgements a blocking read repair waits for, and whether the value was returned
+	int repairsPending;
+	bool answered;
 
 public :
 	Transaction(int trId, int type_of_msg, string trKey, string trVal, int trTime) {
@@ -50,6 +87,12 @@ public :
 		this->trTime = trTime;
 		this->valid = 1;
 		this->numReplies = 0;
+		this->readTime = 0;
+		this->trFound = false;
+		this->trTimestamp = 0;
+		this->trExpiry = 0;
+		this->repairsPending = 0;
+		this->answered = false;
 	}
 	Transaction(const Transaction &trObj){
     }
@@ -63,6 +106,13 @@ public :
 		this->trKey = trObj.trKey;
 		this->trVal = trObj.trVal;
 		this->valid = trObj.valid;
+		this->readTime = trObj.readTime;
+		this->trFound = trObj.trFound;
+		this->trTimestamp = trObj.trTimestamp;
+		this->trExpiry = trObj.trExpiry;
+		this->readReplies = trObj.readReplies;
+		this->repairsPending = trObj.repairsPending;
+		this->answered = trObj.answered;
 		return *this;
 	}
 
@@ -102,8 +152,89 @@ public :
 	void setTrValue(string value){
 		this->trVal = value;
 	}
+
+	int getReadTime(){
+		return this->readTime;
+	}
+
+	void setReadTime(int readTime){
+		this->readTime = readTime;
+	}
+
+	bool isTrFound(){
+		return this->trFound;
+	}
+
+	int getTrTimestamp(){
+		return this->trTimestamp;
+	}
+
+	int getTrExpiry(){
+		return this->trExpiry;
+	}
+
+	// Records a READREPLY, keeping the value written last as the value of the transaction.
+	// An empty value is a value like any other.
+	void addReadReply(const Address &from, bool found, const string &value, int timestamp, int expiry){
+		ReadReply reply;
+		reply.from = from;
+		reply.found = found;
+		reply.timestamp = timestamp;
+		reply.repaired = false;
+		this->readReplies.push_back(reply);
+		if (found && (!this->trFound || timestamp > this->trTimestamp)) {
+			this->trFound = true;
+			this->trVal = value;
+			this->trTimestamp = timestamp;
+			this->trExpiry = expiry;
+		}
+	}
+
+	vector<ReadReply> & getReadReplies(){
+		return this->readReplies;
+	}
+
+	int getRepairsPending(){
+		return this->repairsPending;
+	}
+
+	void setRepairsPending(int repairsPending){
+		this->repairsPending = repairsPending;
+	}
+
+	bool isAnswered(){
+		return this->answered;
+	}
+
+	void setAnswered(){
+		this->answered = true;
+	}
 };
 
+/**
+ * STRUCT NAME: ScanRange
+ *
+ * DESCRIPTION: Coordinator side state of the part of a clientScan owned by one node:
+ * 				the rest of the token range still to scan, from the continuation
+ * 				(firstToken, afterKey) on, and the replies to the page in flight
+ * 				merged by (token, key), keeping the newest write of every key.
+ */
+typedef struct ScanRange {
+	int scanId;
+	size_t firstToken;
+	size_t lastToken;
+	string afterKey;
+	int pageSize;
+	// Owner of the range and its two successors, the PRIMARY, SECONDARY and TERTIARY replicas
+	vector<Node> replicas;
+	int pageTime;
+	int replies;
+	map<pair<size_t, string>, Entry> page;
+	// Smallest last key of the replies that were cut short; the page ends there
+	bool cut;
+	pair<size_t, string> pageEnd;
+}ScanRange;
+
 class MP2Node {
 private:
 	// Vector holding the next two neighbors in the ring who have my replicas
@@ -114,6 +245,28 @@ private:
 	vector<Node> ring;
 	// Hash Table
 	HashTable * ht;
+	// LSM engine behind the hash table, owned by it, NULL for the memory engine
+	LsmEngine * lsm;
+	// Compactions already reported in the log
+	unsigned long reportedCompactions;
+	// Records the snapshot and the commit log applied while the storage was opened
+	unsigned long appliedRecords;
+	// Commit log of the server side mutations, NULL when it is off
+	CommitLog * commitLog;
+	// Snapshots of the memory engine, NULL when they are off
+	Snapshot * snapshot;
+	// Writes kept for failed replicas, NULL when hinted handoff is off
+	HintStore * hints;
+	// Time the last snapshot was started at
+	int lastSnapshot;
+	// Time this node last sent the Merkle tree of its range to its replicas
+	int lastRepair;
+	// Expiry of the keys written with a TTL
+	TimerWheel expiries;
+	// Replies held back until the commit log syncs the mutations they acknowledge, encoded
+	vector<pair<Address, string> > deferredReplies;
+	// Encoding of the message being sent, reused from one message to the next
+	string sendBuffer;
 	// Member representing this member
 	Member *memberNode;
 	// Params object
@@ -124,6 +277,10 @@ private:
 	Log * log;
 	// Map from trans id to transaction information
     map<int, Transaction*> trInfo;
+	// Map from trans id of the page in flight to the scan range it was requested for
+	map<int, ScanRange*> scanPages;
+	// Ranges of every clientScan not done yet
+	map<int, int> pendingScans;
 
 public:
 	MP2Node(Member *memberNode, Params *par, EmulNet *emulNet, Log *log, Address *addressOfMember);
@@ -134,14 +291,20 @@ public:
 	// ring functionalities
 	void updateRing();
 	vector<Node> getMembershipList();
-	size_t hashFunction(string key);
+	static size_t hashFunction(const StringView &key);
 	void findNeighbors();
 
 	// client side CRUD APIs
-	void clientCreate(string key, string value);
-	void clientRead(string key);
-	void clientUpdate(string key, string value);
+	void clientCreate(string key, string value, int ttl = 0);
+	void clientRead(string key, int timestamp = 0);
+	void clientUpdate(string key, string value, int ttl = 0);
 	void clientDelete(string key);
+	void clientScan(size_t startToken, size_t endToken, int pageSize);
+
+	// hinted handoff
+	void sendWrite(Address *address, Message message);
+	bool isReachable(Address *address);
+	void replayHints();
 
 	// receive messages from Emulnet
 	bool recvLoop();
@@ -157,13 +320,51 @@ public:
 	vector<Node> findNodes(string key);
 
 	// server
-	bool createKeyValue(string key, string value, ReplicaType replica);
-	string readKey(string key);
-	bool updateKeyValue(string key, string value, ReplicaType replica);
-	bool deletekey(string key);
+	bool createKeyValue(const StringView &key, const StringView &value, ReplicaType replica, int ttl = 0, int timestamp = 0);
+	bool readKey(const StringView &key, EntryView &entry, int timestamp = 0);
+	bool updateKeyValue(const StringView &key, const StringView &value, ReplicaType replica, int ttl = 0, int timestamp = 0);
+	bool deletekey(const StringView &key);
+	string scanKeys(size_t first_token, size_t last_token, const string &after_key, int page_size, ReplicaType replica, bool &more);
+
+	// scan coordination
+	void addScanRange(int scanId, size_t firstToken, size_t lastToken, int pageSize, int owner);
+	void requestScanPage(ScanRange *range);
+	void mergeScanReply(ScanRange *range, bool more, const StringView &records);
+	void finishScanPage(int trId, bool failed);
+
+	// durability
+	void openStorage();
+	void closeStorage();
+	void restart();
+	static bool makeDirectories(string path);
+	static void applyLogRecord(void *owner, MessageType op, const string &key, const Entry &entry);
+	static void onEngineFlush(void *owner);
+	void sendReply(Address *address, const Message &reply);
+	void sendMessage(Address *address, const Message &message);
+	void sendDeferredReplies();
+	void takeSnapshot();
+	bool hasRoomFor(const StringView &key, const StringView &value);
+	void logEngineStats();
+
+	// expiry
+	void scheduleExpiry(const StringView &key, const EntryView &entry);
+	void scheduleStoredExpiries();
+	void expireKeys();
 
 	// stabilization protocol - handle multiple failures
 	void stabilizationProtocol();
+	void collectPrimaryKeys(size_t first_token, size_t last_token, vector<pair<string, Entry>> &keys);
+	void collectKeys(ReplicaType replica, size_t first_token, size_t last_token, vector<pair<string, Entry>> &keys);
+
+	// read repair
+	void readRepair(int trId, Transaction *transaction, bool blocking);
+
+	// anti-entropy repair
+	void antiEntropy();
+	bool primaryRange(size_t &first_token, size_t &last_token);
+	void buildMerkleTree(ReplicaType replica, MerkleTree &tree, size_t first_token, size_t last_token);
+	void streamRanges(Address *address, ReplicaType held, ReplicaType sent, const vector<pair<size_t, size_t>> &ranges);
+	bool repairKeyValue(const StringView &key, const StringView &value, ReplicaType replica, int ttl, int timestamp);
 
     ~MP2Node();
 };
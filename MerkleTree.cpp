@@ -0,0 +1,163 @@
+/**********************************
+ * FILE NAME: MerkleTree.cpp
+ *
+ * DESCRIPTION: Definition of the MerkleTree class
+ **********************************/
+
+#include "MerkleTree.h"
+#include "Coding.h"
+
+/**
+ * Constructor
+ */
+MerkleTree::MerkleTree(size_t firstToken, size_t lastToken): firstToken(firstToken),
+		span((lastToken + RING_SIZE - firstToken) % RING_SIZE + 1), nodes(2 * MERKLE_LEAVES, 0) {}
+
+/**
+ * FUNCTION NAME: contains
+ *
+ * DESCRIPTION: Returns true if token is in the range of the tree
+ */
+bool MerkleTree::contains(size_t token) const {
+	return (token + RING_SIZE - firstToken) % RING_SIZE < span;
+}
+
+/**
+ * FUNCTION NAME: leafOf
+ *
+ * DESCRIPTION: Returns the leaf holding a token of the range
+ */
+unsigned int MerkleTree::leafOf(size_t token) const {
+	size_t offset = (token + RING_SIZE - firstToken) % RING_SIZE;
+	return (unsigned int)(offset * MERKLE_LEAVES / span);
+}
+
+/**
+ * FUNCTION NAME: leafRange
+ *
+ * DESCRIPTION: Sets [first, last] to the offsets in the range of the tokens of a leaf.
+ * 				first > last for a leaf without tokens, when the range has fewer
+ * 				tokens than the tree has leaves.
+ */
+void MerkleTree::leafRange(unsigned int leaf, size_t &first, size_t &last) const {
+	first = (leaf * span + MERKLE_LEAVES - 1) / MERKLE_LEAVES;
+	last = ((leaf + 1) * span + MERKLE_LEAVES - 1) / MERKLE_LEAVES - 1;
+}
+
+/**
+ * FUNCTION NAME: add
+ *
+ * DESCRIPTION: Adds the key at token, with the value of entry, to its leaf. The replica type, the
+ * 				write time and the expiry are left out: they differ between nodes holding the same value.
+ */
+void MerkleTree::add(size_t token, const string &key, const Entry &entry) {
+	if ( !contains(token) ) {
+		return;
+	}
+	uint64_t hash = hashBytes(key.data(), key.size());
+	hash = (hash ^ hashBytes(entry.value.data(), entry.value.size())) * 0x9e3779b97f4a7c15ULL;
+	nodes[MERKLE_LEAVES + leafOf(token)] += hash ^ (hash >> 31);
+}
+
+/**
+ * FUNCTION NAME: build
+ *
+ * DESCRIPTION: Hashes the inner nodes from the leaves up
+ */
+void MerkleTree::build() {
+	for ( unsigned int i = MERKLE_LEAVES - 1; i >= 1; i-- ) {
+		uint64_t left = nodes[2 * i];
+		uint64_t right = nodes[2 * i + 1];
+		nodes[i] = ((left * 0x9e3779b97f4a7c15ULL) ^ (right + 0x632be59bd9b4e019ULL)) * 0xbf58476d1ce4e5b9ULL;
+	}
+}
+
+/**
+ * FUNCTION NAME: root
+ *
+ * DESCRIPTION: Returns the hash of the root, which covers the whole range
+ */
+uint64_t MerkleTree::root() const {
+	return nodes[1];
+}
+
+/**
+ * FUNCTION NAME: encodeLeaves
+ *
+ * DESCRIPTION: Appends the hashes of the leaves, 8 bytes each
+ */
+void MerkleTree::encodeLeaves(string &out) const {
+	for ( unsigned int i = 0; i < MERKLE_LEAVES; i++ ) {
+		putUint64(out, nodes[MERKLE_LEAVES + i]);
+	}
+}
+
+/**
+ * FUNCTION NAME: decodeLeaves
+ *
+ * DESCRIPTION: Sets the leaves to the hashes encoded by encodeLeaves, then builds the tree above them
+ *
+ * RETURNS:
+ * true on SUCCESS
+ * false if there are not MERKLE_LEAVES of them
+ */
+bool MerkleTree::decodeLeaves(const StringView &hashes) {
+	if ( hashes.size != MERKLE_LEAVES * sizeof(uint64_t) ) {
+		return false;
+	}
+	size_t pos = 0;
+	for ( unsigned int i = 0; i < MERKLE_LEAVES; i++ ) {
+		getUint64(hashes, pos, nodes[MERKLE_LEAVES + i]);
+	}
+	build();
+	return true;
+}
+
+/**
+ * FUNCTION NAME: diff
+ *
+ * DESCRIPTION: Appends the token ranges of the leaves under node that differ from another,
+ * 				merging a range with the previous one when they touch
+ */
+void MerkleTree::diff(const MerkleTree &another, unsigned int node, vector<pair<size_t, size_t> > &ranges) const {
+	if ( nodes[node] == another.nodes[node] ) {
+		return;
+	}
+	if ( node < MERKLE_LEAVES ) {
+		diff(another, 2 * node, ranges);
+		diff(another, 2 * node + 1, ranges);
+		return;
+	}
+	size_t first, last;
+	leafRange(node - MERKLE_LEAVES, first, last);
+	if ( first > last ) {
+		return;
+	}
+	if ( !ranges.empty() && ranges.back().second + 1 == first ) {
+		ranges.back().second = last;
+	}
+	else {
+		ranges.push_back(make_pair(first, last));
+	}
+}
+
+/**
+ * FUNCTION NAME: differences
+ *
+ * DESCRIPTION: Returns the token ranges where another tree over the same range differs from this one.
+ * 				A range wraps around the end of the ring when its first token > its last.
+ */
+vector<pair<size_t, size_t> > MerkleTree::differences(const MerkleTree &another) const {
+	vector<pair<size_t, size_t> > ranges;
+	if ( firstToken != another.firstToken || span != another.span ) {
+		ranges.push_back(make_pair((size_t)0, span - 1));
+	}
+	else {
+		diff(another, 1, ranges);
+	}
+	for ( unsigned int i = 0; i < ranges.size(); i++ ) {
+		ranges[i].first = (firstToken + ranges[i].first) % RING_SIZE;
+		ranges[i].second = (firstToken + ranges[i].second) % RING_SIZE;
+	}
+	return ranges;
+}
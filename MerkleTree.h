@@ -0,0 +1,63 @@
+/**********************************
+ * FILE NAME: MerkleTree.h
+ *
+ * DESCRIPTION: Header file of the MerkleTree class
+ **********************************/
+
+#ifndef MERKLETREE_H_
+#define MERKLETREE_H_
+
+/**
+ * Header files
+ */
+#include "stdincludes.h"
+#include "Entry.h"
+#include "StringView.h"
+#include <stdint.h>
+
+/*
+ * Macros
+ */
+// Levels below the root; the token range is split into 2^MERKLE_DEPTH leaves
+#define MERKLE_DEPTH 6
+#define MERKLE_LEAVES (1 << MERKLE_DEPTH)
+
+/**
+ * CLASS NAME: MerkleTree
+ *
+ * DESCRIPTION: Hash tree over the keys a node holds in a token range of the ring.
+ * 				The range [firstToken, lastToken] wraps around the end of the ring when
+ * 				firstToken > lastToken, and is split into MERKLE_LEAVES leaves of
+ * 				consecutive tokens. The hash of a leaf is the sum of the hashes of the
+ * 				keys and values in it, so it does not depend on the order they are
+ * 				added in; an inner node hashes its two children.
+ * 				Two nodes holding the same keys and values in a range build the same
+ * 				tree. Once build() hashed the inner nodes, differences() walks both
+ * 				trees from the root, skipping the subtrees whose hashes match, and
+ * 				returns the token ranges of the leaves that differ. The leaves alone
+ * 				travel between nodes: the tree above them is rebuilt from them.
+ */
+class MerkleTree {
+private:
+	size_t firstToken;
+	// Tokens in the range
+	size_t span;
+	// Heap layout: the root at 1, the children of i at 2i and 2i + 1, the leaves from MERKLE_LEAVES on
+	vector<uint64_t> nodes;
+
+	unsigned int leafOf(size_t token) const;
+	void leafRange(unsigned int leaf, size_t &first, size_t &last) const;
+	void diff(const MerkleTree &another, unsigned int node, vector<pair<size_t, size_t> > &ranges) const;
+
+public:
+	MerkleTree(size_t firstToken, size_t lastToken);
+	bool contains(size_t token) const;
+	void add(size_t token, const string &key, const Entry &entry);
+	void build();
+	uint64_t root() const;
+	void encodeLeaves(string &out) const;
+	bool decodeLeaves(const StringView &hashes);
+	vector<pair<size_t, size_t> > differences(const MerkleTree &another) const;
+};
+
+#endif /* MERKLETREE_H_ */
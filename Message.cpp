@@ -4,18 +4,27 @@
  * DESCRIPTION: Message class definition
  **********************************/
 #include "Message.h"
+#include "Coding.h"
 
 /**
  * Constructor
  */
-// transID::fromAddr::CREATE::key::value::ReplicaType
-// transID::fromAddr::READ::key
-// transID::fromAddr::UPDATE::key::value::ReplicaType
+// transID::fromAddr::CREATE::key::value::ReplicaType[::ttl[::timestamp]]
+// transID::fromAddr::READ::key[::timestamp]
+// transID::fromAddr::UPDATE::key::value::ReplicaType[::ttl[::timestamp]]
 // transID::fromAddr::DELETE::key
-// transID::fromAddr::REPLY::sucess
-// transID::fromAddr::READREPLY::value
+// transID::fromAddr::REPLY::status (0 failure, 1 success, 2 memory cap reached)
+// transID::fromAddr::READREPLY::value[::ttl]
+// transID::fromAddr::SCAN::firstToken::lastToken::pageSize::ReplicaType[::afterKey]
+// transID::fromAddr::SCANREPLY::more[::key::value::timestamp...]
+// transID::fromAddr::MERKLE::firstToken::lastToken::ReplicaType::leafHash...
+// transID::fromAddr::MERKLEDIFF::ReplicaType[::firstToken::lastToken...]
+// transID::fromAddr::REPAIR::key::value::ReplicaType::ttl::timestamp
 Message::Message(string message){
 	this->delimiter = "::";
+	ttl = 0;
+	timestamp = 0;
+	replica = PRIMARY;
 	vector<string> tuple;
 	size_t pos = message.find(delimiter);
 	size_t start = 0;
@@ -34,23 +43,56 @@ Message::Message(string message){
 	switch(type){
 		case CREATE:
 		case UPDATE:
+		case REPAIR:
 			key = tuple.at(3);
 			value = tuple.at(4);
 			if (tuple.size() > 5)
 				replica = static_cast<ReplicaType>(stoi(tuple.at(5)));
+			if (tuple.size() > 6)
+				ttl = stoi(tuple.at(6));
+			if (tuple.size() > 7)
+				timestamp = stoi(tuple.at(7));
 			break;
 		case READ:
 		case DELETE:
 			key = tuple.at(3);
+			if (tuple.size() > 4)
+				timestamp = stoi(tuple.at(4));
 			break;
 		case REPLY:
-			if (tuple.at(3) == "1")
-				success = true;
-			else
-				success = false;
+			status = static_cast<ReplyStatus>(stoi(tuple.at(3)));
+			success = (status == REPLY_SUCCESS);
 			break;
 		case READREPLY:
 			value = tuple.at(3);
+			if (tuple.size() > 4)
+				ttl = stoi(tuple.at(4));
+			break;
+		case SCAN:
+			firstToken = stoul(tuple.at(3));
+			lastToken = stoul(tuple.at(4));
+			pageSize = stoi(tuple.at(5));
+			replica = static_cast<ReplicaType>(stoi(tuple.at(6)));
+			if (tuple.size() > 7)
+				key = tuple.at(7);
+			break;
+		case SCANREPLY:
+			success = stoi(tuple.at(3)) != 0;
+			// The records are kept encoded, the way they were sent
+			for (size_t i = 4; i < tuple.size(); i++)
+				value += (i > 4 ? delimiter : "") + tuple.at(i);
+			break;
+		case MERKLE:
+			firstToken = stoul(tuple.at(3));
+			lastToken = stoul(tuple.at(4));
+			replica = static_cast<ReplicaType>(stoi(tuple.at(5)));
+			for (size_t i = 6; i < tuple.size(); i++)
+				value += (i > 6 ? delimiter : "") + tuple.at(i);
+			break;
+		case MERKLEDIFF:
+			replica = static_cast<ReplicaType>(stoi(tuple.at(3)));
+			for (size_t i = 4; i < tuple.size(); i++)
+				value += (i > 4 ? delimiter : "") + tuple.at(i);
 			break;
 	}
 }
@@ -59,7 +101,7 @@ Message::Message(string message){
  * Constructor
  */
 // construct a create or update message
-Message::Message(int _transID, Address _fromAddr, MessageType _type, string _key, string _value, ReplicaType _replica){
+Message::Message(int _transID, Address _fromAddr, MessageType _type, string _key, string _value, ReplicaType _replica, int _ttl, int _timestamp){
 	this->delimiter = "::";
 	transID = _transID;
 	fromAddr = _fromAddr;
@@ -67,6 +109,29 @@ Message::Message(int _transID, Address _fromAddr, MessageType _type, string _key
 	key = _key;
 	value = _value;
 	replica = _replica;
+	ttl = _ttl;
+	timestamp = _timestamp;
+}
+
+/**
+ * Constructor
+ */
+// copy a decoded message out of the buffer it views
+Message::Message(const MessageView &view){
+	this->delimiter = "::";
+	transID = view.transID;
+	fromAddr = view.fromAddr;
+	type = view.type;
+	replica = view.replica;
+	ttl = view.ttl;
+	timestamp = view.timestamp;
+	firstToken = view.firstToken;
+	lastToken = view.lastToken;
+	pageSize = view.pageSize;
+	success = view.success;
+	status = view.status;
+	key = view.key.toString();
+	value = view.value.toString();
 }
 
 /**
@@ -77,7 +142,13 @@ Message::Message(const Message& anotherMessage) {
 	this->fromAddr = anotherMessage.fromAddr;
 	this->key = anotherMessage.key;
 	this->replica = anotherMessage.replica;
+	this->ttl = anotherMessage.ttl;
+	this->timestamp = anotherMessage.timestamp;
+	this->firstToken = anotherMessage.firstToken;
+	this->lastToken = anotherMessage.lastToken;
+	this->pageSize = anotherMessage.pageSize;
 	this->success = anotherMessage.success;
+	this->status = anotherMessage.status;
 	this->transID = anotherMessage.transID;
 	this->type = anotherMessage.type;
 	this->value = anotherMessage.value;
@@ -88,6 +159,9 @@ Message::Message(const Message& anotherMessage) {
  */
 Message::Message(int _transID, Address _fromAddr, MessageType _type, string _key, string _value){
 	this->delimiter = "::";
+	ttl = 0;
+	timestamp = 0;
+	replica = PRIMARY;
 	transID = _transID;
 	fromAddr = _fromAddr;
 	type = _type;
@@ -101,6 +175,9 @@ Message::Message(int _transID, Address _fromAddr, MessageType _type, string _key
 // construct a read or delete message
 Message::Message(int _transID, Address _fromAddr, MessageType _type, string _key){
 	this->delimiter = "::";
+	ttl = 0;
+	timestamp = 0;
+	replica = PRIMARY;
 	transID = _transID;
 	fromAddr = _fromAddr;
 	type = _type;
@@ -113,10 +190,30 @@ Message::Message(int _transID, Address _fromAddr, MessageType _type, string _key
 // construct reply message
 Message::Message(int _transID, Address _fromAddr, MessageType _type, bool _success){
 	this->delimiter = "::";
+	ttl = 0;
+	timestamp = 0;
+	replica = PRIMARY;
 	transID = _transID;
 	fromAddr = _fromAddr;
 	type = _type;
 	success = _success;
+	status = _success ? REPLY_SUCCESS : REPLY_FAILURE;
+}
+
+/**
+ * Constructor
+ */
+// construct a reply message telling why the request failed
+Message::Message(int _transID, Address _fromAddr, ReplyStatus _status){
+	this->delimiter = "::";
+	ttl = 0;
+	timestamp = 0;
+	replica = PRIMARY;
+	transID = _transID;
+	fromAddr = _fromAddr;
+	type = REPLY;
+	status = _status;
+	success = (_status == REPLY_SUCCESS);
 }
 
 /**
@@ -125,10 +222,33 @@ Message::Message(int _transID, Address _fromAddr, MessageType _type, bool _succe
 // construct read reply message
 Message::Message(int _transID, Address _fromAddr, string _value){
 	this->delimiter = "::";
+	ttl = 0;
+	timestamp = 0;
+	replica = PRIMARY;
 	transID = _transID;
 	fromAddr = _fromAddr;
 	type = READREPLY;
 	value = _value;
+	success = true;
+}
+
+/**
+ * Constructor
+ */
+// construct a scan message
+Message::Message(int _transID, Address _fromAddr, size_t _firstToken, size_t _lastToken, int _pageSize, ReplicaType _replica, string _afterKey){
+	this->delimiter = "::";
+	ttl = 0;
+	timestamp = 0;
+	replica = PRIMARY;
+	transID = _transID;
+	fromAddr = _fromAddr;
+	type = SCAN;
+	firstToken = _firstToken;
+	lastToken = _lastToken;
+	pageSize = _pageSize;
+	replica = _replica;
+	key = _afterKey;
 }
 
 /**
@@ -141,20 +261,44 @@ string Message::toString(){
 	switch(type){
 		case CREATE:
 		case UPDATE:
+		case REPAIR:
 			message += key + delimiter + value + delimiter + to_string(replica);
+			if (ttl > 0 || timestamp > 0)
+				message += delimiter + to_string(ttl);
+			if (timestamp > 0)
+				message += delimiter + to_string(timestamp);
 			break;
 		case READ:
 		case DELETE:
 			message += key;
+			if (timestamp > 0)
+				message += delimiter + to_string(timestamp);
 			break;
 		case REPLY:
-			if (success)
-				message += "1";
-			else
-				message += "0";
+			message += to_string(status);
 			break;
 		case READREPLY:
 			message += value;
+			if (ttl > 0)
+				message += delimiter + to_string(ttl);
+			break;
+		case SCAN:
+			message += to_string(firstToken) + delimiter + to_string(lastToken) + delimiter + to_string(pageSize) + delimiter + to_string(replica);
+			if (!key.empty())
+				message += delimiter + key;
+			break;
+		case SCANREPLY:
+			message += to_string(success ? 1 : 0);
+			if (!value.empty())
+				message += delimiter + value;
+			break;
+		case MERKLE:
+			message += to_string(firstToken) + delimiter + to_string(lastToken) + delimiter + to_string(replica) + delimiter + value;
+			break;
+		case MERKLEDIFF:
+			message += to_string(replica);
+			if (!value.empty())
+				message += delimiter + value;
 			break;
 	}
 	return message;
@@ -168,9 +312,190 @@ Message& Message::operator =(const Message& anotherMessage) {
 	this->fromAddr = anotherMessage.fromAddr;
 	this->key = anotherMessage.key;
 	this->replica = anotherMessage.replica;
+	this->ttl = anotherMessage.ttl;
+	this->timestamp = anotherMessage.timestamp;
+	this->firstToken = anotherMessage.firstToken;
+	this->lastToken = anotherMessage.lastToken;
+	this->pageSize = anotherMessage.pageSize;
 	this->success = anotherMessage.success;
+	this->status = anotherMessage.status;
 	this->transID = anotherMessage.transID;
 	this->type = anotherMessage.type;
 	this->value = anotherMessage.value;
 	return *this;
 }
+
+/**
+ * FUNCTION NAME: encode
+ *
+ * DESCRIPTION: Replaces the contents of buffer with the binary encoding of the message:
+ * 				MESSAGE_VERSION, the type and replica bytes, transID as 4 bytes and the 6
+ * 				bytes of fromAddr, then the fields of the type, integers as varints and
+ * 				strings after their varint length. Values may hold any byte, "::" included.
+ * 				A buffer kept across calls keeps its capacity, so encoding does not allocate.
+ * 				Integers are in host byte order, like Coding.h: every node runs in this process.
+ */
+void Message::encode(string &buffer) const {
+	encode(buffer, StringView(value));
+}
+
+// The same with _value in place of value, e.g. a READREPLY value viewed where the storage engine keeps it
+void Message::encode(string &buffer, const StringView &_value) const {
+	buffer.clear();
+	buffer.push_back((char)MESSAGE_VERSION);
+	buffer.push_back((char)type);
+	buffer.push_back((char)replica);
+	putUint32(buffer, (uint32_t)transID);
+	buffer.append(fromAddr.addr, sizeof(fromAddr.addr));
+	switch(type){
+		case CREATE:
+		case UPDATE:
+		case REPAIR:
+			putVarint32(buffer, (uint32_t)ttl);
+			putVarint32(buffer, (uint32_t)timestamp);
+			putVarBytes(buffer, StringView(key));
+			break;
+		case READ:
+		case DELETE:
+			putVarint32(buffer, (uint32_t)timestamp);
+			putVarBytes(buffer, StringView(key));
+			return;
+		case REPLY:
+			buffer.push_back((char)status);
+			return;
+		case READREPLY:
+			buffer.push_back((char)success);
+			putVarint32(buffer, (uint32_t)ttl);
+			putVarint32(buffer, (uint32_t)timestamp);
+			break;
+		case SCAN:
+			putVarint64(buffer, firstToken);
+			putVarint64(buffer, lastToken);
+			putVarint32(buffer, (uint32_t)pageSize);
+			putVarBytes(buffer, StringView(key));
+			return;
+		case SCANREPLY:
+			buffer.push_back((char)success);
+			break;
+		case MERKLE:
+			putVarint64(buffer, firstToken);
+			putVarint64(buffer, lastToken);
+			break;
+		case MERKLEDIFF:
+			break;
+	}
+	putVarBytes(buffer, _value);
+}
+
+/**
+ * FUNCTION NAME: decode
+ *
+ * DESCRIPTION: Decodes the binary encoding of Message::encode in bytes. Allocates nothing:
+ * 				key and value point into bytes.
+ *
+ * RETURNS:
+ * true on SUCCESS
+ * false if bytes were encoded by another version or are cut short
+ */
+bool MessageView::decode(const StringView &bytes) {
+	if ( bytes.size < MESSAGE_HEADER_SIZE || (unsigned char)bytes.data[0] != MESSAGE_VERSION ) {
+		return false;
+	}
+	type = static_cast<MessageType>((unsigned char)bytes.data[1]);
+	replica = static_cast<ReplicaType>((unsigned char)bytes.data[2]);
+	size_t pos = 3;
+	uint32_t word;
+	getUint32(bytes, pos, word);
+	transID = (int)word;
+	memcpy(fromAddr.addr, bytes.data + pos, sizeof(fromAddr.addr));
+	pos += sizeof(fromAddr.addr);
+	ttl = 0;
+	timestamp = 0;
+	firstToken = 0;
+	lastToken = 0;
+	pageSize = 0;
+	success = false;
+	status = REPLY_FAILURE;
+	key = StringView();
+	value = StringView();
+
+	uint32_t number;
+	uint64_t wide;
+	switch(type){
+		case CREATE:
+		case UPDATE:
+		case REPAIR:
+			if ( !getVarint32(bytes, pos, number) ) {
+				return false;
+			}
+			ttl = (int)number;
+			if ( !getVarint32(bytes, pos, number) || !getVarBytes(bytes, pos, key) ) {
+				return false;
+			}
+			timestamp = (int)number;
+			break;
+		case READ:
+		case DELETE:
+			if ( !getVarint32(bytes, pos, number) ) {
+				return false;
+			}
+			timestamp = (int)number;
+			return getVarBytes(bytes, pos, key);
+		case REPLY:
+			if ( pos >= bytes.size ) {
+				return false;
+			}
+			status = static_cast<ReplyStatus>((unsigned char)bytes.data[pos]);
+			success = (status == REPLY_SUCCESS);
+			return true;
+		case READREPLY:
+			if ( pos >= bytes.size ) {
+				return false;
+			}
+			success = bytes.data[pos++] != 0;
+			if ( !getVarint32(bytes, pos, number) ) {
+				return false;
+			}
+			ttl = (int)number;
+			if ( !getVarint32(bytes, pos, number) ) {
+				return false;
+			}
+			timestamp = (int)number;
+			break;
+		case SCAN:
+			if ( !getVarint64(bytes, pos, wide) ) {
+				return false;
+			}
+			firstToken = wide;
+			if ( !getVarint64(bytes, pos, wide) ) {
+				return false;
+			}
+			lastToken = wide;
+			if ( !getVarint32(bytes, pos, number) ) {
+				return false;
+			}
+			pageSize = (int)number;
+			return getVarBytes(bytes, pos, key);
+		case SCANREPLY:
+			if ( pos >= bytes.size ) {
+				return false;
+			}
+			success = bytes.data[pos++] != 0;
+			break;
+		case MERKLE:
+			if ( !getVarint64(bytes, pos, wide) ) {
+				return false;
+			}
+			firstToken = wide;
+			if ( !getVarint64(bytes, pos, wide) ) {
+				return false;
+			}
+			lastToken = wide;
+			break;
+		case MERKLEDIFF:
+			break;
+		default:
+			return false;
+	}
+	return getVarBytes(bytes, pos, value);
+}
@@ -8,8 +8,19 @@
 
 #include "stdincludes.h"
 #include "Member.h"
+#include "StringView.h"
 #include "common.h"
 
+/*
+ * Macros
+ */
+// First byte of an encoded message, changed with the encoding so that other versions are told apart
+#define MESSAGE_VERSION 1
+// Version, type and replica bytes, transID, and the 6 bytes of fromAddr
+#define MESSAGE_HEADER_SIZE 13
+
+class MessageView;
+
 /**
  * CLASS NAME: Message
  *
@@ -19,11 +30,22 @@ class Message{
 public:
 	MessageType type;
 	ReplicaType replica;
+	// Time units a created or updated key lives for, 0 for ever
+	int ttl;
+	// Time the sender wrote the key at, 0 to let the replica stamp it.
+	// For a READ, the time to read the key at, 0 for its newest value.
+	int timestamp;
+	// Token range of a MERKLE, and the token range and most keys per page of a SCAN, whose key is the continuation:
+	// the scan resumes after that key of firstToken, or at firstToken when it is empty
+	size_t firstToken;
+	size_t lastToken;
+	int pageSize;
 	string key;
 	string value;
 	Address fromAddr;
 	int transID;
-	bool success; // success or not 
+	bool success; // success or not, for a SCANREPLY whether the page was cut short
+	ReplyStatus status; // why a reply failed, REPLY_SUCCESS when it did not
 	// delimiter
 	string delimiter;
 	// construct a message from a string
@@ -31,16 +53,50 @@ public:
 	Message(const Message& anotherMessage);
 	// construct a create or update message
 	Message(int _transID, Address _fromAddr, MessageType _type, string _key, string _value);
-	Message(int _transID, Address _fromAddr, MessageType _type, string _key, string _value, ReplicaType _replica);
+	Message(int _transID, Address _fromAddr, MessageType _type, string _key, string _value, ReplicaType _replica, int _ttl = 0, int _timestamp = 0);
 	// construct a read or delete message
 	Message(int _transID, Address _fromAddr, MessageType _type, string _key);
 	// construct reply message
 	Message(int _transID, Address _fromAddr, MessageType _type, bool _success);
+	Message(int _transID, Address _fromAddr, ReplyStatus _status);
 	// construct read reply message
 	Message(int _transID, Address _fromAddr, string _value);
+	// construct a scan message
+	Message(int _transID, Address _fromAddr, size_t _firstToken, size_t _lastToken, int _pageSize, ReplicaType _replica, string _afterKey);
+	// copy a decoded message out of the buffer it views
+	Message(const MessageView &view);
 	Message& operator = (const Message& anotherMessage);
 	// serialize to a string
 	string toString();
+	// binary encoding sent between nodes, into a buffer the caller reuses
+	void encode(string &buffer) const;
+	// the same with the value taken from where it is stored
+	void encode(string &buffer, const StringView &_value) const;
+};
+
+/**
+ * CLASS NAME: MessageView
+ *
+ * DESCRIPTION: A message decoded from the binary encoding of Message::encode without copying:
+ * 				key and value view the encoded bytes, which must outlive the view
+ */
+class MessageView {
+public:
+	MessageType type;
+	ReplicaType replica;
+	int transID;
+	Address fromAddr;
+	int ttl;
+	int timestamp;
+	size_t firstToken;
+	size_t lastToken;
+	int pageSize;
+	bool success;
+	ReplyStatus status;
+	StringView key;
+	StringView value;
+
+	bool decode(const StringView &bytes);
 };
 
 #endif
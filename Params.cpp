@@ -9,7 +9,50 @@
 /**
  * Constructor
  */
-Params::Params(): PORTNUM(8001) {}
+Params::Params(): PORTNUM(8001), STORAGE_ENGINE(MEMORY_ENGINE), DATA_DIR("data"), MEMTABLE_SIZE(4 * 1024 * 1024), BLOOM_FPR(0.01),
+		SSTABLE_COMPRESSION(NO_COMPRESSION), COMPACTION(NO_COMPACTION), COMPACTION_THROUGHPUT(0), TOMBSTONE_GC_GRACE(100),
+		ROW_CACHE_SIZE(1024 * 1024), BLOCK_CACHE_SIZE(8 * 1024 * 1024), MEMORY_CAP(0), MAX_VERSIONS(1),
+		COMMITLOG_SYNC(COMMITLOG_OFF), COMMITLOG_SYNC_PERIOD(10), COMMITLOG_SEGMENT_SIZE(1024 * 1024),
+		SNAPSHOT_PERIOD(0), HINT_WINDOW(0), MAX_HINTS(10000), HINT_REPLAY_RATE(50), REPAIR_PERIOD(0),
+		READ_REPAIR(NO_READ_REPAIR) {}
+
+/**
+ * FUNCTION NAME: unknownSetting
+ *
+ * DESCRIPTION: Reports a value the option does not take and exits
+ */
+static void unknownSetting(const char *option, const char *setting) {
+	printf("Unknown value %s for %s\n", setting, option);
+	exit(1);
+}
+
+/**
+ * FUNCTION NAME: toLong
+ *
+ * DESCRIPTION: Parses the whole setting as an integer, exits if it is not one
+ */
+static long toLong(const char *option, const char *setting) {
+	char *end;
+	long value = strtol(setting, &end, 10);
+	if ( end == setting || *end != '\0' ) {
+		unknownSetting(option, setting);
+	}
+	return value;
+}
+
+/**
+ * FUNCTION NAME: toDouble
+ *
+ * DESCRIPTION: Parses the whole setting as a number, exits if it is not one
+ */
+static double toDouble(const char *option, const char *setting) {
+	char *end;
+	double value = strtod(setting, &end);
+	if ( end == setting || *end != '\0' ) {
+		unknownSetting(option, setting);
+	}
+	return value;
+}
 
 /**
  * FUNCTION NAME: setparams
@@ -19,6 +62,8 @@ Params::Params(): PORTNUM(8001) {}
 void Params::setparams(char *config_file) {
 	//trace.funcEntry("Params::setparams");
 	char CRUD[10];
+	char option[64];
+	char setting[256];
 	FILE *fp = fopen(config_file,"r");
 
 	fscanf(fp,"MAX_NNB: %d", &MAX_NNB);
@@ -39,6 +84,178 @@ void Params::setparams(char *config_file) {
 	else if ( 0 == strcmp(CRUD, "DELETE") ) {
 		this->CRUDTEST = DELETE_TEST;
 	}
+	else if ( 0 == strcmp(CRUD, "TTL") ) {
+		this->CRUDTEST = TTL_TEST;
+	}
+	else if ( 0 == strcmp(CRUD, "READ_AT") ) {
+		this->CRUDTEST = READ_AT_TEST;
+	}
+	else if ( 0 == strcmp(CRUD, "SCAN") ) {
+		this->CRUDTEST = SCAN_TEST;
+	}
+	else if ( 0 == strcmp(CRUD, "FULL") ) {
+		this->CRUDTEST = FULL_TEST;
+	}
+	else if ( 0 == strcmp(CRUD, "RESTART") ) {
+		this->CRUDTEST = RESTART_TEST;
+	}
+	else if ( 0 == strcmp(CRUD, "LOAD") ) {
+		this->CRUDTEST = LOAD_TEST;
+	}
+	else if ( 0 == strcmp(CRUD, "HINT") ) {
+		this->CRUDTEST = HINT_TEST;
+	}
+	else if ( 0 == strcmp(CRUD, "REPAIR") ) {
+		this->CRUDTEST = REPAIR_TEST;
+	}
+	else {
+		unknownSetting("CRUD_TEST", CRUD);
+	}
+
+	// Optional settings, one "NAME: value" per line after CRUD_TEST
+	int parsed;
+	while ( (parsed = fscanf(fp, " %63[^:]: %255s", option, setting)) == 2 ) {
+		if ( 0 == strcmp(option, "STORAGE_ENGINE") ) {
+			if ( 0 == strcmp(setting, "MEMORY") ) {
+				this->STORAGE_ENGINE = MEMORY_ENGINE;
+			}
+			else if ( 0 == strcmp(setting, "LSM") ) {
+				this->STORAGE_ENGINE = LSM_ENGINE;
+			}
+			else {
+				unknownSetting(option, setting);
+			}
+		}
+		else if ( 0 == strcmp(option, "DATA_DIR") ) {
+			this->DATA_DIR = setting;
+		}
+		else if ( 0 == strcmp(option, "MEMTABLE_SIZE") ) {
+			this->MEMTABLE_SIZE = toLong(option, setting);
+		}
+		else if ( 0 == strcmp(option, "BLOOM_FPR") ) {
+			this->BLOOM_FPR = toDouble(option, setting);
+		}
+		else if ( 0 == strcmp(option, "COMPACTION") ) {
+			if ( 0 == strcmp(setting, "NONE") ) {
+				this->COMPACTION = NO_COMPACTION;
+			}
+			else if ( 0 == strcmp(setting, "SIZE_TIERED") ) {
+				this->COMPACTION = SIZE_TIERED_COMPACTION;
+			}
+			else if ( 0 == strcmp(setting, "LEVELED") ) {
+				this->COMPACTION = LEVELED_COMPACTION;
+			}
+			else {
+				unknownSetting(option, setting);
+			}
+		}
+		else if ( 0 == strcmp(option, "SSTABLE_COMPRESSION") ) {
+			if ( 0 == strcmp(setting, "NONE") ) {
+				this->SSTABLE_COMPRESSION = NO_COMPRESSION;
+			}
+			else if ( 0 == strcmp(setting, "LZ") ) {
+				this->SSTABLE_COMPRESSION = LZ_COMPRESSION;
+			}
+			else {
+				unknownSetting(option, setting);
+			}
+		}
+		else if ( 0 == strcmp(option, "COMPACTION_THROUGHPUT") ) {
+			this->COMPACTION_THROUGHPUT = toLong(option, setting);
+		}
+		else if ( 0 == strcmp(option, "TOMBSTONE_GC_GRACE") ) {
+			this->TOMBSTONE_GC_GRACE = (int)toLong(option, setting);
+		}
+		else if ( 0 == strcmp(option, "ROW_CACHE_SIZE") ) {
+			this->ROW_CACHE_SIZE = toLong(option, setting);
+		}
+		else if ( 0 == strcmp(option, "BLOCK_CACHE_SIZE") ) {
+			this->BLOCK_CACHE_SIZE = toLong(option, setting);
+		}
+		else if ( 0 == strcmp(option, "MEMORY_CAP") ) {
+			this->MEMORY_CAP = toLong(option, setting);
+		}
+		else if ( 0 == strcmp(option, "MAX_VERSIONS") ) {
+			this->MAX_VERSIONS = (int)toLong(option, setting);
+		}
+		else if ( 0 == strcmp(option, "COMMITLOG_SYNC") ) {
+			if ( 0 == strcmp(setting, "OFF") ) {
+				this->COMMITLOG_SYNC = COMMITLOG_OFF;
+			}
+			else if ( 0 == strcmp(setting, "PERIODIC") ) {
+				this->COMMITLOG_SYNC = COMMITLOG_PERIODIC;
+			}
+			else if ( 0 == strcmp(setting, "BATCH") ) {
+				this->COMMITLOG_SYNC = COMMITLOG_BATCH;
+			}
+			else if ( 0 == strcmp(setting, "PER_WRITE") ) {
+				this->COMMITLOG_SYNC = COMMITLOG_PER_WRITE;
+			}
+			else {
+				unknownSetting(option, setting);
+			}
+		}
+		else if ( 0 == strcmp(option, "COMMITLOG_SYNC_PERIOD") ) {
+			this->COMMITLOG_SYNC_PERIOD = (int)toLong(option, setting);
+		}
+		else if ( 0 == strcmp(option, "COMMITLOG_SEGMENT_SIZE") ) {
+			this->COMMITLOG_SEGMENT_SIZE = toLong(option, setting);
+		}
+		else if ( 0 == strcmp(option, "SNAPSHOT_PERIOD") ) {
+			this->SNAPSHOT_PERIOD = (int)toLong(option, setting);
+		}
+		else if ( 0 == strcmp(option, "HINT_WINDOW") ) {
+			this->HINT_WINDOW = (int)toLong(option, setting);
+		}
+		else if ( 0 == strcmp(option, "MAX_HINTS") ) {
+			this->MAX_HINTS = toLong(option, setting);
+		}
+		else if ( 0 == strcmp(option, "HINT_REPLAY_RATE") ) {
+			this->HINT_REPLAY_RATE = (int)toLong(option, setting);
+		}
+		else if ( 0 == strcmp(option, "REPAIR_PERIOD") ) {
+			this->REPAIR_PERIOD = (int)toLong(option, setting);
+		}
+		else if ( 0 == strcmp(option, "READ_REPAIR") ) {
+			if ( 0 == strcmp(setting, "NONE") ) {
+				this->READ_REPAIR = NO_READ_REPAIR;
+			}
+			else if ( 0 == strcmp(setting, "BLOCKING") ) {
+				this->READ_REPAIR = BLOCKING_READ_REPAIR;
+			}
+			else if ( 0 == strcmp(setting, "BACKGROUND") ) {
+				this->READ_REPAIR = BACKGROUND_READ_REPAIR;
+			}
+			else {
+				unknownSetting(option, setting);
+			}
+		}
+		else {
+			printf("Unknown option %s in %s\n", option, config_file);
+			exit(1);
+		}
+	}
+	// A line that is not "NAME: value" stops the loop half way
+	if ( parsed == 1 ) {
+		option[strcspn(option, "\r\n")] = '\0';
+		printf("Could not parse %s in %s\n", option, config_file);
+		exit(1);
+	}
+
+	// The LSM engine keeps one version of a key, so it cannot serve older ones
+	if ( STORAGE_ENGINE == LSM_ENGINE && MAX_VERSIONS > 1 ) {
+		printf("MAX_VERSIONS: %d needs STORAGE_ENGINE: MEMORY, the LSM engine keeps one version of a key\n", MAX_VERSIONS);
+		exit(1);
+	}
+
+	// A cap below what the engine holds before its first write would refuse every write: raise it
+	long minMemoryCap = MIN_MEMORY_CAP;
+	if ( STORAGE_ENGINE == LSM_ENGINE ) {
+		minMemoryCap += MEMTABLE_SIZE + ROW_CACHE_SIZE + BLOCK_CACHE_SIZE;
+	}
+	if ( MEMORY_CAP > 0 && MEMORY_CAP < minMemoryCap ) {
+		MEMORY_CAP = minMemoryCap;
+	}
 
 	//printf("Parameters of the test case: %d %d %d %lf\n", MAX_NNB, SINGLE_FAILURE, DROP_MSG, MSG_DROP_PROB);
 
@@ -11,7 +11,21 @@
 #include "Params.h"
 #include "Member.h"
 
-enum testTYPE { CREATE_TEST, READ_TEST, UPDATE_TEST, DELETE_TEST };
+enum testTYPE { CREATE_TEST, READ_TEST, UPDATE_TEST, DELETE_TEST, TTL_TEST, READ_AT_TEST, SCAN_TEST, FULL_TEST, RESTART_TEST, LOAD_TEST, HINT_TEST, REPAIR_TEST };
+
+enum storageEngine { MEMORY_ENGINE, LSM_ENGINE };
+
+enum compactionStrategy { NO_COMPACTION, SIZE_TIERED_COMPACTION, LEVELED_COMPACTION };
+
+enum blockCompression { NO_COMPRESSION, LZ_COMPRESSION };
+
+enum commitLogSync { COMMITLOG_OFF, COMMITLOG_PERIODIC, COMMITLOG_BATCH, COMMITLOG_PER_WRITE };
+
+enum readRepair { NO_READ_REPAIR, BLOCKING_READ_REPAIR, BACKGROUND_READ_REPAIR };
+
+// Smallest MEMORY_CAP of the memory engine, room for the keys of the test cases on a node.
+// The LSM engine also needs its memtable and its caches on top of it.
+#define MIN_MEMORY_CAP (16 * 1024)
 
 /**
  * CLASS NAME: Params
@@ -32,6 +46,27 @@ public:
 	int allNodesJoined;
 	short PORTNUM;
 	int CRUDTEST;
+	int STORAGE_ENGINE;			// MEMORY or LSM
+	string DATA_DIR;			// directory holding one sub directory of files per node
+	long MEMTABLE_SIZE;			// bytes the LSM memtable holds before it is flushed to an SSTable
+	double BLOOM_FPR;			// false positive rate of the Bloom filter of an SSTable
+	int SSTABLE_COMPRESSION;	// NONE or LZ, codec of the SSTable data blocks
+	int COMPACTION;				// NONE, SIZE_TIERED or LEVELED
+	long COMPACTION_THROUGHPUT;	// bytes per second compaction may write, 0 for no limit
+	int TOMBSTONE_GC_GRACE;		// time units a tombstone is kept before it may be dropped
+	long ROW_CACHE_SIZE;		// bytes of the LSM row cache of decoded entries, 0 for none
+	long BLOCK_CACHE_SIZE;		// bytes of the LSM cache of SSTable blocks, 0 for none
+	long MEMORY_CAP;			// bytes of memory the storage engine of a node may hold, 0 for no limit
+	int MAX_VERSIONS;			// versions of a key the memory engine keeps for reads at a past time
+	int COMMITLOG_SYNC;			// OFF, PERIODIC, BATCH or PER_WRITE
+	int COMMITLOG_SYNC_PERIOD;	// time units between two syncs of a PERIODIC commit log
+	long COMMITLOG_SEGMENT_SIZE;	// bytes of a commit log segment
+	int SNAPSHOT_PERIOD;		// time units between two snapshots of the memory engine, 0 for none
+	int HINT_WINDOW;			// time units a coordinator keeps the writes of a failed replica, 0 for no hinted handoff
+	long MAX_HINTS;				// hints a coordinator keeps per failed replica
+	int HINT_REPLAY_RATE;		// hints sent per time unit to a replica that came back
+	int REPAIR_PERIOD;			// time units between two Merkle tree exchanges of a node with its replicas, 0 for none
+	int READ_REPAIR;			// NONE, BLOCKING or BACKGROUND, how a coordinator fixes the stale replicas a read finds
 	Params();
 	void setparams(char *);
 	int getcurrtime();
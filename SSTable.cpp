@@ -0,0 +1,675 @@
+/**********************************
+ * FILE NAME: SSTable.cpp
+ *
+ * DESCRIPTION: Definition of the SSTable and SSTableWriter classes
+ **********************************/
+
+#include "SSTable.h"
+#include "Coding.h"
+#include <atomic>
+#include <sys/mman.h>
+
+/**
+ * Constructor
+ */
+SSTable::SSTable(const string &path, uint64_t sequence, int level): path(path), fd(-1), id(newId()), sequence(sequence),
+		level(level), fileSize(0) {}
+
+/**
+ * Destructor
+ */
+SSTable::~SSTable() {
+	if ( fd >= 0 ) {
+		close(fd);
+	}
+}
+
+/**
+ * FUNCTION NAME: newId
+ *
+ * DESCRIPTION: Returns an id no other table of the process has had, even once deleted
+ */
+uint64_t SSTable::newId() {
+	static std::atomic<uint64_t> nextId(1);
+	return nextId++;
+}
+
+/**
+ * FUNCTION NAME: write
+ *
+ * DESCRIPTION: Writes the sorted records to a new SSTable file at path
+ *
+ * RETURNS:
+ * true on SUCCESS
+ * false on FAILURE
+ */
+bool SSTable::write(const string &path, const map<string, Entry> &records, double falsePositiveRate, int codec) {
+	SSTableWriter writer(path, falsePositiveRate, codec);
+	for ( map<string, Entry>::const_iterator it = records.begin(); it != records.end(); ++it ) {
+		writer.add(it->first, it->second);
+	}
+	return writer.finish();
+}
+
+/**
+ * FUNCTION NAME: open
+ *
+ * DESCRIPTION: Opens an SSTable file and loads its Bloom filter and block index
+ *
+ * RETURNS:
+ * the table on SUCCESS
+ * NULL on FAILURE
+ */
+SSTable * SSTable::open(const string &path, uint64_t sequence, int level) {
+	SSTable *table = new SSTable(path, sequence, level);
+	table->fd = ::open(path.c_str(), O_RDONLY);
+	if ( table->fd < 0 || !table->loadIndex() || !table->mapFile() ) {
+		delete table;
+		return NULL;
+	}
+	return table;
+}
+
+/**
+ * FUNCTION NAME: loadIndex
+ *
+ * DESCRIPTION: Reads the footer, the Bloom filter and the block index of the file
+ */
+bool SSTable::loadIndex() {
+	const size_t footerSize = 2 * sizeof(uint64_t) + 2 * sizeof(uint32_t);
+	off_t end = lseek(fd, 0, SEEK_END);
+	if ( end < (off_t)footerSize ) {
+		return false;
+	}
+	fileSize = (uint64_t)end;
+
+	string footer(footerSize, '\0');
+	if ( pread(fd, &footer[0], footerSize, end - footerSize) != (ssize_t)footerSize ) {
+		return false;
+	}
+	size_t pos = 0;
+	uint64_t filterOffset;
+	uint64_t indexOffset;
+	uint32_t blockCount;
+	uint32_t magic;
+	getUint64(footer, pos, filterOffset);
+	getUint64(footer, pos, indexOffset);
+	getUint32(footer, pos, blockCount);
+	getUint32(footer, pos, magic);
+	if ( magic != SSTABLE_MAGIC || filterOffset > indexOffset || indexOffset > (uint64_t)end - footerSize ) {
+		return false;
+	}
+
+	size_t filterSize = (size_t)(indexOffset - filterOffset);
+	string filterBlock(filterSize, '\0');
+	if ( filterSize > 0 && pread(fd, &filterBlock[0], filterSize, filterOffset) != (ssize_t)filterSize ) {
+		return false;
+	}
+	if ( !filter.decode(filterBlock) ) {
+		return false;
+	}
+
+	size_t indexSize = (size_t)(end - footerSize - indexOffset);
+	string indexBlock(indexSize, '\0');
+	if ( indexSize > 0 && pread(fd, &indexBlock[0], indexSize, indexOffset) != (ssize_t)indexSize ) {
+		return false;
+	}
+	pos = 0;
+	if ( !getBytes(indexBlock, pos, lastKey) ) {
+		return false;
+	}
+	if ( blockCount == 0 ) {
+		return true;
+	}
+	BlockReader reader(StringView(indexBlock.data() + pos, indexBlock.size() - pos));
+	for ( uint32_t i = 0; i < blockCount; i++ ) {
+		BlockHandle handle;
+		size_t at = 0;
+		uint64_t size;
+		if ( !reader.next() || !getVarint64(reader.payload(), at, handle.offset) || !getVarint64(reader.payload(), at, size) ) {
+			return false;
+		}
+		handle.firstKey = reader.key();
+		handle.size = (uint32_t)size;
+		index.push_back(handle);
+	}
+	return true;
+}
+
+/**
+ * FUNCTION NAME: mapFile
+ *
+ * DESCRIPTION: Maps the whole file read only
+ */
+bool SSTable::mapFile() {
+	void *address = mmap(NULL, (size_t)fileSize, PROT_READ, MAP_SHARED, fd, 0);
+	if ( address == MAP_FAILED ) {
+		return false;
+	}
+	size_t size = (size_t)fileSize;
+	mapping = std::shared_ptr<const char>(static_cast<const char *>(address), [size](const char *data) {
+		munmap(const_cast<char *>(data), size);
+	});
+	return true;
+}
+
+/**
+ * FUNCTION NAME: readBlock
+ *
+ * DESCRIPTION: Reads one data block and uncompresses it if it was stored compressed
+ */
+bool SSTable::readBlock(const BlockHandle &handle, string &block) {
+	string stored(handle.size, '\0');
+	if ( handle.size > 0 && pread(fd, &stored[0], handle.size, handle.offset) != (ssize_t)handle.size ) {
+		return false;
+	}
+	StringView contents;
+	if ( !decodeBlock(StringView(stored), block, contents) ) {
+		return false;
+	}
+	if ( contents.data == stored.data() ) {
+		// Stored raw: drop the codec byte and keep the bytes read
+		stored.resize(contents.size);
+		block.swap(stored);
+	}
+	return true;
+}
+
+/**
+ * FUNCTION NAME: encodeEntry
+ *
+ * DESCRIPTION: Sets payload to the payload of the record of entry in a data block
+ */
+void SSTable::encodeEntry(string &payload, const Entry &entry) {
+	payload.clear();
+	putVarint32(payload, (uint32_t)entry.timestamp);
+	putVarint32(payload, (uint32_t)entry.expiry);
+	payload.push_back((char)entry.replica);
+	payload.push_back((char)entry.flags);
+	payload.append(entry.value);
+}
+
+/**
+ * FUNCTION NAME: decodeEntry
+ *
+ * DESCRIPTION: Decodes the payload of a record
+ *
+ * RETURNS:
+ * true on SUCCESS
+ * false on a corrupt payload
+ */
+bool SSTable::decodeEntry(const StringView &payload, Entry &entry) {
+	EntryView view;
+	if ( !decodeEntry(payload, view) ) {
+		return false;
+	}
+	entry.value.assign(view.value.data, view.value.size);
+	entry.timestamp = view.timestamp;
+	entry.expiry = view.expiry;
+	entry.replica = view.replica;
+	entry.flags = view.flags;
+	return true;
+}
+
+/**
+ * FUNCTION NAME: decodeEntry
+ *
+ * DESCRIPTION: Decodes the payload of a record in place: entry.value views the bytes of payload
+ *
+ * RETURNS:
+ * true on SUCCESS
+ * false on a corrupt payload
+ */
+bool SSTable::decodeEntry(const StringView &payload, EntryView &entry) {
+	size_t pos = 0;
+	uint32_t timestamp;
+	uint32_t expiry;
+	if ( !getVarint32(payload, pos, timestamp) || !getVarint32(payload, pos, expiry) || pos + 2 > payload.size ) {
+		return false;
+	}
+	entry.timestamp = (int)timestamp;
+	entry.expiry = (int)expiry;
+	entry.replica = static_cast<ReplicaType>((unsigned char)payload.data[pos++]);
+	entry.flags = (unsigned char)payload.data[pos++];
+	entry.value = StringView(payload.data + pos, payload.size - pos);
+	return true;
+}
+
+/**
+ * FUNCTION NAME: mayContain
+ *
+ * DESCRIPTION: Checks the key range and the Bloom filter of the table, without any I/O
+ *
+ * RETURNS:
+ * false if the table certainly has no record for key
+ * true otherwise
+ */
+bool SSTable::mayContain(const string &key) {
+	return !index.empty() && key >= index[0].firstKey && key <= lastKey && filter.mayContain(key);
+}
+
+/**
+ * FUNCTION NAME: findBlock
+ *
+ * DESCRIPTION: Returns the only data block that can hold key, -1 if there is none
+ */
+int SSTable::findBlock(const string &key) {
+	if ( !mayContain(key) ) {
+		return -1;
+	}
+	// Last block whose first key is <= key
+	int low = 0;
+	int high = (int)index.size() - 1;
+	int found = -1;
+	while ( low <= high ) {
+		int middle = low + (high - low) / 2;
+		if ( index[middle].firstKey <= key ) {
+			found = middle;
+			low = middle + 1;
+		}
+		else {
+			high = middle - 1;
+		}
+	}
+	return found;
+}
+
+/**
+ * FUNCTION NAME: get
+ *
+ * DESCRIPTION: Looks up key in the only block that can hold it, taking the block from cache when
+ * 				it is there and adding it otherwise
+ *
+ * RETURNS:
+ * true if the table has a record for key, tombstones included
+ * false otherwise
+ */
+bool SSTable::get(const string &key, Entry &entry, BlockCache *cache) {
+	int found = findBlock(key);
+	if ( found < 0 ) {
+		return false;
+	}
+
+	const string *block = NULL;
+	string cacheKey;
+	if ( cache != NULL ) {
+		putUint64(cacheKey, id);
+		putUint64(cacheKey, index[found].offset);
+		block = cache->find(cacheKey);
+	}
+	string loaded;
+	if ( block == NULL ) {
+		if ( !readBlock(index[found], loaded) ) {
+			return false;
+		}
+		if ( cache != NULL ) {
+			cache->insert(cacheKey, loaded, cacheKey.size() + loaded.size());
+		}
+		block = &loaded;
+	}
+	BlockReader reader((StringView(*block)));
+	reader.seek(StringView(key));
+	while ( reader.next() ) {
+		int cmp = reader.key().compare(key);
+		if ( cmp == 0 ) {
+			return decodeEntry(reader.payload(), entry);
+		}
+		if ( cmp > 0 ) {
+			break;
+		}
+	}
+	return false;
+}
+
+/**
+ * FUNCTION NAME: view
+ *
+ * DESCRIPTION: Looks up key in the mapped block that can hold it, without copying anything:
+ * 				the value of entry views the mapping, which entry pins
+ *
+ * RETURNS:
+ * true if the table has a record for key, tombstones included
+ * false otherwise
+ */
+bool SSTable::view(const string &key, EntryView &entry) {
+	int found = findBlock(key);
+	if ( found < 0 || index[found].offset + index[found].size > fileSize ) {
+		return false;
+	}
+	StringView stored(mapping.get() + index[found].offset, index[found].size);
+	std::shared_ptr<const void> pin = mapping;
+	StringView block;
+	if ( stored.size > 0 && stored.data[stored.size - 1] == BLOCK_RAW ) {
+		block = StringView(stored.data, stored.size - 1);
+	}
+	else {
+		std::shared_ptr<string> uncompressed = std::make_shared<string>();
+		if ( !decodeBlock(stored, *uncompressed, block) ) {
+			return false;
+		}
+		pin = uncompressed;
+	}
+	BlockReader reader(block);
+	reader.seek(StringView(key));
+	while ( reader.next() ) {
+		int cmp = reader.key().compare(key);
+		if ( cmp == 0 ) {
+			if ( !decodeEntry(reader.payload(), entry) ) {
+				return false;
+			}
+			entry.pin = pin;
+			return true;
+		}
+		if ( cmp > 0 ) {
+			break;
+		}
+	}
+	return false;
+}
+
+/**
+ * FUNCTION NAME: scan
+ *
+ * DESCRIPTION: Appends every record of the table, in key order
+ *
+ * RETURNS:
+ * true on SUCCESS
+ * false if a block could not be read
+ */
+bool SSTable::scan(vector<pair<string, Entry> > &records) {
+	string block;
+	for ( unsigned int i = 0; i < index.size(); i++ ) {
+		if ( !readBlock(index[i], block) ) {
+			return false;
+		}
+		BlockReader reader((StringView(block)));
+		Entry entry;
+		while ( reader.next() ) {
+			if ( !decodeEntry(reader.payload(), entry) ) {
+				return false;
+			}
+			records.push_back(make_pair(reader.key(), entry));
+		}
+		if ( reader.failed() ) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * FUNCTION NAME: getFirstKey
+ *
+ * DESCRIPTION: Returns the smallest key of the table
+ */
+const string & SSTable::getFirstKey() {
+	static const string none;
+	return index.empty() ? none : index[0].firstKey;
+}
+
+/**
+ * FUNCTION NAME: getLastKey
+ *
+ * DESCRIPTION: Returns the biggest key of the table
+ */
+const string & SSTable::getLastKey() {
+	return lastKey;
+}
+
+/**
+ * FUNCTION NAME: overlaps
+ *
+ * DESCRIPTION: Returns true if the key range of the table meets [first, last]
+ */
+bool SSTable::overlaps(const string &first, const string &last) {
+	return !index.empty() && index[0].firstKey <= last && first <= lastKey;
+}
+
+/**
+ * FUNCTION NAME: getSequence
+ *
+ * DESCRIPTION: Returns the sequence number of the table
+ */
+uint64_t SSTable::getSequence() {
+	return sequence;
+}
+
+/**
+ * FUNCTION NAME: getLevel
+ *
+ * DESCRIPTION: Returns the level of the table, 0 for the tables flushed from the memtable
+ */
+int SSTable::getLevel() {
+	return level;
+}
+
+/**
+ * FUNCTION NAME: getFileSize
+ *
+ * DESCRIPTION: Returns the size of the file in bytes
+ */
+uint64_t SSTable::getFileSize() {
+	return fileSize;
+}
+
+/**
+ * FUNCTION NAME: getPath
+ *
+ * DESCRIPTION: Returns the path of the file
+ */
+const string & SSTable::getPath() {
+	return path;
+}
+
+/**
+ * FUNCTION NAME: remove
+ *
+ * DESCRIPTION: Deletes the file. The table stays readable until it is destroyed.
+ */
+void SSTable::remove() {
+	unlink(path.c_str());
+}
+
+/**
+ * Constructor of the scanner, positioned on the first record of the table
+ */
+SSTable::Scanner::Scanner(SSTable *table): table(table), block(0), reader(StringView()), isValid(true), hasFailed(false) {
+	if ( table->index.empty() ) {
+		isValid = false;
+		return;
+	}
+	if ( !table->readBlock(table->index[0], data) ) {
+		isValid = false;
+		hasFailed = true;
+		return;
+	}
+	reader = BlockReader(StringView(data));
+	next();
+}
+
+bool SSTable::Scanner::valid() const {
+	return isValid;
+}
+
+bool SSTable::Scanner::failed() const {
+	return hasFailed;
+}
+
+/**
+ * FUNCTION NAME: next
+ *
+ * DESCRIPTION: Moves to the next record, reading the next block once this one is done
+ */
+void SSTable::Scanner::next() {
+	while ( isValid && !reader.next() ) {
+		block++;
+		if ( reader.failed() ) {
+			isValid = false;
+			hasFailed = true;
+		}
+		else if ( block >= table->index.size() ) {
+			isValid = false;
+		}
+		else if ( !table->readBlock(table->index[block], data) ) {
+			isValid = false;
+			hasFailed = true;
+		}
+		else {
+			reader = BlockReader(StringView(data));
+		}
+	}
+	if ( isValid ) {
+		currentKey = reader.key();
+		if ( !SSTable::decodeEntry(reader.payload(), currentEntry) ) {
+			isValid = false;
+			hasFailed = true;
+		}
+	}
+}
+
+const string & SSTable::Scanner::key() const {
+	return currentKey;
+}
+
+const Entry & SSTable::Scanner::entry() const {
+	return currentEntry;
+}
+
+/**
+ * Constructor
+ */
+SSTableWriter::SSTableWriter(const string &path, double falsePositiveRate, int codec): path(path), temporary(path + ".tmp"),
+		falsePositiveRate(falsePositiveRate), codec(codec), offset(0), blockCount(0), ok(true), done(false) {
+	fp = fopen(temporary.c_str(), "wb");
+	ok = fp != NULL;
+}
+
+/**
+ * Destructor
+ */
+SSTableWriter::~SSTableWriter() {
+	abandon();
+}
+
+/**
+ * FUNCTION NAME: add
+ *
+ * DESCRIPTION: Appends a record. Keys must come in increasing order.
+ */
+void SSTableWriter::add(const string &key, const Entry &entry) {
+	if ( block.empty() ) {
+		blockFirstKey = key;
+	}
+	hashes.push_back(BloomFilter::hashOf(key));
+	SSTable::encodeEntry(payload, entry);
+	block.add(key, payload);
+	lastKey = key;
+	if ( block.sizeEstimate() >= SSTABLE_BLOCK_SIZE ) {
+		finishBlock();
+	}
+}
+
+/**
+ * FUNCTION NAME: finishBlock
+ *
+ * DESCRIPTION: Writes the current data block with the codec of the writer and adds it to the block index
+ */
+void SSTableWriter::finishBlock() {
+	if ( block.empty() ) {
+		return;
+	}
+	stored.clear();
+	encodeBlock(block.finish(), codec, stored);
+	ok = ok && fwrite(stored.data(), 1, stored.size(), fp) == stored.size();
+	payload.clear();
+	putVarint64(payload, offset);
+	putVarint64(payload, stored.size());
+	indexBlock.add(blockFirstKey, payload);
+	offset += stored.size();
+	blockCount++;
+	block.reset();
+}
+
+/**
+ * FUNCTION NAME: count
+ *
+ * DESCRIPTION: Returns the number of records added
+ */
+unsigned long SSTableWriter::count() {
+	return hashes.size();
+}
+
+/**
+ * FUNCTION NAME: bytesWritten
+ *
+ * DESCRIPTION: Returns the number of data bytes added
+ */
+uint64_t SSTableWriter::bytesWritten() {
+	return offset + (block.empty() ? 0 : block.sizeEstimate());
+}
+
+/**
+ * FUNCTION NAME: finish
+ *
+ * DESCRIPTION: Writes the filter, the index and the footer, syncs the file and renames it to path
+ *
+ * RETURNS:
+ * true on SUCCESS
+ * false on FAILURE, in which case nothing is left at path
+ */
+bool SSTableWriter::finish() {
+	if ( done ) {
+		return false;
+	}
+	finishBlock();
+	BloomFilter filter;
+	filter.build(hashes.size(), falsePositiveRate);
+	for ( unsigned int i = 0; i < hashes.size(); i++ ) {
+		filter.addHash(hashes[i]);
+	}
+	string filterBlock;
+	filter.encode(filterBlock);
+	string indexRegion;
+	putBytes(indexRegion, lastKey);
+	if ( blockCount > 0 ) {
+		indexRegion.append(indexBlock.finish());
+	}
+	string footer;
+	putUint64(footer, offset);
+	putUint64(footer, offset + filterBlock.size());
+	putUint32(footer, blockCount);
+	putUint32(footer, SSTABLE_MAGIC);
+	ok = ok && fwrite(filterBlock.data(), 1, filterBlock.size(), fp) == filterBlock.size();
+	ok = ok && fwrite(indexRegion.data(), 1, indexRegion.size(), fp) == indexRegion.size();
+	ok = ok && fwrite(footer.data(), 1, footer.size(), fp) == footer.size();
+	ok = ok && fflush(fp) == 0 && fsync(fileno(fp)) == 0;
+	if ( !ok ) {
+		abandon();
+		return false;
+	}
+	fclose(fp);
+	fp = NULL;
+	done = true;
+	if ( rename(temporary.c_str(), path.c_str()) != 0 ) {
+		unlink(temporary.c_str());
+		return false;
+	}
+	return true;
+}
+
+/**
+ * FUNCTION NAME: abandon
+ *
+ * DESCRIPTION: Drops the table being written
+ */
+void SSTableWriter::abandon() {
+	if ( done ) {
+		return;
+	}
+	if ( fp != NULL ) {
+		fclose(fp);
+		fp = NULL;
+	}
+	unlink(temporary.c_str());
+	done = true;
+}
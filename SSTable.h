@@ -0,0 +1,188 @@
+/**********************************
+ * FILE NAME: SSTable.h
+ *
+ * DESCRIPTION: Header file of the SSTable class
+ **********************************/
+
+#ifndef SSTABLE_H_
+#define SSTABLE_H_
+
+/**
+ * Header files
+ */
+#include "stdincludes.h"
+#include <stdint.h>
+#include "Entry.h"
+#include "BloomFilter.h"
+#include "Cache.h"
+#include "StringView.h"
+#include "Block.h"
+#include <memory>
+
+/*
+ * Macros
+ */
+// A data block is closed once it holds at least this many bytes, before compression
+#define SSTABLE_BLOCK_SIZE 4096
+// Last 4 bytes of every SSTable file
+#define SSTABLE_MAGIC 0x4b565357
+// False positive rate of the Bloom filter of a table, unless told otherwise
+#define SSTABLE_BLOOM_FPR 0.01
+
+/**
+ * STRUCT NAME: BlockHandle
+ *
+ * DESCRIPTION: Entry of the block index: the first key of a data block and where the block is
+ */
+typedef struct BlockHandle {
+	string firstKey;
+	uint64_t offset;
+	uint32_t size;
+}BlockHandle;
+
+/**
+ * CLASS NAME: SSTable
+ *
+ * DESCRIPTION: Immutable sorted file of (key, entry) records.
+ * 				File layout:
+ * 				1) Data blocks of records sorted by key, each built by a BlockBuilder,
+ * 				   so keys are prefix compressed, then stored by encodeBlock, raw or
+ * 				   compressed with the codec of the writer (see Block.h). The payload
+ * 				   of a record is: timestamp and expiry as varints, replica, flags, value
+ * 				2) The Bloom filter of the keys (see BloomFilter.h)
+ * 				3) The last key of the table, then the block index: a block of the
+ * 				   first key of every data block with its offset and size as varints
+ * 				4) Footer: filter offset, index offset, block count, SSTABLE_MAGIC
+ * 				The filter and the index are loaded when the table is opened, so a
+ * 				point read of a key the table does not hold is answered from memory
+ * 				most of the time, and any other costs one binary search in memory
+ * 				and one block read, or none when the block is in the BlockCache
+ * 				given to get(), which holds blocks uncompressed. Within a block a
+ * 				lookup binary searches the restart points, then decodes at most
+ * 				BLOCK_RESTART_INTERVAL records.
+ * 				The file is also mapped read only: view() decodes the record of a
+ * 				key in place and hands out its value as a view into the mapping,
+ * 				pinned by the view, so it stays valid after the table is deleted.
+ * 				A compressed block is uncompressed into a buffer the view pins instead.
+ * 				Reads only use pread and the read only mapping, so a table can be
+ * 				read from several threads.
+ */
+class SSTable {
+public:
+	/**
+	 * CLASS NAME: Scanner
+	 *
+	 * DESCRIPTION: Reads the records of a table in key order, one block at a time
+	 */
+	class Scanner {
+	public:
+		Scanner(SSTable *table);
+		bool valid() const;
+		bool failed() const;
+		void next();
+		const string & key() const;
+		const Entry & entry() const;
+	private:
+		SSTable *table;
+		unsigned int block;
+		string data;
+		BlockReader reader;
+		string currentKey;
+		Entry currentEntry;
+		bool isValid;
+		// A block could not be read: the scan stopped before the end of the table
+		bool hasFailed;
+	};
+
+private:
+	string path;
+	int fd;
+	// Unique in the process, names the blocks of the table in a BlockCache
+	uint64_t id;
+	// Order of the table among the tables of its level, newer tables have bigger ones
+	uint64_t sequence;
+	int level;
+	vector<BlockHandle> index;
+	string lastKey;
+	BloomFilter filter;
+	uint64_t fileSize;
+	// The whole file, unmapped once the table and every view into it are gone
+	std::shared_ptr<const char> mapping;
+
+	SSTable(const string &path, uint64_t sequence, int level);
+	bool loadIndex();
+	bool mapFile();
+	bool readBlock(const BlockHandle &handle, string &block);
+	int findBlock(const string &key);
+	static uint64_t newId();
+
+	SSTable(const SSTable &anotherTable);
+	SSTable& operator =(const SSTable &anotherTable);
+
+public:
+	static bool write(const string &path, const map<string, Entry> &records, double falsePositiveRate = SSTABLE_BLOOM_FPR, int codec = BLOCK_RAW);
+	static SSTable * open(const string &path, uint64_t sequence, int level = 0);
+	static void encodeEntry(string &payload, const Entry &entry);
+	static bool decodeEntry(const StringView &payload, Entry &entry);
+	static bool decodeEntry(const StringView &payload, EntryView &entry);
+	bool mayContain(const string &key);
+	bool get(const string &key, Entry &entry, BlockCache *cache = NULL);
+	bool view(const string &key, EntryView &entry);
+	bool scan(vector<pair<string, Entry> > &records);
+	const string & getFirstKey();
+	const string & getLastKey();
+	bool overlaps(const string &first, const string &last);
+	uint64_t getSequence();
+	int getLevel();
+	uint64_t getFileSize();
+	const string & getPath();
+	void remove();
+	virtual ~SSTable();
+};
+
+/**
+ * CLASS NAME: SSTableWriter
+ *
+ * DESCRIPTION: Writes an SSTable from records added in key order, without holding them
+ * 				in memory. The file is written under a temporary name and renamed by
+ * 				finish() once it is complete and synced, so a crash never leaves a
+ * 				partial table. The Bloom filter is sized on the number of records
+ * 				actually written.
+ */
+class SSTableWriter {
+private:
+	string path;
+	string temporary;
+	FILE *fp;
+	double falsePositiveRate;
+	// BLOCK_RAW or BLOCK_LZ
+	int codec;
+	vector<uint64_t> hashes;
+	BlockBuilder block;
+	string blockFirstKey;
+	BlockBuilder indexBlock;
+	// Reused for the payload of every record and for every stored block
+	string payload;
+	string stored;
+	string lastKey;
+	uint64_t offset;
+	uint32_t blockCount;
+	bool ok;
+	bool done;
+
+	void finishBlock();
+
+	SSTableWriter(const SSTableWriter &anotherWriter);
+	SSTableWriter& operator =(const SSTableWriter &anotherWriter);
+
+public:
+	SSTableWriter(const string &path, double falsePositiveRate = SSTABLE_BLOOM_FPR, int codec = BLOCK_RAW);
+	void add(const string &key, const Entry &entry);
+	unsigned long count();
+	uint64_t bytesWritten();
+	bool finish();
+	void abandon();
+	virtual ~SSTableWriter();
+};
+
+#endif /* SSTABLE_H_ */
@@ -0,0 +1,129 @@
+/**********************************
+ * FILE NAME: SeqLock.h
+ *
+ * DESCRIPTION: Writer lock with a sequence counter for lock free readers
+ **********************************/
+
+#ifndef SEQLOCK_H_
+#define SEQLOCK_H_
+
+/**
+ * Header files
+ */
+#include "stdincludes.h"
+#include <atomic>
+#include <mutex>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/**
+ * CLASS NAME: SeqLock
+ *
+ * DESCRIPTION: Writers serialize on a mutex and make the sequence odd while they
+ * 				modify the protected data. A reader takes a snapshot with readBegin(),
+ * 				reads without locking and keeps what it read only if readRetry()
+ * 				says no writer ran in between. Whatever the reader dereferences
+ * 				must stay allocated until it is done (see EpochGuard).
+ * 				A writer calls publish() once readers may see its changes; the rest
+ * 				of its work, which readers do not depend on, then keeps only the mutex.
+ */
+class SeqLock {
+private:
+	std::mutex writers;
+	std::atomic<unsigned int> sequence;
+
+	SeqLock(const SeqLock &anotherLock);
+	SeqLock& operator =(const SeqLock &anotherLock);
+
+public:
+	SeqLock(): sequence(0) {}
+
+	void writeLock() {
+		writers.lock();
+		sequence.store(sequence.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+	}
+
+	void publish() {
+		unsigned int current = sequence.load(std::memory_order_relaxed);
+		if ( current & 1 ) {
+			sequence.store(current + 1, std::memory_order_release);
+		}
+	}
+
+	void writeUnlock() {
+		publish();
+		writers.unlock();
+	}
+
+	// Serializes with the writers only, readers are not made to retry
+	void lockWriters() {
+		writers.lock();
+	}
+
+	void unlockWriters() {
+		writers.unlock();
+	}
+
+	unsigned int readBegin() const {
+		unsigned int start;
+		while ( (start = sequence.load(std::memory_order_acquire)) & 1 ) {
+			// A writer is active
+#if defined(__SSE2__)
+			_mm_pause();
+#endif
+		}
+		return start;
+	}
+
+	bool readRetry(unsigned int start) const {
+		std::atomic_thread_fence(std::memory_order_acquire);
+		return sequence.load(std::memory_order_relaxed) != start;
+	}
+};
+
+/**
+ * CLASS NAME: WriteGuard
+ *
+ * DESCRIPTION: Holds the writer side of a SeqLock for as long as the guard lives
+ */
+class WriteGuard {
+public:
+	explicit WriteGuard(SeqLock &lock): lock(lock) {
+		lock.writeLock();
+	}
+	~WriteGuard() {
+		lock.writeUnlock();
+	}
+	// Lets readers in again, the writer lock is kept until the guard goes
+	void publish() {
+		lock.publish();
+	}
+private:
+	SeqLock &lock;
+	WriteGuard(const WriteGuard &anotherGuard);
+	WriteGuard& operator =(const WriteGuard &anotherGuard);
+};
+
+/**
+ * CLASS NAME: WritersGuard
+ *
+ * DESCRIPTION: Holds off the writers of a SeqLock for as long as the guard lives,
+ * 				without making readers wait
+ */
+class WritersGuard {
+public:
+	explicit WritersGuard(SeqLock &lock): lock(lock) {
+		lock.lockWriters();
+	}
+	~WritersGuard() {
+		lock.unlockWriters();
+	}
+private:
+	SeqLock &lock;
+	WritersGuard(const WritersGuard &anotherGuard);
+	WritersGuard& operator =(const WritersGuard &anotherGuard);
+};
+
+#endif /* SEQLOCK_H_ */
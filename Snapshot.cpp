@@ -0,0 +1,250 @@
+/**********************************
+ * FILE NAME: Snapshot.cpp
+ *
+ * DESCRIPTION: Definition of the Snapshot class
+ **********************************/
+
+#include "Snapshot.h"
+#include "Coding.h"
+#include "StringView.h"
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+/**
+ * Constructor
+ */
+Snapshot::Snapshot(const string &directory): directory(directory), writer(0), pendingMark(0) {}
+
+/**
+ * Destructor
+ */
+Snapshot::~Snapshot() {
+	// Let a running child finish, so that the next start finds a complete snapshot
+	if ( writer != 0 ) {
+		int status;
+		waitpid(writer, &status, 0);
+	}
+}
+
+/**
+ * FUNCTION NAME: path
+ *
+ * DESCRIPTION: Returns the path of the snapshot file
+ */
+string Snapshot::path() {
+	return directory + "/" + SNAPSHOT_FILE;
+}
+
+/**
+ * FUNCTION NAME: addChecksum
+ *
+ * DESCRIPTION: Folds the next SNAPSHOT_WRITE_BUFFER bytes of the file, or its last bytes, into sum
+ */
+void Snapshot::addChecksum(uint64_t &sum, const char *data, size_t size) {
+	sum = (sum ^ hashBytes(data, size)) * 0x9e3779b97f4a7c15ULL;
+}
+
+/**
+ * FUNCTION NAME: load
+ *
+ * DESCRIPTION: Maps the snapshot file and hands every entry it holds to apply as a CREATE,
+ * 				followed by a DELETE for a tombstone. Sets mark to the first commit log
+ * 				segment to replay, 0 if there is no snapshot.
+ *
+ * RETURNS:
+ * true if there is no snapshot or it was loaded
+ * false if it could not be read or is corrupt
+ */
+bool Snapshot::load(CommitLog::ReplayFunction apply, void *owner, uint64_t &mark) {
+	mark = 0;
+	int fd = ::open(path().c_str(), O_RDONLY);
+	if ( fd < 0 ) {
+		return errno == ENOENT;
+	}
+	struct stat info;
+	if ( fstat(fd, &info) != 0 || info.st_size < (off_t)sizeof(uint64_t) ) {
+		close(fd);
+		return false;
+	}
+	size_t size = (size_t)info.st_size;
+	void *mapping = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if ( mapping == MAP_FAILED ) {
+		return false;
+	}
+	madvise(mapping, size, MADV_SEQUENTIAL);
+
+	StringView body(static_cast<const char *>(mapping), size - sizeof(uint64_t));
+	uint64_t expected;
+	memcpy(&expected, body.data + body.size, sizeof(expected));
+	uint64_t sum = 0;
+	for ( size_t done = 0; done < body.size; done += SNAPSHOT_WRITE_BUFFER ) {
+		addChecksum(sum, body.data + done, min((size_t)SNAPSHOT_WRITE_BUFFER, body.size - done));
+	}
+
+	size_t pos = 0;
+	uint32_t magic;
+	uint64_t snapshotMark, count;
+	bool ok = sum == expected && getUint32(body, pos, magic) && magic == SNAPSHOT_MAGIC &&
+			getUint64(body, pos, snapshotMark) && getUint64(body, pos, count);
+	for ( uint64_t i = 0; ok && i < count; i++ ) {
+		StringView key, value;
+		uint32_t timestamp, expiry;
+		ok = getBytes(body, pos, key) && getBytes(body, pos, value) && getUint32(body, pos, timestamp) &&
+				getUint32(body, pos, expiry) && pos + 2 <= body.size;
+		if ( !ok ) {
+			break;
+		}
+		Entry entry(value.toString(), (int)timestamp, static_cast<ReplicaType>((unsigned char)body.data[pos++]));
+		entry.expiry = (int)expiry;
+		entry.flags = (unsigned char)body.data[pos++];
+		string name = key.toString();
+		if ( entry.flags & ENTRY_TOMBSTONE ) {
+			// A tombstone is restored as the delete of a value written just before it
+			Entry deleted = entry;
+			deleted.flags &= ~ENTRY_TOMBSTONE;
+			apply(owner, CREATE, name, deleted);
+			apply(owner, DELETE, name, entry);
+		}
+		else {
+			apply(owner, CREATE, name, entry);
+		}
+	}
+	munmap(mapping, size);
+	if ( ok ) {
+		mark = snapshotMark;
+	}
+	return ok;
+}
+
+/**
+ * FUNCTION NAME: writeFile
+ *
+ * DESCRIPTION: Writes every entry of the in memory shards of table to a temporary file,
+ * 				then renames it over the snapshot. Runs in the child, where nothing
+ * 				else touches the table.
+ *
+ * RETURNS:
+ * true on SUCCESS
+ * false on FAILURE
+ */
+bool Snapshot::writeFile(HashTable *table, uint64_t mark) {
+	string temporary = path() + ".tmp";
+	int fd = ::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if ( fd < 0 ) {
+		return false;
+	}
+	uint64_t count = 0;
+	for ( HashTable::iterator it = table->begin(); it != table->end(); ++it ) {
+		count++;
+	}
+
+	string buffer;
+	putUint32(buffer, SNAPSHOT_MAGIC);
+	putUint64(buffer, mark);
+	putUint64(buffer, count);
+	uint64_t sum = 0;
+	bool ok = true;
+	HashTable::iterator it = table->begin();
+	while ( ok ) {
+		bool last = !(it != table->end());
+		if ( !last ) {
+			Entry entry = it.entry();
+			putBytes(buffer, it.key());
+			putBytes(buffer, entry.value);
+			putUint32(buffer, (uint32_t)entry.timestamp);
+			putUint32(buffer, (uint32_t)entry.expiry);
+			buffer.push_back((char)entry.replica);
+			buffer.push_back((char)entry.flags);
+			++it;
+		}
+		// The checksum is folded one SNAPSHOT_WRITE_BUFFER at a time, the way load() reads it back
+		size_t ready = last ? buffer.size() : buffer.size() / SNAPSHOT_WRITE_BUFFER * SNAPSHOT_WRITE_BUFFER;
+		for ( size_t done = 0; done < ready; done += SNAPSHOT_WRITE_BUFFER ) {
+			addChecksum(sum, buffer.data() + done, min((size_t)SNAPSHOT_WRITE_BUFFER, ready - done));
+		}
+		if ( last ) {
+			putUint64(buffer, sum);
+			ready = buffer.size();
+		}
+		ok = write(fd, buffer.data(), ready) == (ssize_t)ready;
+		buffer.erase(0, ready);
+		if ( last ) {
+			break;
+		}
+	}
+
+	ok = ok && fdatasync(fd) == 0;
+	ok = close(fd) == 0 && ok;
+	if ( !ok || rename(temporary.c_str(), path().c_str()) != 0 ) {
+		unlink(temporary.c_str());
+		return false;
+	}
+	// Make the new file name durable
+	int dirFd = ::open(directory.c_str(), O_RDONLY);
+	if ( dirFd >= 0 ) {
+		fsync(dirFd);
+		close(dirFd);
+	}
+	return true;
+}
+
+/**
+ * FUNCTION NAME: start
+ *
+ * DESCRIPTION: Forks a child that writes a snapshot of table as it is now, covering the
+ * 				commit log up to mark. Does nothing while a snapshot is being written.
+ *
+ * RETURNS:
+ * true if a snapshot was started
+ * false otherwise
+ */
+bool Snapshot::start(HashTable *table, uint64_t mark) {
+	if ( writer != 0 ) {
+		return false;
+	}
+	pid_t child = fork();
+	if ( child < 0 ) {
+		return false;
+	}
+	if ( child == 0 ) {
+		// _exit, so that the child does not flush the stdio buffers of the parent
+		_exit(writeFile(table, mark) ? 0 : 1);
+	}
+	writer = child;
+	pendingMark = mark;
+	return true;
+}
+
+/**
+ * FUNCTION NAME: poll
+ *
+ * DESCRIPTION: Checks, without blocking, whether the child finished its snapshot
+ *
+ * RETURNS:
+ * true if a snapshot was completed since the last call, with mark set to its commit log mark
+ * false otherwise
+ */
+bool Snapshot::poll(uint64_t &mark) {
+	int status;
+	if ( writer == 0 || waitpid(writer, &status, WNOHANG) != writer ) {
+		return false;
+	}
+	writer = 0;
+	if ( !WIFEXITED(status) || WEXITSTATUS(status) != 0 ) {
+		return false;
+	}
+	mark = pendingMark;
+	return true;
+}
+
+/**
+ * FUNCTION NAME: running
+ *
+ * DESCRIPTION: Returns true while a snapshot is being written
+ */
+bool Snapshot::running() {
+	return writer != 0;
+}
@@ -0,0 +1,71 @@
+/**********************************
+ * FILE NAME: Snapshot.h
+ *
+ * DESCRIPTION: Header file of the Snapshot class
+ **********************************/
+
+#ifndef SNAPSHOT_H_
+#define SNAPSHOT_H_
+
+/**
+ * Header files
+ */
+#include "stdincludes.h"
+#include "HashTable.h"
+#include "CommitLog.h"
+#include <stdint.h>
+#include <sys/types.h>
+
+/*
+ * Macros
+ */
+// First 4 bytes of a snapshot file
+#define SNAPSHOT_MAGIC 0x4b56534e
+// Name of the snapshot file in the directory of the node
+#define SNAPSHOT_FILE "snapshot.db"
+// Bytes the writer buffers before writing them to the file
+#define SNAPSHOT_WRITE_BUFFER (1 << 20)
+
+/**
+ * CLASS NAME: Snapshot
+ *
+ * DESCRIPTION: Point in time copy of the in memory table of a node, kept in one file:
+ * 				magic, commit log mark, record count, the records, and a checksum
+ * 				of everything before it. A record is the key, the value, timestamp,
+ * 				expiry, replica and flags of one entry; tombstones are kept.
+ * 				start() forks a child that writes the table as it was at the fork,
+ * 				with the pages the node writes afterwards copied on write, so the
+ * 				node keeps serving while the snapshot is written. The child writes a
+ * 				temporary file and renames it over the snapshot once it is synced,
+ * 				so a crash leaves the previous snapshot in place.
+ * 				The mark is the first commit log segment the snapshot does not
+ * 				cover: on startup the snapshot is loaded, then only the segments
+ * 				from the mark on are replayed.
+ * 				load() maps the file and hands the records to the caller straight
+ * 				out of the mapping.
+ */
+class Snapshot {
+private:
+	string directory;
+	// Child writing the next snapshot, 0 when there is none
+	pid_t writer;
+	// Commit log mark of the snapshot the child is writing
+	uint64_t pendingMark;
+
+	string path();
+	static void addChecksum(uint64_t &sum, const char *data, size_t size);
+	bool writeFile(HashTable *table, uint64_t mark);
+
+	Snapshot(const Snapshot &anotherSnapshot);
+	Snapshot& operator =(const Snapshot &anotherSnapshot);
+
+public:
+	Snapshot(const string &directory);
+	bool load(CommitLog::ReplayFunction apply, void *owner, uint64_t &mark);
+	bool start(HashTable *table, uint64_t mark);
+	bool poll(uint64_t &mark);
+	bool running();
+	virtual ~Snapshot();
+};
+
+#endif /* SNAPSHOT_H_ */
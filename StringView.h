@@ -0,0 +1,71 @@
+/**********************************
+ * FILE NAME: StringView.h
+ *
+ * DESCRIPTION: Non owning view over a range of bytes
+ **********************************/
+
+#ifndef STRINGVIEW_H_
+#define STRINGVIEW_H_
+
+#include "stdincludes.h"
+#include <stdint.h>
+
+/**
+ * FUNCTION NAME: hashBytes
+ *
+ * DESCRIPTION: 64 bit hash of a byte range, 8 bytes at a time
+ */
+inline uint64_t hashBytes(const char *data, size_t size) {
+	const uint64_t mul = 0x9e3779b97f4a7c15ULL;
+	uint64_t hash = size * mul;
+	while ( size >= 8 ) {
+		uint64_t word;
+		memcpy(&word, data, sizeof(word));
+		hash = (hash ^ word) * mul;
+		hash ^= hash >> 29;
+		data += 8;
+		size -= 8;
+	}
+	if ( size > 0 ) {
+		uint64_t word = 0;
+		memcpy(&word, data, size);
+		hash = (hash ^ word) * mul;
+		hash ^= hash >> 29;
+	}
+	return hash;
+}
+
+/**
+ * CLASS NAME: StringView
+ *
+ * DESCRIPTION: A pointer and a length. The viewed bytes are owned elsewhere
+ * 				and must outlive the view.
+ */
+class StringView {
+public:
+	const char *data;
+	size_t size;
+
+	StringView(): data(""), size(0) {}
+	StringView(const char *data, size_t size): data(data), size(size) {}
+	StringView(const string &str): data(str.data()), size(str.size()) {}
+
+	bool empty() const {
+		return size == 0;
+	}
+	string toString() const {
+		return string(data, size);
+	}
+	bool operator ==(const StringView &another) const {
+		return size == another.size && memcmp(data, another.data, size) == 0;
+	}
+	bool operator !=(const StringView &another) const {
+		return !(*this == another);
+	}
+	bool operator <(const StringView &another) const {
+		int cmp = memcmp(data, another.data, min(size, another.size));
+		return cmp < 0 || (cmp == 0 && size < another.size);
+	}
+};
+
+#endif /* STRINGVIEW_H_ */
@@ -0,0 +1,130 @@
+/**********************************
+ * FILE NAME: TimerWheel.cpp
+ *
+ * DESCRIPTION: Definition of the TimerWheel class
+ **********************************/
+
+#include "TimerWheel.h"
+
+/**
+ * Constructor
+ */
+TimerWheel::TimerWheel(int now): now(now), count(0) {}
+
+/**
+ * Destructor
+ */
+TimerWheel::~TimerWheel() {}
+
+/**
+ * FUNCTION NAME: place
+ *
+ * DESCRIPTION: Puts a timer in the slot of the lowest level whose span covers its distance from now
+ */
+void TimerWheel::place(const Timer &timer) {
+	long long delta = (long long)timer.expiry - now;
+	if ( delta <= 0 ) {
+		due.push_back(timer);
+		return;
+	}
+	for ( int level = 0; level < TIMER_WHEEL_LEVELS; level++ ) {
+		if ( delta < (1LL << (TIMER_WHEEL_BITS * (level + 1))) ) {
+			slots[level][(timer.expiry >> (TIMER_WHEEL_BITS * level)) & TIMER_WHEEL_MASK].push_back(timer);
+			return;
+		}
+	}
+	overflow.push_back(timer);
+}
+
+/**
+ * FUNCTION NAME: cascade
+ *
+ * DESCRIPTION: Moves the timers of the current slot of a level down to the levels below
+ */
+void TimerWheel::cascade(int level) {
+	vector<Timer> moving;
+	moving.swap(slots[level][(now >> (TIMER_WHEEL_BITS * level)) & TIMER_WHEEL_MASK]);
+	for ( unsigned int i = 0; i < moving.size(); i++ ) {
+		place(moving[i]);
+	}
+}
+
+/**
+ * FUNCTION NAME: schedule
+ *
+ * DESCRIPTION: Arranges for key to be reported by the advance that reaches expiry
+ */
+void TimerWheel::schedule(const string &key, int expiry) {
+	Timer timer;
+	timer.key = key;
+	timer.expiry = expiry;
+	place(timer);
+	count++;
+}
+
+/**
+ * FUNCTION NAME: advance
+ *
+ * DESCRIPTION: Moves the wheel forward to time, one time unit at a time, and appends
+ * 				the keys of the timers that fired to expired
+ */
+void TimerWheel::advance(int time, vector<string> &expired) {
+	for ( unsigned int i = 0; i < due.size(); i++ ) {
+		expired.push_back(due[i].key);
+	}
+	count -= due.size();
+	due.clear();
+
+	while ( now < time && count > 0 ) {
+		now++;
+		// Cascade from the lowest level up, for as long as the time wraps a slot of the level
+		for ( int level = 1; level < TIMER_WHEEL_LEVELS && (now & ((1 << (TIMER_WHEEL_BITS * level)) - 1)) == 0; level++ ) {
+			cascade(level);
+		}
+		if ( (now & ((1 << (TIMER_WHEEL_BITS * TIMER_WHEEL_LEVELS)) - 1)) == 0 && !overflow.empty() ) {
+			vector<Timer> moving;
+			moving.swap(overflow);
+			for ( unsigned int i = 0; i < moving.size(); i++ ) {
+				place(moving[i]);
+			}
+		}
+		vector<Timer> &slot = slots[0][now & TIMER_WHEEL_MASK];
+		for ( unsigned int i = 0; i < slot.size(); i++ ) {
+			expired.push_back(slot[i].key);
+		}
+		count -= slot.size();
+		slot.clear();
+		// Timers cascaded to now
+		for ( unsigned int i = 0; i < due.size(); i++ ) {
+			expired.push_back(due[i].key);
+		}
+		count -= due.size();
+		due.clear();
+	}
+	now = max(now, time);
+}
+
+/**
+ * FUNCTION NAME: size
+ *
+ * DESCRIPTION: Returns the number of timers that have not fired yet
+ */
+unsigned long TimerWheel::size() {
+	return count;
+}
+
+/**
+ * FUNCTION NAME: clear
+ *
+ * DESCRIPTION: Drops every timer
+ */
+void TimerWheel::clear() {
+	for ( int level = 0; level < TIMER_WHEEL_LEVELS; level++ ) {
+		for ( int slot = 0; slot < TIMER_WHEEL_SLOTS; slot++ ) {
+			slots[level][slot].clear();
+		}
+	}
+	overflow.clear();
+	due.clear();
+	count = 0;
+}
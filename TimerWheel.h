@@ -0,0 +1,71 @@
+/**********************************
+ * FILE NAME: TimerWheel.h
+ *
+ * DESCRIPTION: Header file of the TimerWheel class
+ **********************************/
+
+#ifndef TIMERWHEEL_H_
+#define TIMERWHEEL_H_
+
+/**
+ * Header files
+ */
+#include "stdincludes.h"
+
+/*
+ * Macros
+ */
+// Every level of the wheel has 2^TIMER_WHEEL_BITS slots
+#define TIMER_WHEEL_BITS 6
+#define TIMER_WHEEL_SLOTS (1 << TIMER_WHEEL_BITS)
+#define TIMER_WHEEL_MASK (TIMER_WHEEL_SLOTS - 1)
+// Levels cover 2^(TIMER_WHEEL_BITS * TIMER_WHEEL_LEVELS) time units, later timers wait in an overflow list
+#define TIMER_WHEEL_LEVELS 4
+
+/**
+ * STRUCT NAME: Timer
+ *
+ * DESCRIPTION: A key and the time it expires at
+ */
+typedef struct Timer {
+	string key;
+	int expiry;
+}Timer;
+
+/**
+ * CLASS NAME: TimerWheel
+ *
+ * DESCRIPTION: Hierarchical timing wheel of key expiries, driven by the simulated time.
+ * 				Level 0 has one slot per time unit of the next TIMER_WHEEL_SLOTS
+ * 				units; each level above has one slot per slot span of the level below.
+ * 				When the time wraps a slot of a level, the timers of the next slot of
+ * 				the level above cascade down to where they belong now. Scheduling
+ * 				and expiring a timer cost O(1), and every timer cascades at most
+ * 				TIMER_WHEEL_LEVELS - 1 times.
+ * 				Timers cannot be cancelled: the owner checks that a key has not been
+ * 				rewritten since when its timer fires.
+ */
+class TimerWheel {
+private:
+	vector<Timer> slots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+	// Timers beyond the reach of the top level
+	vector<Timer> overflow;
+	// Timers scheduled in the past, fired by the next advance
+	vector<Timer> due;
+	// Last time unit processed
+	int now;
+	unsigned long count;
+
+	void place(const Timer &timer);
+	void cascade(int level);
+
+public:
+	TimerWheel(int now = 0);
+	void schedule(const string &key, int expiry);
+	void advance(int time, vector<string> &expired);
+	unsigned long size();
+	void clear();
+	virtual ~TimerWheel();
+};
+
+#endif /* TIMERWHEEL_H_ */
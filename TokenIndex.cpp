@@ -0,0 +1,180 @@
+/**********************************
+ * FILE NAME: TokenIndex.cpp
+ *
+ * DESCRIPTION: Definition of the TokenIndex class
+ **********************************/
+
+#include "TokenIndex.h"
+
+/**
+ * STRUCT NAME: TokenOrder
+ *
+ * DESCRIPTION: Orders entries by replica type, then ring token, ignoring the key
+ */
+struct TokenOrder {
+	bool operator()(const IndexEntry &entry, const IndexEntry &bound) const {
+		if ( entry.replica != bound.replica ) {
+			return entry.replica < bound.replica;
+		}
+		return entry.token < bound.token;
+	}
+};
+
+/**
+ * STRUCT NAME: KeyOrder
+ *
+ * DESCRIPTION: Orders entries by replica type, ring token and key, resolving keys through the index
+ */
+struct KeyOrder {
+	const TokenIndex *index;
+
+	explicit KeyOrder(const TokenIndex *index): index(index) {}
+	bool operator()(const IndexEntry &entry, const IndexEntry &another) const {
+		if ( entry.replica != another.replica ) {
+			return entry.replica < another.replica;
+		}
+		if ( entry.token != another.token ) {
+			return entry.token < another.token;
+		}
+		return index->key(entry) < index->key(another);
+	}
+};
+
+/**
+ * Constructor
+ */
+TokenIndex::TokenIndex(KeyFunction keyOf, const void *owner): keyOf(keyOf), owner(owner) {}
+
+/**
+ * Destructor
+ */
+TokenIndex::~TokenIndex() {}
+
+/**
+ * FUNCTION NAME: position
+ *
+ * DESCRIPTION: Returns the first entry that does not sort before (replica, token, key)
+ */
+vector<IndexEntry>::iterator TokenIndex::position(unsigned char replica, uint32_t token, const StringView &key) {
+	IndexEntry bound;
+	bound.replica = replica;
+	bound.token = token;
+	vector<IndexEntry>::iterator it = lower_bound(entries.begin(), entries.end(), bound, TokenOrder());
+	// Keys only break ties between entries of the same token, which are few
+	while ( it != entries.end() && it->replica == replica && it->token == token && this->key(*it) < key ) {
+		++it;
+	}
+	return it;
+}
+
+/**
+ * FUNCTION NAME: insert
+ *
+ * DESCRIPTION: Adds the key the owner stores under ref, held as the given replica type at the given ring token
+ */
+void TokenIndex::insert(unsigned char replica, uint32_t token, uint32_t ref) {
+	IndexEntry entry;
+	entry.replica = replica;
+	entry.token = token;
+	entry.ref = ref;
+	entries.insert(position(replica, token, key(entry)), entry);
+}
+
+/**
+ * FUNCTION NAME: erase
+ *
+ * DESCRIPTION: Removes key, held as the given replica type at the given ring token
+ *
+ * RETURNS:
+ * true, with the ref the key was indexed under, if the key was found
+ * false otherwise
+ */
+bool TokenIndex::erase(unsigned char replica, uint32_t token, const StringView &key, uint32_t &ref) {
+	vector<IndexEntry>::iterator it = position(replica, token, key);
+	if ( it == entries.end() || it->replica != replica || it->token != token || this->key(*it) != key ) {
+		return false;
+	}
+	ref = it->ref;
+	entries.erase(it);
+	return true;
+}
+
+/**
+ * FUNCTION NAME: rebuild
+ *
+ * DESCRIPTION: Replaces every entry with the given ones, in any order. unsorted is left empty.
+ */
+void TokenIndex::rebuild(vector<IndexEntry> &unsorted) {
+	sort(unsorted.begin(), unsorted.end(), KeyOrder(this));
+	entries.swap(unsorted);
+	unsorted.clear();
+}
+
+/**
+ * FUNCTION NAME: key
+ *
+ * DESCRIPTION: Returns the key of an entry, as stored by the owner of the index
+ */
+StringView TokenIndex::key(const IndexEntry &entry) const {
+	return keyOf(owner, entry.ref);
+}
+
+/**
+ * FUNCTION NAME: lowerBound
+ *
+ * DESCRIPTION: Returns the first key of the replica type at or after token
+ */
+TokenIndex::iterator TokenIndex::lowerBound(unsigned char replica, uint32_t token) const {
+	IndexEntry bound;
+	bound.replica = replica;
+	bound.token = token;
+	return lower_bound(entries.begin(), entries.end(), bound, TokenOrder());
+}
+
+/**
+ * FUNCTION NAME: upperBound
+ *
+ * DESCRIPTION: Returns the first entry past the keys of the replica type at or before token
+ */
+TokenIndex::iterator TokenIndex::upperBound(unsigned char replica, uint32_t token) const {
+	IndexEntry bound;
+	bound.replica = replica;
+	bound.token = token;
+	return upper_bound(entries.begin(), entries.end(), bound, TokenOrder());
+}
+
+/**
+ * FUNCTION NAME: end
+ *
+ * DESCRIPTION: Returns the past the end iterator
+ */
+TokenIndex::iterator TokenIndex::end() const {
+	return entries.end();
+}
+
+/**
+ * FUNCTION NAME: clear
+ *
+ * DESCRIPTION: Removes every key
+ */
+void TokenIndex::clear() {
+	vector<IndexEntry>().swap(entries);
+}
+
+/**
+ * FUNCTION NAME: size
+ *
+ * DESCRIPTION: Returns the number of keys in the index
+ */
+unsigned long TokenIndex::size() const {
+	return (unsigned long)entries.size();
+}
+
+/**
+ * FUNCTION NAME: memoryUsage
+ *
+ * DESCRIPTION: Returns the bytes of the entries. The keys are accounted for by the owner.
+ */
+size_t TokenIndex::memoryUsage() const {
+	return entries.size() * sizeof(IndexEntry);
+}
@@ -0,0 +1,72 @@
+/**********************************
+ * FILE NAME: TokenIndex.h
+ *
+ * DESCRIPTION: Header file of the TokenIndex class
+ **********************************/
+
+#ifndef TOKENINDEX_H_
+#define TOKENINDEX_H_
+
+/**
+ * Header files
+ */
+#include "stdincludes.h"
+#include <stdint.h>
+#include "StringView.h"
+
+/**
+ * STRUCT NAME: IndexEntry
+ *
+ * DESCRIPTION: One key of the index. The key itself stays with the owner of the index,
+ * 				which resolves ref to it (see TokenIndex::KeyFunction).
+ */
+typedef struct IndexEntry {
+	unsigned char replica;
+	uint32_t token;
+	uint32_t ref;
+}IndexEntry;
+
+/**
+ * CLASS NAME: TokenIndex
+ *
+ * DESCRIPTION: Secondary index of a storage engine shard, ordered by (ReplicaType, ring token, key).
+ * 				All the keys a node holds as one replica type in a token range are
+ * 				adjacent, so they can be streamed without looking at any other key.
+ * 				Entries are kept in one sorted vector and do not copy their key:
+ * 				the owner hands out a ref to the key it already stores, and the
+ * 				index asks the KeyFunction for the key bytes when it has to order
+ * 				two entries of the same token. A write moves the entries after
+ * 				it, which costs less than a tree node per key for the shard sizes
+ * 				the engine runs with. Any write invalidates the iterators.
+ */
+class TokenIndex {
+public:
+	// Returns the key the owner of the index stores under ref
+	typedef StringView (*KeyFunction)(const void *owner, uint32_t ref);
+	typedef vector<IndexEntry>::const_iterator iterator;
+
+private:
+	vector<IndexEntry> entries;
+	KeyFunction keyOf;
+	const void *owner;
+	vector<IndexEntry>::iterator position(unsigned char replica, uint32_t token, const StringView &key);
+
+	TokenIndex(const TokenIndex &anotherIndex);
+	TokenIndex& operator =(const TokenIndex &anotherIndex);
+
+public:
+	TokenIndex(KeyFunction keyOf, const void *owner);
+	void insert(unsigned char replica, uint32_t token, uint32_t ref);
+	bool erase(unsigned char replica, uint32_t token, const StringView &key, uint32_t &ref);
+	void rebuild(vector<IndexEntry> &unsorted);
+	StringView key(const IndexEntry &entry) const;
+	iterator lowerBound(unsigned char replica, uint32_t token) const;
+	iterator upperBound(unsigned char replica, uint32_t token) const;
+	iterator end() const;
+	void clear();
+	unsigned long size() const;
+	size_t memoryUsage() const;
+	virtual ~TokenIndex();
+};
+
+#endif /* TOKENINDEX_H_ */
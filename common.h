@@ -1,6 +1,8 @@
 #ifndef COMMON_H_
 #define COMMON_H_
 
+#include <stddef.h>
+
 /**
  * Global variable
  */
@@ -8,8 +10,26 @@
 static int g_transID = 0;
 
 // message types, reply is the message from node to coordinator
-enum MessageType {CREATE, READ, UPDATE, DELETE, REPLY, READREPLY};
+enum MessageType {CREATE, READ, UPDATE, DELETE, REPLY, READREPLY, SCAN, SCANREPLY, MERKLE, MERKLEDIFF, REPAIR};
 // enum of replica types
 enum ReplicaType {PRIMARY, SECONDARY, TERTIARY};
+// status carried by a reply, FULL when the replica refused a write over its memory cap
+enum ReplyStatus {REPLY_FAILURE, REPLY_SUCCESS, REPLY_FULL};
+
+/**
+ * STRUCT NAME: MemoryUsage
+ *
+ * DESCRIPTION: Bytes of memory a storage engine holds, by what they are used for
+ */
+typedef struct MemoryUsage {
+	size_t keyBytes;
+	size_t valueBytes;
+	// Hash table slots, indexes, caches and allocator slack
+	size_t metadataBytes;
+
+	size_t total() const {
+		return keyBytes + valueBytes + metadataBytes;
+	}
+}MemoryUsage;
 
 #endif